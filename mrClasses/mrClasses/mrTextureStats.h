@@ -28,6 +28,18 @@ BEGIN_NAMESPACE( mr )
     miUlong numTextureMisses;
     //! The number of texture accesses
     miUlong numTextureAccesses;
+    //! The number of texture blocks found in memory
+    miUlong numTextureHits;
+    //! The number of texture blocks evicted from memory
+    miUlong textureEvictions;
+    //! The number of texture blocks loaded ahead of being needed
+    miUlong texturePrefetches;
+    //! The number of prefetched texture blocks that were later used
+    miUlong texturePrefetchHits;
+    //! The number of prefetch requests dropped as the queue was full
+    miUlong texturePrefetchDropped;
+    //! The maximum number of blocks waiting to be prefetched
+    miUlong peakPrefetchQueue;
     //! The total amount of texture data transmitted 
     miUlong transferredTextureData;
     //! The current number of textures
@@ -49,6 +61,12 @@ BEGIN_NAMESPACE( mr )
       numTextures = 0;
       numTextureMisses = 0;
       numTextureAccesses = 0;
+      numTextureHits = 0;
+      textureEvictions = 0;
+      texturePrefetches = 0;
+      texturePrefetchHits = 0;
+      texturePrefetchDropped = 0;
+      peakPrefetchQueue = 0;
       transferredTextureData = 0;
       numPeakTextures = 0;
       peakTextureMemory = 0;
@@ -83,7 +101,17 @@ BEGIN_NAMESPACE( mr )
       mi_info("Texture Flushes:      % 12u", textureFlushes);
       mi_info("Peak Textures #:      % 12u", numPeakTextures);
       mi_info("Texture Accesses:     % 12u", numTextureAccesses);
+      mi_info("Texture Block Hits:   % 12u", numTextureHits);
       mi_info("Texture Block Misses: % 12u", misses);
+      mi_info("Texture Evictions:    % 12u", textureEvictions);
+      if ( texturePrefetches > 0 )
+	{
+	  mi_info("Prefetched Blocks:    % 12u", texturePrefetches);
+	  mi_info("Prefetch Hit Rate:    % 12.2f %%",
+		  100.0 * texturePrefetchHits / texturePrefetches);
+	  mi_info("Prefetch Queue Peak:  % 12u", peakPrefetchQueue);
+	  mi_info("Prefetches Dropped:   % 12u", texturePrefetchDropped);
+	}
       mi_info("--------------------------------------------------------");
       if ( numTextureAccesses == 0 ) return;
 
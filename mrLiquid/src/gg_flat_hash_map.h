@@ -0,0 +1,301 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+#ifndef gg_flat_hash_map_h
+#define gg_flat_hash_map_h
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace stdext
+{
+
+  //
+  // Open addressing (linear probing) hash table with the same interface
+  // as hash_multimap in gg_hash_map.h.  Each bucket keeps the full hash
+  // next to the data pointer, so probing rarely needs to touch the data
+  // itself.  Hash values 0 and 1 are reserved to mark empty and erased
+  // buckets.
+  //
+  // Erasing leaves a tombstone behind and never moves other buckets,
+  // so erasing elements while iterating the table is safe.  Inserting
+  // may rehash the table and invalidates all iterators.
+  //
+  template< typename K, typename D >
+  class flat_hash_multimap
+  {
+  public:
+    typedef size_t hash_key;
+
+    typedef K key_type;
+    typedef typename std::pair< const K, D > value_type;
+
+    struct bucket
+    {
+      hash_key first;
+      D        second;
+    };
+
+  protected:
+    enum {
+      kEmpty   = 0,
+      kDeleted = 1
+    };
+
+    typedef std::vector< bucket > BucketList;
+
+    BucketList _v;
+    size_t     _mask;
+    size_t     _size;
+    size_t     _deleted;
+
+    static inline hash_key fix_hash( hash_key h )
+    {
+      return h < 2 ? h + 2 : h;
+    }
+
+    // The low bits of SDBM hashes of similar names (like maya's dag
+    // paths) are poorly distributed, so mix them before picking the
+    // home bucket.
+    inline size_t home( hash_key h ) const
+    {
+      h ^= h >> 16;
+      h *= (size_t) 0x9E3779B97F4A7C15ULL;
+      h ^= h >> 15;
+      return h & _mask;
+    }
+
+    inline void rehash( size_t buckets )
+    {
+      BucketList old;
+      old.swap( _v );
+      bucket empty = { kEmpty, D() };
+      _v.resize( buckets, empty );
+      _mask    = buckets - 1;
+      _deleted = 0;
+
+      typename BucketList::const_iterator i = old.begin();
+      typename BucketList::const_iterator e = old.end();
+      for ( ; i != e; ++i )
+      {
+	if ( i->first < 2 ) continue;
+	size_t idx = home( i->first );
+	while ( _v[idx].first != kEmpty ) idx = (idx + 1) & _mask;
+	_v[idx] = *i;
+      }
+    }
+
+  public:
+
+    template< typename B >
+    class iterator_base
+    {
+      B* _b;
+      B* _e;
+
+      inline void skip()
+      {
+	while ( _b != _e && _b->first < 2 ) ++_b;
+      }
+
+    public:
+      inline iterator_base() : _b(NULL), _e(NULL) {}
+      inline iterator_base( B* b, B* e ) : _b(b), _e(e) { skip(); }
+
+      template< typename O >
+      inline iterator_base( const iterator_base< O >& o ) :
+      _b( o.bucket_ptr() ), _e( o.end_ptr() ) {}
+
+      inline B* bucket_ptr() const { return _b; }
+      inline B* end_ptr() const    { return _e; }
+
+      inline B& operator*() const  { return *_b; }
+      inline B* operator->() const { return _b; }
+
+      inline iterator_base& operator++()
+      {
+	++_b; skip(); return *this;
+      }
+
+      inline iterator_base operator++(int)
+      {
+	iterator_base t( *this ); ++_b; skip(); return t;
+      }
+
+      template< typename O >
+      inline bool operator==( const iterator_base< O >& o ) const
+      {
+	return _b == o.bucket_ptr();
+      }
+
+      template< typename O >
+      inline bool operator!=( const iterator_base< O >& o ) const
+      {
+	return _b != o.bucket_ptr();
+      }
+    };
+
+    typedef iterator_base< bucket >        iterator;
+    typedef iterator_base< const bucket >  const_iterator;
+
+    inline explicit flat_hash_multimap() :
+    _mask(0),
+    _size(0),
+    _deleted(0)
+    {
+    }
+
+    inline ~flat_hash_multimap()
+    {
+    }
+
+    inline void clear()
+    {
+      BucketList empty;
+      _v.swap( empty );
+      _mask    = 0;
+      _size    = 0;
+      _deleted = 0;
+    }
+
+    inline void reserve( size_t n )
+    {
+      size_t buckets = 16;
+      while ( buckets * 3 < n * 4 ) buckets <<= 1;
+      if ( buckets > _v.size() ) rehash( buckets );
+    }
+
+    inline iterator begin()
+    {
+      if ( _v.empty() ) return iterator();
+      bucket* b = &_v[0];
+      return iterator( b, b + _v.size() );
+    }
+
+    inline const_iterator begin() const
+    {
+      if ( _v.empty() ) return const_iterator();
+      const bucket* b = &_v[0];
+      return const_iterator( b, b + _v.size() );
+    }
+     
+    inline iterator end()
+    {
+      if ( _v.empty() ) return iterator();
+      bucket* b = &_v[0] + _v.size();
+      return iterator( b, b );
+    }
+
+    inline const_iterator end() const
+    {
+      if ( _v.empty() ) return const_iterator();
+      const bucket* b = &_v[0] + _v.size();
+      return const_iterator( b, b );
+    }
+
+    inline size_t   size() const
+    {
+      return _size;
+    }
+
+    //
+    // Find first element with hash k whose data satisfies pred.
+    //
+    template< typename P >
+    inline iterator find( hash_key k, const P& pred )
+    {
+      if ( _size == 0 ) return end();
+
+      k = fix_hash( k );
+      size_t idx = home( k );
+      for (;;)
+      {
+	bucket& b = _v[idx];
+	if ( b.first == kEmpty ) return end();
+	if ( b.first == k && pred( b.second ) )
+	  return iterator( &b, &_v[0] + _v.size() );
+	idx = (idx + 1) & _mask;
+      }
+    }
+
+    //
+    // Insert a new element.  This may rehash the table, which
+    // invalidates all iterators (unlike the std::multimap backend).
+    // Do not insert while iterating.
+    //
+    inline iterator insert( const value_type& v )
+    {
+      // Keep load (including tombstones) under 75%.  If it is mostly
+      // tombstones, just clean them up instead of growing.
+      size_t cap = _v.size();
+      if ( (_size + _deleted + 1) * 4 > cap * 3 )
+      {
+	if ( cap == 0 )                         rehash( 16 );
+	else if ( (_size + 1) * 2 > cap )       rehash( cap * 2 );
+	else                                    rehash( cap );
+      }
+
+      hash_key k = fix_hash( HashFunctor()( v.first ) );
+      size_t idx = home( k );
+      while ( _v[idx].first >= 2 ) idx = (idx + 1) & _mask;
+
+      bucket& b = _v[idx];
+      if ( b.first == kDeleted ) --_deleted;
+      b.first  = k;
+      b.second = v.second;
+      ++_size;
+      return iterator( &b, &_v[0] + _v.size() );
+    }
+
+    inline void erase( const iterator& i )
+    {
+      bucket* b = i.bucket_ptr();
+      b->first  = kDeleted;
+      b->second = D();
+      --_size;
+      ++_deleted;
+    }
+
+    inline void erase( iterator start, const iterator& end )
+    {
+      while ( start != end )
+      {
+	iterator i = start; ++start;
+	erase( i );
+      }
+    }
+
+  };
+
+}
+
+
+#endif // gg_flat_hash_map_h
@@ -45,6 +45,10 @@
 #include "mrOptions.h" 
 #endif
 
+#ifndef mrShardedExport_h
+#include "mrShardedExport.h"
+#endif
+
 
 mrTranslator* mentalCmd::translator = NULL;
 
@@ -85,6 +89,7 @@ MSyntax mentalCmd::newSyntax()
    syntax.addFlag("ai",  "addIncludes",    MSyntax::kString);
    syntax.addFlag("al",  "addLinks",    MSyntax::kString);
 
+   syntax.addFlag("bf",  "byFrame",     MSyntax::kLong);
    syntax.addFlag("bin", "binary");  // DONE
 
    syntax.addFlag("cam", "camera",      MSyntax::kString ); //DONE
@@ -126,6 +131,7 @@ MSyntax mentalCmd::newSyntax()
    syntax.addFlag("pad", "padframe",  MSyntax::kUnsigned ); // DONE
    syntax.addFlag("par", "particlesDir",    MSyntax::kString); // DONE
    syntax.addFlag("pf",  "perframe",  MSyntax::kUnsigned ); // DONE
+   syntax.addFlag("prf", "profile",  MSyntax::kString );
    syntax.addFlag("pfi", "perframeIPR"); // DONE
    syntax.addFlag("phm", "phmapDir",    MSyntax::kString); // DONE
    syntax.addFlag("prj", "project",    MSyntax::kString);  // DONE
@@ -161,6 +167,7 @@ MSyntax mentalCmd::newSyntax()
    syntax.addFlag("xf",  "exportFilter",    MSyntax::kLong); //DONE
    syntax.addFlag("xfs", "exportFilterString",    MSyntax::kString); //DONE
    syntax.addFlag("xp",  "exportPathNames",    MSyntax::kString);
+   syntax.addFlag("xpr", "exportProcesses",    MSyntax::kUnsigned);
    syntax.addFlag("xsf", "exportStartFile"); // DONE
    syntax.addFlag("y",   "yResolution", MSyntax::kUnsigned ); //DONE
 
@@ -203,7 +210,12 @@ MStatus mentalCmd::doIt(const MArgList& args)
       return MS::kFailure;
    }
 
-   return translator->parseArgs( a );
+   // Flags to pass on to worker processes, if export is split among
+   // several of them.
+   MString shardArgs;
+   if ( a.isFlagSet("exportProcesses") ) shardArgs = mr_shard_args( args );
+
+   return translator->parseArgs( a, shardArgs );
 }
 
 
@@ -0,0 +1,148 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <maya/MArgList.h>
+#include <maya/MSyntax.h>
+#include <maya/MArgDatabase.h>
+
+#include "mrIO.h"
+#include "mrIPRLatency.h"
+
+#ifndef mentalIPRStatsCmd_h
+#include "mentalIPRStatsCmd.h"
+#endif
+
+
+
+
+// CONSTRUCTOR DEFINITION:
+mentalIPRStatsCmd::mentalIPRStatsCmd() 
+{
+}
+
+// DESTRUCTOR DEFINITION:
+mentalIPRStatsCmd::~mentalIPRStatsCmd()
+{
+}
+
+
+// METHOD FOR CREATING AN INSTANCE OF THIS COMMAND:
+void* mentalIPRStatsCmd::creator()
+{
+   return new mentalIPRStatsCmd;
+}
+
+
+// CREATES THE SYNTAX OBJECT FOR THE COMMAND:Synopsis:
+// mentalIPRStats [-reset] [-log file] [-stage name -percentile p]
+MSyntax mentalIPRStatsCmd::newSyntax()
+{
+   MSyntax syntax;
+
+   syntax.addFlag("r",  "reset" );
+   syntax.addFlag("l",  "log", MSyntax::kString );
+   syntax.addFlag("s",  "stage", MSyntax::kString );
+   syntax.addFlag("p",  "percentile", MSyntax::kDouble );
+
+   // MAKE COMMAND NON QUERYABLE AND NON-EDITABLE:
+   syntax.enableQuery(false);
+   syntax.enableEdit(false);
+
+   return syntax;
+}
+
+
+// MAKE THIS COMMAND UNDOABLE:
+bool mentalIPRStatsCmd::isUndoable() const
+{
+   return false;
+}
+
+
+// PARSE THE COMMAND'S FLAGS AND ARGUMENTS
+//
+// With -percentile, returns that percentile (in ms) of the IPR latency
+// of -stage (wait, update, write, flush, render or total, which is the
+// default).  Otherwise, prints and returns a line per stage with its
+// p50, p90, p99 and max.
+MStatus mentalIPRStatsCmd::doIt(const MArgList& args)
+{
+   MArgDatabase a( syntax(), args );
+
+   if ( a.isFlagSet( "reset" ) )
+   {
+      mrIPRLatency::reset();
+   }
+
+   if ( a.isFlagSet( "log" ) )
+   {
+      MString file;
+      a.getFlagArgument( "log", 0, file );
+      if ( ! mrIPRLatency::log( file ) )
+      {
+	 LOG_ERROR("mentalIPRStats: could not open \"" + file + "\"");
+	 return MS::kFailure;
+      }
+      if ( file.length() > 0 )
+	 LOG_MESSAGE("mentalIPRStats: logging IPR latency to \"" + 
+		     file + "\"");
+   }
+
+   if ( a.isFlagSet( "percentile" ) )
+   {
+      double p;
+      a.getFlagArgument( "percentile", 0, p );
+
+      MString stage = "total";
+      if ( a.isFlagSet( "stage" ) )
+	 a.getFlagArgument( "stage", 0, stage );
+
+      mrIPRLatency::Interval i = mrIPRLatency::interval( stage );
+      if ( i == mrIPRLatency::kNumIntervals )
+      {
+	 LOG_ERROR("mentalIPRStats: unknown stage \"" + stage + "\"");
+	 return MS::kFailure;
+      }
+
+      setResult( mrIPRLatency::percentile( i, p ) );
+      return MS::kSuccess;
+   }
+
+   if ( a.isFlagSet( "reset" ) || a.isFlagSet( "log" ) )
+      return MS::kSuccess;
+
+   MStringArray lines = mrIPRLatency::report();
+   unsigned num = lines.length();
+   for ( unsigned i = 0; i < num; ++i )
+      LOG_MESSAGE( lines[i] );
+   setResult( lines );
+   return MS::kSuccess;
+}
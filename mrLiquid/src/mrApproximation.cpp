@@ -480,6 +480,7 @@ void mrApproximation::mrayApproximation()
 // Constructor for mental ray approximation
 void mrApproximation::getData( bool sameFrame )
 {
+   MRL_PROFILE( kGetData );
    approxString.clear();
    animated = MAnimUtil::isAnimated( nodeHandle.objectRef() );
    if ( maya )   mayaApproximation();
@@ -35,10 +35,27 @@
 
 #if defined(WIN32) || defined(WIN64)
 #include <windows.h>  // for htonl, etc.
+#include <stdlib.h>   // for _byteswap_*
 #else
 #include <netinet/in.h>
 #endif
 
+#include <cstddef>
+#include <cstring>
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#  define MR_BYTESWAP_AVX2
+#  define MR_BYTESWAP_SSSE3
+#elif defined(__SSSE3__)
+#  include <tmmintrin.h>
+#  define MR_BYTESWAP_SSSE3
+#elif defined(__SSE2__) || defined(_M_X64) || \
+      ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#  include <emmintrin.h>
+#  define MR_BYTESWAP_SSE2
+#endif
+
 
 //! Swap a double between network and host byte-order
 inline double ByteSwap( double f )
@@ -79,10 +96,198 @@ inline float ByteSwap( float f )
 }
 
 
+//
+// Bulk swapping of arrays of 2, 4 or 8 byte elements.
+//
+// Arrays are swapped 32 bytes at a time with AVX2, 16 at a time with
+// SSSE3 (pshufb) or SSE2 (shifts and shuffles), depending on what the
+// compiler targets, and the remainder one element at a time.
+//
+
+//! Swap a single element of size bytes from s into d (which can be s).
+inline void ByteSwapElement( char* d, const char* s, const size_t size )
+{
+  switch( size )
+  {
+     case 2:
+	{
+	  unsigned short x;
+	  memcpy( &x, s, 2 );
+	  x = (unsigned short)( ( x >> 8 ) | ( x << 8 ) );
+	  memcpy( d, &x, 2 );
+	  break;
+	}
+     case 4:
+	{
+	  unsigned int x;
+	  memcpy( &x, s, 4 );
+#if defined(_MSC_VER)
+	  x = _byteswap_ulong( x );
+#elif defined(__GNUC__)
+	  x = __builtin_bswap32( x );
+#else
+	  x = ( ( x >> 24 ) | ( ( x >> 8 ) & 0xFF00 ) |
+		( ( x << 8 ) & 0xFF0000 ) | ( x << 24 ) );
+#endif
+	  memcpy( d, &x, 4 );
+	  break;
+	}
+     case 8:
+	{
+#if defined(_MSC_VER) || defined(__GNUC__)
+	  unsigned long long x;
+	  memcpy( &x, s, 8 );
+#  if defined(_MSC_VER)
+	  x = _byteswap_uint64( x );
+#  else
+	  x = __builtin_bswap64( x );
+#  endif
+	  memcpy( d, &x, 8 );
+#else
+	  char t[8];
+	  for ( int i = 0; i < 8; ++i ) t[i] = s[7-i];
+	  memcpy( d, t, 8 );
+#endif
+	  break;
+	}
+  }
+}
+
+#ifdef MR_BYTESWAP_SSSE3
+//! pshufb mask reversing each element of size bytes
+inline __m128i ByteSwapMask( const size_t size )
+{
+  switch( size )
+  {
+     case 2:
+	return _mm_setr_epi8( 1, 0, 3, 2, 5, 4, 7, 6,
+			      9, 8, 11, 10, 13, 12, 15, 14 );
+     case 4:
+	return _mm_setr_epi8( 3, 2, 1, 0, 7, 6, 5, 4,
+			      11, 10, 9, 8, 15, 14, 13, 12 );
+     default:
+	return _mm_setr_epi8( 7, 6, 5, 4, 3, 2, 1, 0,
+			      15, 14, 13, 12, 11, 10, 9, 8 );
+  }
+}
+#endif
+
+#ifdef MR_BYTESWAP_SSE2
+//! Reverse each element of size bytes in v
+inline __m128i ByteSwapSSE2( __m128i v, const size_t size )
+{
+  if ( size == 8 ) v = _mm_shuffle_epi32( v, _MM_SHUFFLE(2, 3, 0, 1) );
+  if ( size >= 4 )
+  {
+     v = _mm_shufflelo_epi16( v, _MM_SHUFFLE(2, 3, 0, 1) );
+     v = _mm_shufflehi_epi16( v, _MM_SHUFFLE(2, 3, 0, 1) );
+  }
+  return _mm_or_si128( _mm_slli_epi16( v, 8 ), _mm_srli_epi16( v, 8 ) );
+}
+#endif
+
+
+/** 
+ * Swap the byte order of num elements of size bytes (2, 4 or 8).
+ * dst can be the same as src to swap in place, but the arrays must not
+ * otherwise overlap.
+ * 
+ * @param dst   destination array
+ * @param src   source array
+ * @param num   number of elements
+ * @param size  size of each element in bytes
+ */
+inline void ByteSwapBlock( void* dst, const void* src, const size_t num,
+			   const size_t size )
+{
+  char*       d = static_cast< char* >( dst );
+  const char* s = static_cast< const char* >( src );
+  size_t bytes  = num * size;
+  const char* e = s + bytes;
+
+#ifdef MR_BYTESWAP_AVX2
+  {
+    const __m128i m = ByteSwapMask( size );
+    const __m256i mask = _mm256_inserti128_si256( _mm256_castsi128_si256(m),
+						  m, 1 );
+    for ( ; e - s >= 32; s += 32, d += 32 )
+    {
+      __m256i v = _mm256_loadu_si256( (const __m256i*) s );
+      _mm256_storeu_si256( (__m256i*) d, _mm256_shuffle_epi8( v, mask ) );
+    }
+  }
+#endif
+#ifdef MR_BYTESWAP_SSSE3
+  {
+    const __m128i mask = ByteSwapMask( size );
+    for ( ; e - s >= 16; s += 16, d += 16 )
+    {
+      __m128i v = _mm_loadu_si128( (const __m128i*) s );
+      _mm_storeu_si128( (__m128i*) d, _mm_shuffle_epi8( v, mask ) );
+    }
+  }
+#elif defined(MR_BYTESWAP_SSE2)
+  for ( ; e - s >= 16; s += 16, d += 16 )
+  {
+    __m128i v = _mm_loadu_si128( (const __m128i*) s );
+    _mm_storeu_si128( (__m128i*) d, ByteSwapSSE2( v, size ) );
+  }
+#endif
+
+  for ( ; s < e; s += size, d += size )
+    ByteSwapElement( d, s, size );
+}
+
+
+//! Swap an array of floats between network and host byte-order
+inline void ByteSwapArray( float* p, size_t num )
+{
+  ByteSwapBlock( p, p, num, sizeof(float) );
+}
+
+//! Swap an array of doubles between network and host byte-order
+inline void ByteSwapArray( double* p, size_t num )
+{
+  ByteSwapBlock( p, p, num, sizeof(double) );
+}
+
+//! Swap an array of 32-bit ints between network and host byte-order
+inline void ByteSwapArray( unsigned* p, size_t num )
+{
+  ByteSwapBlock( p, p, num, sizeof(unsigned) );
+}
+
+inline void ByteSwapArray( int* p, size_t num )
+{
+  ByteSwapBlock( p, p, num, sizeof(int) );
+}
+
+//! Swap an array of 16-bit ints between network and host byte-order
+inline void ByteSwapArray( unsigned short* p, size_t num )
+{
+  ByteSwapBlock( p, p, num, sizeof(unsigned short) );
+}
+
+inline void ByteSwapArray( short* p, size_t num )
+{
+  ByteSwapBlock( p, p, num, sizeof(short) );
+}
+
+//! Copy an array of num elements from src into dst, swapping their
+//! byte order.
+template< typename T >
+inline void ByteSwapCopy( T* dst, const T* src, size_t num )
+{
+  ByteSwapBlock( dst, src, num, sizeof(T) );
+}
+
+
 #ifdef MR_BIG_ENDIAN
 #define MAKE_BIGENDIAN(t)
 #define MAKE_BIGENDIAN_V(t)
 #define MAKE_BIGENDIAN_P(t)
+#define MAKE_BIGENDIAN_ARRAY(p, n)
+#define MAKE_BIGENDIAN_COPY(d, s, n) memcpy( d, s, (n) * sizeof(*(s)) );
 #else
 #define MAKE_BIGENDIAN(t) t = ByteSwap(t);
 #define MAKE_BIGENDIAN_V(t) \
@@ -90,6 +295,8 @@ inline float ByteSwap( float f )
    t[1] = ByteSwap(t[1]); \
    t[2] = ByteSwap(t[2]);
 #define MAKE_BIGENDIAN_P(t) MAKE_BIGENDIAN_V(t); t[3] = ByteSwap(t[3]);
+#define MAKE_BIGENDIAN_ARRAY(p, n) ByteSwapArray( p, n );
+#define MAKE_BIGENDIAN_COPY(d, s, n) ByteSwapCopy( d, s, n );
 #endif
 
 
@@ -112,6 +319,11 @@ inline float ByteSwap( float f )
         MRL_FREAD( &v, sizeof(double), 3, f );  MAKE_BIGENDIAN_V(v); \
     } while(0);
 
+// Read n elements (ints, floats or doubles) into array p
+#define LOAD_ARRAY(p, n) do { \
+        MRL_FREAD( p, sizeof(*(p)), n, f ); MAKE_BIGENDIAN_ARRAY( p, n ); \
+    } while(0);
+
 #define SAVE_INT(x) do { \
 	x = htonl( x ); \
 	MRL_FWRITE( &x, sizeof(int), 1, f ); \
@@ -130,5 +342,25 @@ inline float ByteSwap( float f )
         MAKE_BIGENDIAN_V(v); MRL_FWRITE( &v, sizeof(double), 3, f ); \
     } while(0);
 
+// Write n elements of array p (ints, floats or doubles), leaving p as is.
+// Elements are swapped thru a small buffer a block at a time.
+#ifdef MR_BIG_ENDIAN
+#define SAVE_ARRAY(p, n) do { \
+        MRL_FWRITE( p, sizeof(*(p)), n, f ); \
+    } while(0);
+#else
+#define SAVE_ARRAY(p, n) do { \
+        char swapBuf_[16384]; \
+        const size_t num_   = (size_t) (n); \
+        const size_t chunk_ = sizeof(swapBuf_) / sizeof(*(p)); \
+        for ( size_t i_ = 0; i_ < num_; i_ += chunk_ ) { \
+	   size_t c_ = num_ - i_; \
+	   if ( c_ > chunk_ ) c_ = chunk_; \
+	   ByteSwapBlock( swapBuf_, (p) + i_, c_, sizeof(*(p)) ); \
+	   MRL_FWRITE( swapBuf_, sizeof(*(p)), c_, f ); \
+        } \
+    } while(0);
+#endif
+
 
 #endif  // mrByteSwap_h
@@ -863,6 +863,7 @@ MString mrCamera::get_buffers()
 
 void mrCamera::write( MRL_FILE* f )
 {
+   MRL_PROFILE_WRITE( f );
    if ( options->exportFilter & mrOptions::kCameras )
       return;
 
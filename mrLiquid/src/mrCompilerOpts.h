@@ -218,4 +218,13 @@
 //!#    define MR_GOOGLE
 #endif
 
+//!
+//! If set, mrLiquid will use the old std::multimap based hash
+//! (gg_hash_map.h) for its internal hash instead of the open addressing
+//! table in gg_flat_hash_map.h.  The multimap needs a tree descent per
+//! lookup and a heap allocation per node, so this is only kept around
+//! for debugging.
+//!
+// #define MR_MULTIMAP_HASH
+
 #endif
@@ -0,0 +1,156 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef mrContentHash_h
+#define mrContentHash_h
+
+#include <cstring>
+
+#include "maya/MPointArray.h"
+#include "maya/MFloatVectorArray.h"
+#include "maya/MFloatArray.h"
+#include "maya/MIntArray.h"
+#include "maya/MString.h"
+
+
+//! Fast 64-bit hash of a shape's contents (points, topology, uvs).
+//!
+//! Values are fed one at a time and mixed with the murmur3 64-bit
+//! finalizer constants.  It is not meant to be cryptographically
+//! strong, just to tell with near certainty whether two frames of a
+//! shape would be exported the same.  A value() of 0 is never
+//! returned, so 0 can be used to mean "unknown".
+class mrContentHash
+{
+public:
+  typedef unsigned long long Key;
+
+  mrContentHash() : h( 0x9E3779B97F4A7C15ULL ), n( 0 ) {}
+
+  inline void add( Key k )
+  {
+    k *= 0x87C37B91114253D5ULL;
+    k  = ( k << 31 ) | ( k >> 33 );
+    k *= 0x4CF5AD432745937FULL;
+    h ^= k;
+    h  = ( h << 27 ) | ( h >> 37 );
+    h  = h * 5 + 0x52DCE729;
+    ++n;
+  }
+
+  inline void add( int x )      { add( (Key) (unsigned) x ); }
+  inline void add( unsigned x ) { add( (Key) x ); }
+  inline void add( float x )
+  {
+    unsigned b; memcpy( &b, &x, sizeof(b) ); add( (Key) b );
+  }
+  inline void add( double x )
+  {
+    Key b; memcpy( &b, &x, sizeof(b) ); add( b );
+  }
+
+  inline void add( const MIntArray& a )
+  {
+    unsigned num = a.length();
+    add( num );
+    for ( unsigned i = 0; i < num; ++i ) add( a[i] );
+  }
+
+  inline void add( const MFloatArray& a )
+  {
+    unsigned num = a.length();
+    add( num );
+    for ( unsigned i = 0; i < num; ++i ) add( a[i] );
+  }
+
+  inline void add( const MPointArray& a )
+  {
+    unsigned num = a.length();
+    add( num );
+    for ( unsigned i = 0; i < num; ++i )
+    {
+      const MPoint& p = a[i];
+      add( p.x ); add( p.y ); add( p.z ); add( p.w );
+    }
+  }
+
+  inline void add( const MFloatVectorArray& a )
+  {
+    unsigned num = a.length();
+    add( num );
+    for ( unsigned i = 0; i < num; ++i )
+    {
+      const MFloatVector& v = a[i];
+      add( v.x ); add( v.y ); add( v.z );
+    }
+  }
+
+  //! Add a block of bytes, eight at a time.
+  inline void add( const char* s, size_t len )
+  {
+    add( (Key) len );
+    size_t i = 0;
+    for ( ; i + 8 <= len; i += 8 )
+    {
+      Key k; memcpy( &k, s + i, 8 ); add( k );
+    }
+    if ( i < len )
+    {
+      Key k = 0; memcpy( &k, s + i, len - i ); add( k );
+    }
+  }
+
+  inline void add( const MString& s )
+  {
+    const char* c = s.asChar();
+    unsigned len = s.length();
+    add( len );
+    for ( unsigned i = 0; i < len; ++i ) add( (unsigned) c[i] );
+  }
+
+  //! Return the hash of everything added so far.
+  inline Key value() const
+  {
+    Key k = h ^ n;
+    k ^= k >> 33;
+    k *= 0xFF51AFD7ED558CCDULL;
+    k ^= k >> 33;
+    k *= 0xC4CEB9FE1A85EC53ULL;
+    k ^= k >> 33;
+    return k ? k : 1;
+  }
+
+protected:
+  Key h;
+  Key n;
+};
+
+#endif // mrContentHash_h
@@ -0,0 +1,209 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef mrCornerHash_h
+#define mrCornerHash_h
+
+#include <vector>
+
+
+//! Table used to weld polygon corners (vertex, normal, uvs) into
+//! the shared vertices of a mesh.
+//!
+//! Corners are kept in a single contiguous arena, in the order they
+//! are added, so the index of a corner is also its vertex number in
+//! the mesh.  An open addressing table keyed on (vertex, normal) points
+//! to the first corner with that key, and corners with the same key
+//! are chained in insertion order.  Comparing uvs (which is fuzzy)
+//! is left to the caller, walking the chain with find()/next().
+//! All memory is released at once with clear().
+class mrCornerHash
+{
+   struct Slot
+   {
+     unsigned head;    // first corner with this vertex and normal
+     unsigned tail;    // last one
+   };
+
+   typedef std::vector< Slot >     SlotList;
+   typedef std::vector< unsigned > LinkList;
+   typedef std::vector< int >      DataList;
+
+   SlotList slots;     // hash table
+   LinkList links;     // next corner with same key, per corner
+   DataList data;      // id, nid, uvIds[numUVSets], per corner
+   unsigned mask;
+   unsigned keys;
+   unsigned stride;
+
+   static inline unsigned hash( unsigned id, unsigned nid )
+   {
+      unsigned h = id * 0x9E3779B1u ^ nid * 0x85EBCA6Bu;
+      h ^= h >> 16;
+      h *= 0x7FEB352Du;
+      h ^= h >> 15;
+      return h;
+   }
+
+   inline bool same( unsigned c, unsigned id, unsigned nid ) const
+   {
+      const int* d = &data[c * stride];
+      return ( (unsigned) d[0] == id && (unsigned) d[1] == nid );
+   }
+
+   inline Slot& lookup( unsigned id, unsigned nid )
+   {
+      unsigned idx = hash( id, nid ) & mask;
+      for (;;)
+      {
+	 Slot& x = slots[idx];
+	 if ( x.head == kNone || same( x.head, id, nid ) ) return x;
+	 idx = (idx + 1) & mask;
+      }
+   }
+
+   inline void rehash( unsigned buckets )
+   {
+      SlotList old;
+      old.swap( slots );
+      Slot empty = { kNone, kNone };
+      slots.resize( buckets, empty );
+      mask = buckets - 1;
+
+      SlotList::const_iterator i = old.begin();
+      SlotList::const_iterator e = old.end();
+      for ( ; i != e; ++i )
+      {
+	 if ( i->head != kNone )
+	    lookup( vertex( i->head ), normal( i->head ) ) = *i;
+      }
+   }
+
+   public:
+     enum {
+       kNone = 0xffffffff
+     };
+
+     mrCornerHash() : mask(0), keys(0), stride(2) {}
+
+     //! Number of corners stored.
+     unsigned size() const throw() { return (unsigned) links.size(); }
+
+     //! Free all memory and prepare for a new mesh with numUVSets uv
+     //! ids per corner and about numCorners unique corners.
+     inline void init( unsigned numUVSets, unsigned numCorners )
+     {
+	clear();
+	stride = 2 + numUVSets;
+	data.reserve( numCorners * stride );
+	links.reserve( numCorners );
+	unsigned buckets = 16;
+	while ( buckets < numCorners * 2 ) buckets <<= 1;
+	rehash( buckets );
+     }
+
+     //! Free all memory.
+     inline void clear()
+     {
+	SlotList s; slots.swap( s );
+	LinkList l; links.swap( l );
+	DataList d; data.swap( d );
+	mask = 0;
+	keys = 0;
+     }
+
+     //! Return first corner with vertex id and normal nid, or kNone.
+     inline unsigned find( unsigned id, unsigned nid ) const
+     {
+	if ( keys == 0 ) return kNone;
+	unsigned idx = hash( id, nid ) & mask;
+	for (;;)
+	{
+	   const Slot& x = slots[idx];
+	   if ( x.head == kNone || same( x.head, id, nid ) ) return x.head;
+	   idx = (idx + 1) & mask;
+	}
+     }
+
+     //! Return next corner with the same vertex and normal, or kNone.
+     inline unsigned next( unsigned c ) const { return links[c]; }
+
+     inline unsigned vertex( unsigned c ) const
+     {
+	return (unsigned) data[c * stride];
+     }
+
+     inline unsigned normal( unsigned c ) const
+     {
+	return (unsigned) data[c * stride + 1];
+     }
+
+     inline int* uvIds( unsigned c )
+     {
+	return &data[c * stride + 2];
+     }
+
+     inline const int* uvIds( unsigned c ) const
+     {
+	return &data[c * stride + 2];
+     }
+
+     //! Add a new corner, after any others with the same vertex and
+     //! normal.  Its uv ids are left for the caller to fill in.
+     //! Returns the index of the corner.
+     inline unsigned insert( unsigned id, unsigned nid )
+     {
+	if ( (keys + 1) * 2 > slots.size() )
+	   rehash( slots.empty() ? 16 : (unsigned) slots.size() * 2 );
+
+	unsigned c = size();
+	links.push_back( kNone );
+	data.resize( data.size() + stride, -1 );
+	data[c * stride]     = (int) id;
+	data[c * stride + 1] = (int) nid;
+
+	Slot& x = lookup( id, nid );
+	if ( x.head == kNone )
+	{
+	   x.head = c;
+	   ++keys;
+	}
+	else
+	{
+	   links[x.tail] = c;
+	}
+	x.tail = c;
+	return c;
+     }
+};
+
+
+#endif // mrCornerHash_h
@@ -90,6 +90,7 @@ void mrFileObject::getRealName(bool& useNamespace, short& nameType)
 
 void mrFileObject::getData()
 {
+   MRL_PROFILE( kGetData );
    MStatus status;
    MFnDagNode fn( path );
    MPlug p = fn.findPlug( "file", true );
@@ -176,6 +177,7 @@ mrFileObject* mrFileObject::factory( MDagPath& shape )
 
 void mrFileObject::getMotionBlur( const char step )
 {
+   MRL_PROFILE( kMotionBlur );
 // file objects already come with moblur baked in, so nothing to do here...
 }
 
@@ -222,6 +224,7 @@ void mrFileObject::calculateBoundingBoxes( BBox& box, BBox& mbox )
 
 void mrFileObject::write( MRL_FILE* f )
 {
+   MRL_PROFILE_WRITE( f );
    if ( options->exportFilter & mrOptions::kObjects )
       return;
    
@@ -55,6 +55,7 @@ extern int          frame;
 
 void mrFluid::getData()
 {
+   MRL_PROFILE( kGetData );
    MStatus status; MPlug p;
    MFnDagNode fn( path );
 
@@ -142,6 +143,7 @@ void mrFluid::setIncremental( bool sameFrame )
 
 void mrFluid::getMotionBlur( char step )
 {
+   MRL_PROFILE( kMotionBlur );
 }
 
 
@@ -194,6 +194,7 @@ float FloatInterpAttr::getValue( double u, double v, double t )
 
 void mrFur::getData()
 {
+   MRL_PROFILE( kGetData );
    maxDisplace = 0;
 
    MStatus status;
@@ -319,6 +320,7 @@ void mrFur::setIncremental( bool sameFrame )
 
 void mrFur::getMotionBlur( const char step )
 {
+   MRL_PROFILE( kMotionBlur );
    if ( type_ == -1 ) return; // invalid hair (probably being created)
 
    MStatus status;
@@ -1236,6 +1238,7 @@ void mrFur::getHairSystemInfo()
  */
 void mrFur::write( MRL_FILE* f )
 {
+   MRL_PROFILE_WRITE( f );
    if ( written == kWritten ) return;
 
    if ( options->furType == mrOptions::kFurVolumetric )
@@ -35,6 +35,10 @@
 #include <algorithm>
 #include <vector>
 
+#ifndef mrPtrIndex_h
+#include "mrPtrIndex.h"
+#endif
+
 #ifndef mrNode_h
 #include "mrNode.h"
 #endif
@@ -54,7 +58,13 @@
 extern MComputation escHandler;
 
 
-//! Template base class used to represent groups of any kind, like instgroups
+//! Template base class used to represent groups of any kind, like instgroups.
+//! Members are kept in an mrPtrList, in insertion order (which is the order
+//! they get written out in) and indexed by pointer so that contains() and
+//! erase() are O(1).
+//! A node is a member at most once.  Inserting a member again does
+//! nothing (it used to add a second entry, which wrote the same instance
+//! twice into the instgroup and needed two erases to remove).
 template< typename D, typename C = std::vector< D* > >
 class mrGroup : public mrInstanceBase
 {
@@ -65,7 +75,11 @@ class mrGroup : public mrInstanceBase
      typedef typename MemberList::value_type value_type;
      
    protected:
-     MemberList members;
+     mutable mrPtrList< D, C > members;
+
+     void compact() const { members.compact(); }
+     bool push_member( D* const elem )   { return members.push_back( elem ); }
+     bool remove_member( D* const elem ) { return members.erase( elem ); }
      
    public:
      mrGroup(const MString& name) : mrInstanceBase(name)  {};
@@ -79,11 +93,9 @@ class mrGroup : public mrInstanceBase
      iterator begin() throw() { return members.begin(); }
      iterator end()   throw() { return members.end(); }
 
-     bool  contains( const D* const elem ) 
+     bool  contains( const D* const elem ) const
      {
-	iterator i = std::find( members.begin(), members.end(), elem );
-	return( i != members.end() );
-	// return members.find(elem) != members.end();
+	return members.contains( elem );
      }
      value_type back() throw() { return members.back(); }
      
@@ -95,8 +107,8 @@ class mrGroup : public mrInstanceBase
      virtual void newRenderPass();
      virtual void setIncremental( bool sameFrame );
 
-     size_t size() throw() { return members.size(); };
-     bool  empty() throw() { return members.empty(); };
+     size_t size() const throw() { return members.size(); };
+     bool  empty() const throw() { return size() == 0; };
   
      virtual void  debug( int tabs = 0 ) const throw();
 
@@ -145,7 +157,8 @@ inline mrGroup< D, C >::~mrGroup()
 }
 
 /** 
- * Add new member to group.
+ * Add new member to group.  Members already in the group are not
+ * added twice.
  * 
  * @param inst New member, usually an miInstance.
  * 
@@ -156,8 +169,7 @@ inline void mrGroup< D, C >::insert( D* const inst )
 {
    assert( inst != NULL );
    assert( dynamic_cast< mrGroup* >(inst) == NULL );
-   members.push_back( inst );
-   if ( written == kWritten ) written = kIncremental;
+   if ( push_member( inst ) && written == kWritten ) written = kIncremental;
 }
 
 
@@ -171,10 +183,8 @@ inline void mrGroup< D, C >::insert( D* const inst )
 template< typename D, typename C >
 inline void mrGroup< D, C >::safe_erase( D* const elem )
 {
-   iterator i = std::find( members.begin(), members.end(), elem );
-   if ( i != members.end() )
+   if ( remove_member( elem ) )
    {
-      members.erase(i);
       if ( written == kWritten ) written = kIncremental;
    }
    else
@@ -193,10 +203,8 @@ inline void mrGroup< D, C >::safe_erase( D* const elem )
 template< typename D, typename C >
 inline void mrGroup< D, C >::erase( D* const elem )
 {
-   iterator i = std::find( members.begin(), members.end(), elem );
-   if ( i != members.end() )
+   if ( remove_member( elem ) )
    {
-      members.erase(i);
       if ( written == kWritten ) written = kIncremental;
    }
 }
@@ -210,6 +218,7 @@ inline void mrGroup< D, C >::erase( D* const elem )
 template< typename D, typename C >
 inline void mrGroup< D, C >::write_each_member( MRL_FILE* f )
 {
+   compact();
    typename MemberList::iterator i = members.begin();
    typename MemberList::iterator e = members.end();
    for ( ; i != e; ++i )
@@ -227,6 +236,7 @@ inline void mrGroup< D, C >::write_each_member( MRL_FILE* f )
 template< typename D, typename C >
 inline void mrGroup< D, C >::newRenderPass()
 {
+   compact();
    typename MemberList::iterator i = members.begin();
    typename MemberList::iterator e = members.end();
    for ( ; i != e; ++i )
@@ -245,6 +255,7 @@ inline void mrGroup< D, C >::newRenderPass()
 template< typename D, typename C >
 inline void mrGroup< D, C >::setIncremental( bool sameFrame )
 {
+   compact();
    typename MemberList::iterator i = members.begin();
    typename MemberList::iterator e = members.end();
    for ( ; i != e; ++i )
@@ -264,6 +275,7 @@ inline void mrGroup< D, C >::setIncremental( bool sameFrame )
 template< typename D, typename C >
 inline void mrGroup< D, C >::write_members( MRL_FILE* f )
 {
+   compact();
    typename MemberList::iterator i = members.begin();
    typename MemberList::iterator e = members.end();
    for ( ; i != e; ++i )
@@ -314,6 +326,7 @@ template< typename D, typename C >
 const mrGroup< D, C >& mrGroup< D, C >::operator=( const mrGroup< D, C >& b )
 {
    clear();
+   b.compact();
    typename MemberList::iterator i = b.members.begin();
    typename MemberList::iterator e = b.members.end();
    for ( ; i != e; ++i )
@@ -348,6 +361,7 @@ void mrGroup< D, C >::debug( int tabs ) const throw()
       cerr << "\t";
    cerr << "* GROUP " << this << " name: " << name << "  contents: " << endl;
 
+   compact();
    typename MemberList::const_iterator i = members.begin();
    typename MemberList::const_iterator e = members.end();
    for ( ; i != e; ++i )
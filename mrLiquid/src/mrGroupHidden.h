@@ -66,9 +66,9 @@ class mrGroupHidden : public mrGroup< mrNode >
      
 };
 
-inline void mrGroupHidden::insert( mrInstanceBase* const inst )
+inline void mrGroupHidden::insert( mrNode* const inst )
 {
-   members.push_back( inst );
+   push_member( inst );
 }
 
 inline void mrGroupHidden::write( MRL_FILE* f )
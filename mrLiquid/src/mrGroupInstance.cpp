@@ -80,6 +80,7 @@ nodeHandle( fn.object() )
 
 void mrGroupInstance::write( MRL_FILE* f )
 {
+   MRL_PROFILE_WRITE( f );
    mrGroup< mrInstanceBase >::write(f);
 }
 
@@ -145,13 +145,9 @@ struct hairVertices : public std::vector< miVector >
 	unsigned num;
 	LOAD_INT(num);
 	resize(num);
-	for (unsigned i = 0; i < num; ++i)
-	{
-	   miVector& v = this->operator[](i);
-	   LOAD_FLOAT( v.x );
-	   LOAD_FLOAT( v.y );
-	   LOAD_FLOAT( v.z );
-	}
+	if ( num == 0 ) return;
+	float* v = &(this->operator[](0).x);
+	LOAD_ARRAY( v, num * 3 );
      }
 
      void write( MRL_FILE* f )
@@ -159,13 +155,9 @@ struct hairVertices : public std::vector< miVector >
         size_t   num = size();
 	unsigned w   = (unsigned) num;
 	SAVE_INT( w );
-	for (unsigned i = 0; i < num; ++i)
-	{
-	   miVector v = this->operator[](i);
-	   SAVE_FLOAT( v.x );
-	   SAVE_FLOAT( v.y );
-	   SAVE_FLOAT( v.z );
-	}
+	if ( num == 0 ) return;
+	const float* v = &(this->operator[](0).x);
+	SAVE_ARRAY( v, num * 3 );
      }
 };
 
@@ -93,8 +93,13 @@ struct EqualFunctor
 //#    include <hash_map>
 //#    define STD_HASH  stdext::hash_multimap< const char*, T*, HashFunctor >
 // #  else
+#  ifdef MR_MULTIMAP_HASH
 #    include "gg_hash_map.h"
 #    define STD_HASH  stdext::hash_multimap< const char*, T* >
+#  else
+#    include "gg_flat_hash_map.h"
+#    define STD_HASH  stdext::flat_hash_multimap< const char*, T* >
+#  endif
 // #  endif
 
 #endif  // MR_GOOGLE
@@ -169,6 +174,22 @@ public:
   }
 
 #ifndef MR_GOOGLE
+#  ifndef MR_MULTIMAP_HASH
+  struct NameEqual
+  {
+    const MString& name;
+    NameEqual( const MString& n ) : name(n) {}
+    inline bool operator()( const T* node ) const
+    {
+      return node->name == name;
+    }
+  };
+
+  inline iterator find( const MString& name )
+  {
+    return Base::find( HashFunctor()( name.asChar() ), NameEqual(name) );
+  }
+#  else
   inline iterator find( const MString& name )
   {
     size_t key = HashFunctor()( name.asChar() );
@@ -185,7 +206,11 @@ public:
       }
     return e;
   }
+#  endif
 
+  //! Add a node.  With the default (flat) backend this may rehash the
+  //! table and invalidate all iterators, so never insert into a list
+  //! while iterating it.
   inline iterator insert( const MString& name, T* node )
   {
     return Base::insert( value_type( name.asChar(), node ) );
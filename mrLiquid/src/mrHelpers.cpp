@@ -37,6 +37,7 @@
 
 #if defined(WIN32) || defined(WIN64)
 
+#  include <windows.h>
 #  include <direct.h>
 #  include <io.h>
 
@@ -45,6 +46,7 @@
 
 #else
 
+#  include <unistd.h>
 #  define MKDIR(_DIR_, _MODE_) (mkdir(_DIR_, _MODE_))
 
 #endif
@@ -322,6 +324,45 @@ size_t fileSize( const MString& file )
 }
 
 
+/** 
+ * Make dst the same file as src.  A hard link is used if possible,
+ * otherwise src is copied.  Any existing dst is replaced.
+ * 
+ * @param src existing file
+ * @param dst new file name
+ * 
+ * @return true on success, false if not.
+ */
+bool linkFile( const MString& src, const MString& dst )
+{
+#if defined(WIN32) || defined(WIN64)
+   UNLINK( dst.asChar() );
+   if ( CreateHardLinkA( dst.asChar(), src.asChar(), NULL ) ) return true;
+   return ( CopyFileA( src.asChar(), dst.asChar(), FALSE ) != 0 );
+#else
+   UNLINK( dst.asChar() );
+   if ( link( src.asChar(), dst.asChar() ) == 0 ) return true;
+
+   // Different filesystem or no hard links.  Copy it.
+   FILE* in = fopen( src.asChar(), "rb" );
+   if ( !in ) return false;
+   FILE* out = fopen( dst.asChar(), "wb" );
+   if ( !out ) { fclose(in); return false; }
+
+   bool ok = true;
+   char buf[65536];
+   size_t n;
+   while ( ( n = fread( buf, 1, sizeof(buf), in ) ) > 0 )
+   {
+      if ( fwrite( buf, 1, n, out ) != n ) { ok = false; break; }
+   }
+   fclose(in);
+   if ( fclose(out) != 0 ) ok = false;
+   return ok;
+#endif
+}
+
+
 /** 
  * Check to see if fileA is newer than fileB
  * 
@@ -81,6 +81,7 @@ MString getFilePath( const MString& file );
 bool    fileIsNewer( const MString& fileA, const MString& fileB );
 bool    fileExists(const MString & filename );
 size_t  fileSize( const MString& file );
+bool    linkFile( const MString& src, const MString& dst );
 
 MString parseString( const MString& inputString );
 
@@ -0,0 +1,118 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+/**
+ * @file   mrHexEncode.cpp
+ * 
+ * @brief  Fast encoding of raw data as hex text.
+ * 
+ */
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#  define MR_HEX_SSE2
+#  include <emmintrin.h>
+#endif
+
+#include "mrHexEncode.h"
+
+
+namespace {
+
+//! Hex pairs for each byte value.
+struct mrHexTable
+{
+  char pairs[512];
+
+  mrHexTable()
+  {
+     static const char kHex[] = "0123456789abcdef";
+     for ( int i = 0; i < 256; ++i )
+     {
+	pairs[i*2]   = kHex[i >> 4];
+	pairs[i*2+1] = kHex[i & 0xF];
+     }
+  }
+};
+
+const mrHexTable kTable;
+
+#ifdef MR_HEX_SSE2
+//! Turn 16 nibbles (0-15) into their lowercase hex chars.
+inline __m128i nibbles_to_hex( __m128i n )
+{
+   // '0' + n, plus 'a' - '0' - 10 for nibbles above 9
+   const __m128i nine = _mm_set1_epi8( 9 );
+   const __m128i zero = _mm_set1_epi8( '0' );
+   const __m128i gap  = _mm_set1_epi8( 'a' - '0' - 10 );
+   __m128i letters = _mm_and_si128( _mm_cmpgt_epi8( n, nine ), gap );
+   return _mm_add_epi8( _mm_add_epi8( n, zero ), letters );
+}
+#endif
+
+} // namespace
+
+
+char* mr_hex_encode( char* out, const void* data, size_t bytes )
+{
+   const unsigned char* s = static_cast< const unsigned char* >( data );
+   const unsigned char* e = s + bytes;
+
+#ifdef MR_HEX_SSE2
+   const __m128i mask = _mm_set1_epi8( 0x0F );
+   for ( ; e - s >= 16; s += 16, out += 32 )
+   {
+      __m128i v  = _mm_loadu_si128( reinterpret_cast< const __m128i* >( s ) );
+      __m128i hi = _mm_and_si128( _mm_srli_epi16( v, 4 ), mask );
+      __m128i lo = _mm_and_si128( v, mask );
+      // High nibble of each byte goes first
+      __m128i a  = nibbles_to_hex( _mm_unpacklo_epi8( hi, lo ) );
+      __m128i b  = nibbles_to_hex( _mm_unpackhi_epi8( hi, lo ) );
+      _mm_storeu_si128( reinterpret_cast< __m128i* >( out ), a );
+      _mm_storeu_si128( reinterpret_cast< __m128i* >( out + 16 ), b );
+   }
+#endif
+
+   return mr_hex_encode_scalar( out, s, e - s );
+}
+
+
+char* mr_hex_encode_scalar( char* out, const void* data, size_t bytes )
+{
+   const unsigned char* s = static_cast< const unsigned char* >( data );
+   const unsigned char* e = s + bytes;
+   for ( ; s < e; ++s, out += 2 )
+   {
+      const char* p = kTable.pairs + *s * 2;
+      out[0] = p[0];
+      out[1] = p[1];
+   }
+   return out;
+}
@@ -0,0 +1,68 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+/**
+ * @file   mrHexEncode.h
+ * 
+ * @brief  Fast encoding of raw data as hex text.
+ * 
+ */
+
+#ifndef mrHexEncode_h
+#define mrHexEncode_h
+
+#include <cstddef>
+
+
+/** 
+ * Encode bytes of data as lowercase hex, two chars per byte, in memory
+ * order.  Uses SSE2 when available (16 bytes at a time).
+ * 
+ * @param out   buffer of at least 2 * bytes chars (no '\\0' is added)
+ * @param data  data to encode
+ * @param bytes number of bytes of data
+ * 
+ * @return pointer past last char written.
+ */
+char* mr_hex_encode( char* out, const void* data, size_t bytes );
+
+/** 
+ * Same as mr_hex_encode(), but always uses the lookup table.  Used for
+ * the tail of mr_hex_encode() and to check it against.
+ * 
+ * @param out   buffer of at least 2 * bytes chars (no '\\0' is added)
+ * @param data  data to encode
+ * @param bytes number of bytes of data
+ * 
+ * @return pointer past last char written.
+ */
+char* mr_hex_encode_scalar( char* out, const void* data, size_t bytes );
+
+#endif // mrHexEncode_h
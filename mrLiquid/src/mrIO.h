@@ -49,6 +49,10 @@
 
 #endif
 
+#ifdef USE_MRL_BUFFERED_IO
+#  include "mrlBufferedIO.h"
+#endif  // USE_MRL_BUFFERED_IO
+
 
 // Simple file with some macros to spit out strings to a stream.
 // Based on OS, we might change the function called for best performance.
@@ -58,6 +62,7 @@
 #ifndef MRL_FILE
 #  define MRL_FILE    FILE
 #  define MRL_FOPEN   fopen
+#  define MRL_FWRAP(x) (x)
 #  define MRL_FFLUSH  fflush
 #  define MRL_FCLOSE  fclose
 #  define MRL_PUTS(x) fputs( x,f)
@@ -71,6 +76,26 @@
 #  define MRL_stderr  stderr
 #endif
 
+// Without streaming compression, files are always written uncompressed.
+#ifndef MRL_FOPEN_GZ
+#  define MRL_FOPEN_GZ(name,level)  MRL_FOPEN( name, "wb" )
+#endif
+
+//! Bytes written to f so far (before any compression).
+inline double mr_bytes_written( MRL_FILE* f )
+{
+   if ( f == NULL ) return 0;
+#if defined(MRL_MEMORY_FILES)
+   return (double) f->tell();
+#elif defined(USE_SFIO)
+   Sfoff_t p = sftell( f );
+   return p < 0 ? 0 : (double) p;
+#else
+   long p = ftell( f );
+   return p < 0 ? 0 : (double) p;
+#endif
+}
+
 #ifdef DEBUG
 #  define COMMENT(x)   MRL_PUTS(x)
 #  define TAB(x)       write_tabs(f,x)
@@ -45,6 +45,8 @@
 #endif
 
 #include <algorithm>
+#include <map>
+#include <set>
 
 #include "maya/MSceneMessage.h"
 #include "maya/MDGMessage.h"
@@ -53,6 +55,7 @@
 #include "maya/MItDag.h"
 #include "maya/MItDependencyGraph.h"
 #include "maya/MItDependencyNodes.h"
+#include "maya/MObjectHandle.h"
 #include "maya/MComputation.h"
 #include "maya/MStringArray.h"
 #include "maya/MGlobal.h"
@@ -145,6 +148,7 @@
 #endif
 
 #include "mrIPRCallbacks.h"
+#include "mrIPRLatency.h"
 
 
 extern int               frame;
@@ -193,6 +197,18 @@ typedef std::set< mrNode* > mrNodesToUpdate;
 mrNodesToUpdate nodesToUpdate;
 
 
+//
+// Changes to shading nodes (and other dependency nodes that are not in
+// the dag) arrive in bursts.  A slider drag on a shader sends hundreds of
+// attribute callbacks, each of which used to walk the whole downstream
+// network (shader -> shading group -> ...).  Instead, we just remember
+// which nodes changed here and on idle time, plan_updates() walks the
+// downstream graph of all of them at once, visiting each node only once.
+//
+typedef std::map< MString, MObjectHandle > mrNodesToPlan;
+mrNodesToPlan nodesToPlan;
+
+
 
 //!
 //! List of attributes that effect transforms (ie. position of the whole
@@ -540,6 +556,7 @@ mrIPRCallbacks::~mrIPRCallbacks()
   
   nodesToRemove.clear();
   nodesToUpdate.clear();
+  nodesToPlan.clear();
   mr_cleanup_socket_library();
 }
 
@@ -1269,6 +1286,7 @@ void after_new_scene_cb( void* data )
    DBG("---- AFTER_NEW_SCENE_CB ----");
 
    nodesToUpdate.clear();
+   nodesToPlan.clear();
    ipr->remove_all_callbacks();
 
    // Delete main group nodes and internal lists
@@ -1581,6 +1599,8 @@ void rm_node_cb( MObject& node, void* data )
    mrTranslator* t = ipr->translator();
    assert( t     != NULL );
 
+   mrShader::invalidateConnections();
+
    DBG("---- RM_NODE_CB ---- ");
    MFnDependencyNode fn( node );
    MString name = fn.name();
@@ -1651,6 +1671,8 @@ void rm_dag_cb( MDagMessage::DagMessage msg, MDagPath& child,
    mrTranslator* t = ipr->translator();
    assert( t     != NULL );
 
+   mrShader::invalidateConnections();
+
    DBG("---- RM_DAG_CB ---- msg: " << msg);
 
    MDagPath node;
@@ -1875,6 +1897,9 @@ void connection_cb( MPlug& src, MPlug& dst,
    mrTranslator* t = ipr->translator();
    assert( t     != NULL );
 
+   mrIPRLatency::callback();
+   mrShader::invalidateConnections();
+
    MStatus status;
 
 
@@ -2214,6 +2239,40 @@ void parenting_cb( MDagMessage::DagMessage msg,
  * @param other  Other attribute?
  * @param data   Pointer to translator.
  */
+/** 
+ * Check whether the changes of a node can wait until idle time to be
+ * propagated to the nodes below it (see plan_updates()).  Dag nodes,
+ * globals and paintfx brushes still need to be processed as they change.
+ * 
+ * @param node MObject of thing that changed
+ * 
+ * @return true if update can be planned, false if not.
+ */
+bool can_plan_update( const MObject& node )
+{
+   if ( node.hasFn( MFn::kDagNode ) ||
+	node.hasFn( MFn::kBrush ) ||
+	node.hasFn( MFn::kRenderGlobals ) ||
+	node.hasFn( MFn::kResolution ) )
+      return false;
+
+   if ( node.hasFn( MFn::kPluginDependNode ) )
+   {
+      MFnDependencyNode fn( node );
+      switch ( fn.typeId().id() )
+      {
+	 case kMentalrayOptions:
+	 case kMentalrayFramebuffer:
+	 case kMentalrayUserBuffer:
+	 case kMentalrayOutputPass:
+	 case kMentalrayRenderPass:
+	    return false;
+      }
+   }
+   return true;
+}
+
+
 void attr_cb( MNodeMessage::AttributeMessage msg,
 	      MPlug& plug, MPlug& other, void* data )
 {
@@ -2426,6 +2485,8 @@ void attr_cb( MNodeMessage::AttributeMessage msg,
       return;
    }
 
+   mrIPRLatency::callback();
+
 
    DBG2("eval?  " <<  (msg & MNodeMessage::kAttributeEval)  );
    DBG2("set?   " <<  (msg & MNodeMessage::kAttributeSet)   );
@@ -2547,13 +2608,21 @@ void attr_cb( MNodeMessage::AttributeMessage msg,
    }
 
 
-   MItDependencyGraph it( node ); 
-   for ( ; !it.isDone(); it.next() )
+   if ( can_plan_update( node ) )
    {
-      MObject curr = it.thisNode();
-      MFnDependencyNode fn( curr );
-      DBG2("\t" << fn.name() );
-      attr_process( curr, ipr, attrName );
+      // Leave walking the downstream network for idle time.
+      nodesToPlan.insert( std::make_pair( fn.name(), MObjectHandle( node ) ) );
+   }
+   else
+   {
+      MItDependencyGraph it( node ); 
+      for ( ; !it.isDone(); it.next() )
+      {
+	 MObject curr = it.thisNode();
+	 MFnDependencyNode fn( curr );
+	 DBG2("\t" << fn.name() );
+	 attr_process( curr, ipr, attrName );
+      }
    }
 
    //
@@ -2640,6 +2709,7 @@ void attr_cb( MNodeMessage::AttributeMessage msg,
 
 
 #ifdef MR_IPR_AGGRESSIVE
+   ipr->plan_updates();
    t->render();  // @todo: should really call idle_cb with wait of 0
 #else
    resetTimer();
@@ -2766,6 +2836,8 @@ void name_change_cb( MObject& node, const MString& prevName,
    MFnDependencyNode fn( node );
    if ( fn.name() == prevName ) return;
 
+   mrShader::invalidateConnections();
+
    MString newName = fn.name();
    DBG("---- NAME_CHANGE_CB from: " << prevName << " to: " << newName);
 
@@ -3099,6 +3171,51 @@ void mrIPRCallbacks::delete_nodes()
 }
 
 
+/** 
+ * Propagate the changes of all nodes stored by attr_cb() to the nodes
+ * downstream of them, marking those for update.  Networks shared by
+ * several changed nodes are walked only once.
+ * 
+ */
+void mrIPRCallbacks::plan_updates()
+{
+  if ( nodesToPlan.empty() ) return;
+
+  DBG("---- PLAN UPDATES " << nodesToPlan.size() << " ----");
+
+  std::set< MString > visited;
+
+  mrNodesToPlan::iterator i = nodesToPlan.begin();
+  mrNodesToPlan::iterator e = nodesToPlan.end();
+  for ( ; i != e; ++i )
+    {
+      // Node may have been deleted since it changed, or it may be
+      // downstream of another node we already walked.
+      if ( ! i->second.isValid() ) continue;
+      if ( visited.find( i->first ) != visited.end() ) continue;
+
+      MObject node = i->second.objectRef();
+      MItDependencyGraph it( node );
+      for ( ; !it.isDone(); it.next() )
+	{
+	  MObject curr = it.thisNode();
+	  MFnDependencyNode fn( curr );
+	  if ( ! visited.insert( fn.name() ).second )
+	    {
+	      // Already processed, and so was all that's below it.
+	      it.prune();
+	      continue;
+	    }
+	  DBG2("\t" << fn.name() );
+	  attr_process( curr, this );
+	}
+    }
+
+  nodesToPlan.clear();
+  DBG("---- END PLAN UPDATES " << visited.size() << " nodes ----");
+}
+
+
 /** 
  * Function used to re-sync the maya scene to the mray database.
  * 
@@ -3113,6 +3230,9 @@ void mrIPRCallbacks::update_scene()
      rescan_frame( this, t );
    }
 
+   mrShader::invalidateConnections();
+   plan_updates();
+
    ////////////////////////////////// 
    //  Update nodes that changed
    //////////////////////////////////
@@ -3172,6 +3292,7 @@ void mrIPRCallbacks::update_scene()
    ////////////////////////////////// 
    // Write out the scene incrementally
    //////////////////////////////////
+   mrIPRLatency::updated( t->fileHandle() );
    escHandler.beginComputation();
    t->writeDatabase();
 
@@ -3187,6 +3308,7 @@ void mrIPRCallbacks::update_scene()
    // After we wrote the database, we can now remove any (unused) nodes
    //////////////////////////////////
    delete_nodes();
+   mrIPRLatency::written( t->fileHandle() );
 
    escHandler.endComputation();
 }
@@ -3243,6 +3365,10 @@ void idle_cb( void* data )
       t->setRenderTypeFromNode(options);
    }
 
+   // Propagate the changes of all shading nodes before checking if
+   // there's something to render.
+   ipr->plan_updates();
+
    if ( !t->willRender() ) return;
 
 
@@ -3256,6 +3382,7 @@ void idle_cb( void* data )
    ////////////////////////////////// 
    // Start the render
    //////////////////////////////////
+   mrIPRLatency::idle();
    if ( (options->IPRflags & mrOptions::kAllValidLayers) == 0 )
    {
       ipr->update_scene();
@@ -3265,6 +3392,7 @@ void idle_cb( void* data )
    {
       t->IPRRenderPasses();
    }
+   mrIPRLatency::flushed();
 
    // Reset timer (mainly for Progressive IPR)
    idleTimer.start();
@@ -59,6 +59,7 @@ public:
   void unpause();
 
   void delete_nodes();
+  void plan_updates();
   void update_scene();
   void update_attr_callbacks();
 
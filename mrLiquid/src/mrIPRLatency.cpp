@@ -0,0 +1,305 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+/**
+ * @file   mrIPRLatency.cpp
+ * 
+ * @brief  Wall clock timings of each stage of an IPR update, from the
+ *         first maya callback to the first tile back in the render view.
+ * 
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#if defined(WIN32) || defined(WIN64)
+#  include <windows.h>
+#endif
+
+#include "mrIO.h"
+#include "mrTimer.h"
+#include "mrIPRLatency.h"
+
+
+#if defined(WIN32) || defined(WIN64)
+#define MR_ATOMIC_CAS(x, a, b) \
+   ( InterlockedCompareExchange( &(x), (b), (a) ) == (a) )
+typedef LONG mrAtomic;
+#else
+#define MR_ATOMIC_CAS(x, a, b)  __sync_bool_compare_and_swap( &(x), (a), (b) )
+typedef long mrAtomic;
+#endif
+
+
+namespace {
+
+const char* kIntervalNames[] = {
+  "wait",
+  "update",
+  "write",
+  "flush",
+  "render",
+  "total",
+  NULL
+};
+
+//! Time stamps of the stages of one update (0 if not reached).
+struct mrLatencyRecord
+{
+  double t[mrIPRLatency::kNumStages];
+  double bytes;
+
+  void clear()
+  {
+     memset( t, 0, sizeof(t) );
+     bytes = 0;
+  }
+};
+
+//! Last kNumSamples values of an interval, in milliseconds.
+struct mrLatencyRing
+{
+  double   v[mrIPRLatency::kNumSamples];
+  unsigned num;
+  unsigned next;
+
+  void add( double ms )
+  {
+     v[next] = ms;
+     next = ( next + 1 ) % mrIPRLatency::kNumSamples;
+     if ( num < mrIPRLatency::kNumSamples ) ++num;
+  }
+};
+
+mrLatencyRing   rings[mrIPRLatency::kNumIntervals];
+mrLatencyRecord building;     // update being prepared
+mrLatencyRecord flying;       // update sent, waiting for its first tile
+bool            pending = false;
+FILE*           logFile = NULL;
+
+// Handshake with the reader thread for the first tile of flying:
+//   kTileIdle -> (flushed) kTileArmed -> (tile) kTileStamping ->
+//   kTileDone -> (collect) kTileIdle
+enum {
+  kTileIdle,
+  kTileArmed,
+  kTileStamping,
+  kTileDone
+};
+volatile mrAtomic tileState = kTileIdle;
+volatile double   tileTime  = 0;
+
+
+//! Store the intervals of a finished update.
+void finish( mrLatencyRecord& r, double tile )
+{
+   double* t = r.t;
+   t[mrIPRLatency::kTile] = tile;
+
+   // Stages skipped (ie. no update_scene() when rendering passes) take
+   // no time.
+   for ( int i = 1; i < mrIPRLatency::kNumStages; ++i )
+      if ( t[i] == 0 ) t[i] = t[i-1];
+
+   double ms[mrIPRLatency::kNumIntervals];
+   for ( int i = 0; i < mrIPRLatency::kTotal; ++i )
+      ms[i] = ( t[i+1] - t[i] ) * 1000.0;
+   ms[mrIPRLatency::kTotal] = ( tile - t[mrIPRLatency::kCallback] ) * 1000.0;
+
+   for ( int i = 0; i < mrIPRLatency::kNumIntervals; ++i )
+      rings[i].add( ms[i] );
+
+   if ( logFile )
+   {
+      fprintf( logFile, "%.3f", t[mrIPRLatency::kCallback] );
+      for ( int i = 0; i < mrIPRLatency::kNumIntervals; ++i )
+	 fprintf( logFile, ",%.2f", ms[i] );
+      fprintf( logFile, ",%.0f\n", r.bytes );
+      fflush( logFile );
+   }
+}
+
+
+//! Pick up the first tile of the update in flight, if it arrived.
+void collect()
+{
+   if ( MR_ATOMIC_CAS( tileState, kTileDone, kTileIdle ) )
+      finish( flying, tileTime );
+}
+
+} // namespace
+
+
+
+void mrIPRLatency::callback()
+{
+   if ( pending ) return;
+   building.clear();
+   building.t[kCallback] = mr_wall_time();
+   pending = true;
+}
+
+
+void mrIPRLatency::idle()
+{
+   collect();
+   double now = mr_wall_time();
+   if ( !pending )
+   {
+      // Update not started by a callback (time change, progressive
+      // passes, etc).
+      building.clear();
+      building.t[kCallback] = now;
+      pending = true;
+   }
+   building.t[kIdle] = now;
+}
+
+
+void mrIPRLatency::updated( MRL_FILE* f )
+{
+   if ( !pending ) return;
+   building.t[kUpdated] = mr_wall_time();
+   building.bytes = mr_bytes_written( f );
+}
+
+
+void mrIPRLatency::written( MRL_FILE* f )
+{
+   if ( !pending ) return;
+   building.t[kWritten] = mr_wall_time();
+   if ( building.t[kUpdated] == 0 ) building.bytes = 0;
+   else building.bytes = mr_bytes_written( f ) - building.bytes;
+}
+
+
+void mrIPRLatency::flushed()
+{
+   if ( !pending ) return;
+   collect();
+
+   // If the previous update never got a tile back (its render was
+   // stopped by this one), it is dropped.
+   building.t[kFlushed] = mr_wall_time();
+   flying    = building;
+   pending   = false;
+   tileState = kTileArmed;
+}
+
+
+void mrIPRLatency::tile()
+{
+   if ( tileState != kTileArmed ) return;
+   if ( ! MR_ATOMIC_CAS( tileState, kTileArmed, kTileStamping ) ) return;
+   tileTime = mr_wall_time();
+   MR_ATOMIC_CAS( tileState, kTileStamping, kTileDone );
+}
+
+
+void mrIPRLatency::reset()
+{
+   for ( int i = 0; i < kNumIntervals; ++i )
+      rings[i].num = rings[i].next = 0;
+}
+
+
+bool mrIPRLatency::log( const MString& file )
+{
+   if ( logFile ) fclose( logFile );
+   logFile = NULL;
+   if ( file.length() == 0 ) return true;
+
+   logFile = fopen( file.asChar(), "a" );
+   if ( !logFile ) return false;
+
+   // Only a new (empty) file gets the header line.
+   fseek( logFile, 0, SEEK_END );
+   if ( ftell( logFile ) == 0 )
+   {
+      fprintf( logFile, "start" );
+      for ( int i = 0; i < kNumIntervals; ++i )
+	 fprintf( logFile, ",%s", kIntervalNames[i] );
+      fprintf( logFile, ",bytes\n" );
+   }
+   return true;
+}
+
+
+double mrIPRLatency::percentile( const Interval i, const double p )
+{
+   collect();
+   const mrLatencyRing& r = rings[i];
+   if ( r.num == 0 ) return -1;
+
+   double v[kNumSamples];
+   memcpy( v, r.v, r.num * sizeof(double) );
+   std::sort( v, v + r.num );
+
+   // Nearest rank
+   int k = (int) ceil( p / 100.0 * r.num ) - 1;
+   if ( k < 0 ) k = 0;
+   if ( k >= (int) r.num ) k = r.num - 1;
+   return v[k];
+}
+
+
+unsigned mrIPRLatency::samples( const Interval i )
+{
+   collect();
+   return rings[i].num;
+}
+
+
+mrIPRLatency::Interval mrIPRLatency::interval( const MString& name )
+{
+   int i = 0;
+   for ( ; i < kNumIntervals; ++i )
+      if ( name == kIntervalNames[i] ) break;
+   return (Interval) i;
+}
+
+
+MStringArray mrIPRLatency::report()
+{
+   MStringArray lines;
+   for ( int i = 0; i < kNumIntervals; ++i )
+   {
+      Interval s = (Interval) i;
+      char tmp[256];
+      sprintf( tmp, "%-6s %4u  p50 %8.1f  p90 %8.1f  p99 %8.1f  "
+	       "max %8.1f ms", kIntervalNames[i], samples( s ),
+	       percentile( s, 50 ), percentile( s, 90 ),
+	       percentile( s, 99 ), percentile( s, 100 ) );
+      lines.append( tmp );
+   }
+   return lines;
+}
@@ -0,0 +1,134 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+/**
+ * @file   mrIPRLatency.h
+ * 
+ * @brief  Wall clock timings of each stage of an IPR update, from the
+ *         first maya callback to the first tile back in the render view.
+ * 
+ */
+
+#ifndef mrIPRLatency_h
+#define mrIPRLatency_h
+
+#include "maya/MString.h"
+#include "maya/MStringArray.h"
+
+#ifndef mrIO_h
+#include "mrIO.h"
+#endif
+
+
+//! Times the stages of each IPR update and keeps rolling percentiles of
+//! the last kNumSamples updates.
+//!
+//! An update starts with the first attr_cb/connection_cb after the
+//! previous one was sent and ends when the first tile of its render
+//! comes back.  Intervals kept are:
+//!
+//!   - wait:   first callback   -> idle_cb decides to update
+//!   - update: idle_cb          -> nodes updated (before writing)
+//!   - write:  nodes updated    -> database written
+//!   - flush:  database written -> render command flushed to pipe
+//!   - render: pipe flushed     -> first tile read back
+//!   - total:  first callback   -> first tile read back
+//!
+//! All calls but tile() are done from maya's main thread.  tile() is
+//! called from the render view's reader thread and just stores a time
+//! stamp, which the main thread picks up later.
+class mrIPRLatency
+{
+   public:
+     enum Stage
+     {
+       kCallback,
+       kIdle,
+       kUpdated,
+       kWritten,
+       kFlushed,
+       kTile,
+       kNumStages
+     };
+
+     enum Interval
+     {
+       kWait,
+       kUpdate,
+       kWrite,
+       kFlush,
+       kRender,
+       kTotal,
+       kNumIntervals
+     };
+
+     static const unsigned kNumSamples = 256;
+
+     //! Maya callback arrived.  Only the first one of an update counts.
+     static void callback();
+
+     //! idle_cb is about to update the scene.
+     static void idle();
+
+     //! Nodes were updated.  f is the stream the database is written to.
+     static void updated( MRL_FILE* f );
+
+     //! Database was written to f.
+     static void written( MRL_FILE* f );
+
+     //! Render command was flushed to mental ray.
+     static void flushed();
+
+     //! A tile was read back (from the render view's reader thread).
+     static void tile();
+
+     //! Clear all samples.
+     static void reset();
+
+     //! Append a line per finished update to file (or stop, if file
+     //! is empty).
+     static bool log( const MString& file );
+
+     //! Percentile p (0-100) of interval, in milliseconds.  Returns -1
+     //! if there are no samples.
+     static double percentile( const Interval i, const double p );
+
+     //! Number of samples of interval.
+     static unsigned samples( const Interval i );
+
+     //! Index of an interval from its name, or kNumIntervals.
+     static Interval interval( const MString& name );
+
+     //! A line per interval with its name, count, p50, p90, p99 and max.
+     static MStringArray report();
+};
+
+
+#endif // mrIPRLatency_h
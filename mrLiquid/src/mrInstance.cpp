@@ -39,6 +39,9 @@
 #include "mrImagePlane.h"
 #include "mrInstanceGeoShader.h"
 
+#include "maya/MAnimUtil.h"
+#include "maya/MFnAttribute.h"
+
 
 #if MAYA_API_VERSION >= 700
 #include "maya/MFnRenderLayer.h"
@@ -108,7 +111,44 @@ void mrInstanceGroup::write(MRL_FILE* f)
 
 
 /** 
- * This method checks whether the instance is animated.
+ * Returns true if any transform attribute of a dag node (translate,
+ * rotate, scale, pivots, etc) is driven by a connection, like those of
+ * constraints, driven keys, expressions or rigs.
+ * 
+ */
+static bool mrTransformIsDriven( const MObject& node )
+{
+   MFnDependencyNode dep( node );
+   MPlugArray connAttrs;
+   dep.getConnections( connAttrs );
+   unsigned numConn = connAttrs.length();
+   MPlugArray plugs;
+   for ( unsigned i = 0; i < numConn; ++i )
+   {
+      connAttrs[i].connectedTo( plugs, true, false );
+      if ( plugs.length() == 0 ) continue;
+
+      MFnAttribute attr( connAttrs[i].attribute() );
+      MString name = attr.name();
+      const char* n = name.asChar();
+      if ( strncmp( n, "translate", 9 ) == 0 ||
+	   strncmp( n, "rotate", 6 )    == 0 ||
+	   strncmp( n, "scale", 5 )     == 0 ||
+	   strncmp( n, "shear", 5 )     == 0 ||
+	   strncmp( n, "jointOrient", 11 ) == 0 ||
+	   strcmp( n, "inheritsTransform" ) == 0 ||
+	   strcmp( n, "offsetParentMatrix" ) == 0 )
+	 return true;
+   }
+   return false;
+}
+
+
+/** 
+ * This method checks whether the instance is animated, and whether
+ * its world matrix can change over time (moving).  An instance that is
+ * not animated itself still moves with an animated or constrained
+ * parent.
  * 
  */
 void mrInstance::isAnimated()
@@ -139,6 +179,23 @@ void mrInstance::isAnimated()
 	 }
       }
    }
+
+   moving = animated;
+   if ( moving || !path.isValid() ) return;
+
+   if ( MAnimUtil::isAnimated( path, true ) )
+   {
+      moving = true; return;
+   }
+
+   MDagPath p( path );
+   for ( ; p.length() > 0; p.pop() )
+   {
+      if ( mrTransformIsDriven( p.node() ) )
+      {
+	 moving = true; return;
+      }
+   }
 }
 
 /** 
@@ -359,6 +416,7 @@ path( instDagPath ),
 visible( kVInherit ),
 old_visible( kVInherit ),
 animated( false ),
+moving( false ),
 hide( false ),
 old_hide( false )
 {
@@ -390,6 +448,7 @@ shape(s),
 visible( kVInherit ),
 old_visible( kVInherit ),
 animated( false ),
+moving( false ),
 hide( false ),
 old_hide( false )
 {
@@ -406,6 +465,7 @@ path( instDagPath ),
 visible( kVInherit ),
 old_visible( kVInherit ),
 animated( false ),
+moving( false ),
 hide( false ),
 old_hide( false )
 {
@@ -629,8 +689,19 @@ void mrInstance::write_properties( MRL_FILE* f )
 }
 
 
+mrInstanceBase::MotionSampling mrInstance::motionSampling() const
+{
+   if ( options->motionBlur != mrOptions::kMotionBlurLinear &&
+	shape && shape->shapeAnimated )
+      return kMotionDeform;
+   if ( moving ) return kMotionTransform;
+   return kMotionNone;
+}
+
+
 void mrInstance::getMotionBlur( const char step )
 {
+   MRL_PROFILE( kMotionBlur );
    DBG("getMotionBlur " << (short) step);
    if ( step == options->motionSteps )
    {
@@ -663,6 +734,11 @@ void mrInstance::write_matrices( MRL_FILE* f )
 
 void mrInstance::write_instance( MRL_FILE* f )
 {
+   // Shape stopped (or started) sharing another object's definition
+   const MString& shapeName = shape->definitionName();
+   if ( written == kWritten && shapeName != shapeRef )
+      written = kIncremental;
+
    switch( written )
    {
       case kWritten:
@@ -673,7 +749,8 @@ void mrInstance::write_instance( MRL_FILE* f )
 	 MRL_PUTS( "incremental ");
    }
 
-   MRL_FPRINTF(f, "instance \"%s\" \"%s\"\n", name.asChar(), shape->name.asChar());
+   shapeRef = shapeName;
+   MRL_FPRINTF(f, "instance \"%s\" \"%s\"\n", name.asChar(), shapeName.asChar());
    write_properties(f);
    if(!hide) write_matrices(f);
    MRL_PUTS("end instance\n");
@@ -683,6 +760,7 @@ void mrInstance::write_instance( MRL_FILE* f )
 
 void mrInstance::write( MRL_FILE* f )
 {
+   MRL_PROFILE_WRITE( f );
    assert( shape != NULL );
    shape->write(f);
    if ( shape->written == kWritten )
@@ -766,6 +844,7 @@ void mrInstanceLight::setIncremental(bool sameFrame)
 
 void mrInstanceLight::write( MRL_FILE* f )
 {
+   MRL_PROFILE_WRITE( f );
    assert( shape != NULL );
    shape->write(f);
    if ( shape->written == kWritten && 
@@ -888,6 +967,7 @@ void mrInstanceCamera::setIncremental(bool sameFrame)
 
 void mrInstanceCamera::write( MRL_FILE* f )
 {
+   MRL_PROFILE_WRITE( f );
    assert( shape != NULL );
    shape->write(f);
    if ( shape->written == kWritten && 
@@ -58,6 +58,16 @@ class mrInstanceBase : public mrNode
 
      
    public:
+     //! What needs to be sampled at each motion step
+     enum MotionSampling
+     {
+        kMotionNone,      //!<- nothing moves
+        kMotionTransform, //!<- only the matrix at the last step
+        kMotionDeform     //!<- shape at every step
+     };
+
+     //! Which motion steps this instance needs to be visited at
+     virtual MotionSampling motionSampling() const { return kMotionNone; }
 
      //! Update instance and shape's motion blur information for current step
      virtual void getMotionBlur( const char step ) {};
@@ -110,7 +120,8 @@ class mrInstance : public mrInstanceBase
      //! Write out matrices for current instance
      void write_matrices( MRL_FILE* f );
      
-     //! Check to see if instance is animated in any way
+     //! Check to see if instance is animated in any way, and whether it
+     //! moves (also thru its parents or constraints).
      inline void isAnimated();
 
      //! Get new matrix for current frame (if needed)
@@ -140,6 +151,9 @@ class mrInstance : public mrInstanceBase
      //! Update instance incrementally (if needed)
      virtual void setIncremental( bool sameFrame );
 
+     //! Which motion steps this instance needs to be visited at
+     virtual MotionSampling motionSampling() const;
+
      //! Update instance and shape's motion blur information for current step
      virtual void getMotionBlur( const char step );
      
@@ -190,7 +204,11 @@ class mrInstance : public mrInstanceBase
      MDagPath path;  //! needed to support instancing with materials
 
      char visible, old_visible; 
-     bool  animated, hide, old_hide;
+     bool  animated;
+     bool  moving;   //! world matrix changes over time (see isAnimated())
+     bool  hide, old_hide;
+
+     MString shapeRef; //! object the instance was last written with
 };
 
 
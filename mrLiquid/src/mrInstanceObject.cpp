@@ -140,6 +140,7 @@ mrInstanceObjectBase::setFlags( const mrInheritableFlags* const flags ) throw()
 
 void mrInstanceObjectBase::getData()
 {
+   MRL_PROFILE( kGetData );
    int  old_label      = label;
    char old_visible    = visible;
    char old_trace      = trace;
@@ -354,6 +355,12 @@ motionBlur( true )
 
 
 
+mrInstanceBase::MotionSampling mrInstanceObjectBase::motionSampling() const
+{
+   if ( !motionBlur ) return kMotionNone;
+   return mrInstance::motionSampling();
+}
+
 void mrInstanceObjectBase::getMotionBlur( const char step )
 {
    if ( !motionBlur ) return;
@@ -619,6 +626,7 @@ void mrInstanceObjectBase::write_each_material( MRL_FILE* f )
 
 void mrInstanceObjectBase::write( MRL_FILE* f )
 {
+   MRL_PROFILE_WRITE( f );
    write_each_material( f );
    assert( shape != NULL );
    shape->write(f);
@@ -79,6 +79,9 @@ class mrInstanceObjectBase : public mrInstance
      virtual void write_properties( MRL_FILE* f ) throw();
      
    public:
+     //! Which motion steps this instance needs to be visited at
+     virtual MotionSampling motionSampling() const;
+
      //! Get motion blur of instance and shape for this step
      virtual void getMotionBlur( const char step );
 
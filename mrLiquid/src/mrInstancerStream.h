@@ -0,0 +1,80 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef mrInstancerStream_h
+#define mrInstancerStream_h
+
+//
+// Layout of the binary files mrParticlesInstancer writes for the
+// mrl_geo_instancer geometry shader, instead of one mi instance per
+// particle.  The file is written in the exporter's byte order and is
+// meant to be mapped into memory as is:
+//
+//   mrInstancerHeader
+//   names   - the instancer's name, then the name of each object
+//             instanced, all NUL terminated and padded to 4 bytes
+//             (namesSize bytes in all).
+//   records - count fixed size records, one per visible particle:
+//             unsigned object;      index into object names
+//             unsigned id;          index of the particle
+//             float    m[16];       global to local matrix
+//             float    mt[16];      motion matrix (if kInstancerMotion)
+//
+
+#define MRL_INSTANCER_MAGIC   "MRLI"
+#define MRL_INSTANCER_VERSION 1
+
+enum mrInstancerFlags
+{
+kInstancerMotion = 1
+};
+
+struct mrInstancerHeader
+{
+     char     magic[4];
+     int      version;
+     int      endian;      // 1 in the byte order of the writer
+     unsigned flags;
+     unsigned count;       // number of records
+     unsigned numObjects;
+     unsigned namesSize;
+};
+
+//! Size of each record for the given header flags
+inline unsigned mrInstancerStride( const unsigned flags )
+{
+   unsigned stride = 2 * sizeof(unsigned) + 16 * sizeof(float);
+   if ( flags & kInstancerMotion ) stride += 16 * sizeof(float);
+   return stride;
+}
+
+
+#endif // mrInstancerStream_h
@@ -74,6 +74,7 @@
 
 void mrLight::getData()
 {
+   MRL_PROFILE( kGetData );
    MFnLight fn( path );
    MStatus status;
    MPlug p;
@@ -242,6 +243,7 @@ void mrLight::write_camera( MRL_FILE* f )
 
 void mrLight::write( MRL_FILE* f )
 {
+   MRL_PROFILE_WRITE( f );
    DBG( name << ": write " << this);
    if ( options->exportFilter & mrOptions::kLights )
       return;
@@ -61,6 +61,7 @@
 
 void mrMeshBase::getData( bool sameFrame )
 {
+   MRL_PROFILE( kGetData );
    mrObject::getData( sameFrame );
 
    DBG(name << ": mrMeshBase::getData");
@@ -118,6 +119,123 @@ void mrMeshBase::getData( bool sameFrame )
 
       vxdata->add( attrName, data, numVerts );
    }
+
+   // Only fragment export (to skip unchanged frames) and automatic
+   // instancing look at the hash.  Per vertex user data is not hashed,
+   // so meshes with it are always written.
+   contentHash = 0;
+   if ( ( options->fragmentExport || options->exportAutoInstance ) && 
+	vxdata == NULL )
+      hash_contents( fn );
+}
+
+
+void mrMeshBase::hash_contents( MFnMesh& fn )
+{
+#if MAYA_API_VERSION >= 800
+   MStatus status; MPlug p;
+
+   // Animated approximations are not part of the hash.
+   p = fn.findPlug( "miDisplaceApprox", true, &status );
+   if ( status == MS::kSuccess && p.isConnected() )
+   {
+      MPlugArray plugs;
+      p.connectedTo( plugs, true, false );
+      if ( plugs.length() == 1 && MAnimUtil::isAnimated( plugs[0].node() ) )
+	 return;
+   }
+   p = fn.findPlug( "miApproxList", true, &status );
+   if ( status == MS::kSuccess )
+   {
+      unsigned num = p.numConnectedElements();
+      for ( unsigned i = 0; i < num; ++i )
+      {
+	 MPlugArray plugs;
+	 p.connectionByPhysicalIndex(i).connectedTo( plugs, true, false );
+	 if ( plugs.length() == 1 && MAnimUtil::isAnimated( plugs[0].node() ) )
+	    return;
+      }
+   }
+
+   mrContentHash h;
+   h.add( pts );
+   h.add( (int) trilist );
+   h.add( (int) hasReferenceObject );
+
+   MIntArray counts, ids;
+   fn.getVertices( counts, ids );
+   h.add( counts );
+   h.add( ids );
+
+   fn.getNormalIds( counts, ids );
+   h.add( ids );
+
+   MFloatVectorArray normals;
+   fn.getNormals( normals );
+   h.add( normals );
+
+   MStringArray uvsets;
+   fn.getUVSetNames( uvsets );
+   unsigned numUVSets = uvsets.length();
+   for ( unsigned i = 0; i < numUVSets; ++i )
+   {
+      MFloatArray u, v;
+      fn.getUVs( u, v, &uvsets[i] );
+      h.add( uvsets[i] );
+      h.add( u );
+      h.add( v );
+      fn.getAssignedUVs( counts, ids, &uvsets[i] );
+      h.add( ids );
+   }
+
+   unsigned numInstances = fn.instanceCount( false );
+   for ( unsigned i = 0; i < numInstances; ++i )
+   {
+      MObjectArray shaders;
+      fn.getConnectedShaders( i, shaders, ids );
+      h.add( shaders.length() );
+      h.add( ids );
+   }
+
+   if ( hasReferenceObject )
+   {
+      p = fn.findPlug( "referenceObject", true, &status );
+      MPlugArray plugs;
+      p.connectedTo( plugs, true, false );
+      if ( plugs.length() == 1 && plugs[0].node().hasFn( MFn::kMesh ) )
+      {
+	 MFnMesh pref( plugs[0].node() );
+	 MPointArray prefPt;
+	 pref.getPoints( prefPt, MSpace::kObject );
+	 h.add( prefPt );
+      }
+   }
+
+   // Approximations are written inside the object, so two meshes only
+   // match if they use the same approximation nodes.
+   MPlugArray plugs;
+   p = fn.findPlug( "miDisplaceApprox", true, &status );
+   if ( status == MS::kSuccess && p.isConnected() )
+   {
+      p.connectedTo( plugs, true, false );
+      if ( plugs.length() == 1 )
+	 h.add( MFnDependencyNode( plugs[0].node() ).name() );
+   }
+   p = fn.findPlug( "miApproxList", true, &status );
+   if ( status == MS::kSuccess )
+   {
+      unsigned num = p.numConnectedElements();
+      h.add( num );
+      for ( unsigned i = 0; i < num; ++i )
+      {
+	 p.connectionByPhysicalIndex(i).connectedTo( plugs, true, false );
+	 if ( plugs.length() == 1 )
+	    h.add( MFnDependencyNode( plugs[0].node() ).name() );
+      }
+   }
+
+   contentHash = h.value();
+#endif
 }
 
 
@@ -226,6 +344,7 @@ mrMeshBase* mrMeshBase::factory( const MDagPath& shape )
 
 void mrMeshBase::getMotionBlur( const char step )
 {
+   MRL_PROFILE( kMotionBlur );
    prepareMotionBlur();
    if ( mb == NULL ) return;
    
@@ -584,17 +703,16 @@ void mrMesh::calculateDerivatives( const MFloatArray& u,
 
 
 
+// Binary vertex data is collected in a block and swapped and written
+// all at once in write_trilist().
 #define WRITE_UV(t) \
-      MAKE_BIGENDIAN(t[0]); \
-      MAKE_BIGENDIAN(t[1]); \
-      MRL_FWRITE( t, sizeof(float), 2, f );
+      block.insert( block.end(), t, t + 2 );
 
 #define WRITE_VECTOR(t) \
-      MAKE_BIGENDIAN_V(t); \
-      MRL_FWRITE( t, sizeof(float), 3, f );
+      block.insert( block.end(), t, t + 3 );
 
 
-mrMesh::VertexStore* 
+unsigned
 mrMesh::in_hash( const unsigned polyId, const unsigned i, const unsigned id,
 		 const MFloatVectorArray& n, const unsigned nid,
 		 const unsigned*    uvbase,
@@ -604,59 +722,47 @@ mrMesh::in_hash( const unsigned polyId, const unsigned i, const unsigned id,
 		 const unsigned      numUVSets,
 		 const MStringArray& uvsets )
 {
-  VertexHash_t::iterator vtxIt  = vertexHash.find( id );
-  VertexHash_t::iterator vtxEnd = vertexHash.end();
-  if ( vtxIt == vtxEnd ) return NULL;
-
-  vtxEnd = vertexHash.upper_bound( id );
-
-  for ( ; vtxIt != vtxEnd; ++vtxIt )
+  // compare vertex normal and uvs.  All corners returned by find()
+  // share vertex and normal already.
+  //
+  // ideal, but not correct.  we would need to get if edge is
+  // smooth or not.
+  // 	  if ( ( s->nid != nid && n[s->nid].isEquivalent(n[nid]) ) ||
+  unsigned s = vertexHash.find( id, nid );
+  for ( ; s != mrCornerHash::kNone; s = vertexHash.next( s ) )
     {
-      // compare vertex normal and uvs. 
-      VertexStore* s = vtxIt->second;
-
-      // ideal, but not correct.  we would need to get if edge is
-      // smooth or not.
-      // 	  if ( ( s->nid != nid && n[s->nid].isEquivalent(n[nid]) ) ||
+      const int* oldIds = vertexHash.uvIds( s );
 
-      if ( ( s->nid != nid ) || 
-	   ( s->uvId.length() != numUVSets ) )
-	{
-	  continue;
-	}
-      else
+      // still same vertex, check uvs now
+      unsigned uv;
+      int uvId;
+      for ( uv = 0; uv < numUVSets; ++uv )
 	{
-	  // still same vertex, check uvs now
-	  unsigned uv;
-	  int uvId;
-	  for ( uv = 0; uv < numUVSets; ++uv )
-	    {
-	      if ( uvCounts[uv][polyId] == 0 ) continue;
+	  if ( uvCounts[uv][polyId] == 0 ) continue;
 
-	      // while uv is same, continue.
-	      unsigned pos = i + uvbase[uv];
-	      uvId = uvIds[uv][pos];
+	  // while uv is same, continue.
+	  unsigned pos = i + uvbase[uv];
+	  uvId = uvIds[uv][pos];
 
-	      int oldId = s->uvId[uv];
-	      if ( oldId == uvId ) continue;
+	  int oldId = oldIds[uv];
+	  if ( oldId == uvId ) continue;
 		  
-	      // if uv is different, break.
-	      assert( uvId  < (int) u[uv].length() );
-	      assert( oldId < (int) u[uv].length() );
-
-	      if ( oldId < 0 || uvId < 0 ||
-		   fabs(u[uv][oldId] - u[uv][uvId]) > 0.001f ||
-		   fabs(v[uv][oldId] - v[uv][uvId]) > 0.001f ) 
-		break;
-	    }
+	  // if uv is different, break.
+	  assert( uvId  < (int) u[uv].length() );
+	  assert( oldId < (int) u[uv].length() );
+
+	  if ( oldId < 0 || uvId < 0 ||
+	       fabs(u[uv][oldId] - u[uv][uvId]) > 0.001f ||
+	       fabs(v[uv][oldId] - v[uv][uvId]) > 0.001f ) 
+	    break;
+	}
 
-	  if ( uv < numUVSets ) continue;
+      if ( uv < numUVSets ) continue;
 	      
-	  return s;
-	}
+      return s;
     }
 
-  return NULL;
+  return mrCornerHash::kNone;
 }
 
 void mrMesh::hash_trilist_vertex( const unsigned polyId,
@@ -672,21 +778,18 @@ void mrMesh::hash_trilist_vertex( const unsigned polyId,
 				  const MStringArray& uvsets )
 {
 
-  VertexStore* s = in_hash( polyId, i, id, n, nid,
-			    uvbase, uvCounts, uvIds, u, v, 
-			    numUVSets, uvsets );
-  if ( s )
+  unsigned s = in_hash( polyId, i, id, n, nid,
+			uvbase, uvCounts, uvIds, u, v, 
+			numUVSets, uvsets );
+  if ( s != mrCornerHash::kNone )
     {
-      meshTriangles.push_back( s->vid );
+      meshTriangles.push_back( s );
       return;
     }
       
   // new vertex, store info in hash
-  s = new VertexStore();
-  s->id  = id;
-  s->vid = vertexHash.size();
-  s->nid = nid;
-  s->uvId.setLength( numUVSets );
+  s = vertexHash.insert( id, nid );
+  int* uvIdList = vertexHash.uvIds( s );
   int uvId;
   for ( unsigned uv = 0; uv < numUVSets; ++uv )
     {
@@ -703,185 +806,194 @@ void mrMesh::hash_trilist_vertex( const unsigned polyId,
 	  uvId = uvIds[uv][i + uvbase[uv]];
 	}
 
-      s->uvId[uv] = uvId;
+      uvIdList[uv] = uvId;
     }
 
-  vertexHash.insert( std::make_pair( id, s ) );
-  meshTriangles.push_back( s->vid );
-
-  triList.push_back( s );
+  meshTriangles.push_back( s );
 }
 
 
-void mrMesh::write_trilist_vertex( MRL_FILE* f, 
-				   const VertexStore* const s,
+void mrMesh::write_trilist_vertex( std::vector< float >& block, 
+				   const unsigned s,
 				   const MFloatVectorArray& n,
 				   const unsigned     numUVSets,
 				   const MFloatArray* u,
 				   const MFloatArray* v,
 				   const MPointArray& pref )
 { 
-  unsigned id  = s->id;
-  unsigned nid = s->nid;
+  unsigned id  = vertexHash.vertex( s );
+  unsigned nid = vertexHash.normal( s );
+  const int* uvIds = vertexHash.uvIds( s );
   bool hasDerivs = ( options->exportPolygonDerivatives && 
 		     (dPdu.length() > 0) );
   bool hasPref = (pref.length() > 0 );
 
-  if ( options->exportBinary )
+  float tmp[3];
+  tmp[0] = (float)pts[id].x;
+  tmp[1] = (float)pts[id].y;
+  tmp[2] = (float)pts[id].z;
+  WRITE_VECTOR(tmp);
+  tmp[0] = (float)n[nid].x;
+  tmp[1] = (float)n[nid].y;
+  tmp[2] = (float)n[nid].z;
+  WRITE_VECTOR(tmp);
+  if ( mb )
     {
-      float tmp[3];
-      tmp[0] = (float)pts[id].x;
-      tmp[1] = (float)pts[id].y;
-      tmp[2] = (float)pts[id].z;
-      WRITE_VECTOR(tmp);
-      tmp[0] = (float)n[nid].x;
-      tmp[1] = (float)n[nid].y;
-      tmp[2] = (float)n[nid].z;
-      WRITE_VECTOR(tmp);
-      if ( mb )
+      for ( short t = 0; t < options->motionSteps; ++t )
 	{
-	  for ( short t = 0; t < options->motionSteps; ++t )
-	    {
-	      tmp[0] = (float)mb[t][id].x;
-	      tmp[1] = (float)mb[t][id].y;
-	      tmp[2] = (float)mb[t][id].z;
-	      WRITE_VECTOR(tmp);
-	    }
+	  tmp[0] = (float)mb[t][id].x;
+	  tmp[1] = (float)mb[t][id].y;
+	  tmp[2] = (float)mb[t][id].z;
+	  WRITE_VECTOR(tmp);
 	}
-      
-      if ( numUVSets > 0 )
+    }
+
+  if ( numUVSets > 0 )
+    {
+      float2 uv;
+      for ( unsigned h = 0; h < numUVSets; ++h )
 	{
-	  float2 uv;
-	  for ( unsigned h = 0; h < numUVSets; ++h )
-	    {
 
-	      int uvId = s->uvId[h];
+	  int uvId = uvIds[h];
 
-	      if ( uvId < 0 )
-		{
-		  uv[0] = uv[1] = 0;
-		}
-	      else
-		{
-		  assert( uvId < (int) u[h].length() );
-		  assert( uvId < (int) v[h].length() );
+	  if ( uvId < 0 )
+	    {
+	      uv[0] = uv[1] = 0;
+	    }
+	  else
+	    {
+	      assert( uvId < (int) u[h].length() );
+	      assert( uvId < (int) v[h].length() );
 
-		  uv[0] = u[h][uvId];
-		  uv[1] = v[h][uvId];
-		}
+	      uv[0] = u[h][uvId];
+	      uv[1] = v[h][uvId];
+	    }
 
 
-	      WRITE_UV(uv);
-	    }
+	  WRITE_UV(uv);
+	}
 
-	  if ( hasDerivs )
+      if ( hasDerivs )
+	{
+	  int uvId = uvIds[0];
+	  if ( uvId < 0 )
 	    {
-	      int uvId = s->uvId[0];
-	      if ( uvId < 0 )
-		{
-		  tmp[0] = tmp[1] = tmp[2] = 0.0f;
-		  WRITE_VECTOR(tmp);
-		  WRITE_VECTOR(tmp);
-		}
-	      else
-		{
-		  assert( uvId < (int) dPdu.length() );
-		  assert( uvId < (int) dPdv.length() );
-
-		  tmp[0] = (float)dPdu[uvId].x;
-		  tmp[1] = (float)dPdu[uvId].y;
-		  tmp[2] = (float)dPdu[uvId].z;
-		  WRITE_VECTOR(tmp);
-		  tmp[0] = (float)dPdv[uvId].x;
-		  tmp[1] = (float)dPdv[uvId].y;
-		  tmp[2] = (float)dPdv[uvId].z;
-		  WRITE_VECTOR(tmp);
-		}
+	      tmp[0] = tmp[1] = tmp[2] = 0.0f;
+	      WRITE_VECTOR(tmp);
+	      WRITE_VECTOR(tmp);
+	    }
+	  else
+	    {
+	      assert( uvId < (int) dPdu.length() );
+	      assert( uvId < (int) dPdv.length() );
+
+	      tmp[0] = (float)dPdu[uvId].x;
+	      tmp[1] = (float)dPdu[uvId].y;
+	      tmp[2] = (float)dPdu[uvId].z;
+	      WRITE_VECTOR(tmp);
+	      tmp[0] = (float)dPdv[uvId].x;
+	      tmp[1] = (float)dPdv[uvId].y;
+	      tmp[2] = (float)dPdv[uvId].z;
+	      WRITE_VECTOR(tmp);
 	    }
 	}
+    }
 
-      if ( hasPref )
-	{
-	  assert( id < pref.length() );
+  if ( hasPref )
+    {
+      assert( id < pref.length() );
 
-	  tmp[0] = (float)pref[id].x;
-	  tmp[1] = (float)pref[id].y;
-	  tmp[2] = (float)pref[id].z;
-	  WRITE_VECTOR(tmp);
-	}
-      
-      if ( vxdata )
+      tmp[0] = (float)pref[id].x;
+      tmp[1] = (float)pref[id].y;
+      tmp[2] = (float)pref[id].z;
+      WRITE_VECTOR(tmp);
+    }
+
+  if ( vxdata )
+    {
+      vxdata->write_trilist( block, id );
+    }
+}
+
+
+void mrMesh::write_trilist_vertex( MRL_FILE* f, 
+				   const unsigned s,
+				   const MFloatVectorArray& n,
+				   const unsigned     numUVSets,
+				   const MFloatArray* u,
+				   const MFloatArray* v,
+				   const MPointArray& pref )
+{ 
+  unsigned id  = vertexHash.vertex( s );
+  unsigned nid = vertexHash.normal( s );
+  const int* uvIds = vertexHash.uvIds( s );
+  bool hasDerivs = ( options->exportPolygonDerivatives && 
+		     (dPdu.length() > 0) );
+  bool hasPref = (pref.length() > 0 );
+
+  MRL_FPRINTF( f, "%g %g %g %g %g %g", pts[id].x, pts[id].y, pts[id].z, 
+	   n[nid].x, n[nid].y, n[nid].z );
+  if ( mb )
+    {
+      for ( short t= 0; t < options->motionSteps; ++t )
 	{
-	  vxdata->write_trilist( f, id );
+	  MRL_FPRINTF( f, " %g %g %g", 
+		   mb[t][id].x, mb[t][id].y, mb[t][id].z );
 	}
-
     }
-  else
+  if ( numUVSets > 0 )
     {
-      MRL_FPRINTF( f, "%g %g %g %g %g %g", pts[id].x, pts[id].y, pts[id].z, 
-	       n[nid].x, n[nid].y, n[nid].z );
-      if ( mb )
+      float2 uv;
+      for ( unsigned h = 0; h < numUVSets; ++h )
 	{
-	  for ( short t= 0; t < options->motionSteps; ++t )
+
+	  int uvId = uvIds[h];
+
+	  if ( uvId < 0 )
 	    {
-	      MRL_FPRINTF( f, " %g %g %g", 
-		       mb[t][id].x, mb[t][id].y, mb[t][id].z );
+	      uv[0] = uv[1] = 0;
 	    }
-	}
-      if ( numUVSets > 0 )
-	{
-	  float2 uv;
-	  for ( unsigned h = 0; h < numUVSets; ++h )
+	  else
 	    {
+	      assert( uvId < (int) u[h].length() );
+	      assert( uvId < (int) v[h].length() );
 
-	      int uvId = s->uvId[h];
-
-	      if ( uvId < 0 )
-		{
-		  uv[0] = uv[1] = 0;
-		}
-	      else
-		{
-		  assert( uvId < (int) u[h].length() );
-		  assert( uvId < (int) v[h].length() );
+	      uv[0] = u[h][uvId];
+	      uv[1] = v[h][uvId];
+	    }
 
-		  uv[0] = u[h][uvId];
-		  uv[1] = v[h][uvId];
-		}
+	  MRL_FPRINTF( f, " %g %g", uv[0], uv[1] );
+	}
 
-	      MRL_FPRINTF( f, " %g %g", uv[0], uv[1] );
+      if ( hasDerivs )
+	{
+	  int uvId = uvIds[0];
+	  if ( uvId < 0 )
+	    {
+	      MRL_PUTS( " 0 0 0 0 0 0" );
 	    }
-
-	  if ( hasDerivs )
+	  else
 	    {
-	      int uvId = s->uvId[0];
-	      if ( uvId < 0 )
-		{
-		  MRL_PUTS( " 0 0 0 0 0 0" );
-		}
-	      else
-		{
-		  assert( uvId < (int) dPdu.length() );
-		  assert( uvId < (int) dPdv.length() );
+	      assert( uvId < (int) dPdu.length() );
+	      assert( uvId < (int) dPdv.length() );
 
-		  MRL_FPRINTF( f, " %g %g %g %g %g %g", 
-			   dPdu[uvId].x, dPdu[uvId].y, dPdu[uvId].z,
-			   dPdv[uvId].x, dPdv[uvId].y, dPdv[uvId].z );
-		}
+	      MRL_FPRINTF( f, " %g %g %g %g %g %g", 
+		       dPdu[uvId].x, dPdu[uvId].y, dPdu[uvId].z,
+		       dPdv[uvId].x, dPdv[uvId].y, dPdv[uvId].z );
 	    }
 	}
-      if ( hasPref )
-	{
-	  assert( id < pref.length() );
+    }
+  if ( hasPref )
+    {
+      assert( id < pref.length() );
 
-	  MRL_FPRINTF( f, " %g %g %g", pref[id][0], pref[id][1], pref[id][2] );
-	}
-      if ( vxdata )
-	{
-	  vxdata->write_trilist( f, id );
-	}
-      MRL_PUTC('\n');
+      MRL_FPRINTF( f, " %g %g %g", pref[id][0], pref[id][1], pref[id][2] );
+    }
+  if ( vxdata )
+    {
+      vxdata->write_trilist( f, id );
     }
+  MRL_PUTC('\n');
 }
 
 
@@ -1068,8 +1180,8 @@ void mrMesh::write_trilist( MRL_FILE* f )
 
   DBG( "mrMesh::write_trilist " << __LINE__ );
 
-  unsigned numFaceVertices = m.numFaceVertices();
-  triList.reserve( numFaceVertices );     // probably be less than this
+  // Most corners get welded, so expect about one per mesh vertex.
+  vertexHash.init( numUVSets, numMeshVerts );
 
   unsigned numPolys = triangleCounts.length();
   meshTriangles.reserve( numPolys * 2 );  // estimate all faces = quads
@@ -1126,9 +1238,8 @@ void mrMesh::write_trilist( MRL_FILE* f )
   delete [] uvIds;
 
   triangleVerts.clear();
-  vertexHash.clear();
 
-  unsigned numFaceVerts = triList.size();
+  unsigned numFaceVerts = vertexHash.size();
 
   DBG( "mrMesh::write_trilist " << __LINE__ );
 
@@ -1186,18 +1297,34 @@ void mrMesh::write_trilist( MRL_FILE* f )
 
 
   { // Write vertices
-    TriList_t::const_iterator i = triList.begin();
-    TriList_t::const_iterator e = triList.end();
-    for ( ; i != e; ++i )
+    if ( options->exportBinary )
+    {
+      // Collect vertices in blocks, swap and write each in one go.
+      static const unsigned kBlockVerts = 16384;
+      std::vector< float > block;
+      for ( unsigned i = 0; i < numFaceVerts; ++i )
+      {
+	write_trilist_vertex( block, i, normals, numUVSets, u, v, prefPt );
+	if ( (i + 1) % kBlockVerts == 0 || i + 1 == numFaceVerts )
+	{
+	  MAKE_BIGENDIAN_ARRAY( &block[0], block.size() );
+	  MRL_FWRITE( &block[0], sizeof(float), block.size(), f );
+	  block.clear();
+	}
+      }
+    }
+    else
     {
-      write_trilist_vertex( f, *i, normals, numUVSets, u, v, prefPt );
-      delete *i; // clear this vertex cache
+      for ( unsigned i = 0; i < numFaceVerts; ++i )
+      {
+	write_trilist_vertex( f, i, normals, numUVSets, u, v, prefPt );
+      }
     }
   }
 
   DBG( "mrMesh::write_trilist " << __LINE__ );
   // Clear temporary caches
-  triList.clear();
+  vertexHash.clear();
   delete [] u;
   delete [] v;
 
@@ -1255,10 +1382,7 @@ void mrMesh::write_trilist( MRL_FILE* f )
     {
       unsigned totalVertices = totalTriangles*3;
       
-      for ( unsigned i = 0; i < totalVertices; ++i )
-	{
-	  meshTriangles[i] = htonl( meshTriangles[i] );
-	}
+      MAKE_BIGENDIAN_ARRAY( &meshTriangles[0], totalVertices );
 
       MRL_PUTS("integer `");
       MRL_FWRITE( &meshTriangles[0], sizeof(unsigned), totalVertices, f );
@@ -1279,11 +1403,10 @@ void mrMesh::write_trilist( MRL_FILE* f )
 	      int materialTag = 0;
 	      if ( i < numMaterialIds ) materialTag = materialId[i];
 
-	      m[idx] = materialTag;
-	      m[idx] = htonl( m[idx] );
-	      ++idx;
+	      m[idx++] = materialTag;
 	    }
 	}
+      MAKE_BIGENDIAN_ARRAY( m, totalTriangles );
 
       MRL_PUTS("integer `");
       MRL_FWRITE( m, sizeof(int), totalTriangles, f );
@@ -1591,6 +1714,7 @@ void mrMesh::write_group( MRL_FILE* f )
    unsigned numPolys = m.numPolygons();
 
    meshTriangles.reserve( m.numFaceVertices() );
+   vertexHash.init( numUVSets, numMeshVerts );
 
    { //////////// START OF SPITTING VERTICES
 
@@ -1615,20 +1739,17 @@ void mrMesh::write_group( MRL_FILE* f )
 
 	    // @todo: should this use hash_trilist_vertex instead?
 
-	    VertexStore* s = in_hash( i, j, vId, normals, nId,
-				      uvbase, uvCounts, uvIds, 
-				      u, v, numUVSets, uvset );
+	    unsigned s = in_hash( i, j, vId, normals, nId,
+				  uvbase, uvCounts, uvIds, 
+				  u, v, numUVSets, uvset );
 
-	    if ( s ) {
-	      meshTriangles.push_back( s->vid );
+	    if ( s != mrCornerHash::kNone ) {
+	      meshTriangles.push_back( s );
 	      continue;
 	    }
 
-	    s = new VertexStore;
-	    // s->id  = vId;  // unneeded
-	    s->nid = nId;
-	    s->vid = vertexHash.size();
-	    s->uvId.setLength( numUVSets );
+	    s = vertexHash.insert( vId, nId );
+	    int* uvIdList = vertexHash.uvIds( s );
 	    int uvId = -1;
 	    for ( unsigned uv = 0; uv < numUVSets; ++uv )
 	      {
@@ -1636,10 +1757,9 @@ void mrMesh::write_group( MRL_FILE* f )
 		  uvId = uvIds[uv][j+uvbase[uv]];
 		else
 		  uvId = -1;
-		s->uvId[uv] = uvId;
+		uvIdList[uv] = uvId;
 	      }
-	    vertexHash.insert( std::make_pair( vId, s ) );
-	    meshTriangles.push_back( s->vid );
+	    meshTriangles.push_back( s );
 	    ////////// end of hash_trilist_vertex
 
 	    TAB(2); MRL_FPRINTF( f, "v %d", vId);
@@ -1758,15 +1878,7 @@ void mrMesh::write_group( MRL_FILE* f )
    delete [] u;
    delete [] v;
 
-   {
-     VertexHash_t::const_iterator i = vertexHash.begin();
-     VertexHash_t::const_iterator e = vertexHash.end();
-     for ( ; i != e; ++i )
-       {
-	 delete i->second;
-       }
-     vertexHash.clear();
-   }
+   vertexHash.clear();
    
    { //////////// START OF SPITTING POLYGONS
       TAB(2); COMMENT( "# polygons\n" );
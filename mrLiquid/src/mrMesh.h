@@ -46,6 +46,10 @@ class MFnMesh;
 #include "mrUserDataVertex.h"
 #endif
 
+#ifndef mrCornerHash_h
+#include "mrCornerHash.h"
+#endif
+
 class MItMeshPolygon;
 
 //! Base class used for polygonal meshes and for polygonal
@@ -71,6 +75,10 @@ protected:
   void getInfo();
   void getData( bool sameFrame );
 
+  //! Set contentHash from the mesh's points, topology, normals, uvs
+  //! and per face materials.
+  void hash_contents( MFnMesh& fn );
+
 protected:     
   bool trilist;
   bool hasReferenceObject;
@@ -104,14 +112,8 @@ protected:
   mrMesh( const MString& name );
   mrMesh( const MDagPath& shape );
 
-  struct VertexStore {
-    unsigned id;
-    unsigned vid;
-    unsigned nid;
-    MIntArray uvId;
-  };
-  typedef std::multimap< unsigned int, VertexStore* > VertexHash_t;
-  VertexHash_t vertexHash;
+  //! Unique corners of the mesh.  Index of corner is its vertex number.
+  mrCornerHash vertexHash;
 
   struct holeStore {
     holeStore( unsigned num, unsigned off ) : 
@@ -126,9 +128,6 @@ protected:
   HolesHash_t holesHash;
   MIntArray   holeVerts;
 
-  typedef std::vector< VertexStore* >                 TriList_t;
-  TriList_t triList;
-
   void getLocalIndex( const unsigned numVerts,
 		      const unsigned vertbase,
 		      const MIntArray& vertexIds,
@@ -136,15 +135,15 @@ protected:
 		      int indices[3] );
 
 
-  VertexStore* in_hash( const unsigned polyId,
-			const unsigned i, const unsigned id,
-			const MFloatVectorArray& n, const unsigned nid,
-			const unsigned*    uvbase,
-			const MIntArray*   uvCounts,
-			const MIntArray*   uvIds,
-			const MFloatArray* u, const MFloatArray* v,
-			const unsigned      numUVSets,
-			const MStringArray& uvsets );
+  unsigned in_hash( const unsigned polyId,
+		    const unsigned i, const unsigned id,
+		    const MFloatVectorArray& n, const unsigned nid,
+		    const unsigned*    uvbase,
+		    const MIntArray*   uvCounts,
+		    const MIntArray*   uvIds,
+		    const MFloatArray* u, const MFloatArray* v,
+		    const unsigned      numUVSets,
+		    const MStringArray& uvsets );
 
 
   void hash_trilist_vertex( const unsigned polyId,
@@ -160,8 +159,16 @@ protected:
 			    const unsigned      numUVSets,
 			    const MStringArray& uvsets );
 
+  void write_trilist_vertex( std::vector< float >& block,
+			     const unsigned s,
+			     const MFloatVectorArray& n,
+			     const unsigned numUVSets,
+			     const MFloatArray* u,
+			     const MFloatArray* v,
+			     const MPointArray& pref );
+
   void write_trilist_vertex( MRL_FILE* f, 
-			     const VertexStore* const s,
+			     const unsigned s,
 			     const MFloatVectorArray& n,
 			     const unsigned numUVSets,
 			     const MFloatArray* u,
@@ -193,7 +200,7 @@ public:
 
 protected:
   void write_trilist_vertex( std::vector< miVector >& vectors, 
-			     const VertexStore* const s,
+			     const unsigned s,
 			     const MFloatVectorArray& n,
 			     const unsigned numUVSets,
 			     const MFloatArray* u,
@@ -265,7 +265,7 @@ void mrMeshSubd::forceIncremental()
    mrMeshBase::forceIncremental();
 }
 
-mrMeshSubd::VertexStore* 
+unsigned
 mrMeshSubd::in_hash( const unsigned polyId,
 		     const unsigned i, const unsigned id,
 		     const unsigned*    uvbase,
@@ -275,46 +275,33 @@ mrMeshSubd::in_hash( const unsigned polyId,
 		     const unsigned numUVSets,
 		     const MStringArray& uvsets )
 {
-  VertexHash_t::iterator vtxIt  = vertexHash.find( id );
-  VertexHash_t::iterator vtxEnd = vertexHash.end();
-  if ( vtxIt == vtxEnd ) return NULL;
-
-  vtxEnd = vertexHash.upper_bound( id );
-  for ( ; vtxIt != vtxEnd; ++vtxIt )
+  unsigned s = vertexHash.find( id, 0 );
+  for ( ; s != mrCornerHash::kNone; s = vertexHash.next( s ) )
     {
-      // compare vertex normal and uvs. 
-      VertexStore* s = vtxIt->second;
-
-      if ( s->uvId.length() != numUVSets )
-	{
-	  continue;
-	}
-      else
+      // same vertex, check uvs now
+      const int* oldIds = vertexHash.uvIds( s );
+      unsigned uv;
+      int uvId;
+      for ( uv = 0; uv < numUVSets; ++uv )
 	{
-	  // still same vertex, check uvs now
-	  unsigned uv;
-	  int uvId;
-	  for ( uv = 0; uv < numUVSets; ++uv )
-	    {
-	      if ( uvCounts[uv][polyId] == 0 ) continue;
-	      // while uv is same, continue.
-	      unsigned pos = i + uvbase[uv];
-	      uvId = uvIds[uv][pos];
-	      if ( s->uvId[uv] == uvId ) continue;
+	  if ( uvCounts[uv][polyId] == 0 ) continue;
+	  // while uv is same, continue.
+	  unsigned pos = i + uvbase[uv];
+	  uvId = uvIds[uv][pos];
+	  if ( oldIds[uv] == uvId ) continue;
 		  
-	      // if uv is different, break.
-	      pos = s->uvId[uv];
-	      if ( fabs(u[uv][pos] - u[uv][uvId]) > 0.001f ||
-		   fabs(v[uv][pos] - v[uv][uvId]) > 0.001f ) 
-		break;
-	    }
-	      
-	  if ( uv >= numUVSets )
-	    return s;
+	  // if uv is different, break.
+	  pos = oldIds[uv];
+	  if ( fabs(u[uv][pos] - u[uv][uvId]) > 0.001f ||
+	       fabs(v[uv][pos] - v[uv][uvId]) > 0.001f ) 
+	    break;
 	}
+	      
+      if ( uv >= numUVSets )
+	return s;
     }
 
-  return NULL;
+  return mrCornerHash::kNone;
 }
 
 
@@ -441,6 +428,7 @@ void mrMeshSubd::write_group( MRL_FILE* f )
    } //////////// END OF SPITTING MOTION VECTORS
 
    unsigned numPolys = m.numPolygons();
+   vertexHash.init( numUVSets, numMeshVerts );
    
    { //////////// START OF SPITTING VERTICES
 
@@ -459,16 +447,15 @@ void mrMeshSubd::write_group( MRL_FILE* f )
 	  {
 	    vId = vertexIds[idx++];
 
-	    VertexStore* s = in_hash( i, j, vId, uvbase, uvCounts, uvIds, 
-				      u, v, numUVSets, uvset );
-	    if ( s ) {
-	      meshTriangles.push_back( s->vid );
+	    unsigned s = in_hash( i, j, vId, uvbase, uvCounts, uvIds, 
+				  u, v, numUVSets, uvset );
+	    if ( s != mrCornerHash::kNone ) {
+	      meshTriangles.push_back( s );
 	      continue;
 	    }
 
-	    s = new VertexStore;
-	    s->vid = vertexHash.size();
-	    s->uvId.setLength( numUVSets );
+	    s = vertexHash.insert( vId, 0 );
+	    int* uvIdList = vertexHash.uvIds( s );
 	    int uvId;
 	    for ( unsigned uv = 0; uv < numUVSets; ++uv )
 	      {
@@ -476,9 +463,9 @@ void mrMeshSubd::write_group( MRL_FILE* f )
 		  uvId = uvIds[uv][j+uvbase[uv]];
 		else
 		  uvId = 0;
-		s->uvId[uv] = uvId;
+		uvIdList[uv] = uvId;
 	      }
-	    meshTriangles.push_back( s->vid );
+	    meshTriangles.push_back( s );
 
 
 	    MRL_FPRINTF( f, "v %d", vId );
@@ -555,7 +542,6 @@ void mrMeshSubd::write_group( MRL_FILE* f )
 	       }
 	    }
 
-	    vertexHash.insert( std::make_pair( vId, s ) );
 	    MRL_PUTC( '\n' );
 	  }
 	
@@ -924,14 +910,9 @@ void mrMeshSubd::write_group( MRL_FILE* f )
    } //////////// END OF SPITTING POLYGONS
 
 
-   { // Clear vertex hash
-     VertexHash_t::iterator i = vertexHash.begin();
-     VertexHash_t::iterator e = vertexHash.end();
-     for ( ; i != e; ++i )
-       delete i->second;
-     vertexHash.clear();
-     meshTriangles.clear();
-   }
+   // Clear vertex hash
+   vertexHash.clear();
+   meshTriangles.clear();
 }
 
 
@@ -61,22 +61,17 @@ protected:
      virtual void           write_group( MRL_FILE* f );
      virtual void   write_approximation( MRL_FILE* f );
 
-  struct VertexStore {
-    unsigned  vid;
-    MIntArray uvId;
-  };
+  //! Unique corners of the mesh.  Index of corner is its vertex number.
+  mrCornerHash vertexHash;
 
-  typedef std::multimap< unsigned int, VertexStore* > VertexHash_t;
-  VertexHash_t vertexHash;
-
-  VertexStore* in_hash( const unsigned polyId,
-			const unsigned i, const unsigned id,
-			const unsigned*    uvbase,
-			const MIntArray*   uvCounts,
-			const MIntArray*   uvIds,
-			const MFloatArray* u, const MFloatArray* v,
-			const unsigned numUVSets,
-			const MStringArray& uvsets );
+  unsigned in_hash( const unsigned polyId,
+		    const unsigned i, const unsigned id,
+		    const unsigned*    uvbase,
+		    const MIntArray*   uvCounts,
+		    const MIntArray*   uvIds,
+		    const MFloatArray* u, const MFloatArray* v,
+		    const unsigned numUVSets,
+		    const MStringArray& uvsets );
      
 public:
      virtual ~mrMeshSubd();
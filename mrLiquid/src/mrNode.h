@@ -60,6 +60,10 @@
 #include "mrHelpers.h"
 #endif
 
+#ifndef mrProfiler_h
+#include "mrProfiler.h"
+#endif
+
 //! Base class from which most/all other translation nodes are derived.
 class mrNode
 {
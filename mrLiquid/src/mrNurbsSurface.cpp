@@ -188,6 +188,7 @@ mrNurbsSurface* mrNurbsSurface::factory( const MDagPath& shape )
 
 void mrNurbsSurface::getMotionBlur( const char step )
 {
+   MRL_PROFILE( kMotionBlur );
    prepareMotionBlur();
    if ( mb == NULL ) return;
    
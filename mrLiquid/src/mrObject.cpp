@@ -29,9 +29,18 @@
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //
 
+#include <cstdio>
+#include <cstring>
+#include <map>
+
 #include "mrUserDataObject.h"
 #include "mrObject.h"
 #include "mrHelpers.h"
+#include "mrHexEncode.h"
+
+#ifdef MRL_MEMORY_FILES
+#include "mrThread.h"
+#endif
 
 extern MString miDir;
 extern MString sceneName;
@@ -98,6 +107,8 @@ mrShape( s ),
 miText( NULL ),
 #endif
 mb( NULL ),
+contentHash( 0 ),
+fragmentKey( 0 ),
 maxDisplace( -1 ),
 rayOffset(0),
 label(0),
@@ -132,6 +143,8 @@ mrShape( shapePath ),
 miText( NULL ),
 #endif
 mb( NULL ),
+contentHash( 0 ),
+fragmentKey( 0 ),
 maxDisplace( -1 ),
 rayOffset(0),
 label(0),
@@ -448,6 +461,7 @@ void mrObject::setIncremental( bool sameFrame )
  */
 void mrObject::getData( bool sameFrame )
 {
+   MRL_PROFILE( kGetData );
    DBG(name <<":  mrObject::getData");
 
    MFnDagNode fn( path ); MPlug p; MStatus status;
@@ -746,12 +760,12 @@ void mrObject::write_user_data( MRL_FILE* f )
 
 
 /** 
- * Open a new mi file for saving object to
- * 
+ * Return the name of the mi file to save the object to in
+ * fragment export (creating its directory, if needed).
  * 
- * @return MRL_FILE* to new mi file.
+ * @return name of fragment mi file.
  */
-MRL_FILE* mrObject::new_mi_file()
+MString mrObject::fragment_filename()
 {
    MString file = miDir;
    MString fileroot = path.partialPathName();
@@ -792,10 +806,24 @@ MRL_FILE* mrObject::new_mi_file()
       file += frame;
    }
    file += ".mi2";
+   return file;
+}
+
 
+/** 
+ * Open a new mi file for saving object to
+ * 
+ * @param file name of file, as returned by fragment_filename().
+ * 
+ * @return MRL_FILE* to new mi file.
+ */
+MRL_FILE* mrObject::new_mi_file( const MString& file )
+{
    MString msg = "Opening \"" + file + "\"";
    LOG_MESSAGE(msg);
 
+   // Fragments are $included or passed to -mi_fragment by their .mi2
+   // name, so they are never compressed.
    MRL_FILE* f = MRL_FOPEN( file.asChar(), "wb" );
    if (!f) {
       MString err = "Could not open \"";
@@ -806,6 +834,369 @@ MRL_FILE* mrObject::new_mi_file()
    return f;
 }
 
+
+/** 
+ * Return a key for everything written to the object's fragment
+ * file: the shape's contentHash, its object flags and its motion
+ * vectors.
+ * 
+ * @return key or 0 if the shape did not provide a content hash.
+ */
+mrContentHash::Key mrObject::fragment_key() const
+{
+   if ( contentHash == 0 ) return 0;
+#ifndef MR_NO_CUSTOM_TEXT
+   if ( miText ) return 0;
+#endif
+
+   mrContentHash h;
+   h.add( contentHash );
+   h.add( maxDisplace );
+   h.add( rayOffset );
+   h.add( label );
+   h.add( (int) caustic );
+   h.add( (int) globillum );
+   h.add( (int) minSamples );
+   h.add( (int) maxSamples );
+#if MAYA_API_VERSION >= 650
+   h.add( (int) shadow );
+   h.add( (int) transparency );
+   h.add( (int) reflection );
+   h.add( (int) refraction );
+   h.add( (int) finalgather );
+   h.add( (int) face );
+#else
+   h.add( (int) trace );
+   h.add( (int) shadow );
+#endif
+   h.add( (int) visible );
+   h.add( (int) shadowmap );
+
+   if ( mb )
+   {
+      for ( int i = 0; i < options->motionSteps; ++i )
+	 h.add( mb[i] );
+   }
+   return h.value();
+}
+
+
+/** 
+ * Check whether the fragment about to be written is the same as the
+ * last one saved for this object.  If so, hard link (or copy) the
+ * old file to the new name instead of exporting the object again.
+ * This catches shapes that are flagged as animated (skinned, with
+ * deformers, etc) but that do not move on some frames.
+ * 
+ * @param file name of this frame's fragment file.
+ * 
+ * @return true if the old fragment was reused.
+ */
+bool mrObject::reuse_fragment( const MString& file )
+{
+   mrContentHash::Key key = fragment_key();
+   if ( key != 0 && key == fragmentKey && fileExists( fragmentFile ) )
+   {
+      if ( file == fragmentFile || linkFile( fragmentFile, file ) )
+      {
+	 if ( options->exportVerbosity > 4 )
+	 {
+	    MString msg = name + ": unchanged, reusing \"";
+	    msg += fragmentFile;
+	    msg += "\"";
+	    LOG_MESSAGE(msg);
+	 }
+	 return true;
+      }
+   }
+
+   fragmentKey  = key;
+   fragmentFile = file;
+   return false;
+}
+
+
+/** 
+ * Return a key for an object's definition, for automatic instancing.
+ * This is the fragment key of the object, if it is not deforming and
+ * has no user data attached.
+ * 
+ * @return key or 0 if the object should not be shared.
+ */
+mrContentHash::Key mrObject::instance_key() const
+{
+   if ( shapeAnimated || !user.empty() ) return 0;
+   return fragment_key();
+}
+
+
+namespace {
+
+//! An object written out and the objects that became instances of it.
+struct mrSharedObject
+{
+  MString            name;
+  unsigned long long bytes;  // size of its definition in the .mi file
+  unsigned           copies; // since last reportSharedObjects()
+  unsigned           points;
+  mrSharedObject() : bytes(0), copies(0), points(0) {}
+};
+
+typedef std::map< mrContentHash::Key, mrSharedObject > mrSharedObjects;
+mrSharedObjects sharedObjects;
+
+}
+
+
+void mrObject::clearSharedObjects()
+{
+   sharedObjects.clear();
+}
+
+
+void mrObject::reportSharedObjects()
+{
+   unsigned masters = 0, copies = 0, points = 0;
+   unsigned long long bytes = 0;
+   mrSharedObjects::iterator i = sharedObjects.begin();
+   mrSharedObjects::iterator e = sharedObjects.end();
+   for ( ; i != e; ++i )
+   {
+      mrSharedObject& s = i->second;
+      if ( s.copies == 0 ) continue;
+      ++masters;
+      copies += s.copies;
+      points += s.points;
+      bytes  += s.bytes * s.copies;
+      s.copies = s.points = 0;
+   }
+
+   char buf[256];
+   sprintf( buf, "Automatic instancing: %u objects written as instances "
+	    "of %u others, saving %u vertices and %.2f Mb of .mi data.",
+	    copies, masters, points, bytes / (1024.0 * 1024.0) );
+   LOG_MESSAGE( buf );
+}
+
+
+bool mrObject::same_vertices( const mrObject* o ) const
+{
+   unsigned num = pts.length();
+   if ( o->pts.length() != num ) return false;
+   for ( unsigned i = 0; i < num; ++i )
+   {
+      const MPoint& a = pts[i];
+      const MPoint& b = o->pts[i];
+      // MPoint::operator== uses a tolerance, so compare each component.
+      if ( a.x != b.x || a.y != b.y || a.z != b.z || a.w != b.w )
+	 return false;
+   }
+
+   if ( (mb == NULL) != (o->mb == NULL) ) return false;
+   if ( mb == NULL ) return true;
+
+   for ( int s = 0; s < options->motionSteps; ++s )
+   {
+      unsigned numMb = mb[s].length();
+      if ( o->mb[s].length() != numMb ) return false;
+      for ( unsigned i = 0; i < numMb; ++i )
+      {
+	 const MFloatVector& a = mb[s][i];
+	 const MFloatVector& b = o->mb[s][i];
+	 if ( a.x != b.x || a.y != b.y || a.z != b.z )
+	    return false;
+      }
+   }
+   return true;
+}
+
+
+bool mrObject::share_definition( mrContentHash::Key& key )
+{
+   key = 0;
+   if ( masterName.length() > 0 )
+   {
+      // Keep using the other object's definition while both are
+      // unchanged.  Otherwise, write this object out for real.
+      if ( written == kWritten )
+      {
+	 mrObject* o = dynamic_cast< mrObject* >( mrShape::find( masterName ) );
+	 if ( o && o->written == kWritten && o->masterName.length() == 0 &&
+	      o->instance_key() == instance_key() && same_vertices( o ) )
+	    return true;
+      }
+      masterName = "";
+      written = kNotWritten;
+   }
+
+   if ( written != kNotWritten || !options->exportAutoInstance ||
+	options->IPR || options->fragmentExport || options->lightMap )
+      return false;
+
+   mrContentHash::Key k = instance_key();
+   if ( k == 0 ) return false;
+
+   mrSharedObject& s = sharedObjects[k];
+   if ( s.name.length() > 0 && s.name != name )
+   {
+      mrObject* o = dynamic_cast< mrObject* >( mrShape::find( s.name ) );
+      // The key only finds a candidate.  Its vertices must match too,
+      // so a hash collision does not make this a copy of another shape.
+      if ( o && o->written == kWritten && o->masterName.length() == 0 &&
+	   same_vertices( o ) )
+      {
+	 masterName = s.name;
+	 ++s.copies;
+	 s.points += pts.length();
+	 written = kWritten;
+	 return true;
+      }
+   }
+
+   s.name  = name;
+   s.bytes = 0;
+   key = k;
+   return false;
+}
+
+
+#ifdef MRL_MEMORY_FILES
+
+//! Number of elements each thread formats at a time.
+static const unsigned kAsciiChunk = 16384;
+
+struct mrAsciiChunks
+{
+  mrObject::AsciiWriter func;
+  const void* a;
+  const void* b;
+  unsigned    num;
+  unsigned    first;  // first chunk of this batch
+  MRL_FILE**  bufs;
+};
+
+static void write_ascii_chunk( unsigned i, void* data )
+{
+   mrAsciiChunks* c = (mrAsciiChunks*) data;
+   unsigned start = (c->first + i) * kAsciiChunk;
+   unsigned end   = start + kAsciiChunk;
+   if ( end > c->num ) end = c->num;
+   c->func( c->bufs[i], c->a, c->b, start, end );
+}
+
+#endif
+
+
+/** 
+ * Write out num ascii elements of arrays a and b, using func.
+ *
+ * With options->exportThreads set, big arrays get formatted in chunks
+ * into memory buffers by several threads.  The buffers are then
+ * written in order, so the output does not change.  Only the
+ * formatting runs in the threads, all Maya calls remain in the main one.
+ * 
+ * @param f     MRL_FILE* descriptor to mi file
+ * @param func  function writing a range of elements
+ * @param a     first array
+ * @param b     second array (or NULL)
+ * @param num   number of elements
+ */
+void mrObject::write_ascii( MRL_FILE* f, AsciiWriter func,
+			    const void* a, const void* b, unsigned num )
+{
+#ifdef MRL_MEMORY_FILES
+   unsigned threads = options->exportThreads;
+   if ( options->exportThreads < 0 ) threads = mr_num_cpus();
+
+   unsigned numChunks = ( num + kAsciiChunk - 1 ) / kAsciiChunk;
+   if ( threads > 1 && numChunks > 1 )
+   {
+      // Do a few chunks per thread at a time, to keep memory use bounded.
+      unsigned batch = threads * 2;
+      if ( batch > numChunks ) batch = numChunks;
+
+      mrAsciiChunks c;
+      c.func  = func;
+      c.a     = a;
+      c.b     = b;
+      c.num   = num;
+      c.bufs  = new MRL_FILE*[batch];
+      for ( unsigned i = 0; i < batch; ++i )
+	 c.bufs[i] = mrlFile::memory( kAsciiChunk * 32 );
+
+      for ( c.first = 0; c.first < numChunks; c.first += batch )
+      {
+	 unsigned n = numChunks - c.first;
+	 if ( n > batch ) n = batch;
+	 mr_parallel_for( n, write_ascii_chunk, &c, threads );
+	 for ( unsigned i = 0; i < n; ++i )
+	 {
+	    f->append( c.bufs[i] );
+	    c.bufs[i]->rewind();
+	 }
+      }
+
+      for ( unsigned i = 0; i < batch; ++i )
+	 MRL_FCLOSE( c.bufs[i] );
+      delete [] c.bufs;
+      return;
+   }
+#endif
+
+   func( f, a, b, 0, num );
+}
+
+
+/** 
+ * Write out num elements of arrays a and b as binary vectors, using
+ * func to pack them.
+ *
+ * Each vector is still written as `xyz` as .mi requires, but the
+ * vectors are packed, byte swapped and framed in big blocks which are
+ * written with a single call.
+ * 
+ * @param f     MRL_FILE* descriptor to mi file
+ * @param func  function packing a range of elements as floats
+ * @param a     first array
+ * @param b     second array (or NULL)
+ * @param num   number of elements
+ */
+void mrObject::write_binary( MRL_FILE* f, BinaryPacker func,
+			     const void* a, const void* b, unsigned num )
+{
+   static const unsigned kChunk = 8192;
+   static const unsigned kVectorSize = 3 * sizeof(float) + 3;
+
+   // Packers store at most two vectors per element
+   float* t   = new float[ kChunk * 2 * 3 ];
+   char*  buf = new char[ kChunk * 2 * kVectorSize ];
+
+   for ( unsigned start = 0; start < num; start += kChunk )
+   {
+      unsigned end = start + kChunk;
+      if ( end > num ) end = num;
+
+      unsigned numVectors = func( t, a, b, start, end );
+      MAKE_BIGENDIAN_ARRAY( t, numVectors * 3 );
+
+      char* d = buf;
+      const float* v = t;
+      for ( unsigned i = 0; i < numVectors; ++i, v += 3 )
+      {
+	 *d++ = '`';
+	 memcpy( d, v, 3 * sizeof(float) );
+	 d += 3 * sizeof(float);
+	 *d++ = '`';
+	 *d++ = '\n';
+      }
+      MRL_FWRITE( buf, sizeof(char), d - buf, f );
+   }
+
+   delete [] buf;
+   delete [] t;
+}
+
+
 /** 
  * Write out a list of floats as 'HEX' into MRL_FILE* stream or as binary to
  * a new pre-opened file MRL_FILE*.
@@ -828,18 +1219,44 @@ void mrObject::write_hex_floats( MRL_FILE* f, const float* data, unsigned size )
 	 return;
       }
 
-      for ( unsigned i = 0; i < size; ++i )
+      if ( size == 0 )
       {
-	 if ( i % 8 == 0 ) {
-	    if ( i > 0 ) MRL_PUTS("\'\n");
-	    TAB(2); MRL_PUTC('\'');
-	 }
+	 MRL_PUTS("'\n");
+	 return;
+      }
+
+      // Each line is '<8 floats as hex>', encoded a chunk of lines at
+      // a time.  Floats are written as their bytes in memory order
+      // (what swapping to big endian and printing with %08x gives).
+#ifdef DEBUG
+      static const unsigned kTabs = 2;
+#else
+      static const unsigned kTabs = 0;
+#endif
+      static const unsigned kPerLine   = 8;
+      static const unsigned kLineSize  = kTabs + 3 + kPerLine * 8;
+      static const unsigned kChunk     = 1024;  // lines
 
-	 float t = data[i];
-	 MAKE_BIGENDIAN(t);
-	 MRL_FPRINTF( f, "%08x", *((int*)&t) );
+      char* buf = new char[ kChunk * kLineSize ];
+      for ( unsigned start = 0; start < size; start += kChunk * kPerLine )
+      {
+	 unsigned end = start + kChunk * kPerLine;
+	 if ( end > size ) end = size;
+
+	 char* d = buf;
+	 for ( unsigned i = start; i < end; i += kPerLine )
+	 {
+	    unsigned num = end - i;
+	    if ( num > kPerLine ) num = kPerLine;
+	    for ( unsigned t = 0; t < kTabs; ++t ) *d++ = '\t';
+	    *d++ = '\'';
+	    d = mr_hex_encode( d, data + i, num * sizeof(float) );
+	    *d++ = '\'';
+	    *d++ = '\n';
+	 }
+	 MRL_FWRITE( buf, sizeof(char), d - buf, f );
       }
-      MRL_PUTS("'\n");
+      delete [] buf;
    }
 }
 
@@ -868,6 +1285,7 @@ void mrObject::write_hex_floats( MRL_FILE* f, const float* data, unsigned size )
  */
 void mrObject::write( MRL_FILE* f )
 {
+   MRL_PROFILE_WRITE( f );
    if ( options->exportFilter & mrOptions::kObjects )
       return;
 
@@ -883,7 +1301,13 @@ void mrObject::write( MRL_FILE* f )
      {
 	if ( shapeAnimated || frame == frameFirst )
 	{
-	   f = new_mi_file();
+	   MString file = fragment_filename();
+	   if ( reuse_fragment( file ) )
+	   {
+	      written = kWritten;
+	      return;
+	   }
+	   f = new_mi_file( file );
 	}
 	else 
         {
@@ -893,6 +1317,10 @@ void mrObject::write( MRL_FILE* f )
      }
    }
    
+   mrContentHash::Key sharedKey;
+   if ( share_definition( sharedKey ) )
+      return;
+
    switch( written )
    {
       case kWritten:
@@ -902,6 +1330,10 @@ void mrObject::write( MRL_FILE* f )
    }
 
    DBG(name << ": mrObject::write()");
+
+#ifdef MRL_MEMORY_FILES
+   unsigned long long start = f->tell();
+#endif
    
    MRL_FPRINTF(f, "object \"%s\"\n", name.asChar() );
    write_properties(f);
@@ -930,6 +1362,10 @@ void mrObject::write( MRL_FILE* f )
    NEWLINE();
    written = kWritten;
 
+#ifdef MRL_MEMORY_FILES
+   if ( sharedKey ) sharedObjects[sharedKey].bytes = f->tell() - start;
+#endif
+
    DBG(name << ": mrObject::write() DONE");
    
 
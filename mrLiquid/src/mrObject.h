@@ -51,6 +51,7 @@
 
 #ifndef mrShape_h
 #include "mrShape.h"
+#include "mrContentHash.h"
 #endif
 
 #ifndef mrUserData_h
@@ -124,6 +125,26 @@ public:
 
   static void write_hex_floats( MRL_FILE* f, const float* data, unsigned size );
 
+  //! Function writing ascii elements [start, end) of array a (and b).
+  typedef void (*AsciiWriter)( MRL_FILE* f, const void* a, const void* b,
+			       unsigned start, unsigned end );
+
+  //! Write num ascii elements with func.  If options->exportThreads
+  //! allows it, large arrays are formatted in chunks on several threads
+  //! and then written in order, so the output is the same.
+  static void write_ascii( MRL_FILE* f, AsciiWriter func,
+			   const void* a, const void* b, unsigned num );
+
+  //! Function storing elements [start, end) of array a (and b) as
+  //! floats, 3 per vector.  Returns the number of vectors stored.
+  typedef unsigned (*BinaryPacker)( float* t, const void* a, const void* b,
+				    unsigned start, unsigned end );
+
+  //! Write num elements as binary vectors with func.  Elements are
+  //! packed, byte swapped and written out in large blocks.
+  static void write_binary( MRL_FILE* f, BinaryPacker func,
+			    const void* a, const void* b, unsigned num );
+
 
 protected:
   mrObject( const MString& s ); // for image plane
@@ -155,7 +176,30 @@ protected:
      
   virtual void getData( bool sameFrame );
   virtual void isAnimated();
-  MRL_FILE* new_mi_file();
+  MString   fragment_filename();
+  MRL_FILE* new_mi_file( const MString& file );
+
+  //! Key of everything written in the object's fragment file
+  //! (0 if unknown).
+  mrContentHash::Key fragment_key() const;
+
+  //! If the fragment for this frame would be the same as the last one
+  //! written, reuse that file for file and return true.
+  bool reuse_fragment( const MString& file );
+
+  //! Key of the object's definition for automatic instancing (0 if the
+  //! object cannot be shared).
+  mrContentHash::Key instance_key() const;
+
+  //! Compare the points and motion vectors of o with this object's, bit
+  //! for bit.  Used to verify that a matching instance_key() is not a
+  //! hash collision.
+  bool same_vertices( const mrObject* o ) const;
+
+  //! With automatic instancing, check if an identical object was already
+  //! written.  If so, set masterName to it and return true.  If not,
+  //! key is set so the object's size can be recorded once written.
+  bool share_definition( mrContentHash::Key& key );
 
 public:
 
@@ -168,6 +212,14 @@ public:
   MPointArray         pts;
   MFloatVectorArray*   mb;
 
+  // Hash of points, topology and uvs, set by getData() of shapes that
+  // support it (0 = unknown, always rewrite fragment).
+  mrContentHash::Key contentHash;
+
+  // Last fragment file written and its key
+  mrContentHash::Key fragmentKey;
+  MString            fragmentFile;
+
   mrUserDataList user;
 
 #ifdef GEOSHADER_H
@@ -190,6 +242,13 @@ public:
 
      
 public:
+  //! Forget the objects seen for automatic instancing.
+  static void clearSharedObjects();
+
+  //! Print how many objects were written as instances of others since
+  //! the last call, and the .mi data that saved.
+  static void reportSharedObjects();
+
   void clearMotionBlur();
 
   virtual void write( MRL_FILE* f );
@@ -269,37 +328,205 @@ public:
 
 
 
-#define WRITE_VECTOR(t) \
-      MAKE_BIGENDIAN_V(t); \
-      MRL_PUTC('`'); \
-      MRL_FWRITE( t, sizeof(float), 3, f ); \
-      MRL_PUTS("`\n");
+
+//
+// Ascii writers for the write_vectors() functions below, passed to
+// mrObject::write_ascii().
+//
+template< class A >
+void mr_ascii_xyz( MRL_FILE* f, const void* a, const void*,
+		   unsigned start, unsigned end )
+{
+   const A& pts = *static_cast< const A* >( a );
+   for ( unsigned i = start; i < end; ++i )
+   {
+      TAB(2);
+      MRL_FPRINTF(f, "%g %g %g\n", pts[i].x, pts[i].y, pts[i].z);
+   }
+}
+
+template< class A >
+void mr_ascii_xyzw( MRL_FILE* f, const void* a, const void*,
+		    unsigned start, unsigned end )
+{
+   const A& pts = *static_cast< const A* >( a );
+   for ( unsigned i = start; i < end; ++i )
+   {
+      TAB(2);
+      MRL_FPRINTF(f, "%g %g %g\n", pts[i].x, pts[i].y, pts[i].z);
+      TAB(2);
+      MRL_FPRINTF(f, "%g 0 0\n", pts[i].w);
+   }
+}
+
+template< class A >
+void mr_ascii_rgb( MRL_FILE* f, const void* a, const void*,
+		   unsigned start, unsigned end )
+{
+   const A& cols = *static_cast< const A* >( a );
+   for ( unsigned i = start; i < end; ++i )
+   {
+      TAB(2);
+      MRL_FPRINTF( f, "%g %g %g\n", cols[i].r, cols[i].g, cols[i].b );
+   }
+}
+
+template< class A >
+void mr_ascii_u( MRL_FILE* f, const void* a, const void*,
+		 unsigned start, unsigned end )
+{
+   const A& u = *static_cast< const A* >( a );
+   for ( unsigned i = start; i < end; ++i )
+   {
+      TAB(2);
+      MRL_FPRINTF(f, "%g 0 0\n", u[i]);
+   }
+}
 
 inline
-void mrObject::write_user_vectors( MRL_FILE* f, const MPointArray& pts )
+void mr_ascii_int( MRL_FILE* f, const void* a, const void*,
+		   unsigned start, unsigned end )
 {
-   unsigned num = pts.length();
-   if ( options->exportBinary )
+   const MIntArray& u = *static_cast< const MIntArray* >( a );
+   for ( unsigned i = start; i < end; ++i )
    {
-      float t[4], t2[4]; t2[1] = t2[2] = 0.0f;
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 pts[i].get( t ); 
-	 WRITE_VECTOR(t);
-	 t2[0] = t[3];
-	 WRITE_VECTOR(t);
-      }
+      TAB(2);
+      MRL_FPRINTF(f, "%d 0 0\n", u[i]);
    }
-   else
+}
+
+template< class A >
+void mr_ascii_uv( MRL_FILE* f, const void* a, const void* b,
+		  unsigned start, unsigned end )
+{
+   const A& u = *static_cast< const A* >( a );
+   const A& v = *static_cast< const A* >( b );
+   for ( unsigned i = start; i < end; ++i )
+   {
+      TAB(2);
+      MRL_FPRINTF(f, "%g %g 0\n", u[i], v[i]);
+   }
+}
+
+template< class A >
+void mr_ascii_derivs( MRL_FILE* f, const void* a, const void* b,
+		      unsigned start, unsigned end )
+{
+   const A& dPdu = *static_cast< const A* >( a );
+   const A& dPdv = *static_cast< const A* >( b );
+   for ( unsigned i = start; i < end; ++i )
+   {
+      TAB(2);
+      MRL_FPRINTF(f, "%g %g %g\n", dPdu[i].x, dPdu[i].y, dPdu[i].z);
+      TAB(2);
+      MRL_FPRINTF(f, "%g %g %g\n", dPdv[i].x, dPdv[i].y, dPdv[i].z);
+   }
+}
+
+//
+// Binary packers for the write_vectors() functions below, passed to
+// mrObject::write_binary().  They store elements [start, end) of
+// array a (and b) as floats in t and return the number of vectors.
+//
+template< class A >
+unsigned mr_binary_xyz( float* t, const void* a, const void*,
+			unsigned start, unsigned end )
+{
+   const A& pts = *static_cast< const A* >( a );
+   for ( unsigned i = start; i < end; ++i, t += 3 )
+   {
+      t[0] = (float) pts[i].x;
+      t[1] = (float) pts[i].y;
+      t[2] = (float) pts[i].z;
+   }
+   return end - start;
+}
+
+template< class A >
+unsigned mr_binary_xyzw( float* t, const void* a, const void*,
+			 unsigned start, unsigned end )
+{
+   const A& pts = *static_cast< const A* >( a );
+   for ( unsigned i = start; i < end; ++i, t += 6 )
+   {
+      t[0] = (float) pts[i].x;
+      t[1] = (float) pts[i].y;
+      t[2] = (float) pts[i].z;
+      t[3] = (float) pts[i].w;
+      t[4] = t[5] = 0.0f;
+   }
+   return (end - start) * 2;
+}
+
+template< class A >
+unsigned mr_binary_rgb( float* t, const void* a, const void*,
+			unsigned start, unsigned end )
+{
+   const A& cols = *static_cast< const A* >( a );
+   for ( unsigned i = start; i < end; ++i, t += 3 )
+   {
+      t[0] = cols[i].r;
+      t[1] = cols[i].g;
+      t[2] = cols[i].b;
+   }
+   return end - start;
+}
+
+template< class A >
+unsigned mr_binary_u( float* t, const void* a, const void*,
+		      unsigned start, unsigned end )
+{
+   const A& u = *static_cast< const A* >( a );
+   for ( unsigned i = start; i < end; ++i, t += 3 )
    {
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 TAB(2);
-	 MRL_FPRINTF(f, "%g %g %g\n", pts[i].x, pts[i].y, pts[i].z);
-	 TAB(2);
-	 MRL_FPRINTF(f, "%g 0 0\n", pts[i].w);
-      }
+      t[0] = (float) u[i];
+      t[1] = t[2] = 0.0f;
    }
+   return end - start;
+}
+
+template< class A >
+unsigned mr_binary_uv( float* t, const void* a, const void* b,
+		       unsigned start, unsigned end )
+{
+   const A& u = *static_cast< const A* >( a );
+   const A& v = *static_cast< const A* >( b );
+   for ( unsigned i = start; i < end; ++i, t += 3 )
+   {
+      t[0] = (float) u[i];
+      t[1] = (float) v[i];
+      t[2] = 0.0f;
+   }
+   return end - start;
+}
+
+template< class A >
+unsigned mr_binary_derivs( float* t, const void* a, const void* b,
+			   unsigned start, unsigned end )
+{
+   const A& dPdu = *static_cast< const A* >( a );
+   const A& dPdv = *static_cast< const A* >( b );
+   for ( unsigned i = start; i < end; ++i, t += 6 )
+   {
+      t[0] = (float) dPdu[i].x;
+      t[1] = (float) dPdu[i].y;
+      t[2] = (float) dPdu[i].z;
+      t[3] = (float) dPdv[i].x;
+      t[4] = (float) dPdv[i].y;
+      t[5] = (float) dPdv[i].z;
+   }
+   return (end - start) * 2;
+}
+
+
+inline
+void mrObject::write_user_vectors( MRL_FILE* f, const MPointArray& pts )
+{
+   unsigned num = pts.length();
+   if ( options->exportBinary )
+      write_binary( f, mr_binary_xyzw< MPointArray >, &pts, NULL, num );
+   else
+      write_ascii( f, mr_ascii_xyzw< MPointArray >, &pts, NULL, num );
 }
 
 inline
@@ -307,21 +534,9 @@ void mrObject::write_user_vectors( MRL_FILE* f, const MIntArray& u )
 {
    unsigned num = u.length();
    if ( options->exportBinary )
-   {
-      float t[3]; t[1] = 0.0f; t[2] = 0.0f;
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 t[0] = (float)u[i];  WRITE_VECTOR(t);
-      }
-   }
+      write_binary( f, mr_binary_u< MIntArray >, &u, NULL, num );
    else
-   {
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 TAB(2);
-	 MRL_FPRINTF(f, "%d 0 0\n", u[i]);
-      }
-   }
+      write_ascii( f, mr_ascii_int, &u, NULL, num );
 }
 
 inline
@@ -329,21 +544,9 @@ void mrObject::write_user_vectors( MRL_FILE* f, const MDoubleArray& u )
 {
    unsigned num = u.length();
    if ( options->exportBinary )
-   {
-      float t[3]; t[1] = 0.0f; t[2] = 0.0f;
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 t[0] = (float)u[i];  WRITE_VECTOR(t);
-      }
-   }
+      write_binary( f, mr_binary_u< MDoubleArray >, &u, NULL, num );
    else
-   {
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 TAB(2);
-	 MRL_FPRINTF(f, "%g 0 0\n", u[i]);
-      }
-   }
+      write_ascii( f, mr_ascii_u< MDoubleArray >, &u, NULL, num );
 }
 
 
@@ -352,25 +555,9 @@ void mrObject::write_user_vectors( MRL_FILE* f, const MVectorArray& pts )
 {
    unsigned num = pts.length();
    if ( options->exportBinary )
-   {
-      float t[3]; double tmp[3];
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 pts[i].get( tmp ); 
-	 t[0] = (float)tmp[0]; 
-	 t[1] = (float)tmp[1]; 
-	 t[2] = (float)tmp[2];
-	 WRITE_VECTOR(t);
-      }
-   }
+      write_binary( f, mr_binary_xyz< MVectorArray >, &pts, NULL, num );
    else
-   {
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 TAB(2);
-	 MRL_FPRINTF(f, "%g %g %g\n", pts[i].x, pts[i].y, pts[i].z);
-      }
-   }
+      write_ascii( f, mr_ascii_xyz< MVectorArray >, &pts, NULL, num );
 }
 
 
@@ -380,22 +567,9 @@ void mrObject::write_vectors( MRL_FILE* f,
 {
    unsigned num = u.length();
    if ( options->exportBinary )
-   {
-      float t[3]; t[2] = 0.0f;
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 t[0] = (float)u[i]; t[1] = (float)v[i];
-	 WRITE_VECTOR(t);
-      }
-   }
+      write_binary( f, mr_binary_uv< MDoubleArray >, &u, &v, num );
    else
-   {
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 TAB(2);
-	 MRL_FPRINTF(f, "%g %g 0\n", u[i], v[i]);
-      }
-   }
+      write_ascii( f, mr_ascii_uv< MDoubleArray >, &u, &v, num );
 }
 
 inline
@@ -404,22 +578,9 @@ void mrObject::write_vectors( MRL_FILE* f,
 {
    unsigned num = u.length();
    if ( options->exportBinary )
-   {
-      float t[3]; t[2] = 0.0f;
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 t[0] = u[i]; t[1] = v[i];
-	 WRITE_VECTOR(t);
-      }
-   }
+      write_binary( f, mr_binary_uv< MFloatArray >, &u, &v, num );
    else
-   {
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 TAB(2);
-	 MRL_FPRINTF(f, "%g %g 0\n", u[i], v[i]);
-      }
-   }
+      write_ascii( f, mr_ascii_uv< MFloatArray >, &u, &v, num );
 }
 
 inline
@@ -430,29 +591,10 @@ void mrObject::write_vectors( MRL_FILE* f,
    assert( dPdu.length() == dPdv.length() );
    
    unsigned num = dPdu.length();
-   double t[3]; float ft[3];
    if ( options->exportBinary )
-   {
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 dPdu[i].get( t );
-	 ft[0] = (float)t[0]; ft[1] = (float)t[1]; ft[2] = (float)t[2];
-	 WRITE_VECTOR(ft);
-	 dPdv[i].get( t );
-	 ft[0] = (float)t[0]; ft[1] = (float)t[1]; ft[2] = (float)t[2];
-	 WRITE_VECTOR(ft); 
-      }
-   }
+      write_binary( f, mr_binary_derivs< MVectorArray >, &dPdu, &dPdv, num );
    else
-   {
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 TAB(2); 
-	 MRL_FPRINTF(f, "%g %g %g\n", dPdu[i].x, dPdu[i].y, dPdu[i].z);
-	 TAB(2); 
-	 MRL_FPRINTF(f, "%g %g %g\n", dPdv[i].x, dPdv[i].y, dPdv[i].z);
-      }
-   }
+      write_ascii( f, mr_ascii_derivs< MVectorArray >, &dPdu, &dPdv, num );
 }
 
 inline
@@ -463,25 +605,12 @@ void mrObject::write_vectors( MRL_FILE* f,
    assert( dPdu.length() == dPdv.length() );
    
    unsigned num = dPdu.length();
-   float t[3];
    if ( options->exportBinary )
-   {
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 dPdu[i].get( t ); WRITE_VECTOR(t);
-	 dPdv[i].get( t ); WRITE_VECTOR(t); 
-      }
-   }
+      write_binary( f, mr_binary_derivs< MFloatVectorArray >,
+		    &dPdu, &dPdv, num );
    else
-   {
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 TAB(2);
-	 MRL_FPRINTF(f, "%g %g %g\n", dPdu[i].x, dPdu[i].y, dPdu[i].z);
-	 TAB(2);
-	 MRL_FPRINTF(f, "%g %g %g\n", dPdv[i].x, dPdv[i].y, dPdv[i].z);
-      }
-   }
+      write_ascii( f, mr_ascii_derivs< MFloatVectorArray >,
+		   &dPdu, &dPdv, num );
 }
 
 inline
@@ -489,25 +618,9 @@ void mrObject::write_vectors( MRL_FILE* f, const MVectorArray& pts )
 {
    unsigned num = pts.length();
    if ( options->exportBinary )
-   {
-      float t[3]; double tmp[3];
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 pts[i].get( tmp ); 
-	 t[0] = (float)tmp[0]; 
-	 t[1] = (float)tmp[1]; 
-	 t[2] = (float)tmp[2];
-	 WRITE_VECTOR(t);
-      }
-   }
+      write_binary( f, mr_binary_xyz< MVectorArray >, &pts, NULL, num );
    else
-   {
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 TAB(2);
-	 MRL_FPRINTF(f, "%g %g %g\n", pts[i].x, pts[i].y, pts[i].z);
-      }
-   }
+      write_ascii( f, mr_ascii_xyz< MVectorArray >, &pts, NULL, num );
 }
 
 
@@ -516,22 +629,9 @@ void mrObject::write_vectors( MRL_FILE* f, const MColorArray& cols )
 {
    unsigned num = cols.length();
    if ( options->exportBinary )
-   {
-      float t[3];
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 cols[i].get( t );
-	 WRITE_VECTOR(t);
-      }
-   }
+      write_binary( f, mr_binary_rgb< MColorArray >, &cols, NULL, num );
    else
-   {
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 TAB(2);
-	 MRL_FPRINTF( f, "%g %g %g\n", cols[i].r, cols[i].g, cols[i].b );
-      }
-   }
+      write_ascii( f, mr_ascii_rgb< MColorArray >, &cols, NULL, num );
 }
 
 
@@ -540,22 +640,9 @@ void mrObject::write_vectors( MRL_FILE* f, const MFloatVectorArray& pts )
 {
    unsigned num = pts.length();
    if ( options->exportBinary )
-   {
-      float t[3];
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 pts[i].get( t );
-	 WRITE_VECTOR(t);
-      }
-   }
+      write_binary( f, mr_binary_xyz< MFloatVectorArray >, &pts, NULL, num );
    else
-   {
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 TAB(2);
-	 MRL_FPRINTF(f, "%g %g %g\n", pts[i].x, pts[i].y, pts[i].z);
-      }
-   }
+      write_ascii( f, mr_ascii_xyz< MFloatVectorArray >, &pts, NULL, num );
 }
 
 inline
@@ -563,21 +650,9 @@ void mrObject::write_vectors( MRL_FILE* f, const MFloatPointArray& pts )
 {
    unsigned num = pts.length();
    if ( options->exportBinary )
-   {
-      float t[4];
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 pts[i].get( t ); WRITE_VECTOR(t);
-      }
-   }
+      write_binary( f, mr_binary_xyz< MFloatPointArray >, &pts, NULL, num );
    else
-   {
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 TAB(2);
-	 MRL_FPRINTF(f, "%g %g %g\n", pts[i].x, pts[i].y, pts[i].z);
-      }
-   }
+      write_ascii( f, mr_ascii_xyz< MFloatPointArray >, &pts, NULL, num );
 }
 
 inline
@@ -585,25 +660,11 @@ void mrObject::write_vectors( MRL_FILE* f, const MPointArray& pts )
 {
    unsigned num = pts.length();
    if ( options->exportBinary )
-   {
-      float t[4];
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 pts[i].get( t ); WRITE_VECTOR(t);
-      }
-   }
+      write_binary( f, mr_binary_xyz< MPointArray >, &pts, NULL, num );
    else
-   {
-      for ( unsigned i = 0; i < num; ++i )
-      {
-	 TAB(2);
-	 MRL_FPRINTF(f, "%g %g %g\n", pts[i].x, pts[i].y, pts[i].z);
-      }
-   }
+      write_ascii( f, mr_ascii_xyz< MPointArray >, &pts, NULL, num );
 }
 
-#undef WRITE_VECTOR
-
 
 
 
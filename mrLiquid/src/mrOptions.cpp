@@ -514,6 +514,12 @@ void mrOptions::resetAll()
    exportCustomMotion = true;
    exportCustomVectors = true;
    exportTriangles = false;
+   exportThreads = 0;
+   exportDedupShaders = false;
+   exportDedupReport = false;
+   exportAutoInstance = false;
+   exportInstancerStream = false;
+   exportPDC2 = false;
    exportMotionCamera = true;
    exportMotionOffset = true;
    exportMotionOutput = true;
@@ -638,6 +644,7 @@ void getApproximation( mrApproximation*& a, const MPlug& p )
 
 void mrOptions::getData()
 {  
+   MRL_PROFILE( kGetData );
    /////////////////////////////////////////////////////////////////////////
    //
    // GET MENTALRAYOPTIONS NODE OPTIONS
@@ -1357,6 +1364,13 @@ void mrOptions::getData()
    CHECK_AND_GET( exportCustomMotion );  // NOT DONE YET
    CHECK_AND_GET( exportCustomVectors );
    CHECK_AND_GET_OPTIONAL( exportTriangles );
+   // Only changes how the .mi file is written, not what gets rendered.
+   GET_OPTIONAL( exportThreads );
+   GET_OPTIONAL( exportDedupShaders );
+   GET_OPTIONAL( exportDedupReport );
+   GET_OPTIONAL( exportAutoInstance );
+   GET_OPTIONAL( exportInstancerStream );
+   GET_OPTIONAL( exportPDC2 );
    
    CHECK_AND_GET( exportMotionOffset );  // NOT DONE YET
    CHECK_AND_GET( exportMotionOutput );  // NOT DONE YET
@@ -1614,6 +1628,7 @@ void mrOptions::update( const MObject& inMrayOptions,
 
 void mrOptions::write( MRL_FILE* f )
 {
+   MRL_PROFILE_WRITE( f );
 #ifndef MR_NO_CUSTOM_TEXT
    if ( miText )
    {
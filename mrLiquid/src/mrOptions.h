@@ -475,6 +475,12 @@ public:
      
   short exportVerbosity;
   short renderVerbosity;
+  short exportThreads;         // threads formatting vectors (-1 = all cpus)
+  bool  exportDedupShaders;    // write identical shaders only once
+  bool  exportDedupReport;     // list the identical shaders found
+  bool  exportAutoInstance;    // write identical meshes only once
+  bool  exportInstancerStream; // save particle instances to a binary file
+  bool  exportPDC2;            // save particle caches as mappable .pdc2
   PerFrame   perframe;              //  0 = one .mi file,
   // >0 one per frame in a format
   bool  exportUsingApi;        // use raylib instead of MRL_FPRINTF()
@@ -0,0 +1,102 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef mrPDC2_h
+#define mrPDC2_h
+
+//
+// Layout of version 2 particle caches (.pdc2).  Unlike Maya's PDC
+// files, these are written in the byte order of the exporter and every
+// attribute is stored as a column starting on a 64 byte boundary, so
+// the cache can be mapped into memory and used in place:
+//
+//   PDC2_Header                         (64 bytes)
+//   PDC2_Attr  [numAttrs]               (64 bytes each)
+//   columns, each at its PDC2_Attr::offset from the start of the file
+//
+// Attribute types and the values stored for each are the same as in
+// PDC files (ints, doubles or 3 doubles per vector, one value or one
+// per particle).
+//
+// The renderer does not load the cache as user data.  Instead, the
+// user data holds a small reference: PDC2_REF_MAGIC followed by the
+// NUL terminated name of the .pdc2 file.
+//
+
+#define PDC2_MAGIC     "PDC2"
+#define PDC2_REF_MAGIC "PDCR"
+#define PDC2_VERSION   1
+#define PDC2_ALIGN     64
+
+struct PDC2_Header
+{
+     char               magic[4];
+     int                version;
+     int                endian;       // 1 in the byte order of the writer
+     unsigned           count;        // number of particles
+     unsigned           numAttrs;
+     unsigned           pad0;
+     unsigned long long size;         // size of the whole file
+     char               pad1[32];
+};
+
+struct PDC2_Attr
+{
+     char               name[40];     // NUL terminated
+     int                type;
+     unsigned           pad0;
+     unsigned long long offset;       // from start of file
+     unsigned long long bytes;
+};
+
+//! Size in bytes of the column of an attribute of a PDC type (0-5)
+inline unsigned long long pdc2Bytes( const int type, const unsigned count )
+{
+   switch( type )
+   {
+      case 0:  return sizeof(int);
+      case 1:  return (unsigned long long) sizeof(int) * count;
+      case 2:  return sizeof(double);
+      case 3:  return (unsigned long long) sizeof(double) * count;
+      case 4:  return sizeof(double) * 3;
+      case 5:  return (unsigned long long) sizeof(double) * 3 * count;
+      default: return 0;
+   }
+}
+
+//! Round offset up to the alignment of columns
+inline unsigned long long pdc2Align( const unsigned long long offset )
+{
+   return ( offset + PDC2_ALIGN - 1 ) & ~((unsigned long long) PDC2_ALIGN - 1);
+}
+
+
+#endif // mrPDC2_h
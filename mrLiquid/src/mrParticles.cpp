@@ -37,6 +37,10 @@
 #include <netinet/in.h>
 #endif
 
+#include <cstring>
+#include <string>
+#include <vector>
+
 #include "maya/MFnDagNode.h"
 #include "maya/MFnAttribute.h"
 #include "maya/MFnNumericAttribute.h"
@@ -59,6 +63,8 @@
 #include "mrHelpers.h"
 #include "mrIO.h"
 #include "mrByteSwap.h"
+#include "mrHexEncode.h"
+#include "mrPDC2.h"
 #include "mrAttrAux.h"
 
 extern MString partDir;
@@ -182,8 +188,17 @@ MString mrParticles::getPDCFile() const
 }
 
 
+MString mrParticles::getPDC2File() const
+{
+   MString pdcFile = getPDCFile();
+   pdcFile += "2";
+   return pdcFile;
+}
+
+
 void mrParticles::getData()
 {
+   MRL_PROFILE( kGetData );
    {  // Get all stuff possible from MFnParticleSystem
       MFnParticleSystem fn( path );
       visible    = fn.primaryVisibility();
@@ -227,6 +242,7 @@ void mrParticles::getData()
 	 volumetric = true;
 
       MStatus status; MPlug p;
+      pdc2 = false;
       miPDCFile = "";
       GET_OPTIONAL( miPDCFile );
       if ( miPDCFile != "" )
@@ -277,6 +293,9 @@ void mrParticles::getData()
       if ( useParticleDiskCache && fileExists( getPDCFile() ) ) return;
 
       miPDCFile += "-mray";
+#ifndef GEOSHADER_H
+      pdc2 = options->exportPDC2;
+#endif
       
       // We will allow to spit out any arbitrary attribute into a PDC file in
       // the current project.  For doing so, the string attribute miAttributes
@@ -430,11 +449,135 @@ void mrParticles::getData()
 	 attributeTypes.remove(i);
       }
 
-      writePDCFile();
+      if ( pdc2 ) writePDC2File();
+      else        writePDCFile();
+   }
+}
+
+
+
+
+// Size in bytes of the blocks of elements swapped and written at once
+static const unsigned kSaveBytes = 16384;
+
+//! Save an int array, in big endian order
+static void save_array( MRL_FILE* f, const MIntArray& v )
+{
+   static const unsigned kChunk = kSaveBytes / sizeof(int);
+   int buf[kChunk];
+   unsigned num = v.length();
+   for ( unsigned i = 0; i < num; i += kChunk )
+   {
+      unsigned n = num - i;
+      if ( n > kChunk ) n = kChunk;
+      for ( unsigned j = 0; j < n; ++j ) buf[j] = v[i+j];
+      MAKE_BIGENDIAN_ARRAY( buf, n );
+      MRL_FWRITE( buf, sizeof(int), n, f );
+   }
+}
+
+//! Save a double array, in big endian order
+static void save_array( MRL_FILE* f, const MDoubleArray& v )
+{
+   static const unsigned kChunk = kSaveBytes / sizeof(double);
+   double buf[kChunk];
+   unsigned num = v.length();
+   for ( unsigned i = 0; i < num; i += kChunk )
+   {
+      unsigned n = num - i;
+      if ( n > kChunk ) n = kChunk;
+      for ( unsigned j = 0; j < n; ++j ) buf[j] = v[i+j];
+      MAKE_BIGENDIAN_ARRAY( buf, n );
+      MRL_FWRITE( buf, sizeof(double), n, f );
    }
 }
 
+//! Save a vector array as 3 doubles per vector, in big endian order
+static void save_array( MRL_FILE* f, const MVectorArray& v )
+{
+   static const unsigned kChunk = kSaveBytes / (3 * sizeof(double));
+   double buf[kChunk * 3];
+   unsigned num = v.length();
+   for ( unsigned i = 0; i < num; i += kChunk )
+   {
+      unsigned n = num - i;
+      if ( n > kChunk ) n = kChunk;
+      double* d = buf;
+      for ( unsigned j = 0; j < n; ++j, d += 3 )
+      {
+	 const MVector& t = v[i+j];
+	 d[0] = t.x; d[1] = t.y; d[2] = t.z;
+      }
+      MAKE_BIGENDIAN_ARRAY( buf, n * 3 );
+      MRL_FWRITE( buf, sizeof(double), n * 3, f );
+   }
+}
 
+/** 
+ * Save the value of a particle attribute in PDC format (without its
+ * name and type).
+ * 
+ * @param f     file to save to
+ * @param p     plug of attribute
+ * @param type  PDC type of attribute (0-5)
+ * @param count number of particles
+ */
+static void save_attribute( MRL_FILE* f, const MPlug& p, const int type,
+			    const unsigned count )
+{
+   MObject o;
+   switch( type )
+   {
+      case 0:
+	 {
+	    int v;
+	    p.getValue(v);
+	    SAVE_INT(v);
+	 }
+	 break;
+      case 1:
+	 {
+	    p.getValue(o);
+	    MFnIntArrayData fnAttr( o );
+	    const MIntArray& v = fnAttr.array();
+	    assert( v.length() == count );
+	    save_array( f, v );
+	 }
+	 break;
+      case 2:
+	 {
+	    double v;
+	    p.getValue(v);
+	    SAVE_DOUBLE(v);
+	 }
+	 break;
+      case 3:
+	 {
+	    p.getValue(o);
+	    MFnDoubleArrayData fnAttr( o );
+	    const MDoubleArray& v = fnAttr.array();
+	    assert( v.length() == count );
+	    save_array( f, v );
+	 }
+	 break;
+      case 4:
+	 {
+	    MVector v; 
+	    p.getValue(o);
+	    MFnNumericData fnAttr(o);
+	    fnAttr.getData( v.x, v.y, v.z );
+	    SAVE_DVECTOR( v );
+	 }
+	 break;
+      case 5:
+	 {
+	    p.getValue(o);
+	    MFnVectorArrayData fnAttr( o );
+	    save_array( f, fnAttr.array() );
+	 }
+	 break;
+   }
+}
 
 
 void mrParticles::writeParticleFile( MRL_FILE* f ) const
@@ -475,75 +618,7 @@ void mrParticles::writeParticleFile( MRL_FILE* f ) const
       SAVE_INT( tmp );
       p = fn.findPlug( attributes[i] );
       
-      MObject o;
-      switch( attributeTypes[i] )
-      {
-	 case 0:
-	    {
-	       int v;
-	       p.getValue(v);
-	       SAVE_INT(v);
-	    }
-	    break;
-	 case 1:
-	    {
-	       p.getValue(o);
-	       MFnIntArrayData fnAttr( o );
-	       const MIntArray& v = fnAttr.array();
-	       unsigned num = v.length();
-	       assert( num == count );
-	       for ( unsigned j = 0; j < num; ++j )
-	       {
-		  tmp = v[j];
-		  SAVE_INT( tmp );
-	       }
-	    }
-	    break;
-	 case 2:
-	    {
-	       double v;
-	       p.getValue(v);
-	       SAVE_DOUBLE(v);
-	    }
-	    break;
-	 case 3:
-	    {
-	       p.getValue(o);
-	       MFnDoubleArrayData fnAttr( o );
-	       const MDoubleArray& v = fnAttr.array();
-	       unsigned num = v.length();
-	       assert( num == count );
-	       for ( unsigned j = 0; j < num; ++j )
-	       {
-		  double t = v[j];
-		  SAVE_DOUBLE( t );
-	       }
-	    }
-	    break;
-	 case 4:
-	    {
-	       MVector v; 
-	       p.getValue(o);
-	       MFnNumericData fnAttr(o);
-	       fnAttr.getData( v.x, v.y, v.z );
-	       SAVE_DVECTOR( v );
-	    }
-	    break;
-	 case 5:
-	    {
-	       p.getValue(o);
-	       MFnVectorArrayData fnAttr( o );
-	       const MVectorArray& v = fnAttr.array();
-	       unsigned num = v.length();
-
-	       for ( unsigned j = 0; j < num; ++j )
-	       {
-		  MVector t = v[j];
-		  SAVE_DVECTOR( t );
-	       }
-	    }
-	    break;
-      }
+      save_attribute( f, p, attributeTypes[i], count );
    }
    if (f) MRL_FCLOSE(f);
 }
@@ -596,82 +671,184 @@ void mrParticles::writePDCFile() const
       SAVE_INT( tmp );
       p = fn.findPlug( attributes[i] );
       
-      MObject o;
-      switch( attributeTypes[i] )
-      {
-	 case 0:
-	    {
-	       int v;
-	       p.getValue(v);
-	       SAVE_INT(v);
-	    }
-	    break;
-	 case 1:
-	    {
-	       p.getValue(o);
-	       MFnIntArrayData fnAttr( o );
-	       const MIntArray& v = fnAttr.array();
-	       unsigned num = v.length();
-	       assert( num == count );
-	       for ( unsigned j = 0; j < num; ++j )
-	       {
-		  tmp = v[j];
-		  SAVE_INT( tmp );
-	       }
-	    }
-	    break;
-	 case 2:
-	    {
-	       double v;
-	       p.getValue(v);
-	       SAVE_DOUBLE(v);
-	    }
-	    break;
-	 case 3:
-	    {
-	       p.getValue(o);
-	       MFnDoubleArrayData fnAttr( o );
-	       const MDoubleArray& v = fnAttr.array();
-	       unsigned num = v.length();
-	       assert( num == count );
-	       for ( unsigned j = 0; j < num; ++j )
-	       {
-		  double t = v[j];
-		  SAVE_DOUBLE( t );
-	       }
-	    }
-	    break;
-	 case 4:
-	    {
-	       MVector v; 
-	       p.getValue(o);
-	       MFnNumericData fnAttr(o);
-	       fnAttr.getData( v.x, v.y, v.z );
-	       SAVE_DVECTOR( v );
-	    }
-	    break;
-	 case 5:
-	    {
-	       p.getValue(o);
-	       MFnVectorArrayData fnAttr( o );
-	       const MVectorArray& v = fnAttr.array();
-	       unsigned num = v.length();
+      save_attribute( f, p, attributeTypes[i], count );
+   }
+   if (f) MRL_FCLOSE(f);
+}
 
-	       for ( unsigned j = 0; j < num; ++j )
-	       {
-		  MVector t = v[j];
-		  SAVE_DVECTOR( t );
-	       }
-	    }
-	    break;
+/** 
+ * Save the value of a particle attribute as a column of a .pdc2 file,
+ * in native byte order.
+ * 
+ * @param f     file to save to
+ * @param p     plug of attribute
+ * @param type  PDC type of attribute (0-5)
+ * @param count number of particles
+ * @param buf   scratch buffer for array attributes
+ */
+static void save_column( MRL_FILE* f, const MPlug& p, const int type,
+			 const unsigned count, std::vector< double >& buf )
+{
+   MObject o;
+   switch( type )
+   {
+      case 0:
+	 {
+	    int v;
+	    p.getValue(v);
+	    MRL_FWRITE( &v, sizeof(int), 1, f );
+	 }
+	 break;
+      case 1:
+	 {
+	    p.getValue(o);
+	    MFnIntArrayData fnAttr( o );
+	    const MIntArray& v = fnAttr.array();
+	    assert( v.length() == count );
+	    if ( count == 0 ) break;
+	    buf.resize( ( count + 1 ) / 2 );
+	    int* d = (int*) &buf[0];
+	    v.get( d );
+	    MRL_FWRITE( d, sizeof(int), count, f );
+	 }
+	 break;
+      case 2:
+	 {
+	    double v;
+	    p.getValue(v);
+	    MRL_FWRITE( &v, sizeof(double), 1, f );
+	 }
+	 break;
+      case 3:
+	 {
+	    p.getValue(o);
+	    MFnDoubleArrayData fnAttr( o );
+	    const MDoubleArray& v = fnAttr.array();
+	    assert( v.length() == count );
+	    if ( count == 0 ) break;
+	    buf.resize( count );
+	    v.get( &buf[0] );
+	    MRL_FWRITE( &buf[0], sizeof(double), count, f );
+	 }
+	 break;
+      case 4:
+	 {
+	    double v[3];
+	    p.getValue(o);
+	    MFnNumericData fnAttr(o);
+	    fnAttr.getData( v[0], v[1], v[2] );
+	    MRL_FWRITE( v, sizeof(double), 3, f );
+	 }
+	 break;
+      case 5:
+	 {
+	    p.getValue(o);
+	    MFnVectorArrayData fnAttr( o );
+	    const MVectorArray& v = fnAttr.array();
+	    assert( v.length() == count );
+	    if ( count == 0 ) break;
+	    buf.resize( count * 3 );
+	    v.get( (double (*)[3]) &buf[0] );
+	    MRL_FWRITE( &buf[0], sizeof(double), count * 3, f );
+	 }
+	 break;
+   }
+}
+
+
+void mrParticles::writePDC2File() const
+{
+   DBG("write PDC2 file");
+   MString pdcFile = getPDC2File();
+   
+   if ( options->exportVerbosity > 3 )
+   {
+      MString msg = "Saving particle cache file \"";
+      msg += pdcFile;
+      msg += "\".";
+      LOG_MESSAGE(msg);
+   }
+
+   // Not compressed, as the renderer maps it into memory
+   MRL_FILE* f = MRL_FOPEN( pdcFile.asChar(), "wb" );
+   if (!f) { 
+      MString err = name + ": Could not create particle cache file";
+      LOG_ERROR(err);
+      return;
+   }
+
+   // Build the index of attributes first, so all of it can be written
+   // before the columns.
+   std::vector< PDC2_Attr > index;
+   std::vector< unsigned >  plugs;
+   unsigned numAttrs = attributes.length();
+   for ( unsigned i = 0; i < numAttrs; ++i )
+   {
+      if ( attributes[i].length() >= sizeof(index[0].name) )
+      {
+	 MString err = name;
+	 err += ": Attribute name \"";
+	 err += attributes[i];
+	 err += "\" is too long for pdc2 file.  Not spit.";
+	 LOG_ERROR(err);
+	 continue;
       }
+      PDC2_Attr a;
+      memset( &a, 0, sizeof(a) );
+      strcpy( a.name, attributes[i].asChar() );
+      a.type  = attributeTypes[i];
+      a.bytes = pdc2Bytes( a.type, count );
+      index.push_back( a );
+      plugs.push_back( i );
    }
-   if (f) MRL_FCLOSE(f);
+
+   PDC2_Header h;
+   memset( &h, 0, sizeof(h) );
+   memcpy( h.magic, PDC2_MAGIC, 4 );
+   h.version  = PDC2_VERSION;
+   h.endian   = 1;
+   h.count    = count;
+   h.numAttrs = (unsigned) index.size();
+
+   unsigned long long offset = sizeof(h) + sizeof(PDC2_Attr) * h.numAttrs;
+   offset = pdc2Align( offset );
+   std::vector< PDC2_Attr >::iterator a = index.begin();
+   std::vector< PDC2_Attr >::iterator e = index.end();
+   for ( ; a != e; ++a )
+   {
+      a->offset = offset;
+      offset = pdc2Align( offset + a->bytes );
+   }
+   h.size = offset;
+
+   static const char zeros[PDC2_ALIGN] = { 0 };
+   MRL_FWRITE( &h, sizeof(h), 1, f );
+   unsigned long long pos = sizeof(h);
+   if ( h.numAttrs )
+   {
+      MRL_FWRITE( &index[0], sizeof(PDC2_Attr), h.numAttrs, f );
+      pos += sizeof(PDC2_Attr) * h.numAttrs;
+   }
+
+   MPlug p; MStatus status;
+   MFnDagNode fn( path );
+   std::vector< double > buf;
+   for ( unsigned i = 0; i < h.numAttrs; ++i )
+   {
+      MRL_FWRITE( zeros, 1, (size_t)( index[i].offset - pos ), f );
+      p = fn.findPlug( attributes[ plugs[i] ] );
+      save_column( f, p, index[i].type, count, buf );
+      pos = index[i].offset + index[i].bytes;
+   }
+   MRL_FWRITE( zeros, 1, (size_t)( h.size - pos ), f );
+   MRL_FCLOSE(f);
 }
 
+
 mrParticles::mrParticles( const MDagPath& shape ) :
 mrObject( getMrayName( shape ) ),
-pdcWritten( mrNode::kNotWritten )
+pdcWritten( mrNode::kNotWritten ),
+pdc2( false )
 {
    shapeAnimated = true;
    path = shape;
@@ -1186,8 +1363,28 @@ void mrParticles::write_user_data( MRL_FILE* f )
 	!volumetric ) return;
 
    if ( pdcWritten == kIncremental ) MRL_PUTS("incremental ");
-   MRL_FPRINTF(f, "data \"%s:pdc\" \"%s\"\n",
-	   name.asChar(), getPDCFile().asChar() );
+   if ( pdc2 )
+   {
+      // Just a reference to the .pdc2 file, which the shaders map
+      // into memory themselves.
+      MString file = getPDC2File();
+      std::string ref( PDC2_REF_MAGIC );
+      ref.append( file.asChar(), file.length() + 1 );
+      ref.resize( ( ref.size() + 3 ) & ~3, '\0' );
+
+      std::string hex( ref.size() * 2, '\0' );
+      mr_hex_encode( &hex[0], ref.data(), ref.size() );
+
+      MRL_FPRINTF(f, "data \"%s:pdc\"\n", name.asChar() );
+      TAB(1); MRL_FPRINTF( f, "%u [\n", (unsigned) ref.size() );
+      TAB(1); MRL_FPRINTF( f, "'%s'\n", hex.c_str() );
+      TAB(1); MRL_PUTS("]\n");
+   }
+   else
+   {
+      MRL_FPRINTF(f, "data \"%s:pdc\" \"%s\"\n",
+		  name.asChar(), getPDCFile().asChar() );
+   }
    NEWLINE();
    pdcWritten = kWritten;
 }
@@ -128,12 +128,21 @@ class mrParticles : public mrObject
      //! Return the full name of the pdc file for this frame.
      MString getPDCFile() const;
 
+     //! Return the full name of the pdc2 file for this frame.
+     MString getPDC2File() const;
+
    protected:
      char pdcWritten;
 
+     //! Is the particle cache saved as a .pdc2 file?
+     bool pdc2;
+
      //! Write the PDC file to disk
      void writePDCFile() const;
 
+     //! Write the particle cache to disk as a .pdc2 file
+     void writePDC2File() const;
+
      //! Write particle data file to disk (in maya2mr's format)
      void writeParticleFile( MRL_FILE* f ) const;
 
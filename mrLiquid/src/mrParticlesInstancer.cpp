@@ -31,8 +31,11 @@
 
 #include <cassert>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
 
 #include <algorithm>
+#include <string>
 
 #include "maya/MFnParticleSystem.h"
 #include "maya/MBoundingBox.h"
@@ -49,17 +52,21 @@
 #include "mrSubd.h"
 
 #include "mrParticlesInstancer.h"
+#include "mrInstancerStream.h"
 
 #include "mrAttrAux.h"
 
 
 extern MDagPath currentObjPath;
 extern MDagPath currentInstPath;
+extern MString  partDir;
+extern int      frame;
 
 
 
 void mrParticlesInstancer::getData( bool sameFrame )
 {
+   MRL_PROFILE( kGetData );
    MStatus status;  MPlug p;
    MFnDagNode fn( instancer );
 
@@ -323,8 +330,141 @@ void mrParticlesInstancer::forceIncremental()
 
 
 
+/** 
+ * Return the name of the binary file the particle matrices are saved to
+ * for the mrl_geo_instancer geometry shader.
+ * 
+ * @return name of .mri file
+ */
+MString mrParticlesInstancer::getStreamFile() const
+{
+  MString file = partDir;
+  char* instName = STRDUP( name.asChar() );
+  char* s = instName;
+  for( ;*s != 0; ++s )
+    {
+      if ( *s == '|' || *s == ':' )
+	*s = '_';
+    }
+  file += instName;
+  free(instName);
+
+  file += ".";
+  file += frame;
+  file += ".mri";
+
+  return file;
+}
+
+
+/** 
+ * Open the .mri file and write its header and the names of the
+ * instancer and of the objects it instances.
+ * 
+ * @param visibility per particle visibility (or empty)
+ * 
+ * @return file to append the particle records to or NULL on failure.
+ */
+MRL_FILE* mrParticlesInstancer::open_stream( const MDoubleArray& visibility )
+{
+   MString file = getStreamFile();
+   MRL_FILE* f = MRL_FOPEN( file.asChar(), "wb" );
+   if ( f == NULL )
+   {
+      MString msg = "Could not save instancer file \"";
+      msg += file;
+      msg += "\".";
+      LOG_ERROR( msg );
+      return NULL;
+   }
+
+   mrInstancerHeader h;
+   memcpy( h.magic, MRL_INSTANCER_MAGIC, 4 );
+   h.version    = MRL_INSTANCER_VERSION;
+   h.endian     = 1;
+   h.flags      = 0;
+   if ( options->motionBlur != mrOptions::kMotionBlurOff )
+      h.flags  |= kInstancerMotion;
+   h.numObjects = (unsigned) shapes->size();
+
+   h.count = numParts;
+   unsigned numVisible = visibility.length();
+   for ( unsigned i = 0; i < numVisible; ++i )
+      if ( visibility[i] == 0.0 ) --h.count;
+
+   std::string names( name.asChar(), name.length() + 1 );
+   mrShapeList::const_iterator si = shapes->begin();
+   mrShapeList::const_iterator se = shapes->end();
+   for ( ; si != se; ++si )
+   {
+      const MString& shapeName = (*si)->definitionName();
+      names.append( shapeName.asChar(), shapeName.length() + 1 );
+   }
+   names.resize( ( names.size() + 3 ) & ~3, '\0' );
+   h.namesSize = (unsigned) names.size();
+
+   MRL_FWRITE( &h, sizeof(h), 1, f );
+   MRL_FWRITE( names.data(), 1, names.size(), f );
+   return f;
+}
+
+
+/** 
+ * Write the geometry shader that reads the .mri file back and the
+ * instance of it, in place of all the particle instances.
+ * 
+ * @param f mi file
+ */
+void mrParticlesInstancer::write_stream_instance( MRL_FILE* f )
+{
+#ifdef MR_OPTIMIZE_SHADERS
+   MString tmp = "mrl_shaders.so";
+   if ( options->DSOs.find( tmp ) == options->DSOs.end() )
+   {
+      MRL_FPRINTF(f, "link \"%s\"\n", tmp.asChar() );
+      options->DSOs.insert( tmp );
+   }
+
+   tmp = "mrl_shaders.mi";
+   if ( options->miFiles.find( tmp ) == options->miFiles.end() )
+   {
+      const char* mifile = tmp.asChar();
+      MRL_FPRINTF(f, "$ifndef \"%s\"\n", mifile );
+      MRL_FPRINTF(f, "$include \"%s\"\n", mifile );
+      MRL_FPRINTF(f, "set \"%s\" \"t\"\n", mifile );
+      MRL_PUTS("$endif\n");
+      options->miFiles.insert( tmp );
+      NEWLINE();
+   }
+#endif
+
+   write_each_material( f );
+
+   if ( written == kIncremental )
+      MRL_PUTS( "incremental ");
+   MRL_FPRINTF(f, "shader \"%s:shader\"\n", name.asChar() );
+   TAB(1); MRL_PUTS("\"mrl_geo_instancer\" (\n");
+   TAB(2); MRL_FPRINTF(f, "\"filename\" \"%s\"\n", 
+		       getStreamFile().asChar() );
+   TAB(1); MRL_PUTS(")\n");
+   NEWLINE();
+
+   if ( written == kIncremental )
+      MRL_PUTS( "incremental ");
+   MRL_FPRINTF( f, "instance \"%s\"\n", name.asChar() );
+   TAB(1); MRL_FPRINTF(f, "geometry = \"%s:shader\"\n", name.asChar());
+   TAB(1); MRL_PUTS("visible on\n");
+   TAB(1); MRL_PUTS("shadow on\n");
+   TAB(1); MRL_PUTS("trace  on\n");
+   write_materials( f );
+   MRL_PUTS("end instance\n");
+   NEWLINE();
+}
+
+
 void mrParticlesInstancer::write( MRL_FILE* f )
 {
+   MRL_PROFILE_WRITE( f );
    if ( shapes->empty() ) written = kWritten;
 
    mrShapeList::const_iterator i = shapes->begin();
@@ -407,18 +547,25 @@ void mrParticlesInstancer::write( MRL_FILE* f )
    
    assert( velocity.length() == numParts );
 
+   MRL_FILE* stream = NULL;
+   if ( options->exportInstancerStream )
+      stream = open_stream( visibility );
+
    char pId[32];
    unsigned numShapes = (unsigned) shapes->size();
    MString baseName = name;
    char oldWritten = written;
    for( unsigned i = 0; i < numParts; ++i )
    {
-      if ( i >= oldNumParts ) written = mrNode::kNotWritten;
-      else written = oldWritten;
+      if ( stream == NULL )
+      {
+	 if ( i >= oldNumParts ) written = mrNode::kNotWritten;
+	 else written = oldWritten;
 
-      sprintf(pId, "|%07X", i ); // safe up to 0xFFFFFFF (268,435,455)
-      name  = baseName;
-      name += pId;
+	 sprintf(pId, "|%07X", i ); // safe up to 0xFFFFFFF (268,435,455)
+	 name  = baseName;
+	 name += pId;
+      }
 
       //
       // First, figure out what shape we are instancing.
@@ -588,8 +735,28 @@ void mrParticlesInstancer::write( MRL_FILE* f )
 	 mt = tm.asMatrixInverse();
       }
 
-      
-
+      if ( stream )
+      {
+	 if ( visibility.length() > 0 && visibility[i] == 0.0 )
+	    continue;
+
+	 unsigned ids[2] = { (unsigned) shapeId, i };
+	 float matrices[32];
+	 unsigned num = 16;
+	 for ( unsigned r = 0; r < 4; ++r )
+	    for ( unsigned c = 0; c < 4; ++c )
+	       matrices[r*4+c] = (float) m[r][c];
+	 if ( options->motionBlur != mrOptions::kMotionBlurOff )
+	 {
+	    for ( unsigned r = 0; r < 4; ++r )
+	       for ( unsigned c = 0; c < 4; ++c )
+		  matrices[16+r*4+c] = (float) mt[r][c];
+	    num = 32;
+	 }
+	 MRL_FWRITE( ids, sizeof(unsigned), 2, stream );
+	 MRL_FWRITE( matrices, sizeof(float), num, stream );
+	 continue;
+      }
       
       if ( visibility.length() > 0 )
       {
@@ -611,6 +778,14 @@ void mrParticlesInstancer::write( MRL_FILE* f )
    written = oldWritten;
    name = baseName;
 
+   if ( stream )
+   {
+      MRL_FCLOSE( stream );
+      write_stream_instance( f );
+      written = kWritten;
+      return;
+   }
+
    if ( written == kIncremental ) MRL_PUTS("incremental ");
    MRL_FPRINTF( f, "instgroup \"%sGrp\"\n", name.asChar() );
    for( unsigned i = 0; i < numParts; ++i )
@@ -33,6 +33,7 @@
 #define mrParticlesInstancer_h
 
 #include <maya/MDagPathArray.h>
+#include <maya/MDoubleArray.h>
 
 #include "mrUserData.h"
 #include "mrInstanceObject.h"
@@ -71,6 +72,16 @@ protected:
 
   void getData( bool sameFrame );
 
+  //! Name of the binary file particle matrices are saved to, when
+  //! exporting them as a stream.
+  MString getStreamFile() const;
+
+  //! Open the stream file and write its header.
+  MRL_FILE* open_stream( const MDoubleArray& visibility );
+
+  //! Write the geometry shader and instance that read the stream file.
+  void write_stream_instance( MRL_FILE* f );
+
 public:
   static mrParticlesInstancer* factory( const MDagPath& instancer,
 					const MDagPath& particleShape );
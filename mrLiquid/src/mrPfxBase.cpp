@@ -22,11 +22,14 @@ totalVerts( 0 )
 void mrPfxBase::write_scalars( MRL_FILE* f, const MDoubleArray& d )
 {
    unsigned numScalars = d.length();
+   if ( numScalars == 0 ) return;
+
+   float* t = new float[ numScalars ];
    for (unsigned i = 0; i < numScalars; ++i)
-   {
-      float tmp = (float) d[i];
-      SAVE_FLOAT( tmp );
-   }
+      t[i] = (float) d[i];
+   MAKE_BIGENDIAN_ARRAY( t, numScalars );
+   MRL_FWRITE( t, sizeof(float), numScalars, f );
+   delete [] t;
 }
 
 void mrPfxBase::write_mi_scalars( MRL_FILE* f, const MDoubleArray& d )
@@ -43,10 +46,8 @@ void mrPfxBase::write_mi_scalars( MRL_FILE* f, const MDoubleArray& d )
 #else
       float* t = new float[ numScalars ];
       for ( i = 0; i < numScalars; ++i )
-      {
 	 t[i] = (float)d[i];
-	 MAKE_BIGENDIAN(t[i]);
-      }
+      MAKE_BIGENDIAN_ARRAY( t, numScalars );
       MRL_PUTS("binary `");
       MRL_FWRITE( t, sizeof(float), numScalars, f );
       MRL_PUTS("`\n");
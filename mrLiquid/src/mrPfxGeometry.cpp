@@ -74,6 +74,7 @@ extern int     frame;
 
 void mrPfxGeometry::getData()
 {
+   MRL_PROFILE( kGetData );
    DBG(name << ": getData()");
    spit = 0;
    maxDisplace = 0;
@@ -213,6 +214,7 @@ void mrPfxGeometry::setIncremental( bool sameFrame )
 
 void mrPfxGeometry::getMotionBlur( char step )
 {
+   MRL_PROFILE( kMotionBlur );
    if ( type_ == -1 ) return; // invalid hair (probably being created)
    if ( brushType_ == kMesh ) 
    {
@@ -533,6 +535,7 @@ void mrPfxGeometry::write_hr_files()
  */
 void mrPfxGeometry::write( MRL_FILE* f )
 {
+   MRL_PROFILE_WRITE( f );
    if ( written == kWritten ) return;
    
    if ( brushType_ == kMesh )
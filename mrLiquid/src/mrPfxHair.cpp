@@ -73,6 +73,7 @@ extern int     frame;
 
 void mrPfxHair::getData()
 {
+   MRL_PROFILE( kGetData );
    spit = 0;
    maxDisplace = 0;
 
@@ -172,6 +173,7 @@ void mrPfxHair::setIncremental( bool sameFrame )
 
 void mrPfxHair::getMotionBlur( char step )
 {
+   MRL_PROFILE( kMotionBlur );
    if ( type_ == kHairInvalid ) return; // invalid hair (probably being created)
 
    MStatus status;
@@ -750,6 +752,7 @@ MString mrPfxHair::getHR() const
  */
 void mrPfxHair::write( MRL_FILE* f )
 {
+   MRL_PROFILE_WRITE( f );
    if ( written == kWritten ) return;
 
 
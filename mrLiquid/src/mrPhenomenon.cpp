@@ -1104,6 +1104,7 @@ void mrPhenomenon::write_ae_template()
 
 void mrPhenomenon::write( MRL_FILE* f )
 {
+   MRL_PROFILE_WRITE( f );
    if ( written != kNotWritten ) 
       return;
 
@@ -1151,6 +1152,9 @@ void mrPhenomenon::write( MRL_FILE* f )
    options->exportFilter = oldExportFilter - allShaders;
    written = kInProgress;
 
+   // Shader names inside the declaration are local to it.
+   ++noDedup;
+
    MRL_PUTS( "declare phenomenon\n" );
    MRL_PUTS("\n#\n# Interface\n#\n\n");
    write_output(f, dep);
@@ -1160,6 +1164,8 @@ void mrPhenomenon::write( MRL_FILE* f )
    MRL_PUTS("\n#\n# Roots\n#\n\n");
    write_roots( f, dep );
    MRL_PUTS( "end declare\n" );
+
+   --noDedup;
    
    if ( miText && miText->mode == mrCustomText::kAppend )
    {
@@ -78,7 +78,7 @@ MR_THREAD_RETURN _mr_error_reader_cb( void* v )
 #ifdef MR_LOG_TO_MAYA_CONSOLE
       if ( MGlobal::mayaState() != MGlobal::kInteractive )
       {
-	 MRL_FPRINTF( stderr, "%s", line );
+	 fprintf( stderr, "%s", line );
 	 fflush( stderr );
 	 continue;
       }
@@ -87,7 +87,7 @@ MR_THREAD_RETURN _mr_error_reader_cb( void* v )
       line[idx] = 0; // remove "\n"
       MGlobal::displayInfo( line );
 #else
-      MRL_FPRINTF( stderr, "%s", line );
+      fprintf( stderr, "%s", line );
       fflush( stderr );
 #endif
    }
@@ -362,6 +362,18 @@ bool mr_popen3(
    return ok;
 }
 
+int mr_wait( MR_PROCESS processId )
+{
+   int r = -1;
+   if ( WaitForSingleObject( processId, INFINITE ) == WAIT_OBJECT_0 )
+   {
+      DWORD code;
+      if ( GetExitCodeProcess( processId, &code ) ) r = (int) code;
+   }
+   CloseHandle( processId );
+   return r;
+}
+
 bool mr_system( const char* cmd )
 {
    FILE* in, *out, *err;
@@ -385,12 +397,24 @@ bool mr_system( const char* cmd )
 
 #include <cstdio>
 #include <errno.h>
+#include <sys/wait.h>
 
 bool mr_system( const char* cmd )
 {
    return ( system( cmd ) == 0 );
 }
 
+int mr_wait( MR_PROCESS pid )
+{
+   int status;
+   while ( waitpid( pid, &status, 0 ) == -1 )
+   {
+      if ( errno != EINTR ) return -1;
+   }
+   if ( WIFEXITED( status ) ) return WEXITSTATUS( status );
+   return -1;
+}
+
 
 
 
@@ -113,6 +113,18 @@ bool mr_popen3( const char*  cmd,
 		);
 
 
+/** 
+ * Wait for a process started with mr_popen3 to finish.
+ * On Windows, this also closes the process handle.
+ * 
+ * @param processId process to wait for
+ * 
+ * @return exit code of process, or -1 if it could not be waited for
+ *         or did not exit normally.
+ */
+int mr_wait( MR_PROCESS processId );
+
+
 /** 
  * Start a new thread for reading the contents of a file descriptor
  * 
@@ -0,0 +1,282 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+/**
+ * @file   mrProfiler.cpp
+ * 
+ * @brief  Optional profiler of where export time goes, per node class
+ *         and per phase (getData, getMotionBlur, write).
+ * 
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#ifdef __GNUC__
+#  include <cxxabi.h>
+#  include <cstdlib>
+#endif
+
+#include "mrIO.h"
+#include "mrTimer.h"
+#include "mrProfiler.h"
+
+
+bool mrProfiler::enabled = false;
+
+namespace {
+
+const char* kPhaseNames[] = { "getData", "getMotionBlur", "write" };
+
+//! Statistics for one node class and phase.
+struct mrProfileStat
+{
+  mrProfileStat() : calls(0), total(0), self(0), bytes(0) {}
+
+  unsigned long calls;
+  double total;   // seconds, including nested scopes
+  double self;    // seconds, excluding nested scopes
+  double bytes;   // bytes written, excluding nested scopes
+};
+
+//! An active scope.
+struct mrProfileFrame
+{
+  const void*           node;
+  const std::type_info* type;
+  mrProfiler::Phase     phase;
+  MRL_FILE*             f;
+  double start;
+  double bytes;
+  double childTime;
+  double childBytes;
+};
+
+struct mrTypeLess
+{
+  bool operator()( const std::type_info* a, const std::type_info* b ) const
+  {
+     return a->before( *b ) != 0;
+  }
+};
+
+struct mrProfileStats
+{
+  mrProfileStat phase[mrProfiler::kNumPhases];
+};
+
+//! A line of the report.
+struct mrProfileRow
+{
+  std::string          name;
+  int                  phase;
+  const mrProfileStat* stat;
+
+  bool operator<( const mrProfileRow& b ) const
+  {
+     return stat->self > b.stat->self;
+  }
+};
+
+typedef std::map< const std::type_info*, mrProfileStats, mrTypeLess > mrProfileMap;
+
+mrProfileMap                  stats;
+std::vector< mrProfileFrame > stack;
+double                        startTime = 0;
+
+
+//! Readable name of a node class.
+std::string class_name( const std::type_info* t )
+{
+   const char* name = t->name();
+#ifdef __GNUC__
+   int status;
+   char* d = abi::__cxa_demangle( name, NULL, NULL, &status );
+   if ( d )
+   {
+      std::string r( d );
+      free( d );
+      return r;
+   }
+#else
+   if ( strncmp( name, "class ", 6 ) == 0 )       name += 6;
+   else if ( strncmp( name, "struct ", 7 ) == 0 ) name += 7;
+#endif
+   return std::string( name );
+}
+
+} // namespace
+
+
+void mrProfiler::start()
+{
+   stats.clear();
+   stack.clear();
+   startTime = mr_wall_time();
+   enabled   = true;
+}
+
+
+void mrProfiler::Scope::begin( const void* node, const std::type_info& t,
+			       const Phase phase, MRL_FILE* f )
+{
+   // A method calling its base class' version of itself is one call.
+   if ( !stack.empty() )
+   {
+      const mrProfileFrame& top = stack.back();
+      if ( top.node == node && top.phase == phase ) return;
+   }
+
+   mrProfileFrame fr;
+   fr.node  = node;
+   fr.type  = &t;
+   fr.phase = phase;
+   fr.f     = f;
+   fr.bytes = mr_bytes_written( f );
+   fr.childTime  = 0;
+   fr.childBytes = 0;
+   fr.start = mr_wall_time();
+   stack.push_back( fr );
+   active = true;
+}
+
+
+void mrProfiler::Scope::end()
+{
+   if ( stack.empty() ) return;  // stop() was called inside a scope
+
+   const mrProfileFrame& fr = stack.back();
+   double t     = mr_wall_time() - fr.start;
+   double bytes = mr_bytes_written( fr.f ) - fr.bytes;
+   if ( bytes < 0 ) bytes = 0;
+
+   mrProfileStat& s = stats[fr.type].phase[fr.phase];
+   ++s.calls;
+   s.total += t;
+   s.self  += t - fr.childTime;
+   s.bytes += bytes - fr.childBytes;
+
+   MRL_FILE* f = fr.f;
+   stack.pop_back();
+
+   if ( !stack.empty() )
+   {
+      mrProfileFrame& parent = stack.back();
+      parent.childTime += t;
+      if ( parent.f == f ) parent.childBytes += bytes;
+   }
+}
+
+
+void mrProfiler::stop( const MString& root )
+{
+   if ( !enabled ) return;
+   enabled = false;
+   stack.clear();
+
+   double elapsed = mr_wall_time() - startTime;
+
+   // One row per class and phase, sorted by self time, slowest first
+   std::vector< mrProfileRow > rows;
+   mrProfileStat phases[kNumPhases];
+
+   mrProfileMap::const_iterator i = stats.begin();
+   mrProfileMap::const_iterator e = stats.end();
+   for ( ; i != e; ++i )
+   {
+      std::string name = class_name( i->first );
+      for ( int p = 0; p < kNumPhases; ++p )
+      {
+	 const mrProfileStat& s = i->second.phase[p];
+	 if ( s.calls == 0 ) continue;
+	 mrProfileRow r = { name, p, &s };
+	 rows.push_back( r );
+	 phases[p].calls += s.calls;
+	 phases[p].self  += s.self;
+	 phases[p].bytes += s.bytes;
+      }
+   }
+   std::sort( rows.begin(), rows.end() );
+
+   MString jsonName = root + ".json";
+   FILE* json = fopen( jsonName.asChar(), "wb" );
+   MString csvName = root + ".csv";
+   FILE* csv = fopen( csvName.asChar(), "wb" );
+   if ( json == NULL || csv == NULL )
+   {
+      if ( json ) fclose( json );
+      if ( csv )  fclose( csv );
+      MString err = "Could not save profile to \"";
+      err += root;
+      err += "\"";
+      LOG_ERROR( err );
+      return;
+   }
+
+   fprintf( json, "{\n  \"elapsed\": %.6f,\n  \"phases\": {\n", elapsed );
+   for ( int p = 0; p < kNumPhases; ++p )
+   {
+      fprintf( json, "    \"%s\": { \"calls\": %lu, \"self\": %.6f, "
+	       "\"bytes\": %.0f }%s\n", kPhaseNames[p], phases[p].calls,
+	       phases[p].self, phases[p].bytes,
+	       p < kNumPhases - 1 ? "," : "" );
+   }
+   fprintf( json, "  },\n  \"nodes\": [\n" );
+
+   fprintf( csv, "class,phase,calls,total,self,bytes\n" );
+
+   size_t num = rows.size();
+   for ( size_t j = 0; j < num; ++j )
+   {
+      const char* name = rows[j].name.c_str();
+      const char* phase = kPhaseNames[ rows[j].phase ];
+      const mrProfileStat& s = *rows[j].stat;
+      fprintf( json, "    { \"class\": \"%s\", \"phase\": \"%s\", "
+	       "\"calls\": %lu, \"total\": %.6f, \"self\": %.6f, "
+	       "\"bytes\": %.0f }%s\n", name, phase,
+	       s.calls, s.total, s.self, s.bytes, j < num - 1 ? "," : "" );
+      fprintf( csv, "%s,%s,%lu,%.6f,%.6f,%.0f\n", name, phase,
+	       s.calls, s.total, s.self, s.bytes );
+   }
+   fprintf( json, "  ]\n}\n" );
+
+   fclose( json );
+   fclose( csv );
+
+   MString msg = "Export profile saved to ";
+   msg += jsonName;
+   msg += " and ";
+   msg += csvName;
+   LOG_MESSAGE( msg );
+}
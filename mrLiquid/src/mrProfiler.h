@@ -0,0 +1,117 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+/**
+ * @file   mrProfiler.h
+ * 
+ * @brief  Optional profiler of where export time goes, per node class
+ *         and per phase (getData, getMotionBlur, write).
+ * 
+ */
+
+#ifndef mrProfiler_h
+#define mrProfiler_h
+
+#include <typeinfo>
+
+#include "maya/MString.h"
+
+#ifndef mrIO_h
+#include "mrIO.h"
+#endif
+
+
+//! Accumulates wall time, number of calls and bytes written for each
+//! node class and phase of the export.
+//!
+//! Code to profile just places an MRL_PROFILE() at the top of a method.
+//! Scopes nest: time (and bytes) spent in a nested scope is also
+//! counted in its parent's total, but not in its parent's self time.
+//! When profiling is off, a scope costs a single test of a global flag.
+//!
+//! Nodes are translated from the main thread only, so no locking is done.
+class mrProfiler
+{
+   public:
+     enum Phase
+     {
+       kGetData,
+       kMotionBlur,
+       kWrite,
+       kNumPhases
+     };
+
+     //! Is profiling on?
+     static bool enabled;
+
+     //! Clear all statistics and turn profiling on.
+     static void start();
+
+     //! Turn profiling off and save the statistics gathered since
+     //! start() to root.json and root.csv.
+     static void stop( const MString& root );
+
+     //! Profiles the lifetime of the object.  Use thru MRL_PROFILE().
+     class Scope
+     {
+	public:
+	  template< class T >
+	  inline Scope( const T* node, const Phase phase,
+			MRL_FILE* f = NULL ) : active( false )
+	  {
+	     if ( enabled ) begin( node, typeid(*node), phase, f );
+	  }
+
+	  inline ~Scope()
+	  {
+	     if ( active ) end();
+	  }
+
+	private:
+	  void begin( const void* node, const std::type_info& t,
+		      const Phase phase, MRL_FILE* f );
+	  void end();
+
+	  bool active;
+     };
+};
+
+
+//! Profile the current method of a node as phase (kGetData,
+//! kMotionBlur or kWrite).
+#define MRL_PROFILE( phase ) \
+   mrProfiler::Scope mrl_profile_scope( this, mrProfiler::phase )
+
+//! Profile a write method of a node, counting bytes written to f.
+#define MRL_PROFILE_WRITE( f ) \
+   mrProfiler::Scope mrl_profile_scope( this, mrProfiler::kWrite, f )
+
+
+#endif // mrProfiler_h
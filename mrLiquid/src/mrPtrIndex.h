@@ -0,0 +1,270 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef mrPtrIndex_h
+#define mrPtrIndex_h
+
+#include <cstddef>
+#include <vector>
+
+
+//! Open addressing hash table mapping a pointer to an integer slot.
+//! Used by groups to keep membership checks and removals O(1).
+//! Removal uses backward shift deletion, so no tombstones are
+//! left behind in the table.
+class mrPtrIndex
+{
+   struct Entry
+   {
+     const void* key;
+     size_t      slot;
+   };
+
+   typedef std::vector< Entry > EntryList;
+
+   EntryList  table;
+   size_t     mask;
+   size_t     count;
+
+   static inline size_t hash( const void* p )
+   {
+      // Pointers are aligned, so drop the low bits and mix the rest
+      // with a fibonacci multiplier.
+      size_t h = reinterpret_cast< size_t >( p ) >> 3;
+      h ^= h >> 16;
+      h *= (size_t) 0x9E3779B97F4A7C15ULL;
+      h ^= h >> 15;
+      return h;
+   }
+
+   inline void rehash( size_t buckets )
+   {
+      EntryList old;
+      old.swap( table );
+      Entry empty = { NULL, 0 };
+      table.resize( buckets, empty );
+      mask  = buckets - 1;
+      count = 0;
+
+      EntryList::const_iterator i = old.begin();
+      EntryList::const_iterator e = old.end();
+      for ( ; i != e; ++i )
+      {
+	 if ( i->key ) insert( i->key, i->slot );
+      }
+   }
+
+   public:
+     mrPtrIndex() : mask(0), count(0) {}
+
+     size_t size() const throw()  { return count; }
+     bool  empty() const throw()  { return count == 0; }
+
+     inline void clear()
+     {
+	EntryList empty;
+	table.swap( empty );
+	mask  = 0;
+	count = 0;
+     }
+
+     //! Reserve space for at least n pointers without rehashing.
+     inline void reserve( size_t n )
+     {
+	size_t buckets = 16;
+	while ( buckets < n * 2 ) buckets <<= 1;
+	if ( buckets > table.size() ) rehash( buckets );
+     }
+
+     //! Return the slot stored for p, or -1 if p is not in the index.
+     inline ptrdiff_t find( const void* p ) const
+     {
+	if ( count == 0 ) return -1;
+	size_t idx = hash( p ) & mask;
+	for (;;)
+	{
+	   const Entry& x = table[idx];
+	   if ( x.key == p )    return (ptrdiff_t) x.slot;
+	   if ( x.key == NULL ) return -1;
+	   idx = (idx + 1) & mask;
+	}
+     }
+
+     //! Add p or update its slot if already present.
+     inline void insert( const void* p, size_t slot )
+     {
+	if ( (count + 1) * 2 > table.size() )
+	   rehash( table.empty() ? 16 : table.size() * 2 );
+
+	size_t idx = hash( p ) & mask;
+	for (;;)
+	{
+	   Entry& x = table[idx];
+	   if ( x.key == p ) { x.slot = slot; return; }
+	   if ( x.key == NULL )
+	   {
+	      x.key  = p;
+	      x.slot = slot;
+	      ++count;
+	      return;
+	   }
+	   idx = (idx + 1) & mask;
+	}
+     }
+
+     //! Remove p from the index.  Returns false if p was not present.
+     inline bool erase( const void* p )
+     {
+	if ( count == 0 ) return false;
+	size_t idx = hash( p ) & mask;
+	for (;;)
+	{
+	   const void* k = table[idx].key;
+	   if ( k == p )    break;
+	   if ( k == NULL ) return false;
+	   idx = (idx + 1) & mask;
+	}
+
+	// Backward shift the rest of the cluster into the freed bucket.
+	size_t hole = idx;
+	for (;;)
+	{
+	   idx = (idx + 1) & mask;
+	   const Entry& x = table[idx];
+	   if ( x.key == NULL ) break;
+	   size_t home = hash( x.key ) & mask;
+	   if ( ((idx - home) & mask) >= ((idx - hole) & mask) )
+	   {
+	      table[hole] = x;
+	      hole = idx;
+	   }
+	}
+	table[hole].key  = NULL;
+	table[hole].slot = 0;
+	--count;
+	return true;
+     }
+};
+
+//! List of pointers kept in insertion order and indexed by mrPtrIndex,
+//! so contains() and erase() are O(1).  A pointer is in the list at most
+//! once.  erase() leaves a NULL hole in its slot, which is compacted away,
+//! in order, the next time the list is iterated.
+template< typename D, typename C = std::vector< D* > >
+class mrPtrList
+{
+   public:
+     typedef C               container;
+     typedef typename container::iterator       iterator;
+     typedef typename container::const_iterator const_iterator;
+     typedef typename container::value_type     value_type;
+
+   protected:
+     container  items;
+     mrPtrIndex index;
+     size_t     holes;
+
+   public:
+     mrPtrList() : holes(0) {}
+
+     size_t size() const throw() { return items.size() - holes; }
+     bool  empty() const throw() { return size() == 0; }
+
+     bool  contains( const D* const elem ) const
+     {
+	return index.find( elem ) >= 0;
+     }
+
+     iterator begin() { compact(); return items.begin(); }
+     iterator end()   { compact(); return items.end(); }
+     value_type back() { compact(); return items.back(); }
+
+     inline void clear()
+     {
+	items.clear();
+	index.clear();
+	holes = 0;
+     }
+
+     //! Remove the NULL holes left behind by erase(), preserving the
+     //! order of the remaining items and updating their slots.
+     inline void compact()
+     {
+	if ( holes == 0 ) return;
+
+	size_t num = items.size();
+	size_t j = 0;
+	for ( size_t i = 0; i < num; ++i )
+	{
+	   D* elem = items[i];
+	   if ( elem == NULL ) continue;
+	   if ( i != j )
+	   {
+	      items[j] = elem;
+	      index.insert( elem, j );
+	   }
+	   ++j;
+	}
+	items.resize( j );
+	holes = 0;
+     }
+
+     //! Append elem.  Returns false (and does nothing) if already present.
+     inline bool push_back( D* const elem )
+     {
+	if ( index.find( elem ) >= 0 ) return false;
+	index.insert( elem, items.size() );
+	items.push_back( elem );
+	return true;
+     }
+
+     //! Remove elem.  Returns false if it was not present.
+     inline bool erase( D* const elem )
+     {
+	ptrdiff_t slot = index.find( elem );
+	if ( slot < 0 ) return false;
+
+	index.erase( elem );
+	if ( (size_t) slot == items.size() - 1 )
+	{
+	   items.pop_back();
+	}
+	else
+	{
+	   items[slot] = NULL;
+	   ++holes;
+	}
+	return true;
+     }
+};
+
+
+#endif // mrPtrIndex_h
@@ -116,6 +116,6 @@ void mrRenderContext::open( const char* filename )
 
 void mrRenderContext::close()
 {
-   if ( f ) fclose(f);
+   if ( f ) MRL_FCLOSE(f);
 }
 
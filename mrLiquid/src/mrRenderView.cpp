@@ -72,6 +72,7 @@
 
 #include "mrRenderView.h"
 #include "mrByteSwap.h"
+#include "mrIPRLatency.h"
 
 
 extern MString tempDir;
@@ -571,7 +572,7 @@ MR_THREAD_RETURN mr_stub_reader_cb( void* v )
 	 nRet = WSAStartup(wVersionRequested, &wsaData);
 	 if (wsaData.wVersion != wVersionRequested)
 	 {
-	    MRL_FPRINTF(stderr,"\n Wrong winsock version\n");
+	    fprintf(stderr,"\n Wrong winsock version\n");
 	    MR_THREAD_EXIT(1);
 	 }
 #endif
@@ -667,6 +668,7 @@ MR_THREAD_RETURN mr_pipe_reader_cb( void* v )
 	 case 2:
 	    // tile data
 	    {
+	       mrIPRLatency::tile();
 	       int w = p.xh - p.xl + 1;
 	       int h = p.yh - p.yl + 1;
 	       int size = w*h;
@@ -31,6 +31,7 @@
 
 #include <set>
 #include <cassert>
+#include <cstring>
 
 #include "maya/MPlug.h"
 #include "maya/MPlugArray.h"
@@ -144,6 +145,10 @@
 #include "mrUserData.h"
 #endif
 
+#ifndef mrContentHash_h
+#include "mrContentHash.h"
+#endif
+
 
 #include "mrAttrAux.h"
 
@@ -211,6 +216,7 @@ extern MDagPath currentObjPath;
 		     destName = d.name(); \
 		   } \
 	       } \
+	       destName = alias( destName ); \
 	       MRL_FPRINTF(f, "= \"%s\"", destName.asChar() ); \
 	    } \
 	 } \
@@ -468,7 +474,8 @@ shaderName( shader ),
 miText(NULL),
 progressiveLast( -1.0f ),
 numOutAttrs( 1 ),
-isAnimated( false )
+isAnimated( false ),
+childStamp( 0 )
 {
   options->passAlphaThrough = true;
 }
@@ -480,7 +487,8 @@ shaderName( shader ),
 miText(NULL),
 progressiveLast( -1.0f ),
 numOutAttrs( 1 ),
-isAnimated( MAnimUtil::isAnimated( path ) )
+isAnimated( MAnimUtil::isAnimated( path ) ),
+childStamp( 0 )
 {
    MFnDependencyNode fn( nodeHandle.objectRef() );
    DBG( shaderName << " => " << fn.typeId().id() );
@@ -495,7 +503,8 @@ nodeHandle( fn.object() ),
 miText(NULL),
 progressiveLast( -1.0f ),
 numOutAttrs( 0 ),
-isAnimated( MAnimUtil::isAnimated( fn.object() ) )
+isAnimated( MAnimUtil::isAnimated( fn.object() ) ),
+childStamp( 0 )
 {
 
    auxShaders.reserve(10);
@@ -549,6 +558,11 @@ isAnimated( MAnimUtil::isAnimated( fn.object() ) )
    DBG(name << "  mrShader::constructor " << numOutAttrs);
 }
 
+mrShader::~mrShader()
+{
+   if ( aliasName.length() > 0 ) --numAliases;
+}
+
 //@todo: speed up by using binary search and listing all ids in order.
 bool mrShader::isMayaShader( unsigned id )
 {
@@ -1329,6 +1343,7 @@ MString mrShader::newOutShader( MRL_FILE* f, const MPlug& p,
       newOutShader += "-";
       newOutShader += container;
    }
+   newOutShader = alias( newOutShader );
    newOutShader += ">";
    newOutShader += attrName;
 
@@ -1337,7 +1352,7 @@ MString mrShader::newOutShader( MRL_FILE* f, const MPlug& p,
       return newOutShader;  // we already did this shader with another plug
    auxShaders.push_back( pp );
    
-   MString newOutConn = d.name() + "." + attrName;
+   MString newOutConn = alias( d.name() + "." + attrName );
 
    if ( written == kIncremental ) MRL_PUTS("incremental ");
    MRL_FPRINTF(f, "shader \"%s\"\n", newOutShader.asChar() );
@@ -1474,28 +1489,100 @@ MString mrShader::getStringForChildPlug( const MPlug& p,
 
 
 
-void mrShader::getChildShaders( NodeSet& nodes,
-				const MFnDependencyNode& dep )
+namespace {
+
+//! Connected inputs of a node, as found when the cache was last
+//! invalidated.
+struct mrConnectionEntry
 {
+#if MAYA_API_VERSION >= 600
+  MObjectHandle            node;
+#else
+  MObject                  node;
+#endif
+  mrShader::ConnectionList list;
+};
+
+typedef std::map< std::string, mrConnectionEntry > mrConnectionCache;
+mrConnectionCache connectionCache;
+
+}
+
+unsigned mrShader::traversalStamp = 1;
+
+
+void mrShader::invalidateConnections()
+{
+  connectionCache.clear();
+  ++traversalStamp;
+}
+
+
+const mrShader::ConnectionList& 
+mrShader::connections( const MFnDependencyNode& dep )
+{
+  MObject node = dep.object();
+
+  // Keyed by name, but a node renamed (or a new node reusing the name)
+  // is also caught by comparing the node itself.
+  std::string name( dep.name().asChar() );
+  mrConnectionCache::iterator i = connectionCache.find( name );
+  if ( i != connectionCache.end() )
+    {
+#if MAYA_API_VERSION >= 600
+      const MObjectHandle& h = i->second.node;
+      if ( h.isValid() && h.objectRef() == node ) return i->second.list;
+#else
+      if ( i->second.node == node ) return i->second.list;
+#endif
+    }
+
+  mrConnectionEntry& entry = connectionCache[name];
+  entry.node = node;
+  entry.list.clear();
+
   MPlugArray connAttrs;
   dep.getConnections( connAttrs );
 
+  unsigned numConn = connAttrs.length();
+  entry.list.reserve( numConn );
+
+  MPlugArray plugs;
+  for ( unsigned j = 0; j < numConn; ++j )
+    {
+      connAttrs[j].connectedTo( plugs, true, false );
+      if ( plugs.length() == 0 ) continue;
+
+      Connection c;
+      c.dst = connAttrs[j];
+      c.src = plugs[0];
+      c.key = connAttrs[j].name().asChar();
+      entry.list.push_back( c );
+    }
+  return entry.list;
+}
+
+
+void mrShader::findChildShaders( std::vector< mrNode* >& others,
+				 std::vector< mrShader* >& shaders,
+				 const MFnDependencyNode& dep )
+{
+  const ConnectionList& conns = connections( dep );
+
   int cont = name.rindex('-');
   const char* container = NULL;
   if ( cont >= 0 ) container = name.asChar() + cont + 1;
 
-  unsigned numConn = connAttrs.length();
+  unsigned numConn = (unsigned) conns.size();
   if ( numConn == 0 ) return;
 
-  MPlugArray plugs;
   for ( unsigned i = 0; i < numConn; ++i )
     {
-      connAttrs[i].connectedTo( plugs, true, false );
-      if ( plugs.length() == 0 ) continue;
+      const Connection& c = conns[i];
 
-      DBG(name << ": getChildShaders for plug " << plugs[0].info());
+      DBG(name << ": getChildShaders for plug " << c.src.info());
 
-      const MObject& newObj = plugs[0].node();
+      const MObject& newObj = c.src.node();
 
       if ( newObj.hasFn( MFn::kDagNode ) )
 	{
@@ -1517,7 +1604,7 @@ void mrShader::getChildShaders( NodeSet& nodes,
 						   MObject::kNullObj );
 		mrInstanceCamera* inst = mrInstanceCamera::factory( camPath, 
 								    cam );
-		nodes.insert( inst );
+		others.push_back( inst );
 		continue;
 	      }
 	    case MFn::kLightSource:
@@ -1542,7 +1629,7 @@ void mrShader::getChildShaders( NodeSet& nodes,
 	    case kMentalrayLightProfile:
 	      {
 		mrLightProfile* s = mrLightProfile::factory( fn );
-		nodes.insert( s );
+		others.push_back( s );
 		continue;
 	      }
 	    case kMentalrayVertexColors:
@@ -1592,7 +1679,7 @@ void mrShader::getChildShaders( NodeSet& nodes,
 	{
 	  MFnDependencyNode fn( newObj );
 	  mrTextureNode* s = mrTextureNode::factory( fn );
-	  nodes.insert( s );
+	  others.push_back( s );
 	  // 	 s->setIncremental(sameFrame);
 	  continue;
 	}
@@ -1611,7 +1698,7 @@ void mrShader::getChildShaders( NodeSet& nodes,
 	 // Handle materials connected as mental ray parameters
 	 MFnDependencyNode fn( newObj );
 	 mrShadingGroup* g = mrShadingGroup::factory(fn);
-	 nodes.insert( g );
+	 others.push_back( g );
 	 continue;
       }
       else if (
@@ -1623,7 +1710,7 @@ void mrShader::getChildShaders( NodeSet& nodes,
 	 mrGroupInstance* s = mrGroupInstance::factory( fn );
 	 MString name = fn.name() + ":inst";
 	 mrInstanceGroup* g = mrInstanceGroup::factory( name, s );
-	 nodes.insert( g );
+	 others.push_back( g );
 	 continue;
       }
       else if (
@@ -1641,13 +1728,49 @@ void mrShader::getChildShaders( NodeSet& nodes,
 	}
 
       mrShader* s = mrShader::factory( newObj, container );
-      if ( !s || s->written == kInProgress ) continue; 
-
-      nodes.insert( s );
+      if ( s ) shaders.push_back( s );
 
     } // for (i... numConn)
+}
+
 
+void mrShader::getChildShaders( NodeSet& nodes,
+				const MFnDependencyNode& dep )
+{
+  std::vector< mrNode* >    others;
+  std::vector< mrShader* >  shaders;
+  std::vector< mrNode* >*   o = &others;
+  std::vector< mrShader* >* s = &shaders;
+
+  // The child list of this shader's own node is kept until the next
+  // invalidateConnections().  Shared networks are walked from each
+  // shading group that uses them, so this saves many walks per frame.
+  if ( dep.object() == nodeRef() )
+    {
+      o = &childNodes;
+      s = &childShaders;
+      if ( childStamp != traversalStamp )
+	{
+	  childNodes.clear();
+	  childShaders.clear();
+	  findChildShaders( childNodes, childShaders, dep );
+	  childStamp = traversalStamp;
+	}
+    }
+  else
+    {
+      findChildShaders( others, shaders, dep );
+    }
+
+  nodes.insert( o->begin(), o->end() );
 
+  std::vector< mrShader* >::const_iterator i = s->begin();
+  std::vector< mrShader* >::const_iterator e = s->end();
+  for ( ; i != e; ++i )
+    {
+      if ( (*i)->written == kInProgress ) continue;  // cycle check
+      nodes.insert( *i );
+    }
 }
 
 
@@ -1721,7 +1844,9 @@ void mrShader::updateChildShaders( MRL_FILE* f,
   NodeSet::iterator e = nodes.end();
   for ( ; i != e; ++i )
     {
+      aliasable = *i;
       (*i)->write( f );
+      aliasable = NULL;
     }
 }
 
@@ -1740,8 +1865,7 @@ void mrShader::getConnectionNames( MRL_FILE* f, ConnectionMap& connNames,
 {
    DBG(name << "  mrShader::getConnectionNames");
    
-   MPlugArray connAttrs;
-   dep.getConnections( connAttrs );
+   const ConnectionList& conns = connections( dep );
 
    const char* container = NULL;
    {
@@ -1770,18 +1894,16 @@ void mrShader::getConnectionNames( MRL_FILE* f, ConnectionMap& connNames,
    // of phenomena, too, albeit more from the user's pov.
    //
    ////////////////////////////////////////////////////////////////////////
-   unsigned numConn = connAttrs.length();
+   unsigned numConn = (unsigned) conns.size();
    MPlugArray plugs;
    for ( unsigned i = 0; i < numConn; ++i )
    {
-      connAttrs[i].connectedTo( plugs, true, false );
-      if ( plugs.length() == 0 )
-	 continue;
+      const Connection& c = conns[i];
 
-      DBG(name << " getConnectionNames for plug " << plugs[0].info() );
+      DBG(name << " getConnectionNames for plug " << c.src.info() );
 
-      MObject newObj = plugs[0].node();
-      std::string key( connAttrs[i].name().asChar() );
+      MObject newObj = c.src.node();
+      const std::string& key = c.key;
 
       if ( newObj.hasFn( MFn::kDagNode ) )
       {
@@ -1804,7 +1926,7 @@ void mrShader::getConnectionNames( MRL_FILE* f, ConnectionMap& connNames,
 	    case MFn::kLightSource:
 	       {
 		  MDagPath inst;
-		  MDagPath::getAPathTo( plugs[0].node(), inst );
+		  MDagPath::getAPathTo( c.src.node(), inst );
 		  inst.pop();
 		  connNames.insert( std::make_pair( key,
 						    getMrayName( inst ) ) );
@@ -1817,7 +1939,7 @@ void mrShader::getConnectionNames( MRL_FILE* f, ConnectionMap& connNames,
 		  if ( dynamic_cast< mrShaderMaya* >(this) == NULL )
 		  {
 		     MDagPath objPath;
-		     MDagPath::getAPathTo( plugs[0].node(), objPath );
+		     MDagPath::getAPathTo( c.src.node(), objPath );
 		     mrObject* obj = mrObjectEmpty::factory( objPath );
 		     assert( obj != NULL );
 		     if (obj->written == kNotWritten)
@@ -1936,9 +2058,9 @@ void mrShader::getConnectionNames( MRL_FILE* f, ConnectionMap& connNames,
 		  {
 		     MString msg = name;
 		     msg += ": Unknown plugin connection for attribute \"";
-		     msg += connAttrs[i].info();
+		     msg += c.dst.info();
 		     msg += "\" to \"";
-		     msg += plugs[0].info();
+		     msg += c.src.info();
 		     msg += "\"";
 		     LOG_ERROR(msg);
 		     continue;
@@ -2023,13 +2145,13 @@ void mrShader::getConnectionNames( MRL_FILE* f, ConnectionMap& connNames,
 	       if ( dummy->id == 0 )
 		  continue;
 	    }
-	    invalid_connection( connAttrs[i], plugs[0] );
+	    invalid_connection( c.dst, c.src );
 	    continue;  // not a shader, skip it
 	 }
       }
       else
 	{
-	  invalid_connection( connAttrs[i], plugs[0] );
+	  invalid_connection( c.dst, c.src );
 	  continue;
 	}
 
@@ -2038,17 +2160,19 @@ void mrShader::getConnectionNames( MRL_FILE* f, ConnectionMap& connNames,
       if ( !s || s->written == kInProgress ) continue;  // cycle check
 
       DBG(name << ": +++ NEW CHILD SHADER " << s->name);
+      aliasable = s;
       s->write(f);
+      aliasable = NULL;
       DBG2(name << ": +++ WRITTEN CHILD SHADER " << s->name);
 
       // OKAY, are we are dealing with a child connection of
       // a compound attribute?  If so, we need to create a shader bridge
-      if ( isComponentPlug( connAttrs[i] ) )
+      if ( isComponentPlug( c.dst ) )
       {
-	 DBG(connAttrs[i].info() << " is a child attribute");
+	 DBG(c.dst.info() << " is a child attribute");
 
 	 // Change the connection map key to be the parent (main) plug
-	 MPlug p = connAttrs[i].parent();
+	 MPlug p = c.dst.parent();
 
 	 AuxShaders::iterator ie = auxShaders.end();
 	 if ( std::find( auxShaders.begin(), ie, p ) != ie )
@@ -2065,17 +2189,17 @@ void mrShader::getConnectionNames( MRL_FILE* f, ConnectionMap& connNames,
 // 	// value directly)
 //      // this is wrong.  it needs to check if it is a mentalray output,
 //      // not a maya output
-// 	MFnAttribute fnAttr( plugs[0].attribute() );
+// 	MFnAttribute fnAttr( c.src.attribute() );
 // 	if ( fnAttr.isWritable() )
 // 	  {
 // 	    continue;
 // 	  }
 
 	 MString destName;
-	 if ( isComponentPlug( plugs[0] ) )
+	 if ( isComponentPlug( c.src ) )
 	 {
-	    MString outShader = newOutShader( f, plugs[0], container );
-	    char* destComp = getLowercaseComponent( plugs[0] );
+	    MString outShader = newOutShader( f, c.src, container );
+	    char* destComp = getLowercaseComponent( c.src );
 	    destName = outShader + "." + destComp;
 	 }
 	 else
@@ -2088,12 +2212,12 @@ void mrShader::getConnectionNames( MRL_FILE* f, ConnectionMap& connNames,
 	    {
 	       if ( !container )
 	       {
-		  destName = plugs[0].info();
+		  destName = c.src.info();
 		  DBG("destName !container: " << destName);
 	       }
 	       else
 	       {
-		  MString plugName = plugs[0].info();
+		  MString plugName = c.src.info();
 		  int idx = plugName.rindex('.');
 		  destName = plugName.substring(0, idx-1);
 		  destName += "-";
@@ -2229,14 +2353,161 @@ void mrShader::getConnectionNames( MRL_FILE* f, ConnectionMap& connNames,
    auxiliaryShaders.clear();
    auxShaders.clear();
    /////////////// end of getting connections
+
+   // Refer to de-duplicated child shaders by the shader written for them.
+   if ( numAliases > 0 )
+   {
+      ConnectionMap::iterator ci = connNames.begin();
+      ConnectionMap::iterator ce = connNames.end();
+      for ( ; ci != ce; ++ci )
+	 ci->second = alias( ci->second );
+   }
 }
 
 
+namespace {
+
+//! A shader written out and the shaders found to be identical to it.
+struct mrDedupGroup
+{
+  MString      shader;
+  std::string  params;      // shader's declaration name and parameters
+  MStringArray duplicates;  // since last reportDuplicates()
+};
+
+typedef std::map< mrContentHash::Key, mrDedupGroup > mrDedupGroups;
+mrDedupGroups dedupGroups;
+
+#ifdef MRL_MEMORY_FILES
+MRL_FILE* dedupParams = NULL;
+#endif
+
+}
+
+const mrNode* mrShader::aliasable  = NULL;
+int           mrShader::noDedup    = 0;
+unsigned      mrShader::numAliases = 0;
+
+
+MString mrShader::alias( const MString& ref )
+{
+  if ( numAliases == 0 ) return ref;
+
+  const char* c = ref.asChar();
+  unsigned len = (unsigned) strcspn( c, ".<>" );
+  if ( len == 0 ) return ref;
+
+  MString n = ref;
+  if ( len < ref.length() ) n = ref.substring( 0, len - 1 );
+
+  mrNodeList::iterator i = nodeList.find( n );
+  if ( i == nodeList.end() ) return ref;
+
+  mrShader* s = dynamic_cast< mrShader* >( i->second );
+  if ( s == NULL || s->aliasName.length() == 0 ) return ref;
+
+  MString r = s->aliasName;
+  r += c + len;
+  return r;
+}
+
+
+void mrShader::clearDuplicates()
+{
+  dedupGroups.clear();
+}
+
+
+void mrShader::reportDuplicates()
+{
+  unsigned numGroups = 0, numDups = 0;
+  mrDedupGroups::iterator i = dedupGroups.begin();
+  mrDedupGroups::iterator e = dedupGroups.end();
+  for ( ; i != e; ++i )
+    {
+      MStringArray& dups = i->second.duplicates;
+      unsigned num = dups.length();
+      if ( num == 0 ) continue;
+
+      MString msg = "Shader \"";
+      msg += i->second.shader;
+      msg += "\" written for ";
+      msg += (int) num;
+      msg += " identical shader";
+      if ( num > 1 ) msg += "s";
+      msg += ":";
+      for ( unsigned j = 0; j < num; ++j )
+	{
+	  msg += " ";
+	  msg += dups[j];
+	}
+      LOG_MESSAGE( msg );
+
+      ++numGroups;
+      numDups += num;
+      dups.setLength( 0 );
+    }
+
+  MString msg = "De-duplicated ";
+  msg += (int) numDups;
+  msg += " shaders into ";
+  msg += (int) numGroups;
+  msg += ".";
+  LOG_MESSAGE( msg );
+}
+
+
+#ifdef MRL_MEMORY_FILES
+MRL_FILE* mrShader::dedup_parameters( MFnDependencyNode& dep,
+				      const ConnectionMap& connNames )
+{
+   if ( dedupParams == NULL ) dedupParams = mrlFile::memory();
+   MRL_FILE* f = dedupParams;
+   f->rewind();
+   write_shader_parameters( f, dep, connNames );
+
+   // Child shaders are already referred to by their canonical names,
+   // so the hash covers the whole upstream network.
+   mrContentHash h;
+   h.add( shaderName );
+   h.add( f->data(), f->size() );
+
+   // The hash only finds candidates.  The parameters written are
+   // compared too, so a hash collision never aliases different shaders.
+   std::string params( shaderName.asChar(), shaderName.length() + 1 );
+   params.append( f->data(), f->size() );
+
+   mrDedupGroup& g = dedupGroups[ h.value() ];
+   if ( g.shader.length() > 0 && g.shader != name && g.params == params )
+   {
+      mrShader* s = NULL;
+      mrNodeList::iterator i = nodeList.find( g.shader );
+      if ( i != nodeList.end() ) s = dynamic_cast< mrShader* >( i->second );
+      if ( s && s->written == kWritten && s->aliasName.length() == 0 )
+      {
+	 aliasName = g.shader;
+	 ++numAliases;
+	 g.duplicates.append( name );
+	 return NULL;
+      }
+   }
+
+   g.shader = name;
+   g.params.swap( params );
+   return f;
+}
+#endif
+
+
 void mrShader::write( MRL_FILE* f )
 {
+   MRL_PROFILE_WRITE( f );
 
    DBG( name << ": mrShader::write()" );
 
+   bool mayAlias = ( aliasable == this );
+   aliasable = NULL;
+
    if ( options->exportFilter & mrOptions::kShaderDef )
       return;
 
@@ -2260,6 +2531,16 @@ void mrShader::write( MRL_FILE* f )
       written = kIncremental;
    }
 
+   // A de-duplicated shader that is now referred to by its own name or
+   // that changed gets written out for real.
+   if ( aliasName.length() > 0 && noDedup == 0 && written != kInProgress &&
+	( !mayAlias || written != kWritten ) )
+   {
+      aliasName = "";
+      --numAliases;
+      written = kNotWritten;
+   }
+
    MFnDependencyNode dep( nodeRef() );
    
    if ( written == kWritten )
@@ -2277,7 +2558,21 @@ void mrShader::write( MRL_FILE* f )
    getConnectionNames( f, connNames, dep );
    DBG2(name << ": Done with getConnection names");
 
-
+#ifdef MRL_MEMORY_FILES
+   MRL_FILE* params = NULL;
+   if ( mayAlias && oldWritten == kNotWritten && 
+	options->exportDedupShaders && !options->IPR && 
+	!options->fragmentExport && noDedup == 0 &&
+	!isAnimated && miText == NULL )
+   {
+      params = dedup_parameters( dep, connNames );
+      if ( params == NULL )
+      {
+	 written = kWritten;
+	 return;
+      }
+   }
+#endif
    
    if ( oldWritten == kIncremental )
    {
@@ -2295,6 +2590,10 @@ void mrShader::write( MRL_FILE* f )
    TAB(1);
    MRL_FPRINTF(f, "\"%s\" (\n", shaderName.asChar() );
 
+#ifdef MRL_MEMORY_FILES
+   if ( params ) f->append( params );
+   else
+#endif
    write_shader_parameters( f, dep, connNames );
    MRL_PUTC('\n');
    TAB(1); MRL_PUTS(")\n");
@@ -2399,22 +2698,19 @@ void mrShader::write_link_lines( MRL_FILE* f )
 
    MFnDependencyNode dep( nodeRef() );
 
-   MPlugArray connAttrs;
-   dep.getConnections( connAttrs );
+   const ConnectionList& conns = connections( dep );
 
    int cont = name.rindex('-');
    const char* container = NULL;
    if ( cont >= 0 ) container = name.asChar() + cont + 1;
 
    
-   unsigned numConn = connAttrs.length();
-   MPlugArray plugs;
+   unsigned numConn = (unsigned) conns.size();
    for ( unsigned i = 0; i < numConn; ++i )
    {
-      connAttrs[i].connectedTo( plugs, true, false );
-      if ( plugs.length() == 0 ) continue;
+      const Connection& c = conns[i];
 
-      const MObject& newObj = plugs[0].node();
+      const MObject& newObj = c.src.node();
 
       if ( newObj.hasFn( MFn::kDagNode ) )
       {
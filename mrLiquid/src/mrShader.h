@@ -65,12 +65,23 @@ class mrShader : public mrNode
      typedef std::map< std::string, MString > ConnectionMap;
      typedef std::set< mrNode* >              NodeSet;
 
+     //! A connected input of a node: the plug, its name and the plug
+     //! feeding it.
+     struct Connection
+     {
+       MPlug       dst;
+       MPlug       src;
+       std::string key;
+     };
+     typedef std::vector< Connection > ConnectionList;
+
    protected:
      mrShader( const MString& myName, const MString& shdrName );
      mrShader( const MString& shdrName, const MDagPath& p );
 
    public:
      mrShader( const MFnDependencyNode& p );
+     virtual ~mrShader();
      virtual void write( MRL_FILE* f );
 
 #if MAYA_API_VERSION >= 600
@@ -137,6 +148,35 @@ class mrShader : public mrNode
      static mrShader* factory( const MObject& obj,
 			       const char* container = NULL );
 
+     //! Return the connected inputs of a node.  These are cached until
+     //! the next call to invalidateConnections().
+     static const ConnectionList& connections( const MFnDependencyNode& dep );
+
+     //! Forget all cached connections and child shaders.  Must be called
+     //! for each new frame and whenever a connection changes or a node
+     //! is deleted.
+     static void invalidateConnections();
+
+     //! Shader whose next write() may be skipped if an identical shader
+     //! was written before.  Callers set it only for shaders they
+     //! reference thru alias().
+     static const mrNode* aliasable;
+
+     //! While > 0, shaders are not de-duplicated (inside phenomenon
+     //! declarations, whose shader names are local).
+     static int noDedup;
+
+     //! Given a reference to a shader (its name, optionally followed by
+     //! an output or bridge), return it with the shader's name replaced
+     //! by the identical shader written in its place, if any.
+     static MString alias( const MString& ref );
+
+     //! Forget the shaders seen for de-duplication.
+     static void clearDuplicates();
+
+     //! Print each group of identical shaders found since the last call.
+     static void reportDuplicates();
+
 
 
    protected:
@@ -144,6 +184,18 @@ class mrShader : public mrNode
      //! Print out an error message regarding an invalid connection
      void invalid_connection( const MPlug& from, const MPlug& to ) const;
 
+     //! Find the nodes connected as inputs of dep.  Shaders are
+     //! returned separately from all other nodes.
+     void findChildShaders( std::vector< mrNode* >& others,
+			    std::vector< mrShader* >& shaders,
+			    const MFnDependencyNode& dep );
+
+     //! Write the parameters of the shader into a memory file.  If an
+     //! identical shader was written before, become an alias of it and
+     //! return NULL.
+     MRL_FILE* dedup_parameters( MFnDependencyNode& dep,
+				 const ConnectionMap& connNames );
+
      //! Update written flag for all child shaders of this shader.
      void setWrittenChildShaders( const WriteMode mode );
 
@@ -212,6 +264,19 @@ class mrShader : public mrNode
    protected:     
      bool isAnimated;
 
+     //! Child shaders of this shader's node, found when childStamp
+     //! was traversalStamp.
+     std::vector< mrNode* >   childNodes;
+     std::vector< mrShader* > childShaders;
+     unsigned                 childStamp;
+
+     static unsigned traversalStamp;
+
+     //! Name of the identical shader written in place of this one, if
+     //! this shader was de-duplicated.
+     MString aliasName;
+     static unsigned numAliases;
+
 
 #ifdef GEOSHADER_H
    public:
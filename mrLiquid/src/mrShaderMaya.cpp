@@ -425,11 +425,11 @@ void mrShaderMaya::derive_photon_parameters( MRL_FILE* f, const char* container
 	      destName += "-"; \
 	      destName += container; \
               destName += plugName.substring( idx, plugName.length() - 1); \
-	      MRL_FPRINTF(f, "= \"%s\"", destName.asChar()); \
+	      MRL_FPRINTF(f, "= \"%s\"", alias( destName ).asChar()); \
            } \
            else \
            { \
-	     MRL_FPRINTF(f, "= \"%s\"", plugs[0].name().asChar()); \
+	     MRL_FPRINTF(f, "= \"%s\"", alias( plugs[0].name() ).asChar()); \
 	   } \
         } \
       } \
@@ -486,11 +486,11 @@ void mrShaderMaya::derive_photon_parameters( MRL_FILE* f, const char* container
 	      destName += "-"; \
 	      destName += container; \
               destName += plugName.substring( idx, plugName.length() - 1); \
-	      MRL_FPRINTF(f, "= \"%s\"", destName.asChar()); \
+	      MRL_FPRINTF(f, "= \"%s\"", alias( destName ).asChar()); \
            } \
            else \
            { \
-	     MRL_FPRINTF(f, "= \"%s\"", plugs[0].name().asChar()); \
+	     MRL_FPRINTF(f, "= \"%s\"", alias( plugs[0].name() ).asChar()); \
 	   } \
         } \
       } \
@@ -521,11 +521,11 @@ void mrShaderMaya::derive_photon_parameters( MRL_FILE* f, const char* container
 	      destName += "-"; \
 	      destName += container; \
               destName += plugName.substring( idx, plugName.length() - 1); \
-	      MRL_FPRINTF(f, "= \"%s\"", destName.asChar()); \
+	      MRL_FPRINTF(f, "= \"%s\"", alias( destName ).asChar()); \
            } \
            else \
            { \
-	     MRL_FPRINTF(f, "= \"%s\"", plugs[0].name().asChar()); \
+	     MRL_FPRINTF(f, "= \"%s\"", alias( plugs[0].name() ).asChar()); \
 	   } \
         } \
         else \
@@ -602,7 +602,7 @@ void mrShaderMaya::write_photon_parameters( MRL_FILE* f )
 	    if ( p.isConnected() )
 	    {
 	       p.connectedTo( plugs, true, false );
-	       MRL_FPRINTF(f, "= \"%s\"", plugs[0].name().asChar());
+	       MRL_FPRINTF(f, "= \"%s\"", alias( plugs[0].name() ).asChar());
 	    }
 	    else
 	    {
@@ -640,7 +640,7 @@ void mrShaderMaya::write_photon_parameters( MRL_FILE* f )
 	    if ( p.isConnected() )
 	    {
 	       p.connectedTo( plugs, true, false );
-	       MRL_FPRINTF(f, "= \"%s\"", plugs[0].name().asChar());
+	       MRL_FPRINTF(f, "= \"%s\"", alias( plugs[0].name() ).asChar());
 	    }
 	    else
 	    {
@@ -395,7 +395,7 @@ mrShaderMayaParticleFile::write_shader_parameters( MRL_FILE* f,
       
 	 TAB(2);
 	 MRL_FPRINTF(f, "\"%s\" = \"%s.%s\"", attrAsChar, 
-		 uvChooser.name().asChar(), outAttr.asChar() );
+		 alias( uvChooser.name() ).asChar(), outAttr.asChar() );
 	 continue;
       }
 
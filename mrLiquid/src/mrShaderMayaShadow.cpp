@@ -104,12 +104,12 @@ mrShaderMayaShadow::write_shader_parameters( MRL_FILE* f,
       if ( surface->numOutAttrs > 1 )
 	{
 	  MRL_FPRINTF( f, "\"transparency\" = \"%s.outTransparency\",\n", 
-		       surface->name.asChar() );
+		       alias( surface->name ).asChar() );
 	}
       else
 	{
 	  MRL_FPRINTF( f, "\"transparency\" = \"%s\",\n", 
-		       surface->name.asChar() );
+		       alias( surface->name ).asChar() );
 	}
 
 #ifdef  MAYA2MR_HAIR_SHADOW_BUG
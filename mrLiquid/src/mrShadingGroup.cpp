@@ -100,6 +100,7 @@ bool mrShadingGroup::newDisplacement() const
 
 void mrShadingGroup::getData()
 {
+   MRL_PROFILE( kGetData );
    currentSG = this;
    MStatus status; MPlug p;
    MFnDependencyNode fn( nodeRef() );
@@ -440,6 +441,7 @@ void mrShadingGroup::setIncremental( bool sameFrame )
 
 void mrShadingGroup::write( MRL_FILE* f )
 {
+   MRL_PROFILE_WRITE( f );
    if ( options->exportFilter & mrOptions::kMaterials )
       return;
 
@@ -447,7 +449,9 @@ void mrShadingGroup::write( MRL_FILE* f )
 
    if (! material )
      {
-#define writeShader( x ) if ( x ) x->write(f);
+#define writeShader( x ) \
+       if ( x ) { mrShader::aliasable = x; x->write(f); \
+                  mrShader::aliasable = NULL; }
        writeShader( surface );
 
        if ( miExportShadingEngine && (photon == NULL) &&
@@ -534,13 +538,15 @@ void mrShadingGroup::write( MRL_FILE* f )
 	       TAB(1); MRL_PUTS( "\"maya_shadingengine\" (\n");	 
 	       TAB(2); 
 	       const char* n = surface->name.asChar();
+	       const MString& sn = mrShader::alias( surface->name );
 	       if ( surface->numOutAttrs > 1 )
 		 {
-		   MRL_FPRINTF( f, "\"surfaceShader\" = \"%s.outColor\"", n );
+		   MRL_FPRINTF( f, "\"surfaceShader\" = \"%s.outColor\"", 
+				sn.asChar() );
 		 }
 	       else
 		 {
-		   MRL_FPRINTF( f, "\"surfaceShader\" = \"%s\"", n );
+		   MRL_FPRINTF( f, "\"surfaceShader\" = \"%s\"", sn.asChar() );
 		 }
 #if MAYA_API_VERSION >= 850
 	       MRL_PUTS(",\n");
@@ -562,14 +568,16 @@ void mrShadingGroup::write( MRL_FILE* f )
 	     }
 	   else
 	     {
-	       TAB(1); MRL_FPRINTF( f, " = \"%s\"\n", surface->name.asChar() );
+	       TAB(1); MRL_FPRINTF( f, " = \"%s\"\n", 
+				    mrShader::alias( surface->name ).asChar() );
 	     }
 	 }
    
 #define SGconnection( x )						\
        if ( x )								\
 	 {								\
-	   TAB(1); MRL_FPRINTF( f, #x " = \"%s\"\n", x->name.asChar() ); \
+	   TAB(1); MRL_FPRINTF( f, #x " = \"%s\"\n",			\
+				mrShader::alias( x->name ).asChar() );	\
 	 }
 
        if ( maya_displace && displace && !maya_particle_hair )
@@ -581,10 +589,10 @@ void mrShadingGroup::write( MRL_FILE* f )
 	   if ( m->id == kDisplacementShaderId ||
 		m->id == kOceanShaderId )
 	     MRL_FPRINTF( f, "\"displacement\" = \"%s.displacement\"\n",
-			  displace->name.asChar() );
+			  mrShader::alias( displace->name ).asChar() );
 	   else
 	     MRL_FPRINTF( f, "\"displacement\" = \"%s.outAlpha\"\n",
-			  displace->name.asChar() );
+			  mrShader::alias( displace->name ).asChar() );
 	   TAB(1); MRL_PUTS( ")\n");
 	 }
        else
@@ -600,10 +608,10 @@ void mrShadingGroup::write( MRL_FILE* f )
 	       TAB(2);
 	       if ( volume->numOutAttrs > 1 )
 		 MRL_FPRINTF( f, "\"volumeShader\" = \"%s.outColor\"\n",
-			      volume->name.asChar() );
+			      mrShader::alias( volume->name ).asChar() );
 	       else
 		 MRL_FPRINTF( f, "\"volumeShader\" = \"%s\"\n",
-			      volume->name.asChar() );
+			      mrShader::alias( volume->name ).asChar() );
 	       TAB(1); MRL_PUTS( ")\n");
 	     }
 	   else
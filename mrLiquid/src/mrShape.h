@@ -71,8 +71,18 @@ public:
   virtual void write() = 0;
 #endif
      
+  //! Name instances should refer to the shape's definition by.
+  inline const MString& definitionName() const
+  {
+    return masterName.length() > 0 ? masterName : name;
+  }
+
   MDagPath path;
   bool shapeAnimated; // Shape is deforming?
+
+  // Identical object written in place of this shape by automatic
+  // instancing (empty if the shape was written itself)
+  MString masterName;
 };
 
 
@@ -0,0 +1,324 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+/**
+ * @file   mrShardedExport.cpp
+ * 
+ * @brief  Split the export of a frame range among several mayabatch
+ *         processes running at the same time.
+ * 
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "maya/MGlobal.h"
+
+#include "mrIO.h"
+#include "mrHelpers.h"
+#include "mrPipe.h"
+#include "mrThread.h"
+#include "mrTimer.h"
+#include "mrShardedExport.h"
+
+
+//! Lines read from a worker's stdout or stderr.
+struct mrShardReader
+{
+  FILE*    f;
+  unsigned shard;
+};
+
+/** 
+ * Thread callback echoing a worker's output to stderr, each line
+ * prefixed with the worker's number.
+ * 
+ * @param v an mrShardReader* (cast to void*), deleted when done.
+ * 
+ * @return 0
+ */
+MR_THREAD_RETURN _mr_shard_reader_cb( void* v )
+{
+   mrShardReader* r = (mrShardReader*) v;
+
+   char line[1024];
+   while ( fgets( line, sizeof(line), r->f ) != NULL )
+   {
+      fprintf( stderr, "[shard %u] %s", r->shard, line );
+      fflush( stderr );
+   }
+
+   fclose( r->f );
+   delete r;
+   MR_THREAD_EXIT(0);
+}
+
+
+namespace {
+
+//! Flags of the mental command handled by the sharded export itself.
+//! All of them take one value.
+const char* kShardFlags[] = {
+  "-sf", "-startFrame",
+  "-ef", "-endFrame",
+  "-bf", "-byFrame",
+  "-xpr", "-exportProcesses",
+  "-prf", "-profile",   // workers would all overwrite the same report
+  NULL
+};
+
+//! One worker process.
+struct Shard
+{
+  int        first, last;
+  MR_PROCESS pid;
+  bool       running;
+  int        status;
+  double     start, end;
+};
+
+MString time_string( double secs )
+{
+   unsigned t = (unsigned) ( secs + 0.5 );
+   char tmp[32];
+   sprintf( tmp, "%02u:%02u:%02u", t / 3600, ( t / 60 ) % 60, t % 60 );
+   return MString( tmp );
+}
+
+bool is_flag( const char* s )
+{
+   return ( s[0] == '-' && ( ( s[1] >= 'a' && s[1] <= 'z' ) ||
+			     ( s[1] >= 'A' && s[1] <= 'Z' ) ) );
+}
+
+bool is_shard_flag( const char* s )
+{
+   for ( const char** f = kShardFlags; *f; ++f )
+      if ( strcmp( s, *f ) == 0 ) return true;
+   return false;
+}
+
+bool is_number( const char* s )
+{
+   if ( *s == 0 ) return false;
+   char* end;
+   strtod( s, &end );
+   return ( *end == 0 );
+}
+
+//! Return s as a quoted MEL string.  Backslashes become slashes, as
+//! all strings passed around are paths or names.
+MString mel_quote( const MString& s )
+{
+   MString r = "\"";
+   for ( const char* c = s.asChar(); *c; ++c )
+   {
+      char tmp[3] = { *c, 0, 0 };
+      if ( *c == '\\' )     tmp[0] = '/';
+      else if ( *c == '"' ) { tmp[0] = '\\'; tmp[1] = '"'; }
+      r += tmp;
+   }
+   r += "\"";
+   return r;
+}
+
+//! Command line used to start a mayabatch process.
+MString maya_batch()
+{
+   MString loc = mr_getenv( "MAYA_LOCATION" );
+#if defined(WIN32) || defined(WIN64)
+   MString exe = "mayabatch.exe";
+   if ( loc.length() > 0 ) exe = loc + "/bin/" + exe;
+   return "\"" + exe + "\"";
+#else
+   MString exe = "maya";
+   if ( loc.length() > 0 ) exe = loc + "/bin/" + exe;
+   return "\"" + exe + "\" -batch";
+#endif
+}
+
+bool write_script( const MString& file, const MString& plugin,
+		   const MString& args, int first, int last, int by )
+{
+   FILE* f = fopen( file.asChar(), "wb" );
+   if ( !f ) return false;
+
+   fprintf( f, "// mrLiquid export of frames %d-%d\n", first, last );
+   fprintf( f, "catch( `loadPlugin -quiet %s` );\n",
+	    mel_quote( plugin ).asChar() );
+   fprintf( f, "if ( catch( `mental%s -sf %d -ef %d -bf %d` ) )\n",
+	    args.asChar(), first, last, by );
+   fprintf( f, "   quit -force -exitCode 1;\n" );
+   fprintf( f, "quit -force -exitCode 0;\n" );
+   return ( fclose( f ) == 0 );
+}
+
+bool start_reader( FILE* f, unsigned shard )
+{
+   if ( f == NULL ) return false;
+   mrShardReader* r = new mrShardReader;
+   r->f     = f;
+   r->shard = shard;
+   MR_THREAD id;
+   if ( mr_new_thread( id, _mr_shard_reader_cb, r ) ) return true;
+   fclose( f );
+   delete r;
+   return false;
+}
+
+} // namespace
+
+
+
+MString mr_shard_args( const MArgList& args )
+{
+   MString r;
+   unsigned num = args.length();
+   for ( unsigned i = 0; i < num; ++i )
+   {
+      MString arg = args.asString( i );
+      const char* s = arg.asChar();
+      if ( is_flag( s ) && is_shard_flag( s ) ) { ++i; continue; }
+      r += " ";
+      if ( is_flag( s ) || is_number( s ) ||
+	   arg == "true" || arg == "false" )
+      {
+	 r += arg;
+      }
+      else
+      {
+	 r += mel_quote( arg );
+      }
+   }
+   return r;
+}
+
+
+bool mr_sharded_export( const MString& scene, const MString& args,
+			int first, int last, int by, unsigned numProcs,
+			const MString& scriptDir )
+{
+   if ( by < 1 ) by = 1;
+   unsigned numFrames = ( last - first ) / by + 1;
+   if ( numProcs > numFrames ) numProcs = numFrames;
+   if ( numProcs < 1 ) numProcs = 1;
+
+   MString plugin;
+   MGlobal::executeCommand( "pluginInfo -q -path \"mrLiquid\"", plugin );
+   if ( plugin.length() == 0 ) plugin = "mrLiquid";
+
+   MString batch = maya_batch();
+   std::vector< Shard > shards( numProcs );
+
+   MString msg = "Exporting frames ";
+   msg += first; msg += "-"; msg += last;
+   msg += " with "; msg += (int) numProcs; msg += " processes";
+   LOG_MESSAGE( msg );
+
+   double start = mr_wall_time();
+   for ( unsigned i = 0; i < numProcs; ++i )
+   {
+      // Contiguous ranges, so each worker steps thru time in order.
+      Shard& s = shards[i];
+      unsigned a = (unsigned) ( ( (unsigned long long) numFrames * i ) /
+				numProcs );
+      unsigned b = (unsigned) ( ( (unsigned long long) numFrames * (i+1) ) /
+				numProcs );
+      s.first   = first + (int) a * by;
+      s.last    = first + (int) ( b - 1 ) * by;
+      s.running = false;
+      s.status  = -1;
+      s.start   = s.end = mr_wall_time();
+
+      MString script = scriptDir;
+      script += "mrl_shard_"; script += (int) i; script += ".mel";
+      if ( ! write_script( script, plugin, args, s.first, s.last, by ) )
+      {
+	 LOG_ERROR( "Could not save \"" + script + "\"" );
+	 continue;
+      }
+
+      MString cmd = batch;
+      cmd += " -file \"";   cmd += scene;
+      cmd += "\" -script \""; cmd += script; cmd += "\"";
+      LOG_MESSAGE( cmd );
+
+      FILE* in, *out, *err;
+      if ( ! mr_popen3( s.pid, cmd.asChar(), in, out, err,
+			false, true, true ) )
+      {
+	 LOG_ERROR( "Could not start \"" + cmd + "\"" );
+	 continue;
+      }
+      s.running = true;
+      s.start   = mr_wall_time();
+
+      // Workers' output must be read, or they would block (or get a
+      // SIGPIPE) when writing to it.
+      start_reader( out, i + 1 );
+      start_reader( err, i + 1 );
+   }
+
+   for ( unsigned i = 0; i < numProcs; ++i )
+   {
+      Shard& s = shards[i];
+      if ( !s.running ) continue;
+      s.status = mr_wait( s.pid );
+      s.end    = mr_wall_time();
+   }
+
+   // Report
+   unsigned failed = 0;
+   for ( unsigned i = 0; i < numProcs; ++i )
+   {
+      const Shard& s = shards[i];
+      char tmp[256];
+      sprintf( tmp, "Shard %u: frames %d-%d, %s (exit %d), %s",
+	       i + 1, s.first, s.last,
+	       s.status == 0 ? "ok" : "FAILED", s.status,
+	       time_string( s.end - s.start ).asChar() );
+      if ( s.status == 0 ) LOG_MESSAGE( tmp );
+      else { LOG_ERROR( tmp ); ++failed; }
+
+      MString script = scriptDir;
+      script += "mrl_shard_"; script += (int) i; script += ".mel";
+      UNLINK( script.asChar() );
+   }
+
+   msg = "Sharded export done.  ";
+   if ( failed ) { msg += (int) failed; msg += " shards failed.  "; }
+   msg += "Time: ";
+   msg += time_string( mr_wall_time() - start );
+   LOG_MESSAGE( msg );
+
+   return ( failed == 0 );
+}
@@ -0,0 +1,79 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+/**
+ * @file   mrShardedExport.h
+ * 
+ * @brief  Split the export of a frame range among several mayabatch
+ *         processes running at the same time.
+ * 
+ */
+
+#ifndef mrShardedExport_h
+#define mrShardedExport_h
+
+#include "maya/MString.h"
+#include "maya/MArgList.h"
+
+
+/** 
+ * Turn the arguments of a mental command back into a MEL string,
+ * dropping the frame range, -exportProcesses and -profile flags (and
+ * their values), so they can be passed on to each worker.
+ * 
+ * @param args arguments of mental command
+ * 
+ * @return MEL string with arguments
+ */
+MString mr_shard_args( const MArgList& args );
+
+
+/** 
+ * Export frames first to last (every by frames) by running numProcs
+ * mayabatch processes on scene at the same time.  Each worker loads
+ * the scene and runs "mental <args>" on a contiguous range of frames.
+ * Once all are done, a report of the frames, exit status and time of
+ * each worker is printed.
+ * 
+ * @param scene     maya scene file for workers to load
+ * @param args      mental flags, as returned by mr_shard_args()
+ * @param first     first frame
+ * @param last      last frame
+ * @param by        frame step
+ * @param numProcs  number of worker processes
+ * @param scriptDir directory where the workers' MEL scripts are saved
+ * 
+ * @return true if all workers succeeded, false if not.
+ */
+bool mr_sharded_export( const MString& scene, const MString& args,
+			int first, int last, int by, unsigned numProcs,
+			const MString& scriptDir );
+
+#endif // mrShardedExport_h
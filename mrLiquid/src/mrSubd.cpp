@@ -135,6 +135,7 @@ void mrSubd::deleteSubd( MObject& node )
 
 void mrSubd::getData( bool sameFrame )
 {
+   MRL_PROFILE( kGetData );
    mrObject::getData( sameFrame );
    
    mrayId.clear();
@@ -264,6 +265,7 @@ mrSubd* mrSubd::factory( const MDagPath& shape )
 
 void mrSubd::getMotionBlur( const char step )
 {
+   MRL_PROFILE( kMotionBlur );
    prepareMotionBlur();
    if ( mb == NULL ) return;
    
@@ -173,7 +173,7 @@ MSwatchRenderBase( obj, renderObj, res )
 void mrSwatchRender::stop()
 {
 #ifndef  MR_SINGLE_STANDALONE
-   if ( f ) fclose(f);
+   if ( f ) MRL_FCLOSE(f);
    f = NULL;
 #endif
 }
@@ -232,8 +232,8 @@ bool mrSwatchRender::doRender( mrCamera* camera )
 	 write_header();
       }
 #  else // MR_SINGLE_STANDALONE
-      MRL_FILE* out, *err;
-      if (! ray.start( f, out, err ) )
+      FILE* in, *out, *err;
+      if (! ray.start( in, out, err ) )
       {
 	 LOG_ERROR("Could not start mentalray standalone for shader balls");
 	 // Create an empty image.
@@ -244,6 +244,7 @@ bool mrSwatchRender::doRender( mrCamera* camera )
       }
       fclose( err );
       fclose( out );
+      f = MRL_FWRAP( in );
 #  endif
 #else // MR_SWATCH_PIPE
       MString file = camera->outputs[0]->filename;
@@ -323,7 +324,7 @@ bool mrSwatchRender::doRender( mrCamera* camera )
    MRL_PUTS(buf);
 #endif
 
-   fflush(f);
+   MRL_FFLUSH(f);
 
    // Restore shader's written value so IPR for it works properly
    shader->setWritten( (mrNode::WriteMode) oldWritten );
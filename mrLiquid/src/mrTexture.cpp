@@ -90,6 +90,7 @@ void mrTexture::newRenderPass()
 
 void mrTexture::write( MRL_FILE* f )
 {
+   MRL_PROFILE_WRITE( f );
    if ( options->exportFilter & mrOptions::kTextures )
       return;
 
@@ -209,6 +210,7 @@ mrTextureNode* mrTextureNode::factory( const MFnDependencyNode& d )
 
 void mrTextureNode::getData()
 {
+   MRL_PROFILE( kGetData );
    MStatus status; MPlug p;
    MFnDependencyNode fn( nodeRef() );
    GET_OPTIONAL( miTextureType );
@@ -45,6 +45,8 @@
 
 #include <process.h>
 
+#define MR_ATOMIC_INC(x)  ( InterlockedIncrement( &(x) ) - 1 )
+
 bool mr_new_thread( MR_THREAD& hThread,
 		    MR_THREAD_IN(func), void* data )
 {
@@ -55,8 +57,19 @@ bool mr_new_thread( MR_THREAD& hThread,
    return true;
 }
 
+unsigned mr_num_cpus()
+{
+   SYSTEM_INFO info;
+   GetSystemInfo( &info );
+   return (unsigned) info.dwNumberOfProcessors;
+}
+
 #else
 
+#include <unistd.h>
+
+#define MR_ATOMIC_INC(x)  __sync_fetch_and_add( &(x), 1 )
+
 bool mr_new_thread( MR_THREAD& thread1,
 		    MR_THREAD_IN(func), void* data )
 {
@@ -65,4 +78,101 @@ bool mr_new_thread( MR_THREAD& thread1,
    return false;
 }
 
+unsigned mr_num_cpus()
+{
+   long n = sysconf( _SC_NPROCESSORS_ONLN );
+   if ( n < 1 ) return 1;
+   return (unsigned) n;
+}
+
 #endif
+
+
+struct mrParallelFor
+{
+#if defined(WIN32) || defined(WIN64)
+  volatile LONG next;
+#else
+  volatile unsigned next;
+#endif
+  unsigned   numTasks;
+  mrTaskFunc func;
+  void*      data;
+};
+
+
+static void mr_parallel_for_run( mrParallelFor* p )
+{
+   unsigned i;
+   while ( (i = (unsigned) MR_ATOMIC_INC( p->next )) < p->numTasks )
+      p->func( i, p->data );
+}
+
+
+#if defined(WIN32) || defined(WIN64)
+
+static unsigned __stdcall mr_parallel_for_thread( void* data )
+{
+   mr_parallel_for_run( (mrParallelFor*) data );
+   return 0;
+}
+
+#else
+
+extern "C" void* mr_parallel_for_thread( void* data )
+{
+   mr_parallel_for_run( (mrParallelFor*) data );
+   return NULL;
+}
+
+#endif
+
+
+void mr_parallel_for( unsigned numTasks, mrTaskFunc func, void* data,
+		      unsigned numThreads )
+{
+   mrParallelFor p;
+   p.next     = 0;
+   p.numTasks = numTasks;
+   p.func     = func;
+   p.data     = data;
+
+   if ( numThreads > numTasks ) numThreads = numTasks;
+   if ( numThreads < 2 )
+   {
+      mr_parallel_for_run( &p );
+      return;
+   }
+
+   // We need to wait for the threads, so we don't use mr_new_thread().
+   unsigned num = 0;
+#if defined(WIN32) || defined(WIN64)
+   HANDLE* threads = new HANDLE[numThreads-1];
+   for ( unsigned i = 1; i < numThreads; ++i )
+   {
+      HANDLE h = (HANDLE) _beginthreadex( NULL, 0, mr_parallel_for_thread,
+					  &p, 0, NULL );
+      if ( h == 0 ) break;
+      threads[num++] = h;
+   }
+   mr_parallel_for_run( &p );
+   for ( unsigned i = 0; i < num; ++i )
+   {
+      WaitForSingleObject( threads[i], INFINITE );
+      CloseHandle( threads[i] );
+   }
+#else
+   pthread_t* threads = new pthread_t[numThreads-1];
+   for ( unsigned i = 1; i < numThreads; ++i )
+   {
+      if ( pthread_create( &threads[num], NULL,
+			   mr_parallel_for_thread, &p ) != 0 )
+	 break;
+      ++num;
+   }
+   mr_parallel_for_run( &p );
+   for ( unsigned i = 0; i < num; ++i )
+      pthread_join( threads[i], NULL );
+#endif
+   delete [] threads;
+}
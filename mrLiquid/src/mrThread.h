@@ -92,4 +92,25 @@ bool mr_new_thread( MR_THREAD& handle,
 		    void* data 
 		    );
 
+
+//! Function run by mr_parallel_for for each task.
+typedef void (*mrTaskFunc)( unsigned task, void* data );
+
+/** 
+ * Run func( i, data ) for all i in [0, numTasks), spreading the calls
+ * over up to numThreads threads (the calling thread being one of them).
+ * Tasks are handed out in order, but may finish in any order.
+ * Returns once all tasks are done.
+ *
+ * @param numTasks   number of tasks to run
+ * @param func       function to call for each task
+ * @param data       optional data to send to function
+ * @param numThreads maximum number of threads to use
+ */
+void mr_parallel_for( unsigned numTasks, mrTaskFunc func, void* data,
+		      unsigned numThreads );
+
+//! Return the number of cpus in the machine.
+unsigned mr_num_cpus();
+
 #endif // mrThread_h
@@ -36,6 +36,8 @@
 // GetTickCount() on Windows is a tad faster than clock()
 #if defined(WIN32) || defined(WIN64)
 #include <windows.h>
+#else
+#include <sys/time.h>
 #endif // WIN32
 
 #include <ctime>
@@ -151,5 +153,22 @@ public:
 };
 
 
+//! Wall clock time in seconds.  Unlike mrTimer (which uses clock() and
+//! thus cpu time on unix), it keeps running while maya waits for events.
+inline double mr_wall_time()
+{
+#if defined(WIN32) || defined(WIN64)
+   static LARGE_INTEGER freq = { 0 };
+   if ( freq.QuadPart == 0 ) QueryPerformanceFrequency( &freq );
+   LARGE_INTEGER t;
+   QueryPerformanceCounter( &t );
+   return (double) t.QuadPart / (double) freq.QuadPart;
+#else
+   struct timeval t;
+   gettimeofday( &t, NULL );
+   return (double) t.tv_sec + (double) t.tv_usec * 1e-6;
+#endif
+}
+
 
 #endif  // mrTimer_h
@@ -313,6 +313,14 @@
 #  include "mrlLicensing.h"
 #endif
 
+#ifndef mrShardedExport_h
+#  include "mrShardedExport.h"
+#endif
+
+#ifndef mrProfiler_h
+#  include "mrProfiler.h"
+#endif
+
 
 //
 // Macro includes for this file
@@ -389,6 +397,7 @@ doExtensionPadding( false ),
 createOutputDirectories(true),
 IPR( false ),
 renderSelected( false ),
+exportProcesses( 0 ),
 padframe( 0 ),
 scene(NULL),
 allLights(NULL),
@@ -469,7 +478,8 @@ MStatus mrTranslator::initialize()
 // PARSE THE COMMAND'S FLAGS AND ARGUMENTS AND STORING
 // THEM AS PRIVATE DATA, THEN DO THE WORK BY CALLING redoIt():
 MStatus mrTranslator::parseArgs(
-				const MArgDatabase& a
+				const MArgDatabase& a,
+				const MString& shardArgs
 				)
 {
    // Store current selection
@@ -565,6 +575,11 @@ MStatus mrTranslator::parseArgs(
 	 if (a.isFlagSet("endFrame"))
 	    a.getFlagArgument("endFrame", 0, frameLast);
 	 else frameLast = frameFirst;
+	 if (a.isFlagSet("byFrame"))
+	 {
+	    a.getFlagArgument("byFrame", 0, frameBy);
+	    if ( frameBy < 1 ) frameBy = 1;
+	 }
       }
       else
       {
@@ -610,6 +625,14 @@ MStatus mrTranslator::parseArgs(
       renderSelected = false;
       if (a.isFlagSet("active")) renderSelected = true;
 
+      exportProcesses = 0;
+      if (a.isFlagSet("exportProcesses"))
+	 a.getFlagArgument("exportProcesses", 0, exportProcesses);
+
+      profileFile = "";
+      if (a.isFlagSet("profile"))
+	 a.getFlagArgument("profile", 0, profileFile);
+
       if (a.isFlagSet("project"))
       {
 	 a.getFlagArgument("project", 0, projectDir);
@@ -1244,11 +1267,72 @@ MStatus mrTranslator::parseArgs(
    if ( ! mrl::check_license_status() )
      return MS::kLicenseFailure;
 
+   // Each frame's .mi file is independent, so they can be exported
+   // by several processes at once.  Not so with fragments: every worker
+   // would write the same non-animated .mi2 files at its first frame.
+   if ( exportProcesses > 1 && options->fragmentExport )
+   {
+      LOG_WARNING("-exportProcesses is ignored with -fragmentExport");
+      exportProcesses = 0;
+   }
+
+   if ( exportProcesses > 1 && miStream && !IPR && fileroot != "" &&
+	options->perframe != mrOptions::kMiSingle &&
+	frameFirst != frameLast &&
+	!a.isFlagSet("render") && !a.isFlagSet("preview") &&
+	!a.isFlagSet("lightMap") )
+     return exportShards( shardArgs );
 
    return doIt();
 }
 
 
+/** 
+ * Export the frame range by splitting it among exportProcesses
+ * mayabatch processes, each running the normal per-frame export on
+ * a range of frames.  If the scene has unsaved changes, a copy of it
+ * is saved for the workers to load.
+ * 
+ * @param shardArgs flags of the mental command to pass on to workers.
+ * 
+ * @return MS::kSuccess if all workers succeeded.
+ */
+MStatus mrTranslator::exportShards( const MString& shardArgs )
+{
+   MString sceneFile;
+   MGlobal::executeCommand( "file -q -sceneName", sceneFile );
+   int modified = 1;
+   MGlobal::executeCommand( "file -q -modified", modified );
+
+   MString dir = miDir;
+   ADD_SLASH( dir );
+   checkOutputDirectory( dir );
+
+   if ( sceneFile.length() == 0 || modified )
+   {
+      sceneFile = dir + sceneName + "_shards.mb";
+      MString msg = "Scene has unsaved changes, saving a copy to \"";
+      msg += sceneFile;
+      msg += "\" for export processes";
+      LOG_MESSAGE( msg );
+      if ( MFileIO::exportAll( sceneFile, "mayaBinary" ) != MS::kSuccess )
+      {
+	 LOG_ERROR( "Could not save \"" + sceneFile + "\"" );
+	 return MS::kFailure;
+      }
+   }
+
+   bool ok = mr_sharded_export( sceneFile, shardArgs,
+				frameFirst, frameLast, frameBy,
+				exportProcesses, dir );
+
+   // Restore user selection
+   MGlobal::setActiveSelectionList( originalSelection );
+
+   return ok ? MS::kSuccess : MS::kFailure;
+}
+
+
 void mrTranslator::spitIntroMessage()
 {
    if ( options->exportFilter & mrOptions::kVersion )
@@ -1407,13 +1491,14 @@ MStatus mrTranslator::spitIncludes()
 }
 
 
-MStatus mrTranslator::getMotionBlur( const char step )
+MStatus mrTranslator::getMotionBlur( const std::vector< mrInstanceBase* >& list,
+				     const char step )
 {
    DBG("Getting moblur " << (short)step);
-   mrInstanceList::iterator i = instanceList.begin();
-   mrInstanceList::iterator e = instanceList.end();
+   std::vector< mrInstanceBase* >::const_iterator i = list.begin();
+   std::vector< mrInstanceBase* >::const_iterator e = list.end();
    for ( ; i != e; ++i )
-      i->second->getMotionBlur( step );
+      (*i)->getMotionBlur( step );
    return MS::kSuccess;
 }
 
@@ -2325,17 +2410,67 @@ MStatus mrTranslator::getObjects()
 void mrTranslator::performMotionBlur( double timeStart,
 				   double timeStep )
 {
-   if ( options->motionBlur != mrOptions::kMotionBlurOff )
+   if ( options->motionBlur == mrOptions::kMotionBlurOff ) return;
+
+   mrTRACE("==== Motion Blur ====");
+
+   // Sort instances by what they need sampled, so that static nodes
+   // are not visited (nor the time changed for them) at each step.
+   // Deforming shapes need every step, transforms only the last one.
+   std::vector< mrInstanceBase* > deforming, moving;
    {
-      mrTRACE("==== Motion Blur ====");
-      double time = timeStart;
-      for ( char step = 1; step <= options->motionSteps; ++step )
+      mrInstanceList::iterator i = instanceList.begin();
+      mrInstanceList::iterator e = instanceList.end();
+      for ( ; i != e; ++i )
       {
-	 time += timeStep;
-	 currentTime.setValue(time);
-	 MGlobal::viewFrame( currentTime );
+	 switch( i->second->motionSampling() )
+	 {
+	    case mrInstanceBase::kMotionDeform:
+	       deforming.push_back( i->second ); break;
+	    case mrInstanceBase::kMotionTransform:
+	       moving.push_back( i->second ); break;
+	    default:
+	       break;
+	 }
+      }
+   }
 
-	 getMotionBlur( step );
+   if ( options->exportVerbosity >= 4 )
+   {
+      MString msg = "Motion blur: ";
+      msg += (unsigned) deforming.size();
+      msg += " deforming, ";
+      msg += (unsigned) moving.size();
+      msg += " moving instances";
+      mrTRACE( msg );
+   }
+   if ( deforming.empty() && moving.empty() ) return;
+
+   mrTimer stepTimer;
+   const char steps = options->motionSteps;
+   double time = timeStart;
+   for ( char step = 1; step <= steps; ++step )
+   {
+      time += timeStep;
+      if ( step < steps && deforming.empty() ) continue;
+
+      stepTimer.start();
+      currentTime.setValue(time);
+      MGlobal::viewFrame( currentTime );
+
+      getMotionBlur( deforming, step );
+      if ( step == steps ) getMotionBlur( moving, step );
+
+      stepTimer.stop();
+      if ( options->exportVerbosity >= 4 )
+      {
+	 MString msg = "Motion step ";
+	 msg += (int) step;
+	 msg += " at ";
+	 msg += time;
+	 msg += ": ";
+	 msg += stepTimer.asMString();
+	 mrTRACE( msg );
       }
    }
 }
@@ -2365,6 +2500,8 @@ void mrTranslator::writeScene()
 
 void mrTranslator::updateSceneRenderPass()
 {
+   mrShader::invalidateConnections();
+
    if ( frame == frameFirst )
    {
       // in case we got some new assigned materials or unhidden
@@ -2405,6 +2542,8 @@ void mrTranslator::updateSceneRenderPass()
 
 void mrTranslator::updateSceneIncrementally()
 {
+   mrShader::invalidateConnections();
+
    double timeStart, timeStep;
    // sameFrame is a small optimization on my part
    bool sameFrame = getTimes(  timeStart, timeStep );
@@ -2632,6 +2771,11 @@ void mrTranslator::writeDatabase()
       writeOptions();
       writeTextures();
       writeScene();
+
+      if ( options->exportDedupShaders && options->exportDedupReport )
+	 mrShader::reportDuplicates();
+      if ( options->exportAutoInstance )
+	 mrObject::reportSharedObjects();
    }
    catch ( const char* const errorMessage )
    {
@@ -3197,6 +3341,7 @@ MStatus mrTranslator::scanScene()
 {
    DBG("\tScanning scene");
 
+   mrShader::invalidateConnections();
 
    double timeStart, timeStep;
    getTimes( timeStart, timeStep );
@@ -3273,6 +3418,9 @@ void mrTranslator::deleteMainNodes()
 
 void mrTranslator::deleteScene()
 {
+   mrShader::invalidateConnections();
+   mrShader::clearDuplicates();
+   mrObject::clearSharedObjects();
    deleteDB();
    deleteMainNodes();
    camPaths.clear();
@@ -3407,11 +3555,10 @@ void mrTranslator::cleanup()
       f = NULL;
 
 
+#ifndef MRL_GZIP_FILES
       if ( options->compression )
 	{
 	  // Start gzipping the mi file
-	  // @todo: we could use zlib directly to compress the file stream
-	  //        directly, as it is being spit out.
 	  MString orig( mi_filename() );
 	  MString gzip( orig + ".gz" );
 	  MString cmd = "gzip -vf";
@@ -3428,7 +3575,7 @@ void mrTranslator::cleanup()
 	  if ( MGlobal::mayaState() == MGlobal::kInteractive )
 	    {
 	      MR_PROCESS id;
-	      MRL_FILE* rayin, *rayout, *rayerr;
+	      FILE* rayin, *rayout, *rayerr;
 	      if (! mr_popen3(id, cmd.asChar(), rayin, rayout, rayerr,
 			      false, false, true ) )
 		{
@@ -3457,6 +3604,7 @@ void mrTranslator::cleanup()
 		}
 	    }
 	}
+#endif
 
    }
 }
@@ -3481,6 +3629,8 @@ void mrTranslator::endMI()
       timer.stop();
       timeStr += timer.asMString();
       LOG_MESSAGE( timeStr.asChar() );
+
+      if ( mrProfiler::enabled ) mrProfiler::stop( profileFile );
       
       // Reset global time (but do not waste time doing this in batch)
       if ( MGlobal::mayaState() == MGlobal::kInteractive )
@@ -3572,8 +3722,12 @@ const char* mrTranslator::mi_filename()
  */
 void mrTranslator::openMI(bool report)
 {
-  const char* filename = mi_filename();
-  f = MRL_FOPEN( filename, "wb" );
+  MString filename( mi_filename() );
+#ifdef MRL_GZIP_FILES
+  // Compress the file as it is written, instead of gzipping it at the end.
+  if ( options->compression ) filename += ".gz";
+#endif
+  f = MRL_FOPEN_GZ( filename.asChar(), options->compression );
   if ( f == NULL )
     {
       MString err("Could not open \"");
@@ -3599,13 +3753,14 @@ void mrTranslator::openMI(bool report)
  */
 void mrTranslator::openPipe()
 {
-   MRL_FILE* rayerr;
+   FILE* rayin, *rayerr;
    mrStandalone* ray = new mrStandalone;
-   if (! ray->start( f, rayout, rayerr ) )
+   if (! ray->start( rayin, rayout, rayerr ) )
    {
       LOG_ERROR("Could not open pipe to mental ray stand-alone.");
       throw("Check path, licensing and accessability of command.");
    }
+   f = MRL_FWRAP( rayin );
 
    if ( rayout )
    {
@@ -3613,16 +3768,16 @@ void mrTranslator::openPipe()
       if ( ! mr3dView::imgpipe_reader( this ) )
       {
 	 if (f)      MRL_FCLOSE(f);
-	 if (rayerr) MRL_FCLOSE(rayerr);
-	 if (rayout) MRL_FCLOSE(rayout);
+	 if (rayerr) fclose(rayerr);
+	 if (rayout) fclose(rayout);
 	 throw("imgpipe_reader failed.  Aborting...");
       }
 #else
       if ( ! mrRenderView::imgpipe_reader( this ) )
       {
 	 if (f)      MRL_FCLOSE(f);
-	 if (rayerr) MRL_FCLOSE(rayerr);
-	 if (rayout) MRL_FCLOSE(rayout);
+	 if (rayerr) fclose(rayerr);
+	 if (rayout) fclose(rayout);
 	 throw("imgpipe_reader failed.  Aborting...");
       }
 #endif
@@ -3634,8 +3789,8 @@ void mrTranslator::openPipe()
       if ( ! mr_start_error_reader( errId, rayerr ) )
       {
 	 if (f)      MRL_FCLOSE(f);
-	 if (rayerr) MRL_FCLOSE(rayerr);
-	 if (rayout) MRL_FCLOSE(rayout);
+	 if (rayerr) fclose(rayerr);
+	 if (rayout) fclose(rayout);
 	 throw("mr_start_error_reader failed.  Aborting...");
       }
    }
@@ -4151,6 +4306,8 @@ void mrTranslator::doRenderPasses( bool increment )
  */
 void mrTranslator::updateTime()
 {
+   mrShader::invalidateConnections();
+
    try {
       // Make sure currentTime is != from now, so incremental
       // update will work properly.
@@ -4232,6 +4389,9 @@ MStatus mrTranslator::doIt()
    {
       timer.start();
 
+      mrProfiler::enabled = false;
+      if ( profileFile != "" ) mrProfiler::start();
+
       getMentalrayNodes();
 
       frame = frameFirst;
@@ -91,8 +91,13 @@ public:
   MStatus doIt();
 
   //! Parse arguments based on a pre-defined syntax to change behavior
-  //! of mrTranslator.
-  MStatus parseArgs(const MArgDatabase& a);
+  //! of mrTranslator.  shardArgs are the flags passed on to worker
+  //! processes when -exportProcesses is used.
+  MStatus parseArgs(const MArgDatabase& a, const MString& shardArgs = "");
+
+  //! Export the frame range with several mayabatch processes, one
+  //! per range of frames.
+  MStatus exportShards(const MString& shardArgs);
 
   //! Add the current scanned element in currentNode/ObjPath
   //! to mrTranslator's scene.  Returns the instance or NULL on failure.
@@ -272,9 +277,10 @@ protected:
   //! motion vectors for each motion blurred object and transform)
   void    performMotionBlur( double timeStart, double timeStep );
 
-  //! Get the motion blur information for a particular step.
-  //! [0 <= step < options.motionStep ]
-  MStatus getMotionBlur( const char step );
+  //! Get the motion blur information for a particular step for the
+  //! instances in list.  [1 <= step <= options.motionStep ]
+  MStatus getMotionBlur( const std::vector< mrInstanceBase* >& list,
+			 const char step );
 
   //! Scan maya scene looking for the main mental ray nodes needed for
   //! spitting a scene.  If nodes are not available, try to create them.
@@ -378,6 +384,13 @@ protected:
 
   //! Render only selected objects
   bool renderSelected;
+
+  //! Number of processes to split a per-frame .mi export among.
+  unsigned exportProcesses;
+
+  //! If not empty, profile export and save report to profileFile.json
+  //! and profileFile.csv
+  MString profileFile;
      
   //! Number of 0's padded to mi file's frame number in name.
   unsigned padframe;
@@ -12,14 +12,6 @@
 #include "mrAttrAux.h"
 
 
-#define WRITE_VECTOR(t) \
-      MAKE_BIGENDIAN_V(t); \
-      MRL_FWRITE( t, sizeof(float), 3, f );
-
-#define WRITE_POINT(t) \
-      MAKE_BIGENDIAN_P(t); \
-      MRL_FWRITE( t, sizeof(float), 4, f );
-
 #define CHECK_LENGTH() \
 	 if ( fn.length() != numVerts ) { \
 	    MString err = attrName; \
@@ -34,6 +26,7 @@
 
 void mrUserDataVertex::getData( bool sameFrame )
 {
+   MRL_PROFILE( kGetData );
 }
 
 mrUserDataVertex::mrUserDataVertex( const MDagPath& p ) :
@@ -117,92 +110,90 @@ void mrUserDataVertex::add( const MString& attrName,
     }
 }
 
-void mrUserDataVertex::write_trilist( MRL_FILE* f, unsigned idx )
+void mrUserDataVertex::write_trilist( std::vector< float >& scalars,
+				      const unsigned idx )
 {
    MStatus status;
    mrUserVectors::iterator i = userAttrs.begin();
    mrUserVectors::iterator e = userAttrs.end();
    MFnDependencyNode dep( path.node() );
 
-   if ( options->exportBinary )
+   for ( ; i != e; ++i )
      {
-       float tmp[4];
-       for ( ; i != e; ++i )
-	 {
-	   const mrVertexData& v = *i;
+       const mrVertexData& v = *i;
 	   
-	   MString attrName = "miCustomTex" + v.attr;
-	   MPlug p = dep.findPlug( attrName, true, &status );
+       MString attrName = "miCustomTex" + v.attr;
+       MPlug p = dep.findPlug( attrName, true, &status );
 	   
-	   MObject data;
-	   p.getValue(data);
-	   if ( data.hasFn( MFn::kIntArrayData ) )
-	     {
-	       MFnIntArrayData fn( data );
-	       float t = (float) fn.array()[idx];
-	       SAVE_FLOAT( t );
-	     }
-	   else if ( data.hasFn( MFn::kDoubleArrayData ) )
-	     {
-	       MFnDoubleArrayData fn( data );
-	       float t = (float) fn.array()[idx];
-	       SAVE_FLOAT( t );
-	     }
-	   else if ( data.hasFn( MFn::kVectorArrayData ) )
-	     {
-	       MFnVectorArrayData fn( data );
-	       const MVector& v = fn.array()[idx];
-	       tmp[0] = (float) v[0];
-	       tmp[1] = (float) v[1];
-	       tmp[2] = (float) v[2];
-	       WRITE_VECTOR( tmp );
-	     }
-	   else if ( data.hasFn( MFn::kPointArrayData ) )
-	     {
-	       MFnPointArrayData fn( data );
-	       const MPoint& v = fn.array()[idx];
-	       tmp[0] = (float) v[0];
-	       tmp[1] = (float) v[1];
-	       tmp[2] = (float) v[2];
-	       tmp[3] = (float) v[3];
-	       WRITE_POINT( tmp );
-	     }
+       MObject data;
+       p.getValue(data);
+       if ( data.hasFn( MFn::kIntArrayData ) )
+	 {
+	   MFnIntArrayData fn( data );
+	   scalars.push_back( (float) fn.array()[idx] );
+	 }
+       else if ( data.hasFn( MFn::kDoubleArrayData ) )
+	 {
+	   MFnDoubleArrayData fn( data );
+	   scalars.push_back( (float) fn.array()[idx] );
+	 }
+       else if ( data.hasFn( MFn::kVectorArrayData ) )
+	 {
+	   MFnVectorArrayData fn( data );
+	   const MVector& v = fn.array()[idx];
+	   scalars.push_back( (float) v[0] );
+	   scalars.push_back( (float) v[1] );
+	   scalars.push_back( (float) v[2] );
+	 }
+       else if ( data.hasFn( MFn::kPointArrayData ) )
+	 {
+	   MFnPointArrayData fn( data );
+	   const MPoint& v = fn.array()[idx];
+	   scalars.push_back( (float) v[0] );
+	   scalars.push_back( (float) v[1] );
+	   scalars.push_back( (float) v[2] );
+	   scalars.push_back( (float) v[3] );
 	 }
      }
-   else
-     {
+}
 
-       for ( ; i != e; ++i )
-	 {
-	   const mrVertexData& v = *i;
+void mrUserDataVertex::write_trilist( MRL_FILE* f, unsigned idx )
+{
+   MStatus status;
+   mrUserVectors::iterator i = userAttrs.begin();
+   mrUserVectors::iterator e = userAttrs.end();
+   MFnDependencyNode dep( path.node() );
+
+   for ( ; i != e; ++i )
+     {
+       const mrVertexData& v = *i;
 	   
-	   MString attrName = "miCustomTex" + v.attr;
-	   MPlug p = dep.findPlug( attrName, true, &status );
+       MString attrName = "miCustomTex" + v.attr;
+       MPlug p = dep.findPlug( attrName, true, &status );
 	   
-	   MObject data;
-	   p.getValue(data);
-	   if ( data.hasFn( MFn::kIntArrayData ) )
-	     {
-	       MFnIntArrayData fn( data );
-	       MRL_FPRINTF( f, " %d", fn.array()[idx] );
-	     }
-	   else if ( data.hasFn( MFn::kDoubleArrayData ) )
-	     {
-	       MFnDoubleArrayData fn( data );
-	       MRL_FPRINTF( f, " %g", fn.array()[idx] );
-	     }
-	   else if ( data.hasFn( MFn::kVectorArrayData ) )
-	     {
-	       MFnVectorArrayData fn( data );
-	       const MVector& v = fn.array()[idx];
-	       MRL_FPRINTF( f, " %g %g %g", v.x, v.y, v.z );
-	     }
-	   else if ( data.hasFn( MFn::kPointArrayData ) )
-	     {
-	       MFnPointArrayData fn( data );
-	       const MPoint& v = fn.array()[idx];
-	       MRL_FPRINTF( f, " %g %g %g %g", v.x, v.y, v.z, v.w );
-	     }
+       MObject data;
+       p.getValue(data);
+       if ( data.hasFn( MFn::kIntArrayData ) )
+	 {
+	   MFnIntArrayData fn( data );
+	   MRL_FPRINTF( f, " %d", fn.array()[idx] );
+	 }
+       else if ( data.hasFn( MFn::kDoubleArrayData ) )
+	 {
+	   MFnDoubleArrayData fn( data );
+	   MRL_FPRINTF( f, " %g", fn.array()[idx] );
+	 }
+       else if ( data.hasFn( MFn::kVectorArrayData ) )
+	 {
+	   MFnVectorArrayData fn( data );
+	   const MVector& v = fn.array()[idx];
+	   MRL_FPRINTF( f, " %g %g %g", v.x, v.y, v.z );
+	 }
+       else if ( data.hasFn( MFn::kPointArrayData ) )
+	 {
+	   MFnPointArrayData fn( data );
+	   const MPoint& v = fn.array()[idx];
+	   MRL_FPRINTF( f, " %g %g %g %g", v.x, v.y, v.z, v.w );
 	 }
      }
 }
@@ -255,6 +246,7 @@ unsigned mrUserDataVertex::write_user( MRL_FILE* f )
 
 void mrUserDataVertex::write( MRL_FILE* f )
 {
+   MRL_PROFILE_WRITE( f );
   if ( written == kWritten )     return;
   if ( written == kIncremental ) MRL_PUTS("incremental ");
 
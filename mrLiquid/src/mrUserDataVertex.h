@@ -42,6 +42,7 @@ public:
   static mrUserDataVertex* factory( const MDagPath& path );
 
   void write_trilist( MRL_FILE* f, unsigned idx );
+  void write_trilist( std::vector< float >& scalars, const unsigned idx );
   unsigned write_user( MRL_FILE* f );
 
   virtual void write( MRL_FILE* f );
@@ -55,8 +56,6 @@ public:
 
 #ifdef GEOSHADER_H
 
-  void write_trilist( std::vector< miScalar >& scalars, 
-		      const unsigned idx );
   void     write_trilist( std::vector< miVector >& vectors, 
 			  const unsigned idx );
   unsigned write_user();
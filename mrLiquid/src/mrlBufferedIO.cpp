@@ -0,0 +1,757 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <cstddef>
+#include <cstdlib>
+#include <cfloat>
+
+#ifdef USE_ZLIB
+#  include <zlib.h>
+#endif
+
+#include "mrlBufferedIO.h"
+
+
+namespace {
+
+//! Powers of ten that are exact as doubles.
+static const double kPow10[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+//! Digit pairs used to format integers two digits at a time.
+static const char kDigits[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+static const char kHexLower[] = "0123456789abcdef";
+static const char kHexUpper[] = "0123456789ABCDEF";
+
+
+//! Write decimal digits of x backwards, ending right before end.
+//! Returns pointer to first digit.
+template< typename U >
+inline char* utoa_backwards( char* end, U x )
+{
+   while ( x >= 100 )
+   {
+      unsigned idx = static_cast<unsigned>( x % 100 ) * 2;
+      x /= 100;
+      *--end = kDigits[idx + 1];
+      *--end = kDigits[idx];
+   }
+   if ( x >= 10 )
+   {
+      unsigned idx = static_cast<unsigned>( x ) * 2;
+      *--end = kDigits[idx + 1];
+      *--end = kDigits[idx];
+   }
+   else
+   {
+      *--end = static_cast<char>( '0' + x );
+   }
+   return end;
+}
+
+//! Same for a signed x of type T (U being its unsigned type).  If pad
+//! is set, negative numbers are zero padded to width after the sign.
+template< typename T, typename U >
+inline char* itoa_backwards( char* end, T x, bool pad, int width )
+{
+   U u = static_cast<U>( x );
+   if ( x < 0 ) u = U(0) - u;
+   char* d = utoa_backwards( end, u );
+   if ( x < 0 )
+   {
+      if ( pad )
+	 while ( end - d < width - 1 ) *--d = '0';
+      *--d = '-';
+   }
+   return d;
+}
+
+//! Write hex digits of x backwards, ending right before end.
+template< typename U >
+inline char* xtoa_backwards( char* end, U x, const char* hex )
+{
+   do { *--end = hex[x & 0xF]; x >>= 4; } while ( x );
+   return end;
+}
+
+} // namespace
+
+
+
+int mrlFile::format_float( char* out, double x )
+{
+   char* s = out;
+   double a = x;
+   if ( x < 0.0 || ( x == 0.0 && 1.0 / x < 0.0 ) )
+   {
+      *s++ = '-';
+      a = -x;
+   }
+   if ( a == 0.0 )
+   {
+      *s++ = '0';
+      return static_cast<int>( s - out );
+   }
+
+   // Outside this range (or for nan and inf) the scaling below is not
+   // exact enough, so let the C library deal with it.
+   if ( !( a >= 1e-15 && a < 1e15 ) )
+      return sprintf( out, "%g", x );
+
+   // Decimal exponent of the first digit.  It may be off by one near
+   // powers of ten, which gets fixed below.
+   int X = 0;
+   if ( a >= 1.0 )
+      while ( a >= kPow10[X+1] ) ++X;
+   else
+      while ( a * kPow10[-X] < 1.0 ) --X;
+
+   // Scale to 6 integer digits.  Multiplying or dividing by an exact
+   // power of ten rounds once, so d is within 1 ulp of the exact value.
+   double d;
+   for (;;)
+   {
+      int k = 5 - X;
+      d = k >= 0 ? a * kPow10[k] : a / kPow10[-k];
+      if      ( d <  100000.0 ) --X;
+      else if ( d >= 1000000.0 ) ++X;
+      else break;
+   }
+
+   // Round to nearest.  If d is too close to a tie to tell which way the
+   // exact value goes, leave it to the C library so the digits always
+   // match printf's.
+   unsigned n = static_cast<unsigned>( d );
+   double frac = d - n;
+   double err  = d * 4.0 * DBL_EPSILON;
+   if ( frac - 0.5 < err && 0.5 - frac < err )
+      return sprintf( out, "%g", x );
+   if ( frac > 0.5 && ++n == 1000000 )
+   {
+      n = 100000;
+      ++X;
+   }
+
+   char digits[6];
+   for ( int i = 5; i >= 0; --i, n /= 10 )
+      digits[i] = static_cast<char>( '0' + n % 10 );
+   int len = 6;
+   while ( len > 1 && digits[len-1] == '0' ) --len;
+
+   if ( X < -4 || X >= 6 )
+   {
+      *s++ = digits[0];
+      if ( len > 1 )
+      {
+	 *s++ = '.';
+	 memcpy( s, digits + 1, len - 1 );
+	 s += len - 1;
+      }
+      *s++ = 'e';
+      if ( X < 0 ) { *s++ = '-'; X = -X; }
+      else         { *s++ = '+'; }
+      *s++ = kDigits[ X * 2 ];
+      *s++ = kDigits[ X * 2 + 1 ];
+   }
+   else if ( X >= 0 )
+   {
+      memcpy( s, digits, X + 1 );
+      s += X + 1;
+      if ( len > X + 1 )
+      {
+	 *s++ = '.';
+	 memcpy( s, digits + X + 1, len - X - 1 );
+	 s += len - X - 1;
+      }
+   }
+   else
+   {
+      *s++ = '0';
+      *s++ = '.';
+      for ( int i = -1; i > X; --i ) *s++ = '0';
+      memcpy( s, digits, len );
+      s += len;
+   }
+   return static_cast<int>( s - out );
+}
+
+
+
+mrlFile::mrlFile( FILE* f, bool writing ) :
+fp( f ),
+gz( NULL ),
+buf( NULL ),
+pos( 0 ),
+cap( 0 ),
+drained( 0 ),
+error( false )
+{
+   if ( writing )
+   {
+      cap = kBufferSize;
+      buf = new char[cap];
+   }
+}
+
+mrlFile::~mrlFile()
+{
+   delete [] buf;
+}
+
+mrlFile* mrlFile::open( const char* name, const char* mode )
+{
+   FILE* fp = fopen( name, mode );
+   if ( fp == NULL ) return NULL;
+
+   bool writing = ( strpbrk( mode, "wa+" ) != NULL );
+
+   // We do our own buffering, avoid an extra copy thru stdio's buffer.
+   if ( writing ) setvbuf( fp, NULL, _IONBF, 0 );
+   return new mrlFile( fp, writing );
+}
+
+#ifdef USE_ZLIB
+mrlFile* mrlFile::open_gz( const char* name, int level )
+{
+   if ( level < 1 ) level = 1;
+   else if ( level > 9 ) level = 9;
+
+   char mode[4] = { 'w', 'b', static_cast<char>( '0' + level ), 0 };
+   gzFile z = gzopen( name, mode );
+   if ( z == NULL ) return NULL;
+
+#if ZLIB_VERNUM >= 0x1240
+   // We hand zlib a full buffer at a time, so it only needs a larger
+   // output buffer to cut down on write() calls.
+   gzbuffer( z, 256 * 1024 );
+#endif
+
+   mrlFile* f = new mrlFile( NULL, true );
+   f->gz = z;
+   return f;
+}
+#endif
+
+mrlFile* mrlFile::wrap( FILE* fp )
+{
+   if ( fp == NULL ) return NULL;
+   return new mrlFile( fp, true );
+}
+
+mrlFile* mrlFile::memory( size_t size )
+{
+   mrlFile* f = new mrlFile( NULL, false );
+   f->cap = size;
+   f->buf = new char[size];
+   return f;
+}
+
+mrlFile* mrlFile::std_out()
+{
+   static mrlFile out( stdout, true );
+   return &out;
+}
+
+int mrlFile::close( mrlFile* f )
+{
+   f->drain();
+   int r = f->error ? EOF : 0;
+   if ( f == std_out() )
+   {
+      fflush( stdout );
+      return r;
+   }
+   if ( f->fp && fclose( f->fp ) != 0 ) r = EOF;
+#ifdef USE_ZLIB
+   if ( f->gz && gzclose( static_cast<gzFile>( f->gz ) ) != Z_OK ) r = EOF;
+#endif
+   delete f;
+   return r;
+}
+
+void mrlFile::write_through( const char* s, size_t len )
+{
+   drained += len;
+#ifdef USE_ZLIB
+   if ( gz )
+   {
+      // gzwrite() takes an unsigned count, so feed it in pieces.
+      const size_t kMaxChunk = 1 << 30;
+      while ( len > 0 )
+      {
+	 unsigned n = static_cast<unsigned>( len < kMaxChunk ? len : kMaxChunk );
+	 if ( gzwrite( static_cast<gzFile>( gz ), s, n ) != (int) n )
+	 {
+	    error = true;
+	    return;
+	 }
+	 s   += n;
+	 len -= n;
+      }
+      return;
+   }
+#endif
+   if ( fwrite( s, 1, len, fp ) != len ) error = true;
+}
+
+void mrlFile::drain()
+{
+   if ( pos == 0 || ( fp == NULL && gz == NULL ) ) return;
+   write_through( buf, pos );
+   pos = 0;
+}
+
+void mrlFile::grow( size_t n )
+{
+   size_t c = cap * 2;
+   if ( c < pos + n ) c = pos + n;
+   char* b = new char[c];
+   memcpy( b, buf, pos );
+   delete [] buf;
+   buf = b;
+   cap = c;
+}
+
+int mrlFile::flush()
+{
+   drain();
+   if ( fp && fflush( fp ) != 0 ) error = true;
+#ifdef USE_ZLIB
+   if ( gz && gzflush( static_cast<gzFile>( gz ), Z_SYNC_FLUSH ) != Z_OK )
+      error = true;
+#endif
+   return error ? EOF : 0;
+}
+
+size_t mrlFile::write( const void* p, size_t size, size_t n )
+{
+   write_bytes( static_cast<const char*>( p ), size * n );
+   return n;
+}
+
+size_t mrlFile::read( void* p, size_t size, size_t n )
+{
+   drain();
+   return fread( p, size, n, fp );
+}
+
+int mrlFile::eof()
+{
+   return feof( fp );
+}
+
+void mrlFile::write_int( long x )
+{
+   char* s = reserve( 24 );
+   unsigned long u = static_cast<unsigned long>( x );
+   if ( x < 0 )
+   {
+      *s++ = '-';
+      u = 0UL - u;
+   }
+   char tmp[24];
+   char* end = tmp + sizeof(tmp);
+   char* d = utoa_backwards( end, u );
+   size_t len = end - d;
+   memcpy( s, d, len );
+   pos = ( s + len ) - buf;
+}
+
+void mrlFile::write_uint( unsigned long x )
+{
+   char* s = reserve( 24 );
+   char tmp[24];
+   char* end = tmp + sizeof(tmp);
+   char* d = utoa_backwards( end, x );
+   size_t len = end - d;
+   memcpy( s, d, len );
+   pos += len;
+}
+
+void mrlFile::write_float( double x )
+{
+   char* s = reserve( 32 );
+   pos += format_float( s, x );
+}
+
+int mrlFile::printf( const char* fmt, ... )
+{
+   va_list args;
+   va_start( args, fmt );
+   int r = vprintf( fmt, args );
+   va_end( args );
+   return r;
+}
+
+
+namespace {
+
+//! Argument of a conversion handed off to snprintf.
+struct mrlPrintfArg
+{
+     enum Type {
+       kDouble,
+       kLongDouble,
+       kPointer,
+       kString,
+       kInt,
+       kLong,
+       kLongLong,
+       kUnsigned,
+       kUnsignedLong,
+       kUnsignedLongLong,
+       kPtrdiff,
+       kSize
+     };
+
+     Type type;
+     union {
+       double             d;
+       long double        ld;
+       void*              ptr;
+       const char*        s;
+       int                i;
+       long               l;
+       long long          ll;
+       unsigned           u;
+       unsigned long      ul;
+       unsigned long long ull;
+       ptrdiff_t          pd;
+       size_t             sz;
+     };
+};
+
+#define MRL_SNPRINTF( v ) \
+   if      ( nargs == 2 ) return snprintf( dst, room, fmt, a0, a1, v ); \
+   else if ( nargs == 1 ) return snprintf( dst, room, fmt, a0, v ); \
+   else                   return snprintf( dst, room, fmt, v );
+
+int format_arg( char* dst, size_t room, const char* fmt,
+		int nargs, int a0, int a1, const mrlPrintfArg& x )
+{
+   switch( x.type )
+   {
+      case mrlPrintfArg::kDouble:           MRL_SNPRINTF( x.d );
+      case mrlPrintfArg::kLongDouble:       MRL_SNPRINTF( x.ld );
+      case mrlPrintfArg::kPointer:          MRL_SNPRINTF( x.ptr );
+      case mrlPrintfArg::kString:           MRL_SNPRINTF( x.s );
+      case mrlPrintfArg::kInt:              MRL_SNPRINTF( x.i );
+      case mrlPrintfArg::kLong:             MRL_SNPRINTF( x.l );
+      case mrlPrintfArg::kLongLong:         MRL_SNPRINTF( x.ll );
+      case mrlPrintfArg::kUnsigned:         MRL_SNPRINTF( x.u );
+      case mrlPrintfArg::kUnsignedLong:     MRL_SNPRINTF( x.ul );
+      case mrlPrintfArg::kUnsignedLongLong: MRL_SNPRINTF( x.ull );
+      case mrlPrintfArg::kPtrdiff:          MRL_SNPRINTF( x.pd );
+      case mrlPrintfArg::kSize:             MRL_SNPRINTF( x.sz );
+   }
+   return -1;
+}
+
+#undef MRL_SNPRINTF
+
+} // namespace
+
+
+/** 
+ * Minimal printf.  Handles the common %s, %c, %d, %u, %x and %g
+ * conversions (with optional '-' and '0' flags and a width) directly
+ * into the output buffer.  Anything else is handed off to snprintf.
+ * 
+ * @param fmt  printf format
+ * @param args arguments
+ * 
+ * @return number of chars written
+ */
+int mrlFile::vprintf( const char* fmt, va_list args )
+{
+   int count = 0;
+
+   const char* p = fmt;
+   while ( *p )
+   {
+      // Copy literal text up to next conversion
+      const char* q = p;
+      while ( *q && *q != '%' ) ++q;
+      if ( q != p )
+      {
+	 write_bytes( p, q - p );
+	 count += static_cast<int>( q - p );
+	 p = q;
+	 if ( !*p ) break;
+      }
+
+      // Parse conversion spec
+      const char* spec = p++;
+      bool left = false, zero = false, other = false;
+      for ( ;; ++p )
+      {
+	 if      ( *p == '-' ) left = true;
+	 else if ( *p == '0' ) zero = true;
+	 else if ( *p == '+' || *p == ' ' || *p == '#' ) other = true;
+	 else break;
+      }
+
+      int width = 0;
+      bool starWidth = false;
+      if ( *p == '*' ) { starWidth = true; ++p; }
+      else while ( *p >= '0' && *p <= '9' ) width = width * 10 + (*p++ - '0');
+
+      bool hasPrecision = false;
+      bool starPrecision = false;
+      int  precision = 0;
+      if ( *p == '.' )
+      {
+	 hasPrecision = true;
+	 ++p;
+	 if ( *p == '*' ) { starPrecision = true; ++p; }
+	 else while ( *p >= '0' && *p <= '9' )
+	    precision = precision * 10 + (*p++ - '0');
+      }
+
+      int lng = 0;
+      bool shrt = false;
+      bool sz   = false;
+      for ( ;; ++p )
+      {
+	 if      ( *p == 'l' ) ++lng;
+	 else if ( *p == 'L' ) lng = 2;
+	 else if ( *p == 'h' ) shrt = true;
+	 else if ( *p == 'z' ) sz = true;
+	 else break;
+      }
+
+      char conv = *p;
+      if ( conv == 0 ) break;
+      ++p;
+
+      // %.6g is the same as %g.  Matrices are written with it (the
+      // default exportFloatPrecision), so it takes the fast path too.
+      if ( conv == 'g' && hasPrecision && !starPrecision && precision == 6 )
+	 hasPrecision = false;
+
+      if ( conv == '%' )
+      {
+	 putc('%');
+	 ++count;
+	 continue;
+      }
+
+      if ( !other && !starWidth && !hasPrecision && !shrt &&
+	   lng < 2 && width < 32 &&
+	   ( conv == 's' || conv == 'c' || conv == 'd' || conv == 'i' ||
+	     conv == 'u' || conv == 'x' || conv == 'X' || conv == 'g' ) )
+      {
+	 char  tmp[64];
+	 char* end = tmp + sizeof(tmp);
+	 const char* out = tmp;
+	 size_t len = 0;
+	 switch( conv )
+	 {
+	    case 's':
+	       out = va_arg( args, const char* );
+	       if ( out == NULL ) out = "(null)";
+	       len = strlen( out );
+	       break;
+	    case 'c':
+	       tmp[0] = static_cast<char>( va_arg( args, int ) );
+	       len = 1;
+	       break;
+	    case 'd':
+	    case 'i':
+	       {
+		  bool pad = zero && !left;
+		  char* d;
+		  if ( sz )
+		     d = itoa_backwards< ptrdiff_t, size_t >( end,
+			   va_arg( args, ptrdiff_t ), pad, width );
+		  else if ( lng )
+		     d = itoa_backwards< long, unsigned long >( end,
+			   va_arg( args, long ), pad, width );
+		  else
+		     d = itoa_backwards< int, unsigned >( end,
+			   va_arg( args, int ), pad, width );
+		  out = d; len = end - d;
+		  break;
+	       }
+	    case 'u':
+	       {
+		  char* d;
+		  if ( sz )
+		     d = utoa_backwards( end, va_arg( args, size_t ) );
+		  else if ( lng )
+		     d = utoa_backwards( end, va_arg( args, unsigned long ) );
+		  else
+		     d = utoa_backwards( end, va_arg( args, unsigned ) );
+		  out = d; len = end - d;
+		  break;
+	       }
+	    case 'x':
+	    case 'X':
+	       {
+		  const char* hex = ( conv == 'x' ? kHexLower : kHexUpper );
+		  char* d;
+		  if ( sz )
+		     d = xtoa_backwards( end, va_arg( args, size_t ), hex );
+		  else if ( lng )
+		     d = xtoa_backwards( end, va_arg( args, unsigned long ), hex );
+		  else
+		     d = xtoa_backwards( end, va_arg( args, unsigned ), hex );
+		  out = d; len = end - d;
+		  break;
+	       }
+	    case 'g':
+	       len = format_float( tmp, va_arg( args, double ) );
+	       break;
+	 }
+
+	 size_t padding = ( (size_t) width > len ) ? width - len : 0;
+	 char padChar = ( zero && !left && conv != 's' && conv != 'c' ) ?
+	                '0' : ' ';
+	 if ( !left ) for ( size_t i = 0; i < padding; ++i ) putc( padChar );
+	 write_bytes( out, len );
+	 if ( left )  for ( size_t i = 0; i < padding; ++i ) putc( ' ' );
+	 count += static_cast<int>( len + padding );
+	 continue;
+      }
+
+      // Slow path.  Pull the argument(s) and let snprintf do the work.
+      char sub[32];
+      size_t sublen = p - spec;
+      if ( sublen >= sizeof(sub) ) break;  // bogus format
+      memcpy( sub, spec, sublen );
+      sub[sublen] = 0;
+#if defined(_MSC_VER) && _MSC_VER < 1900
+      // Older msvc runtimes spell size_t's length modifier as I.
+      if ( sz ) *strchr( sub, 'z' ) = 'I';
+#endif
+
+      int nargs = 0;
+      int a[2] = { 0, 0 };
+      if ( starWidth )     a[nargs++] = va_arg( args, int );
+      if ( starPrecision ) a[nargs++] = va_arg( args, int );
+
+      mrlPrintfArg x;
+      switch( conv )
+      {
+	 case 'e': case 'E': case 'f': case 'F':
+	 case 'g': case 'G': case 'a': case 'A':
+	    if ( lng >= 2 ) {
+	       x.type = mrlPrintfArg::kLongDouble;
+	       x.ld   = va_arg( args, long double );
+	    } else {
+	       x.type = mrlPrintfArg::kDouble;
+	       x.d    = va_arg( args, double );
+	    }
+	    break;
+	 case 's':
+	    x.type = mrlPrintfArg::kString;
+	    x.s    = va_arg( args, const char* );
+	    break;
+	 case 'p':
+	    x.type = mrlPrintfArg::kPointer;
+	    x.ptr  = va_arg( args, void* );
+	    break;
+	 case 'c':
+	    x.type = mrlPrintfArg::kInt;
+	    x.i    = va_arg( args, int );
+	    break;
+	 case 'd': case 'i':
+	    if ( sz ) {
+	       x.type = mrlPrintfArg::kPtrdiff;
+	       x.pd   = va_arg( args, ptrdiff_t );
+	    } else if ( lng >= 2 ) {
+	       x.type = mrlPrintfArg::kLongLong;
+	       x.ll   = va_arg( args, long long );
+	    } else if ( lng == 1 ) {
+	       x.type = mrlPrintfArg::kLong;
+	       x.l    = va_arg( args, long );
+	    } else {
+	       x.type = mrlPrintfArg::kInt;
+	       x.i    = va_arg( args, int );
+	    }
+	    break;
+	 default:
+	    if ( sz ) {
+	       x.type = mrlPrintfArg::kSize;
+	       x.sz   = va_arg( args, size_t );
+	    } else if ( lng >= 2 ) {
+	       x.type = mrlPrintfArg::kUnsignedLongLong;
+	       x.ull  = va_arg( args, unsigned long long );
+	    } else if ( lng == 1 ) {
+	       x.type = mrlPrintfArg::kUnsignedLong;
+	       x.ul   = va_arg( args, unsigned long );
+	    } else {
+	       x.type = mrlPrintfArg::kUnsigned;
+	       x.u    = va_arg( args, unsigned );
+	    }
+	    break;
+      }
+
+      int n = format_arg( buf + pos, cap - pos, sub, nargs, a[0], a[1], x );
+      if ( n < 0 ) { error = true; continue; }
+      if ( (size_t) n >= cap - pos )
+      {
+	 // Did not fit.  Drain and retry, or if even an empty buffer is
+	 // too small, format to the heap.
+	 make_room( n + 1 );
+	 if ( (size_t) n < cap - pos )
+	 {
+	    format_arg( buf + pos, cap - pos, sub, nargs, a[0], a[1], x );
+	 }
+	 else
+	 {
+	    char* big = static_cast<char*>( malloc( n + 1 ) );
+	    format_arg( big, n + 1, sub, nargs, a[0], a[1], x );
+	    write_through( big, n );
+	    free( big );
+	    count += n;
+	    continue;
+	 }
+      }
+      pos   += n;
+      count += n;
+   }
+
+   return count;
+}
@@ -0,0 +1,213 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef mrlBufferedIO_h
+#define mrlBufferedIO_h
+
+#include <cstdio>
+#include <cstring>
+#include <cstdarg>
+
+
+//! Buffered output file used for writing .mi files.
+//!
+//! Unlike stdio, all formatting is done directly into a large
+//! memory buffer that gets written out with a single fwrite() when full,
+//! and integers and %g floats are formatted with our own routines,
+//! which are several times faster than the C library's.
+//!
+//! Floats printed with a plain %g come out exactly as printf would
+//! print them, so .mi files are byte for byte the same as before.
+//!
+//! Reading (used by a handful of binary side files) is just passed
+//! through to stdio.
+//!
+//! When compiled with USE_ZLIB, files can also be gzip compressed as
+//! they are written (see open_gz()).  The buffer is then handed to zlib
+//! instead of fwrite() each time it fills up.
+class mrlFile
+{
+   public:
+     enum {
+       kBufferSize = 1024 * 1024
+     };
+
+     //! Open a file, same as fopen().  Returns NULL on failure.
+     static mrlFile* open( const char* name, const char* mode );
+
+#ifdef USE_ZLIB
+     //! Open a file for writing, gzip compressing it as it is written.
+     //! level goes from 1 (fastest) to 9 (smallest).  Returns NULL on
+     //! failure.
+     static mrlFile* open_gz( const char* name, int level );
+#endif
+
+     //! Take ownership of an already open stdio stream (like a pipe).
+     static mrlFile* wrap( FILE* fp );
+
+     //! Return the mrlFile wrapping stdout.
+     static mrlFile* std_out();
+
+     //! Create a file that is kept in memory.  Its buffer grows as
+     //! needed and can be copied into another file with append().
+     static mrlFile* memory( size_t size = 64 * 1024 );
+
+     //! Flush and close file and free it (except for std_out()).
+     static int close( mrlFile* f );
+
+     int flush();
+     
+     inline int puts( const char* s )
+     {
+	write_bytes( s, strlen(s) );
+	return 1;
+     }
+
+     inline int putc( int c )
+     {
+	if ( pos == cap ) make_room( 1 );
+	buf[pos++] = (char) c;
+	return c;
+     }
+
+     int    printf( const char* fmt, ... );
+     int    vprintf( const char* fmt, va_list args );
+     size_t write( const void* p, size_t size, size_t n );
+     size_t read( void* p, size_t size, size_t n );
+     int    eof();
+
+     //! Append the contents of a memory file.
+     inline void append( const mrlFile* m )
+     {
+	write_bytes( m->buf, m->pos );
+     }
+
+     //! Discard the contents of a memory file so it can be reused.
+     inline void rewind() { pos = 0; }
+
+     //! Contents of a memory file (not \0 terminated) and their size.
+     inline const char* data() const { return buf; }
+     inline size_t      size() const { return pos; }
+
+     //! Number of bytes written to file so far (before compression).
+     inline unsigned long long tell() const { return drained + pos; }
+
+     //! Write an integer in decimal.
+     void write_int( long x );
+     //! Write an unsigned integer in decimal.
+     void write_uint( unsigned long x );
+     //! Write a float like printf's %g.
+     void write_float( double x );
+
+     //! Format x exactly like printf's %g.
+     //! Buffer must hold at least 32 chars.  Returns chars written (no \0).
+     static int format_float( char* out, double x );
+
+   protected:
+     mrlFile( FILE* fp, bool writing );
+     ~mrlFile();
+
+     inline void write_bytes( const char* s, size_t len )
+     {
+	if ( len > cap - pos )
+	{
+	   make_room( len );
+	   if ( len > cap - pos )
+	   {
+	      write_through( s, len );
+	      return;
+	   }
+	}
+	memcpy( buf + pos, s, len );
+	pos += len;
+     }
+
+     //! Make sure n bytes are available in buffer.
+     inline char* reserve( size_t n )
+     {
+	if ( n > cap - pos ) make_room( n );
+	return buf + pos;
+     }
+
+     //! Write out the buffer (or grow it, for memory files) so that
+     //! n more bytes fit, if possible.
+     inline void make_room( size_t n )
+     {
+	if ( fp || gz ) drain();
+	else            grow( n );
+     }
+
+     void drain();
+     void grow( size_t n );
+     void write_through( const char* s, size_t len );
+
+     FILE*  fp;
+     void*  gz;     // gzFile, when compressing
+     char*  buf;
+     size_t pos;
+     size_t cap;
+     unsigned long long drained;  // bytes already handed to fp or gz
+     bool   error;
+};
+
+
+#ifndef MRL_FILE
+#  define MRL_FILE    mrlFile
+#  define MRL_FOPEN   mrlFile::open
+#  ifdef USE_ZLIB
+#    define MRL_FOPEN_GZ(name,level) \
+       ( (level) ? mrlFile::open_gz( name, level ) : mrlFile::open( name, "wb" ) )
+#    define MRL_GZIP_FILES
+#  endif
+#  define MRL_FWRAP   mrlFile::wrap
+#  define MRL_FFLUSH(f)  (f)->flush()
+#  define MRL_FCLOSE  mrlFile::close
+#  define MRL_PUTS(x) f->puts(x)
+#  define MRL_PUTC(x) f->putc(x)
+#  define MRL_FPRINTF mrl_fprintf
+#  define MRL_FWRITE(p,s,n,f)  (f)->write(p,s,n)
+#  define MRL_FREAD(p,s,n,f)   (f)->read(p,s,n)
+#  define MRL_FEOF(f)          (f)->eof()
+#  define MRL_stdout  mrlFile::std_out()
+#  define MRL_MEMORY_FILES
+#endif
+
+
+inline int mrl_fprintf( mrlFile* f, const char* fmt, ... )
+{
+   va_list args;
+   va_start( args, fmt );
+   int r = f->vprintf( fmt, args );
+   va_end( args );
+   return r;
+}
+
+#endif // mrlBufferedIO_h
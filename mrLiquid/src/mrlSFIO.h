@@ -31,6 +31,7 @@ extern ssize_t	_stdfread _ARG_((Void_t*, size_t, size_t, Sfio_t*));
 
 #  define MRL_FILE    _sfFILE
 #  define MRL_FOPEN   _stdfopen
+#  define MRL_FWRAP(x) (x)
 #  define MRL_FFLUSH  _stdfflush 
 #  define MRL_FCLOSE  sfclose
 #  define MRL_PUTS(x) sfputr( f, x, -1)
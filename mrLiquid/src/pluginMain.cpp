@@ -48,6 +48,7 @@
 #include "convertLightmapSetupCmd.h"
 #include "mentalIsAnimatedCmd.h"
 #include "mentalParseStringCmd.h"
+#include "mentalIPRStatsCmd.h"
 
 #if defined(_WIN32)
 #  include "mentalClearConsoleCmd.h"
@@ -208,6 +209,7 @@ DLLEXPORT MStatus initializePlugin(MObject obj)
    REGISTER_CMD( mentalVisibility );
    REGISTER_CMD( mentalIsAnimated );
    REGISTER_CMD( mentalParseString );
+   REGISTER_CMD( mentalIPRStats );
 
    REGISTER_NODE( mentalRenderLayerOverride );
 
@@ -412,6 +414,7 @@ DLLEXPORT MStatus uninitializePlugin(MObject obj)
    DEREGISTER_CMD( mentalVisibility );
    DEREGISTER_CMD( mentalIsAnimated );
    DEREGISTER_CMD( mentalParseString );
+   DEREGISTER_CMD( mentalIPRStats );
 
    DEREGISTER_NODE( mentalRenderLayerOverride );
    
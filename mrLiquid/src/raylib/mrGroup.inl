@@ -32,6 +32,7 @@
 template< typename D, typename C >
 inline void mrGroup< D, C>::write_each_member()
 {
+   compact();
    typename MemberList::iterator i = members.begin();
    typename MemberList::iterator e = members.end();
    for ( ; i != e; ++i )
@@ -46,6 +47,7 @@ inline void mrGroup< D, C>::write_each_member()
 template< typename D, typename C >
 inline void mrGroup< D, C>::write_members()
 {
+   compact();
    typename MemberList::iterator i = members.begin();
    typename MemberList::iterator e = members.end();
    for ( ; i != e; ++i )
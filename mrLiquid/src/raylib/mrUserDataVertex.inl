@@ -9,72 +9,6 @@
  */
 
 
-#undef WRITE_FLOAT
-
-#define WRITE_FLOAT(tmp)    { scalars.push_back( tmp ); }
-
-
-
-void mrUserDataVertex::write_trilist( std::vector< miScalar >& scalars, 
-				      const unsigned idx )
-{   
-  MStatus status;
-  mrUserVectors::iterator i = userAttrs.begin();
-  mrUserVectors::iterator e = userAttrs.end();
-  MFnDependencyNode dep( path.node() );
-
-  float tmp;
-  for ( ; i != e; ++i )
-    {
-      const mrVertexData& v = *i;
-      
-      MString attrName = "miCustomTex" + v.attr;
-      MPlug p = dep.findPlug( attrName, true, &status );
-      
-      MObject data;
-      p.getValue(data);
-      if ( data.hasFn( MFn::kIntArrayData ) )
-	{
-	  MFnIntArrayData fn( data );
-	  tmp = (float) fn.array()[idx];
-	  WRITE_FLOAT(tmp);
-	}
-      else if ( data.hasFn( MFn::kDoubleArrayData ) )
-	{
-	  MFnDoubleArrayData fn( data );
-	  tmp = (float) fn.array()[idx];
-	  WRITE_FLOAT(tmp);
-	}
-      else if ( data.hasFn( MFn::kVectorArrayData ) )
-	{
-	  MFnVectorArrayData fn( data );
-	  const MVector& v = fn.array()[idx];
-	  tmp = (float) v[0];
-	  WRITE_FLOAT(tmp);
-	  tmp = (float) v[1];
-	  WRITE_FLOAT(tmp);
-	  tmp = (float) v[2];
-	  WRITE_FLOAT(tmp);
-	}
-      else if ( data.hasFn( MFn::kPointArrayData ) )
-	{
-	  MFnPointArrayData fn( data );
-	  const MPoint& v = fn.array()[idx];
-	  tmp = (float) v[0];
-	  WRITE_FLOAT(tmp);
-	  tmp = (float) v[1];
-	  WRITE_FLOAT(tmp);
-	  tmp = (float) v[2];
-	  WRITE_FLOAT(tmp);
-	  tmp = (float) v[3];
-	  WRITE_FLOAT(tmp);
-	}
-    }
-  
-}
-
-
-
 #undef WRITE_VECTOR
 #define WRITE_VECTOR( tmp ) { vectors.push_back( tmp ); pos = 0; }
 
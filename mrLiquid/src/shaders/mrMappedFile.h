@@ -0,0 +1,116 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef mrMappedFile_h
+#define mrMappedFile_h
+
+#include <cstddef>
+
+#if defined(WIN32) || defined(WIN64)
+#  include <windows.h>
+#else
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+
+//! A file mapped read-only into memory for as long as this object
+//! lives.  data() is NULL if the file could not be opened or is empty.
+class mrMappedFile
+{
+   public:
+     mrMappedFile( const char* file ) :
+     addr( NULL ),
+     len( 0 )
+     {
+#if defined(WIN32) || defined(WIN64)
+	HANDLE fh = CreateFileA( file, GENERIC_READ, FILE_SHARE_READ, NULL,
+				 OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+				 NULL );
+	if ( fh == INVALID_HANDLE_VALUE ) return;
+	LARGE_INTEGER s;
+	if ( GetFileSizeEx( fh, &s ) && s.QuadPart > 0 )
+	{
+	   HANDLE mh = CreateFileMappingA( fh, NULL, PAGE_READONLY,
+					   0, 0, NULL );
+	   if ( mh )
+	   {
+	      addr = (const char*) MapViewOfFile( mh, FILE_MAP_READ,
+						  0, 0, 0 );
+	      if ( addr ) len = (size_t) s.QuadPart;
+	      CloseHandle( mh );
+	   }
+	}
+	CloseHandle( fh );
+#else
+	int fd = open( file, O_RDONLY );
+	if ( fd < 0 ) return;
+	struct stat s;
+	if ( fstat( fd, &s ) == 0 && s.st_size > 0 )
+	{
+	   void* p = mmap( NULL, (size_t) s.st_size, PROT_READ, MAP_SHARED,
+			   fd, 0 );
+	   if ( p != MAP_FAILED )
+	   {
+	      addr = (const char*) p;
+	      len  = (size_t) s.st_size;
+	   }
+	}
+	close( fd );
+#endif
+     }
+
+     ~mrMappedFile()
+     {
+	if ( addr == NULL ) return;
+#if defined(WIN32) || defined(WIN64)
+	UnmapViewOfFile( addr );
+#else
+	munmap( (void*) addr, len );
+#endif
+     }
+
+     inline const char* data() const { return addr; }
+     inline size_t      size() const { return len; }
+
+   private:
+     mrMappedFile( const mrMappedFile& );
+     mrMappedFile& operator=( const mrMappedFile& );
+
+     const char* addr;
+     size_t      len;
+};
+
+
+#endif // mrMappedFile_h
@@ -0,0 +1,570 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+/**
+ * @file   mrlTextureCache.cpp
+ * @author gga
+ * 
+ * @brief  Loading and eviction of the tiles of mrl_exr_file's texture
+ *         cache.  See mrlTextureCache.h.
+ *
+ *         Tile data comes from mental ray's memory allocator.  Built with
+ *         MR_NO_MENTALRAY (as the benchmarks do) it comes from malloc().
+ */
+
+#include <cstdlib>
+#include <cstdio>
+
+#ifdef MR_NO_MENTALRAY
+#  define MRL_TILE_ALLOCATE(size)  malloc( size )
+#  define MRL_TILE_RELEASE(data)   free( data )
+#  define MRL_TILE_ERROR(msg)      fprintf( stderr, "%s\n", msg )
+#else
+#  include "shader.h"
+#  define MRL_TILE_ALLOCATE(size)  mi_mem_allocate( size )
+#  define MRL_TILE_RELEASE(data)   mi_mem_release( data )
+#  define MRL_TILE_ERROR(msg)      mi_error( "%s", msg )
+#endif
+
+#include "mrlTextureCache.h"
+
+
+static mrlTextureBlock tileLoading;
+mrlTextureBlock* const kTileLoading = &tileLoading;
+
+mrlTextureShard textureShards[kNumShards];
+
+mrlTextureReader textureReaders[kMaxTextureReaders];
+volatile mrAtomic numTextureReaders = 0;
+mrlTextureReader textureNoReader;
+
+#if defined(WIN32) || defined(WIN64)
+DWORD textureReaderKey = TLS_OUT_OF_INDEXES;
+#else
+__thread mrlTextureReader* textureThreadReader = NULL;
+#endif
+
+namespace
+{
+  unsigned shardMemoryMax = 0;
+  bool     cacheReady = false;
+}
+
+
+mrlTextureReader* textureNewReader()
+{
+  mrlTextureReader* r = &textureNoReader;
+  mrAtomic n = MR_ATOMIC_INC( numTextureReaders );
+  if ( n <= (mrAtomic) kMaxTextureReaders )
+    {
+      r = &textureReaders[n - 1];
+    }
+  else
+    {
+      MR_ATOMIC_DEC( numTextureReaders );
+    }
+
+#if defined(WIN32) || defined(WIN64)
+  TlsSetValue( textureReaderKey, r );
+#else
+  textureThreadReader = r;
+#endif
+  return r == &textureNoReader ? NULL : r;
+}
+
+
+/** 
+ * Check whether a thread with a reader is reading a block.
+ * 
+ * @param block block to check
+ * 
+ * @return true if some reader has the block
+ */
+static bool textureBlockRead( const mrlTextureBlock* block )
+{
+  unsigned n = (unsigned) numTextureReaders;
+  if ( n > kMaxTextureReaders ) n = kMaxTextureReaders;
+  for ( unsigned i = 0; i < n; ++i )
+    if ( textureReaders[i].reading == block ) return true;
+  return false;
+}
+
+
+/** 
+ * Delete a texture block's data and remove it from its shard.
+ * Shard must be locked.
+ * 
+ * @param block Texture block to delete.
+ */
+static void textureDeleteBlock( mrlTextureShard& shard,
+				mrlTextureBlock* block )
+{
+  *(block->tile) = NULL;
+
+  // Move the last block of the clock into the hole left by this one
+  mrlTextureBlock* last = shard.clock.back();
+  shard.clock[ block->slot ] = last;
+  last->slot = block->slot;
+  shard.clock.pop_back();
+
+  if ( block->data )
+    {
+      shard.memoryUsed -= block->size;
+      MRL_TILE_RELEASE( block->data );
+      block->data = NULL;
+    }
+
+  block->next = shard.freeBlocks;
+  shard.freeBlocks = block;
+}
+
+
+/** 
+ * Try to take a block out of its texture's tile table so it can be
+ * released.  Shard must be locked.
+ *
+ * Lookups read a block without the lock by publishing it in their reader
+ * (or pinning it) and then checking that it is still in the tile table.
+ * Here the block is taken out of the table first and the readers and pins
+ * checked afterwards, so either the lookup sees the block is gone or we
+ * see the block is being read.
+ * 
+ * @return true if block is no longer reachable and may be released.
+ */
+static bool textureUnpublishBlock( mrlTextureBlock* block )
+{
+  if ( block->pins != 0 ) return false;
+
+  *(block->tile) = NULL;
+  MR_MEMORY_BARRIER();
+  if ( block->pins == 0 && !textureBlockRead( block ) ) return true;
+
+  *(block->tile) = block;
+  return false;
+}
+
+
+/** 
+ * Advance the clock hand of a shard, evicting blocks not referenced since
+ * its last pass, until size bytes fit in the shard's memory.
+ * Shard must be locked.
+ * 
+ * @param size bytes needed
+ */
+static void textureMemFlush( mrlTextureShard& shard, const unsigned size )
+{
+  ++shard.sweeps;
+
+  // Two turns of the clock clear all reference bits, so more steps than
+  // that mean the remaining blocks are all being read.
+  size_t steps = 2 * shard.clock.size() + 1;
+  while ( !shard.clock.empty() && shard.memoryUsed + size > shardMemoryMax &&
+	  steps-- > 0 )
+    {
+      if ( shard.hand >= shard.clock.size() ) shard.hand = 0;
+
+      mrlTextureBlock* c = shard.clock[ shard.hand ];
+      if ( c->referenced || !textureUnpublishBlock( c ) )
+	{
+	  c->referenced = false;
+	  ++shard.hand;
+	  continue;
+	}
+
+      // The hand stays put, as the last block of the clock was moved here.
+      textureDeleteBlock( shard, c );
+      ++shard.evictions;
+    }
+}
+
+
+/** 
+ * Account for the memory of a new texture block, evicting other blocks
+ * of the shard if needed.  Shard must be locked.
+ * 
+ * @param size bytes of the block
+ */
+static void textureAddMemory( mrlTextureShard& shard, const unsigned size )
+{
+  if ( shard.memoryUsed + size > shardMemoryMax )
+    textureMemFlush( shard, size );
+
+  shard.memoryUsed  += size;
+  shard.transferred += size;
+  if ( shard.memoryUsed > shard.peakMemory )
+    shard.peakMemory = shard.memoryUsed;
+}
+
+
+/** 
+ * Add a new texture block to a shard's clock.  The caller puts it in its
+ * tile table once the block is filled in.  Shard must be locked.
+ * 
+ * @return new mrlTextureBlock*
+ */
+static mrlTextureBlock*	textureNewBlock( mrlTextureShard& shard,
+					 const mrlTiledTexture* owner,
+					 mrlTileSlot* tile ) 
+{
+   mrlTextureBlock* block;
+   if ( shard.freeBlocks != NULL )
+     {
+       block = shard.freeBlocks;
+       shard.freeBlocks = block->next;
+     }
+   else
+     {
+       block = new mrlTextureBlock;
+       block->pins = 0;
+     }
+
+   // pins is left alone, as a lookup may still be checking a reused block.
+   block->owner = owner;
+   block->tile  = tile;
+   block->next  = NULL;
+   block->referenced = true;
+   block->size  = 0;
+   block->data  = NULL;
+
+   block->slot = (unsigned) shard.clock.size();
+   shard.clock.push_back( block );
+
+   return block;
+}
+
+
+/** 
+ * Delete all the texture blocks of a texture.
+ * 
+ * @param owner texture
+ */
+static void textureDeleteBlocks( const mrlTiledTexture* owner )
+{
+  if ( !cacheReady ) return;
+
+  for ( unsigned s = 0; s < kNumShards; ++s )
+    {
+      mrlTextureShard& shard = textureShards[s];
+      mrl_lock( shard.lock );
+      for ( size_t i = shard.clock.size(); i-- > 0; )
+	{
+	  // Blocks moved into slot i come from past it, so were checked.
+	  mrlTextureBlock* c = shard.clock[i];
+	  if ( c->owner == owner ) textureDeleteBlock( shard, c );
+	}
+      mrl_unlock( shard.lock );
+    }
+}
+
+
+void textureCacheGather( mrlTextureCacheStats& s )
+{
+  if ( !cacheReady ) return;
+
+  // Readers are only written to by their threads, so take away what was
+  // reported last time instead of zeroing them.
+  unsigned n = (unsigned) numTextureReaders;
+  if ( n > kMaxTextureReaders ) n = kMaxTextureReaders;
+  for ( unsigned i = 0; i < n; ++i )
+    {
+      mrlTextureReader& r = textureReaders[i];
+      unsigned long hits = r.hits;
+      unsigned long prefetchHits = r.prefetchHits;
+      s.hits         += hits - r.reportedHits;
+      s.prefetchHits += prefetchHits - r.reportedPrefetchHits;
+      r.reportedHits = hits;
+      r.reportedPrefetchHits = prefetchHits;
+    }
+
+  unsigned long peak = 0;
+  for ( unsigned i = 0; i < kNumShards; ++i )
+    {
+      mrlTextureShard& shard = textureShards[i];
+      mrl_lock( shard.lock );
+
+      // Lookups may be counting hits meanwhile, so take away what was
+      // added up instead of zeroing the counters.
+      unsigned long hits = (unsigned long) shard.hits;
+      unsigned long prefetchHits = (unsigned long) shard.prefetchHits;
+      MR_ATOMIC_SUB64( shard.hits, hits );
+      MR_ATOMIC_SUB64( shard.prefetchHits, prefetchHits );
+
+      s.hits         += hits;
+      s.misses       += shard.misses;
+      s.evictions    += shard.evictions;
+      s.sweeps       += shard.sweeps;
+      s.transferred  += shard.transferred;
+      s.prefetches   += shard.prefetches;
+      s.prefetchHits += prefetchHits;
+      peak += shard.peakMemory;
+      shard.misses = shard.evictions = 0;
+      shard.sweeps = shard.transferred = 0;
+      shard.prefetches = 0;
+      mrl_unlock( shard.lock );
+    }
+
+  // Shards peak at different times, so this is an upper bound.
+  if ( peak > s.peakMemory ) s.peakMemory = peak;
+}
+
+
+void textureCacheShutdown()
+{
+  if ( !cacheReady ) return;
+
+  for ( unsigned s = 0; s < kNumShards; ++s )
+    {
+      mrlTextureShard& shard = textureShards[s];
+      while ( !shard.clock.empty() )
+	textureDeleteBlock( shard, shard.clock.back() );
+
+      mrlTextureBlock* c, *n;
+      for (c = shard.freeBlocks; c != NULL; c = n) 
+	{
+	  n = c->next;
+	  delete c;
+	}
+      shard.freeBlocks = NULL;
+
+      mrlTextureShard::Blocks().swap( shard.clock );
+      mrl_condition_destroy( shard.loaded );
+      mrl_mutex_destroy( shard.lock );
+    }
+
+  cacheReady = false;
+}
+
+
+void textureCacheInit( const unsigned maxMemory )
+{
+  textureCacheShutdown();
+
+#if defined(WIN32) || defined(WIN64)
+  if ( textureReaderKey == TLS_OUT_OF_INDEXES )
+    textureReaderKey = TlsAlloc();
+#endif
+
+  // Threads keep their readers across renders.  Forget their old hits.
+  unsigned n = (unsigned) numTextureReaders;
+  if ( n > kMaxTextureReaders ) n = kMaxTextureReaders;
+  for ( unsigned i = 0; i < n; ++i )
+    {
+      mrlTextureReader& r = textureReaders[i];
+      r.reportedHits = r.hits;
+      r.reportedPrefetchHits = r.prefetchHits;
+    }
+
+  shardMemoryMax = maxMemory / kNumShards;
+
+  for ( unsigned s = 0; s < kNumShards; ++s )
+    {
+      mrlTextureShard& shard = textureShards[s];
+      mrl_mutex_init( shard.lock );
+      mrl_condition_init( shard.loaded );
+      shard.waiting = 0;
+      shard.hand = 0;
+      shard.freeBlocks = NULL;
+      shard.memoryUsed = shard.peakMemory = 0;
+      shard.hits = shard.misses = shard.evictions = 0;
+      shard.sweeps = shard.transferred = 0;
+      shard.prefetches = shard.prefetchHits = 0;
+    }
+
+  cacheReady = true;
+}
+
+
+
+mrlTiledTexture::mrlTiledTexture() :
+  _levels( NULL ),
+  _tileXSize( 0 ),
+  _tileYSize( 0 ),
+  _numXLevels( 0 ),
+  _numYLevels( 0 ),
+  _tileBytes( 0 )
+{
+}
+
+
+mrlTiledTexture::~mrlTiledTexture()
+{
+  if ( _levels == NULL ) return;
+
+  textureDeleteBlocks( this );
+
+  unsigned numLevels = _numXLevels * _numYLevels;
+  for ( unsigned i = 0; i < numLevels; ++i )
+    delete [] _levels[i];
+  delete [] _levels;
+}
+
+
+void mrlTiledTexture::initTiles( const unsigned texelSize )
+{
+  _tileBytes = _tileXSize * _tileYSize * texelSize;
+
+  unsigned numLevels = _numXLevels * _numYLevels;
+  _levels = new mrlTileSlot* volatile[numLevels];
+  for ( unsigned i = 0; i < numLevels; ++i )
+    _levels[i] = NULL;
+}
+
+
+/** 
+ * Load a tile into a shard.  Shard must be locked and the tile's slot
+ * empty.  The slot is marked as loading and the shard is unlocked while
+ * the tile is read, so lookups of other tiles of the shard do not wait
+ * on the disk.  The shard is locked again on return, and threads waiting
+ * for a tile of the shard are woken.
+ * 
+ * @param x     tileX number
+ * @param y     tileY number
+ * @param lx    LOD level X
+ * @param ly    LOD level Y
+ * @param prefetch true if the block is loaded ahead of being needed
+ *
+ * @return new mrlTextureBlock* or NULL if the tile could not be loaded.
+ */
+mrlTextureBlock* mrlTiledTexture::loadBlock( mrlTextureShard& shard,
+					     mrlTileSlot* tile,
+					     const int x, const int y,
+					     const int lx, const int ly,
+					     const bool prefetch )
+{
+  if ( prefetch ) ++shard.prefetches;
+  else            ++shard.misses;
+
+  *tile = kTileLoading;
+  mrl_unlock( shard.lock );
+
+  void* data = MRL_TILE_ALLOCATE( _tileBytes );
+  if ( data == NULL )
+    {
+      MRL_TILE_ERROR( "mrl_exr_file: Could not allocate memory for pixels" );
+    }
+  else if ( !readTile( data, x, y, lx, ly ) )
+    {
+      MRL_TILE_RELEASE( data );
+      data = NULL;
+    }
+
+  mrl_lock( shard.lock );
+
+  mrlTextureBlock* entry = NULL;
+  if ( data )
+    {
+      textureAddMemory( shard, _tileBytes );
+
+      entry = textureNewBlock( shard, this, tile );
+      // A block loaded ahead gets no second chance until it is used.
+      entry->referenced = !prefetch;
+      entry->prefetched = prefetch ? 1 : 0;
+      entry->size = _tileBytes;
+      entry->data = data;
+
+      // Make the pixels visible before lookups can find the block
+      MR_MEMORY_BARRIER();
+    }
+
+  // A failed load empties the slot, so the next lookup tries again.
+  *tile = entry;
+
+  // Waiters cannot tell which tile of the shard they wait on, so all are
+  // woken and the ones whose tile is still loading go back to sleep.
+  if ( shard.waiting )
+    {
+      mrl_wake( shard.loaded, shard.waiting );
+      shard.waiting = 0;
+    }
+  return entry;
+}
+
+
+mrlTextureBlock* mrlTiledTexture::acquireLocked( mrlTileSlot* tile,
+						 mrlTextureReader* reader,
+						 const int tileX,
+						 const int tileY,
+						 const int lx, const int ly )
+{
+  // The block is published or pinned before the shard is unlocked, so
+  // the clock hand of another thread cannot release it under us.
+  mrlTextureShard& shard = textureShard( textureHash( tile ) );
+  mrl_lock( shard.lock );
+
+  // Another thread is reading the tile.  Sleep until it is done instead
+  // of reading the tile twice.
+  while ( *tile == kTileLoading )
+    {
+      ++shard.waiting;
+      mrl_wait( shard.loaded, shard.lock );
+    }
+
+  bool loaded = false;
+  mrlTextureBlock* block = *tile;
+  if ( block )
+    {
+      if ( reader ) textureCountHit( *reader, block );
+      else          textureCountHit( shard, block );
+    }
+  else
+    {
+      // block not loaded
+      block = loadBlock( shard, tile, tileX, tileY, lx, ly, false );
+      loaded = true;
+    }
+
+  if ( block )
+    {
+      if ( reader ) reader->reading = block;
+      else          MR_ATOMIC_INC( block->pins );
+    }
+
+  mrl_unlock( shard.lock );
+
+  if ( loaded ) missed( tileX, tileY, lx, ly );
+
+  return block;
+}
+
+
+void mrlTiledTexture::preload( const int tileX, const int tileY,
+			       const int lx, const int ly )
+{
+  mrlTileSlot* tile = tileSlot( tileX, tileY, lx, ly );
+  if ( *tile != NULL ) return;
+
+  mrlTextureShard& shard = textureShard( textureHash( tile ) );
+  mrl_lock( shard.lock );
+  if ( *tile == NULL )
+    loadBlock( shard, tile, tileX, tileY, lx, ly, true );
+  mrl_unlock( shard.lock );
+}
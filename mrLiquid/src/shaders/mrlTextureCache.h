@@ -0,0 +1,512 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+/**
+ * @file   mrlTextureCache.h
+ * @author gga
+ * 
+ * @brief  Tile cache of mrl_exr_file.  Textures are split in tiles which
+ *         are loaded on demand into a cache shared by all textures and
+ *         evicted with the CLOCK algorithm once the cache is full.
+ *
+ *         The cache does not know about file formats.  A texture derives
+ *         from mrlTiledTexture and reads its tiles in readTile().
+ *         Nothing here depends on mental ray, so the cache can be built
+ *         into the benchmarks as is (see tools/benchmarks).
+ */
+
+#ifndef mrlTextureCache_h
+#define mrlTextureCache_h
+
+#include <cstddef>
+#include <vector>
+
+#if defined(WIN32) || defined(WIN64)
+#  include <windows.h>
+#  define MR_ATOMIC_INC(x)  InterlockedIncrement( &(x) )
+#  define MR_ATOMIC_DEC(x)  InterlockedDecrement( &(x) )
+#  define MR_ATOMIC_CAS(x, a, b) \
+   ( InterlockedCompareExchange( &(x), (b), (a) ) == (a) )
+#  define MR_ATOMIC_CAS_PTR(x, a, b) \
+   ( InterlockedCompareExchangePointer( (PVOID volatile*) &(x), (b), (a) ) == (a) )
+#  define MR_ATOMIC_INC64(x)    InterlockedIncrement64( &(x) )
+#  define MR_ATOMIC_SUB64(x, n) InterlockedExchangeAdd64( &(x), -(LONGLONG)(n) )
+#  define MR_MEMORY_BARRIER()  MemoryBarrier()
+#  define MR_COMPILER_BARRIER() _ReadWriteBarrier()
+#  define MRL_CACHE_ALIGN  __declspec( align(64) )
+typedef LONG mrAtomic;
+typedef LONGLONG mrAtomic64;
+typedef CRITICAL_SECTION mrlMutex;
+typedef HANDLE mrlCondition;   // semaphore, as condition variables need Vista
+#else
+#  include <pthread.h>
+#  define MR_ATOMIC_INC(x)  __sync_add_and_fetch( &(x), 1 )
+#  define MR_ATOMIC_DEC(x)  __sync_sub_and_fetch( &(x), 1 )
+#  define MR_ATOMIC_CAS(x, a, b)  __sync_bool_compare_and_swap( &(x), (a), (b) )
+#  define MR_ATOMIC_CAS_PTR(x, a, b)  __sync_bool_compare_and_swap( &(x), (a), (b) )
+#  define MR_ATOMIC_INC64(x)    __sync_add_and_fetch( &(x), 1 )
+#  define MR_ATOMIC_SUB64(x, n) __sync_sub_and_fetch( &(x), (n) )
+#  define MR_MEMORY_BARRIER()  __sync_synchronize()
+#  if defined(__i386__) || defined(__x86_64__)
+#    define MR_COMPILER_BARRIER() __asm__ __volatile__( "" ::: "memory" )
+#  else
+#    define MR_COMPILER_BARRIER() __sync_synchronize()
+#  endif
+#  define MRL_CACHE_ALIGN  __attribute__(( aligned(64) ))
+typedef long mrAtomic;
+typedef long long mrAtomic64;
+typedef pthread_mutex_t mrlMutex;
+typedef pthread_cond_t  mrlCondition;
+#endif
+
+
+#if defined(WIN32) || defined(WIN64)
+inline void mrl_mutex_init( mrlMutex& m )    { InitializeCriticalSection( &m ); }
+inline void mrl_mutex_destroy( mrlMutex& m ) { DeleteCriticalSection( &m ); }
+inline void mrl_lock( mrlMutex& m )          { EnterCriticalSection( &m ); }
+inline void mrl_unlock( mrlMutex& m )        { LeaveCriticalSection( &m ); }
+
+inline void mrl_condition_init( mrlCondition& c )
+{
+  c = CreateSemaphore( NULL, 0, 0x7fffffff, NULL );
+}
+inline void mrl_condition_destroy( mrlCondition& c ) { CloseHandle( c ); }
+//! Wait on c.  m must be locked, and is locked on return.  The caller must
+//! have counted itself among the n threads passed to mrl_wake().
+inline void mrl_wait( mrlCondition& c, mrlMutex& m )
+{
+  LeaveCriticalSection( &m );
+  WaitForSingleObject( c, INFINITE );
+  EnterCriticalSection( &m );
+}
+//! Wake the n threads waiting on c.
+inline void mrl_wake( mrlCondition& c, unsigned n )
+{
+  ReleaseSemaphore( c, n, NULL );
+}
+#else
+inline void mrl_mutex_init( mrlMutex& m )    { pthread_mutex_init( &m, NULL ); }
+inline void mrl_mutex_destroy( mrlMutex& m ) { pthread_mutex_destroy( &m ); }
+inline void mrl_lock( mrlMutex& m )          { pthread_mutex_lock( &m ); }
+inline void mrl_unlock( mrlMutex& m )        { pthread_mutex_unlock( &m ); }
+
+inline void mrl_condition_init( mrlCondition& c )
+{
+  pthread_cond_init( &c, NULL );
+}
+inline void mrl_condition_destroy( mrlCondition& c )
+{
+  pthread_cond_destroy( &c );
+}
+//! Wait on c.  m must be locked, and is locked on return.  The caller must
+//! have counted itself among the n threads passed to mrl_wake().
+inline void mrl_wait( mrlCondition& c, mrlMutex& m )
+{
+  pthread_cond_wait( &c, &m );
+}
+//! Wake the n threads waiting on c.
+inline void mrl_wake( mrlCondition& c, unsigned n )
+{
+  if ( n == 1 ) pthread_cond_signal( &c );
+  else          pthread_cond_broadcast( &c );
+}
+#endif
+
+
+class mrlTiledTexture;
+struct mrlTextureBlock;
+
+//! Entry of a texture's tile table.  It points to the tile's block while
+//! the tile is in memory, and is NULL otherwise.
+typedef mrlTextureBlock* volatile mrlTileSlot;
+
+
+/**
+ * This struct holds a texture block.
+ * 
+ */
+struct mrlTextureBlock
+{
+  const mrlTiledTexture* owner; //<- texture the block belongs to
+  mrlTileSlot*       tile;    //<- entry of owner's tile table for block
+  mrlTextureBlock*   next;    //<- next block in free list
+  unsigned           slot;    //<- position of block in shard's clock
+  volatile bool      referenced; //<- used since the clock hand passed
+  volatile mrAtomic  prefetched; //<- 1 if loaded ahead and not used yet
+  volatile mrAtomic  pins;    //<- lookups reading the block without a
+                              //   mrlTextureReader
+  unsigned size;              //<- size of the data
+  void*    data;              //<- actual texture data
+};
+
+
+//! Put in a tile's slot while the tile is read from disk, so other
+//! lookups of the tile wait for it instead of reading it again.
+extern mrlTextureBlock* const kTileLoading;
+
+
+//! Number of shards the texture cache is split into.  Must be a power
+//! of two.  Each shard has its own lock and its own share of the
+//! texture memory, so threads missing on different tiles rarely wait
+//! on each other.
+const unsigned kNumShards = 16;
+
+
+/**
+ * One shard of the texture cache.  Blocks are evicted with the CLOCK
+ * algorithm: a hit just marks the block as referenced, and the clock
+ * hand gives referenced blocks a second chance before releasing them.
+ *
+ * All members but hits and prefetchHits are protected by the shard's
+ * lock.  Those two count the hits of threads without an
+ * mrlTextureReader, which do not take the lock, so they are updated
+ * atomically.
+ *
+ * Shards are aligned to a cache line, so threads working on neighboring
+ * shards do not fight over one.
+ */
+struct MRL_CACHE_ALIGN mrlTextureShard
+{
+  typedef std::vector< mrlTextureBlock* > Blocks;
+
+  mrlMutex lock;
+  mrlCondition loaded;         //<- woken when a tile is done loading
+  unsigned waiting;            //<- threads waiting on loaded
+  Blocks   clock;              //<- resident blocks in clock order
+  unsigned hand;               //<- current position of the clock hand
+  mrlTextureBlock* freeBlocks; //<- blocks available for reuse
+
+  unsigned memoryUsed;
+  unsigned peakMemory;
+
+  volatile mrAtomic64 hits;    //<- atomic, see textureCountHit()
+  unsigned long misses;
+  unsigned long evictions;
+  unsigned long sweeps;
+  unsigned long transferred;
+  unsigned long prefetches;
+  volatile mrAtomic64 prefetchHits; //<- atomic, see textureCountHit()
+};
+
+extern mrlTextureShard textureShards[kNumShards];
+
+
+/**
+ * Lookup state of a thread.  Each thread gets one of these on its first
+ * lookup and keeps it for good.  Hits are counted here with no atomics,
+ * and textureGatherStats() adds them up.  Instead of pinning the block
+ * it reads, which would bounce the block's cache line between all the
+ * threads reading it, a lookup publishes the block here, and the clock
+ * hand checks all readers before releasing a block.
+ *
+ * So a thread may only hold one block at a time.
+ */
+struct MRL_CACHE_ALIGN mrlTextureReader
+{
+  mrlTextureBlock* volatile reading;  //<- block being read, or NULL
+  volatile unsigned long hits;
+  volatile unsigned long prefetchHits;
+  unsigned long reportedHits;         //<- hits already gathered
+  unsigned long reportedPrefetchHits; //<- prefetch hits already gathered
+};
+
+//! Threads past this many look up tiles by pinning blocks and count their
+//! hits atomically in the shards.
+const unsigned kMaxTextureReaders = 256;
+
+extern mrlTextureReader textureReaders[kMaxTextureReaders];
+extern volatile mrAtomic numTextureReaders;
+//! Kept by threads that found all readers taken, so they do not ask for
+//! one again on every lookup.
+extern mrlTextureReader textureNoReader;
+
+//! Give the calling thread its reader.  Returns NULL if all are taken.
+mrlTextureReader* textureNewReader();
+
+#if defined(WIN32) || defined(WIN64)
+extern DWORD textureReaderKey;
+#else
+extern __thread mrlTextureReader* textureThreadReader;
+#endif
+
+//! Reader of the calling thread, or NULL if it has to pin blocks.
+inline mrlTextureReader* textureReader()
+{
+#if defined(WIN32) || defined(WIN64)
+  mrlTextureReader* r = (mrlTextureReader*) TlsGetValue( textureReaderKey );
+#else
+  mrlTextureReader* r = textureThreadReader;
+#endif
+  if ( r == NULL ) return textureNewReader();
+  return r == &textureNoReader ? NULL : r;
+}
+
+
+//! Counters of the texture cache, added up over all shards.
+struct mrlTextureCacheStats
+{
+  unsigned long hits;
+  unsigned long misses;
+  unsigned long evictions;
+  unsigned long sweeps;
+  unsigned long transferred;
+  unsigned long prefetches;
+  unsigned long prefetchHits;
+  unsigned long peakMemory;  //<- sum of the peaks of each shard
+};
+
+
+/** 
+ * Set up the texture cache.  Any previous cache is shut down first.
+ * 
+ * @param maxMemory bytes of texture memory, split evenly among shards
+ */
+void textureCacheInit( const unsigned maxMemory );
+
+/** 
+ * Release all blocks of the texture cache.  All textures must have been
+ * deleted.
+ * 
+ */
+void textureCacheShutdown();
+
+/** 
+ * Add up the counters of all shards and readers into s and zero them, so
+ * each call reports what happened since the previous one.  peakMemory is
+ * not zeroed.  Must not be called from two threads at once.
+ * 
+ * @param s counters to add to
+ */
+void textureCacheGather( mrlTextureCacheStats& s );
+
+
+/** 
+ * Hash the tile table entry of a tile.
+ * 
+ * @param tile entry of the tile in its texture's tile table
+ * 
+ * @return hash, whose low bits select the shard
+ */
+inline unsigned long long textureHash( const mrlTileSlot* tile )
+{
+  unsigned long long h = (unsigned long long) (size_t) tile;
+  h = (h >> 3) * 0x9E3779B97F4A7C15ULL;
+  h ^= h >> 29;
+  h *= 0xBF58476D1CE4E5B9ULL;
+  h ^= h >> 32;
+  return h;
+}
+
+
+inline mrlTextureShard& textureShard( const unsigned long long hash )
+{
+  return textureShards[ hash & (kNumShards - 1) ];
+}
+
+
+/** 
+ * Count a hit on a block and mark the block as referenced.  Called with
+ * or without the shard locked.  Only the first hit on a prefetched block
+ * counts as a prefetch hit.  The block is only written to when its flags
+ * change, so its cache line stays shared by the threads reading it.
+ * 
+ * @param reader reader of the calling thread
+ * @param block  block found in its tile table
+ */
+inline void textureCountHit( mrlTextureReader& reader,
+			     mrlTextureBlock* block )
+{
+  ++reader.hits;
+  if ( block->prefetched && MR_ATOMIC_CAS( block->prefetched, 1, 0 ) )
+    ++reader.prefetchHits;
+  if ( !block->referenced ) block->referenced = true;
+}
+
+//! As above, for threads without a reader.
+inline void textureCountHit( mrlTextureShard& shard,
+			     mrlTextureBlock* block )
+{
+  MR_ATOMIC_INC64( shard.hits );
+  if ( block->prefetched && MR_ATOMIC_CAS( block->prefetched, 1, 0 ) )
+    MR_ATOMIC_INC64( shard.prefetchHits );
+  if ( !block->referenced ) block->referenced = true;
+}
+
+
+
+/**
+ * A texture whose tiles are kept in the texture cache.  Derived classes
+ * fill in the tiling of the texture, call initTiles() and read tiles in
+ * readTile().
+ * 
+ */
+class mrlTiledTexture
+{
+public:
+  mrlTiledTexture();
+  //! Releases all blocks of the texture.  Derived classes must make sure
+  //! nothing calls readTile() anymore before this runs.
+  virtual ~mrlTiledTexture();
+
+  //! Return the entry of a tile in the tile table of its level,
+  //! allocating the table if it is the first time the level is used.
+  mrlTileSlot* tileSlot( const int tileX, const int tileY,
+			 const int lx, const int ly )
+  {
+    mrlTileSlot* volatile& level = _levels[ ly * _numXLevels + lx ];
+    mrlTileSlot* tiles = level;
+    if ( tiles == NULL )
+      {
+	unsigned numTiles = _numXTiles[lx] * _numYTiles[ly];
+	tiles = new mrlTileSlot[numTiles];
+	for ( unsigned i = 0; i < numTiles; ++i )
+	  tiles[i] = NULL;
+
+	// Another thread may have allocated the table meanwhile
+	if ( ! MR_ATOMIC_CAS_PTR( level, (mrlTileSlot*) NULL, tiles ) )
+	  {
+	    delete [] tiles;
+	    tiles = level;
+	  }
+      }
+    return tiles + tileY * _numXTiles[lx] + tileX;
+  }
+
+  //! Return the block of a tile, loading it if needed.  The block stays
+  //! in memory until handed to release().  A thread may only hold one
+  //! block at a time.  Returns NULL if the tile could not be loaded.
+  mrlTextureBlock* acquire( const int tileX, const int tileY,
+			    const int lx, const int ly )
+  {
+    mrlTileSlot* tile = tileSlot( tileX, tileY, lx, ly );
+    mrlTextureReader* reader = textureReader();
+
+    // Fast path: tell the clock hand we are reading the block, and make
+    // sure it was not evicted before it could see that.  The barrier
+    // only touches our own reader, so threads do not slow each other.
+    mrlTextureBlock* block = *tile;
+    if ( block && block != kTileLoading )
+      {
+	if ( reader )
+	  {
+	    reader->reading = block;
+	    MR_MEMORY_BARRIER();
+	    if ( *tile == block )
+	      {
+		textureCountHit( *reader, block );
+		return block;
+	      }
+	    reader->reading = NULL;
+	  }
+	else
+	  {
+	    MR_ATOMIC_INC( block->pins );
+	    if ( *tile == block )
+	      {
+		textureCountHit( textureShard( textureHash( tile ) ), block );
+		return block;
+	      }
+	    MR_ATOMIC_DEC( block->pins );
+	  }
+      }
+
+    return acquireLocked( tile, reader, tileX, tileY, lx, ly );
+  }
+
+  static void release( mrlTextureBlock* block )
+  {
+    mrlTextureReader* reader = textureReader();
+    if ( reader )
+      {
+	// Reads of the block must be done before the clock hand sees it
+	// is free.  Stores are not moved ahead of loads on x86, so only
+	// the compiler needs to be told there.
+	MR_COMPILER_BARRIER();
+	reader->reading = NULL;
+      }
+    else
+      {
+	MR_ATOMIC_DEC( block->pins );
+      }
+  }
+
+  //! Load a tile ahead of it being needed, unless it is in memory or
+  //! being loaded already.  Used by the prefetch threads.
+  void preload( const int tileX, const int tileY, const int lx, const int ly );
+
+  unsigned numXLevels()  const { return _numXLevels; }
+  unsigned numYLevels()  const { return _numYLevels; }
+  unsigned numXTiles( const int lx ) const { return _numXTiles[lx]; }
+  unsigned numYTiles( const int ly ) const { return _numYTiles[ly]; }
+  unsigned tileXSize()   const { return _tileXSize; }
+  unsigned tileYSize()   const { return _tileYSize; }
+
+protected:
+  //! Allocate the tile tables, once _numXTiles, _numYTiles, the level
+  //! counts and the tile size are known.  texelSize is the size in bytes
+  //! of a texel of a tile.
+  void initTiles( const unsigned texelSize );
+
+  //! Read a tile into data, which holds _tileXSize * _tileYSize texels.
+  //! Called with no lock held, possibly from several threads at once for
+  //! different tiles.  Must not throw.
+  //!
+  //! @return false if the tile could not be read.
+  virtual bool readTile( void* data, const int tileX, const int tileY,
+			 const int lx, const int ly ) = 0;
+
+  //! Called after a lookup of a tile had to load it, with no lock held.
+  virtual void missed( const int tileX, const int tileY,
+		       const int lx, const int ly ) {}
+
+  //! Slow path of acquire(): lock the shard and wait for or load the tile.
+  mrlTextureBlock* acquireLocked( mrlTileSlot* tile,
+				  mrlTextureReader* reader,
+				  const int tileX, const int tileY,
+				  const int lx, const int ly );
+
+  mrlTextureBlock* loadBlock( mrlTextureShard& shard, mrlTileSlot* tile,
+			      const int x, const int y,
+			      const int lx, const int ly,
+			      const bool prefetch );
+
+  //! Tile table of each level, indexed by ly * _numXLevels + lx.
+  //! Each table is indexed by tileY * _numXTiles[lx] + tileX.
+  mrlTileSlot* volatile* _levels;
+  std::vector< unsigned > _numXTiles, _numYTiles;
+  unsigned _tileXSize, _tileYSize;
+  unsigned _numXLevels, _numYLevels;
+  unsigned _tileBytes;
+};
+
+
+#endif // mrlTextureCache_h
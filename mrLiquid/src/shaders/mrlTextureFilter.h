@@ -0,0 +1,524 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+
+/**
+ * @file   mrlTextureFilter.h
+ * @author gga
+ * 
+ * @brief  Filter kernels of mrl_exr_file: half to float conversion,
+ *         bilinear lookups, level blending and Heckbert's elliptical
+ *         weighted average.
+ *
+ *         Each kernel comes in a scalar and, when MRL_SSE2 is defined,
+ *         an SSE2 version.  The shader calls the unsuffixed version,
+ *         which is the SSE2 one when available.  Both are kept side by
+ *         side so tools/benchmarks/mrMipmapFilterBench can compare them.
+ *
+ *         Kernels are templates on the color type, which must have four
+ *         consecutive floats r, g, b and a, and on the texel fetch of a
+ *         level, which must provide:
+ *
+ *           void texel( Color& c, int x, int y );
+ *             texel (x, y), with x and y within the level.
+ *           void texel4( Color c[4], int x, int y );
+ *             texels (x, y), (x, y+1), (x+1, y) and (x+1, y+1), which
+ *             may lie outside the level.
+ *
+ *         Nothing here depends on mental ray or OpenEXR.
+ */
+
+#ifndef mrlTextureFilter_h
+#define mrlTextureFilter_h
+
+#include <cmath>
+
+
+// SSE2 is needed for the half to float conversion
+#if defined(MR_SSE) && ( defined(__SSE2__) || defined(_M_X64) || \
+			 ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 ) )
+#  define MRL_SSE2
+#  include <emmintrin.h>
+#endif
+
+
+#define WEIGHT_LUT_SIZE 1024
+
+//! Fill the table of EWA weights, a gaussian of r2 in [0,1].
+inline void mrlWeightLutInit( float* lut )
+{
+  for (int i = 0; i < WEIGHT_LUT_SIZE; ++i) {
+    float alpha = 2;
+    float r2 = float(i) / float(WEIGHT_LUT_SIZE - 1);
+    lut[i] = (float) exp(-alpha * r2);
+  }
+}
+
+//! Largest integer not greater than x
+inline int mrlFloor( const float x )
+{
+  int i = (int) x;
+  return x < (float) i ? i - 1 : i;
+}
+
+//! a mod b, positive for negative a
+inline int mrlMod( int a, const int b )
+{
+  a %= b;
+  return a < 0 ? a + b : a;
+}
+
+
+/**
+ * Ellipse of an EWA lookup in the texel coordinates of a level.  Texels
+ * (u, v) with r2 = A*U*U + B*U*V + C*V*V < 1, where U = u - s and
+ * V = v - t, are filtered.  [u0,u1] x [v0,v1] bounds the ellipse.
+ */
+struct mrlEllipse
+{
+  float s, t;
+  float A, B, C;
+  int u0, u1, v0, v1;
+};
+
+/** 
+ * Level of an EWA lookup.  Level 0 is the finest, and each level is
+ * half the size of the previous one.  The level picked has the minor
+ * axis of the ellipse about 3 texels long when filterWidth is 1.
+ * Ellipses more than 30 times longer than wide are treated as wider for
+ * this, so thin ones do not filter lots of texels.
+ * 
+ * @param dsdx  ds/dx of the pixel
+ * @param dtdx  dt/dx of the pixel
+ * @param dsdy  ds/dy of the pixel
+ * @param dtdy  dt/dy of the pixel
+ * @param width  width of level 0
+ * @param height height of level 0
+ * @param filterWidth scale of the level, smaller values pick finer levels
+ * 
+ * @return level, which can be negative or past the last level
+ */
+inline float mrlEwaLevel( const float dsdx, const float dtdx,
+			  const float dsdy, const float dtdy,
+			  const int width, const int height,
+			  const float filterWidth )
+{
+  float ux = dsdx * width,  vx = dtdx * height;
+  float uy = dsdy * width,  vy = dtdy * height;
+  float x2 = ux*ux + vx*vx;
+  float y2 = uy*uy + vy*vy;
+  float majorLength = sqrtf( x2 > y2 ? x2 : y2 );
+  float minorLength = sqrtf( x2 > y2 ? y2 : x2 );
+
+  const float maxEccentricity = 30;
+  if ( minorLength * maxEccentricity < majorLength )
+    minorLength = majorLength / maxEccentricity;
+  if ( minorLength <= 0.0f ) return 0.0f;
+
+  return filterWidth * (float) ( log( minorLength / 3.0f ) / log( 2.0 ) );
+}
+
+/** 
+ * Set up the ellipse of a lookup.
+ * 
+ * @param e     ellipse
+ * @param s     s coordinate of the lookup, in [0,1]
+ * @param t     t coordinate of the lookup, in [0,1]
+ * @param dsdx  ds/dx of the pixel
+ * @param dtdx  dt/dx of the pixel
+ * @param dsdy  ds/dy of the pixel
+ * @param dtdy  dt/dy of the pixel
+ * @param dw    width of the level
+ * @param dh    height of the level
+ */
+inline void mrlEllipseSetup( mrlEllipse& e, const float s, const float t,
+			     const float dsdx, const float dtdx,
+			     const float dsdy, const float dtdy,
+			     const int dw, const int dh )
+{
+  e.s = s * dw - 0.5f;
+  e.t = t * dh - 0.5f;
+
+  float ux = dsdx * dw;
+  float vx = dtdx * dh;
+  float uy = dsdy * dw;
+  float vy = dtdy * dh;
+
+  // compute ellipse coefficients to bound the region: 
+  // A*x*x + B*x*y + C*y*y = F.  The +1s make it at least a texel wide,
+  // and F at least 1, so it is always an ellipse.
+  float A = vx*vx + vy*vy + 1;
+  float B = -2.0f * (ux*vx + uy*vy);
+  float C = ux*ux + uy*uy + 1;
+  float invF = 1.0f / (A*C - B*B*0.25f);
+  e.A = A * invF;
+  e.B = B * invF;
+  e.C = C * invF;
+
+  // Compute the ellipse's (u,v) bounding box in texture space
+  float det = 4.0f * e.A * e.C - e.B * e.B;
+  float invDet = 1.0f / det;
+  float uSize = 2.0f * invDet * sqrtf( e.C * det );
+  float vSize = 2.0f * invDet * sqrtf( e.A * det );
+  e.u0 =  mrlFloor( e.s - uSize );
+  e.u1 = -mrlFloor( -( e.s + uSize ) );
+  e.v0 =  mrlFloor( e.t - vSize );
+  e.v1 = -mrlFloor( -( e.t + vSize ) );
+}
+
+
+//
+// Scalar kernels
+//
+
+//! Convert a half, given as its bits, to float.
+inline float mrlHalfToFloatScalar( const unsigned short h )
+{
+  union { unsigned i; float f; } o, magic;
+  unsigned expMant = h & 0x7fffu;
+  if ( expMant > 0x7bffu )
+    {
+      // inf or nan
+      o.i = 0x7f800000u | ( ( expMant & 0x3ffu ) << 13 );
+    }
+  else
+    {
+      // Shift exponent and mantissa into place and rebias the exponent
+      // with a multiply, which also turns denormals into float normals.
+      magic.i = (254 - 15) << 23;
+      o.i = expMant << 13;
+      o.f *= magic.f;
+    }
+  o.i |= ( h & 0x8000u ) << 16;
+  return o.f;
+}
+
+//! Convert the four halfs of an Imf::Rgba pixel to floats.
+template< class Color >
+inline void mrlHalfToFloatScalar( Color& c, const void* rgba )
+{
+  const unsigned short* h = (const unsigned short*) rgba;
+  c.r = mrlHalfToFloatScalar( h[0] );
+  c.g = mrlHalfToFloatScalar( h[1] );
+  c.b = mrlHalfToFloatScalar( h[2] );
+  c.a = mrlHalfToFloatScalar( h[3] );
+}
+
+//! Bilinear blend of the texels t (as returned by texel4) by ds, dt.
+template< class Color >
+inline void mrlBilinearScalar( Color& c, const Color t[4],
+			       const float ds, const float dt )
+{
+  float r0 = t[0].r + ( t[1].r - t[0].r ) * dt;
+  float g0 = t[0].g + ( t[1].g - t[0].g ) * dt;
+  float b0 = t[0].b + ( t[1].b - t[0].b ) * dt;
+  float a0 = t[0].a + ( t[1].a - t[0].a ) * dt;
+  float r1 = t[2].r + ( t[3].r - t[2].r ) * dt;
+  float g1 = t[2].g + ( t[3].g - t[2].g ) * dt;
+  float b1 = t[2].b + ( t[3].b - t[2].b ) * dt;
+  float a1 = t[2].a + ( t[3].a - t[2].a ) * dt;
+  c.r = r0 + ( r1 - r0 ) * ds;
+  c.g = g0 + ( g1 - g0 ) * ds;
+  c.b = b0 + ( b1 - b0 ) * ds;
+  c.a = a0 + ( a1 - a0 ) * ds;
+}
+
+//! Blend c towards c2, alpha included.
+template< class Color >
+inline void mrlBlendScalar( Color& c, const Color& c2, const float t )
+{
+  c.r += ( c2.r - c.r ) * t;
+  c.g += ( c2.g - c.g ) * t;
+  c.b += ( c2.b - c.b ) * t;
+  c.a += ( c2.a - c.a ) * t;
+}
+
+//! Offsets of the texels of a bilinear lookup at (xf, yf) in [0,1] of a
+//! level dw x dh texels.  Returns the first texel in x, y.
+inline void mrlBilinearSetup( int& x, int& y, float& ds, float& dt,
+			      const float xf, const float yf,
+			      const int dw, const int dh )
+{
+  ds = xf * dw - 0.5f;
+  dt = yf * dh - 0.5f;
+  x  = mrlFloor( ds );
+  y  = mrlFloor( dt );
+  ds -= x;
+  dt -= y;
+}
+
+//! Bilinear lookup at (xf, yf) in [0,1] of a level dw x dh texels.
+template< class Color, class Fetch >
+inline void mrlBlurScalar( Color& c, Fetch& fetch,
+			   const float xf, const float yf,
+			   const int dw, const int dh )
+{
+  int x, y;
+  float ds, dt;
+  mrlBilinearSetup( x, y, ds, dt, xf, yf, dw, dh );
+
+  Color tmp[4];
+  fetch.texel4( tmp, x, y );
+  mrlBilinearScalar( c, tmp, ds, dt );
+}
+
+//! Heckbert's elliptical weighted average of the texels of a level
+//! dw x dh within ellipse e, weighted by the table lut (see
+//! mrlWeightLutInit()).  Texels outside the level repeat.
+template< class Color, class Fetch >
+inline void mrlEwaScalar( Color& c, Fetch& fetch, const mrlEllipse& e,
+			  const int dw, const int dh, const float* lut )
+{
+  float den = 0.0f;
+  float r = 0.0f, g = 0.0f, b = 0.0f, a = 0.0f;
+  Color tmp;
+  for ( int v = e.v0; v <= e.v1; ++v )
+    {
+      float V  = v - e.t;
+      float BV = e.B * V;
+      float CVV = e.C * V * V;
+      int y = mrlMod( v, dh );
+      for ( int u = e.u0; u <= e.u1; ++u )
+	{
+	  float U  = u - e.s;
+	  float r2 = ( e.A * U + BV ) * U + CVV;
+	  if ( r2 >= 1.0f ) continue;
+	  if ( r2 < 0.0f ) r2 = 0.0f;
+
+	  float weight = lut[ (int) ( r2 * ( WEIGHT_LUT_SIZE - 1 ) ) ];
+	  fetch.texel( tmp, mrlMod( u, dw ), y );
+	  r   += tmp.r * weight;
+	  g   += tmp.g * weight;
+	  b   += tmp.b * weight;
+	  a   += tmp.a * weight;
+	  den += weight;
+	}
+    }
+
+  if ( den <= 0.0f )
+    {
+      c.r = c.g = c.b = c.a = 0.0f;
+      return;
+    }
+  float inv = 1.0f / den;
+  c.r = r * inv;
+  c.g = g * inv;
+  c.b = b * inv;
+  c.a = a * inv;
+}
+
+
+#ifdef MRL_SSE2
+//
+// SSE2 kernels
+//
+
+/** 
+ * Convert the four halfs of an Imf::Rgba pixel to floats.  Unlike half's
+ * operator float(), this does not go thru a 256K table, which trashes
+ * the cache when filtering many texels.
+ * 
+ * @param rgba pixel
+ * 
+ * @return r, g, b, a as floats
+ */
+inline __m128 mrlHalfToFloatSSE2( const void* rgba )
+{
+  __m128i h = _mm_loadl_epi64( (const __m128i*) rgba );
+  h = _mm_unpacklo_epi16( h, _mm_setzero_si128() );
+
+  // Same as mrlHalfToFloatScalar(), four at a time
+  const __m128i noSign = _mm_set1_epi32( 0x7fff );
+  const __m128  magic  = _mm_castsi128_ps( _mm_set1_epi32( (254 - 15) << 23 ) );
+  const __m128i maxFinite = _mm_set1_epi32( 0x7bff );
+  const __m128  infNan = _mm_castsi128_ps( _mm_set1_epi32( 255 << 23 ) );
+
+  __m128i expMant = _mm_and_si128( noSign, h );
+  __m128i sign    = _mm_slli_epi32( _mm_xor_si128( h, expMant ), 16 );
+  __m128  scaled  = _mm_mul_ps( _mm_castsi128_ps( _mm_slli_epi32( expMant, 13 ) ),
+				magic );
+  __m128  isInfNan = _mm_castsi128_ps( _mm_cmpgt_epi32( expMant, maxFinite ) );
+  __m128  signInf  = _mm_or_ps( _mm_castsi128_ps( sign ),
+				_mm_and_ps( isInfNan, infNan ) );
+  return _mm_or_ps( scaled, signInf );
+}
+
+template< class Color >
+inline void mrlHalfToFloatSSE2( Color& c, const void* rgba )
+{
+  _mm_storeu_ps( &c.r, mrlHalfToFloatSSE2( rgba ) );
+}
+
+template< class Color >
+inline void mrlBilinearSSE2( Color& c, const Color t[4],
+			     const float ds, const float dt )
+{
+  __m128 t0 = _mm_loadu_ps( &t[0].r );
+  __m128 t1 = _mm_loadu_ps( &t[1].r );
+  __m128 t2 = _mm_loadu_ps( &t[2].r );
+  __m128 t3 = _mm_loadu_ps( &t[3].r );
+  __m128 vt = _mm_set1_ps( dt );
+  t0 = _mm_add_ps( t0, _mm_mul_ps( _mm_sub_ps( t1, t0 ), vt ) );
+  t2 = _mm_add_ps( t2, _mm_mul_ps( _mm_sub_ps( t3, t2 ), vt ) );
+  t0 = _mm_add_ps( t0, _mm_mul_ps( _mm_sub_ps( t2, t0 ), 
+				   _mm_set1_ps( ds ) ) );
+  _mm_storeu_ps( &c.r, t0 );
+}
+
+template< class Color >
+inline void mrlBlendSSE2( Color& c, const Color& c2, const float t )
+{
+  __m128 a = _mm_loadu_ps( &c.r );
+  __m128 b = _mm_loadu_ps( &c2.r );
+  a = _mm_add_ps( a, _mm_mul_ps( _mm_sub_ps( b, a ), _mm_set1_ps( t ) ) );
+  _mm_storeu_ps( &c.r, a );
+}
+
+template< class Color, class Fetch >
+inline void mrlBlurSSE2( Color& c, Fetch& fetch,
+			 const float xf, const float yf,
+			 const int dw, const int dh )
+{
+  int x, y;
+  float ds, dt;
+  mrlBilinearSetup( x, y, ds, dt, xf, yf, dw, dh );
+
+  Color tmp[4];
+  fetch.texel4( tmp, x, y );
+  mrlBilinearSSE2( c, tmp, ds, dt );
+}
+
+//! As mrlEwaScalar(), testing four texels of a row against the ellipse
+//! at a time and summing the weighted texels in one register.
+template< class Color, class Fetch >
+inline void mrlEwaSSE2( Color& c, Fetch& fetch, const mrlEllipse& e,
+			const int dw, const int dh, const float* lut )
+{
+  const __m128 vA    = _mm_set1_ps( e.A );
+  const __m128 one   = _mm_set1_ps( 1.0f );
+  const __m128 zero  = _mm_setzero_ps();
+  const __m128 scale = _mm_set1_ps( WEIGHT_LUT_SIZE - 1 );
+  const __m128 steps = _mm_set_ps( 3.0f, 2.0f, 1.0f, 0.0f );
+  __m128 sum = _mm_setzero_ps();
+  float den = 0.0f;
+  int idx[4];
+  Color tmp;
+
+  for ( int v = e.v0; v <= e.v1; ++v )
+    {
+      float V = v - e.t;
+      __m128 BV  = _mm_set1_ps( e.B * V );
+      __m128 CVV = _mm_set1_ps( e.C * V * V );
+      int y = mrlMod( v, dh );
+
+      for ( int u = e.u0; u <= e.u1; u += 4 )
+	{
+	  __m128 U  = _mm_add_ps( _mm_set1_ps( u - e.s ), steps );
+	  __m128 r2 = _mm_add_ps( _mm_mul_ps( _mm_add_ps( _mm_mul_ps( vA, U ),
+							  BV ), U ), CVV );
+	  int inside = _mm_movemask_ps( _mm_cmplt_ps( r2, one ) );
+	  if ( e.u1 - u < 3 ) inside &= ( 1 << (e.u1 - u + 1) ) - 1;
+	  if ( !inside ) continue;
+
+	  r2 = _mm_mul_ps( _mm_max_ps( r2, zero ), scale );
+	  _mm_storeu_si128( (__m128i*) idx, _mm_cvttps_epi32( r2 ) );
+
+	  for ( int i = 0; i < 4; ++i )
+	    {
+	      if ( !( inside & (1 << i) ) ) continue;
+	      float weight = lut[ idx[i] ];
+	      fetch.texel( tmp, mrlMod( u + i, dw ), y );
+	      sum  = _mm_add_ps( sum, _mm_mul_ps( _mm_loadu_ps( &tmp.r ), 
+						  _mm_set1_ps( weight ) ) );
+	      den += weight;
+	    }
+	}
+    }
+
+  if ( den <= 0.0f )
+    {
+      c.r = c.g = c.b = c.a = 0.0f;
+      return;
+    }
+  _mm_storeu_ps( &c.r, _mm_mul_ps( sum, _mm_set1_ps( 1.0f / den ) ) );
+}
+#endif // MRL_SSE2
+
+
+//
+// Kernels used by the shader
+//
+
+template< class Color >
+inline void mrlHalfToFloat( Color& c, const void* rgba )
+{
+#ifdef MRL_SSE2
+  mrlHalfToFloatSSE2( c, rgba );
+#else
+  mrlHalfToFloatScalar( c, rgba );
+#endif
+}
+
+template< class Color >
+inline void mrlBlend( Color& c, const Color& c2, const float t )
+{
+#ifdef MRL_SSE2
+  mrlBlendSSE2( c, c2, t );
+#else
+  mrlBlendScalar( c, c2, t );
+#endif
+}
+
+template< class Color, class Fetch >
+inline void mrlBlur( Color& c, Fetch& fetch, const float xf, const float yf,
+		     const int dw, const int dh )
+{
+#ifdef MRL_SSE2
+  mrlBlurSSE2( c, fetch, xf, yf, dw, dh );
+#else
+  mrlBlurScalar( c, fetch, xf, yf, dw, dh );
+#endif
+}
+
+template< class Color, class Fetch >
+inline void mrlEwa( Color& c, Fetch& fetch, const mrlEllipse& e,
+		    const int dw, const int dh, const float* lut )
+{
+#ifdef MRL_SSE2
+  mrlEwaSSE2( c, fetch, e, dw, dh, lut );
+#else
+  mrlEwaScalar( c, fetch, e, dw, dh, lut );
+#endif
+}
+
+
+#endif // mrlTextureFilter_h
@@ -9,8 +9,12 @@
  */
 
 #include <sys/stat.h>
+#include <climits>
 
 #include <algorithm>
+#include <vector>
+#include <list>
+#include <map>
 
 #include "mrGenerics.h"
 #include "mrRayDifferentials.h"
@@ -33,7 +37,17 @@
 #include "ImfFrameBuffer.h"
 #include "ImfStringAttribute.h"
 
-// #define MR_ELLIPTIC_FILTER
+#ifndef mrlTextureCache_h
+#  include "mrlTextureCache.h"
+#endif
+
+#ifndef mrlTextureFilter_h
+#  include "mrlTextureFilter.h"
+#endif
+
+#if defined(WIN32) || defined(WIN64)
+#  include <process.h>
+#endif
 
 using namespace rsl;
 using namespace mr;
@@ -107,322 +121,372 @@ struct mrl_exr_file_t
 
 
 
-struct mrlTextureBlock;
+static miScalar* weightLut = NULL;
 
-namespace
+static void weightLutInit()
 {
-  miLock mMemFlushLock;
-  const unsigned maxFileDescriptors = 512;
-  miUint accessId = 0;
-  miUint memoryUsed = 0;
-  miUint memoryMax  = 0;
-  miUint numUsedBlocks = 0;
-  mrlTextureBlock*  usedBlocks = NULL;
-  mrlTextureBlock*  freeBlocks = NULL;
-}
+  if ( weightLut ) return;
 
+  weightLut = new miScalar[WEIGHT_LUT_SIZE];
+  mrlWeightLutInit( weightLut );
+}
 
-/**
- * This struct holds a texture block.
- * 
- */
-struct mrlTextureBlock
+void weightLutRelease()
 {
-  mrlTextureBlock() :
-    access( accessId ),
-    next( NULL ),
-    size( 0 ),
-    data( NULL )
-  {
-  }
+  delete [] weightLut;
+  weightLut = NULL;
+}
+
 
-  miUint access;           //<- last access 'time' of texture block
-  mrlTextureBlock* next;   //<- next block in list
-  unsigned size;           //<- size of the data
-  void*    data;           //<- actual texture data
-};
 
+class exrTexture;
 
 
 /**
- * Functor used to sort texture blocks by last reference number.
+ * An open EXR file of a texture.
  * 
  */
-struct latestBlock
+struct mrlFileDescriptor
 {
-  inline
-  bool operator()( const mrlTextureBlock* a, const mrlTextureBlock* b ) const
-  {
-    return ( a->access < b->access );
-  }
+  const exrTexture*         owner;
+  Imf::TiledRgbaInputFile*  in;
 };
 
+typedef std::list< mrlFileDescriptor > FileDescriptorList;
+typedef std::multimap< const exrTexture*, 
+		       FileDescriptorList::iterator > FileDescriptors;
+
+namespace
+{
+  //! True between textureInit() and textureShutdown().
+  bool     cacheReady = false;
+  //! Protects all the file descriptor variables below.
+  miLock   fdLock;
+  //! Maximum number of EXR files kept open (MRL_TEXTURE_FILES).
+  unsigned maxFileDescriptors = 512;
+  //! Number of EXR files open, idle or checked out.
+  unsigned numFileDescriptors = 0;
+  //! Idle files, most recently used first.
+  FileDescriptorList idleFiles;
+  //! Idle files of each texture.
+  FileDescriptors    fileDescriptors;
+}
+
 
 /** 
- * Delete a texture block's data
+ * Close the least recently used idle file.  fdLock must be locked.
  * 
- * @param block Texture block to delete.
  */
-static void textureDeleteBlock(mrlTextureBlock* block)
+static void textureCloseFileDescriptor()
 {
-  mrlTextureBlock* p = NULL;
-  mrlTextureBlock* c = usedBlocks;
-  for ( ; c != NULL; p = c, c = c->next )
-    {
-      if ( c != block ) continue;
-
-      if ( p )
-	{
-	  p->next = c->next;
-	}
-      else
-	{
-	  usedBlocks = c->next;
-	}
-
-      if ( c->data )
-	{
-	  memoryUsed -= c->size;
-	  mi_mem_release( c->data );
-	  c->data = NULL;
-	}
+  FileDescriptorList::iterator last = --idleFiles.end();
 
-      --numUsedBlocks;
-      c->next = freeBlocks;
-      freeBlocks = c;
+  FileDescriptors::iterator i = fileDescriptors.lower_bound( last->owner );
+  for ( ; i->second != last; ++i ) ;
+  fileDescriptors.erase( i );
 
-      return;
-    }
+  delete last->in;
+  idleFiles.erase( last );
+  --numFileDescriptors;
 }
 
 
 /** 
- * Flush texture blocks from memory to leave room for new block.
+ * Get an open file of a texture for the exclusive use of the caller,
+ * who must hand it back with textureCheckinFileDescriptor().  
+ * An idle file of the texture is reused if possible.  Otherwise, the file
+ * is opened, closing the least recently used idle file if
+ * maxFileDescriptors are open.  If all open files are checked out, the
+ * limit is exceeded until they are returned.
  * 
- * @param entry new block to allocate
+ * @param txt      texture
+ * @param filename texture's filename
  * 
- * @return true if memory was flushed, false if not.
+ * @return open file.  Throws if the file cannot be opened.
  */
-static bool textureMemFlush(mrlTextureBlock* current) 
+static Imf::TiledRgbaInputFile* 
+textureCheckoutFileDescriptor( const exrTexture* txt, const char* filename )
 {
-  bool ret = false;
-  mrlTextureBlock** blockPtr;
-  mrlTextureBlock** blockList;
-  mrlTextureBlock* c = usedBlocks;
-
-  ++gStats->textureFlushes;
-
-  mi_lock( mMemFlushLock );
-
-//   // Count the number of used blocks
-//   unsigned num = 0;
-//   for ( ; c != NULL; c = c->next )
-//     {
-//       if ( c != current ) ++num;
-//     }
-
-  // Allocate a new temporary block list
-  blockList = (mrlTextureBlock**) mi_mem_allocate( numUsedBlocks * 
-						   sizeof( mrlTextureBlock* ) );
-  if ( blockList == NULL ) {
-    mi_warning("mrl_exr_file: could not allocate temporary block buffer for texture flush");
-
-    // Flush all the used blocks in panic mode
-    while(usedBlocks != NULL)
-      textureDeleteBlock(usedBlocks);
-    return true;
-  }
+  mi_lock( fdLock );
 
-  // Copy all blocks but current block to it
-  mrlTextureBlock** lastBlock = blockList;
-  for ( c = usedBlocks; c != NULL; c = c->next )
+  FileDescriptors::iterator i = fileDescriptors.find( txt );
+  if ( i != fileDescriptors.end() )
     {
-      *lastBlock = c; ++lastBlock;
+      Imf::TiledRgbaInputFile* ret = i->second->in;
+      idleFiles.erase( i->second );
+      fileDescriptors.erase( i );
+      mi_unlock( fdLock );
+      return ret;
     }
 
-  if ( numUsedBlocks > 1 )
+  if ( numFileDescriptors >= maxFileDescriptors && !idleFiles.empty() )
+    textureCloseFileDescriptor();
+  ++numFileDescriptors;
+
+  mi_unlock( fdLock );
+
+  try
     {
-      // Sort on temporary block list based on access times
-      std::sort( blockList, blockList + numUsedBlocks, latestBlock() );
+      return new Imf::TiledRgbaInputFile( filename );
     }
-
-  // Flush the used blocks until we have enough memory
-  bool flushed = false;
-  for ( blockPtr = blockList; blockPtr < lastBlock; ++blockPtr )
+  catch( ... )
     {
-      if ( *blockPtr == current ) continue;
-
-      flushed = true;
-      c = *blockPtr;
-      mi_mem_release( c->data );
-      c->data = NULL;
-      memoryUsed -= c->size;
-      
-      if ( memoryUsed <= (memoryMax / 2) ) break;
+      mi_lock( fdLock );
+      --numFileDescriptors;
+      mi_unlock( fdLock );
+      throw;
     }
-   
-  // Release the temporary block list we used for sorting by access times
-  mi_mem_release( blockList );
+}
+
+
+/** 
+ * Return a file obtained with textureCheckoutFileDescriptor() to the
+ * idle files.
+ * 
+ * @param txt texture
+ * @param in  open file of texture
+ */
+static void textureCheckinFileDescriptor( const exrTexture* txt,
+					  Imf::TiledRgbaInputFile* in )
+{
+  mi_lock( fdLock );
+
+  mrlFileDescriptor fd;
+  fd.owner = txt;
+  fd.in    = in;
+  idleFiles.push_front( fd );
+  fileDescriptors.insert( std::make_pair( txt, idleFiles.begin() ) );
 
-  mi_unlock( mMemFlushLock );
+  while ( numFileDescriptors > maxFileDescriptors && !idleFiles.empty() )
+    textureCloseFileDescriptor();
 
-  return flushed;
+  mi_unlock( fdLock );
 }
 
 
 /** 
- * Allocate a new texture block
+ * Close all idle files of a texture.
  * 
- * @param entry 
+ * @param txt texture
  */
-static void	textureAllocateBlock(mrlTextureBlock* c)
+static void textureDeleteFileDescriptor( const exrTexture* txt )
 {
-  int s = c->size;
-  memoryUsed += s;
-  gStats->transferredTextureData += s;
-
-  if ( memoryUsed > memoryMax )
-    {
-      if ( ! textureMemFlush( c ) )
-	{
-	  mi_warning("mrl_exr_file: Could not flush texture blocks");
-	}
-    }
+  mi_lock( fdLock );
 
-  c->data = mi_mem_allocate( s * sizeof( unsigned char ) );
-  if ( c->data == NULL )
+  std::pair< FileDescriptors::iterator, FileDescriptors::iterator > r;
+  r = fileDescriptors.equal_range( txt );
+  for ( FileDescriptors::iterator i = r.first; i != r.second; ++i )
     {
-      mi_error("mrl_exr_file: Could not allocate memory for pixels");
+      delete i->second->in;
+      idleFiles.erase( i->second );
+      --numFileDescriptors;
     }
+  fileDescriptors.erase( r.first, r.second );
 
-  if ( memoryUsed > gStats->peakTextureMemory )
-    gStats->peakTextureMemory = memoryUsed;
+  mi_unlock( fdLock );
 }
 
 
-
 /** 
- * Load a new EXR texture block
+ * Close all idle files.
  * 
- * @param entry mrlTextureBlock* to place data into
- * @param name  EXR filename to load block from
- * @param x     tileX number
- * @param y     tileY number
- * @param lx    LOD level X
- * @param ly    LOD level Y
  */
-static void	textureLoadBlock(
-				 mrlTextureBlock *entry,
-				 Imf::TiledRgbaInputFile& in,
-				 const int x, const int y,
-				 const int lx, const int ly
-				 )
+static void textureDeleteFileDescriptors()
 {
-  // Update the stats
-  ++gStats->numTextureMisses;
-  
+  mi_lock( fdLock );
+  while ( !idleFiles.empty() )
+    textureCloseFileDescriptor();
+  mi_unlock( fdLock );
+}
 
-  try 
-    {
-      mrASSERT( lx < in.numXLevels() );
-      mrASSERT( ly < in.numYLevels() );
-      
-      Imath::Box2i dataWindow = in.dataWindowForLevel(lx, ly);
-      
-      int dw = dataWindow.max.x - dataWindow.min.x + 1;
-      int dh = dataWindow.max.y - dataWindow.min.y + 1;
-      int dx = dataWindow.min.x;
-      int dy = dataWindow.min.y;
-      
-      unsigned tileXSize = in.tileXSize();
-      unsigned tileYSize = in.tileYSize();
 
+/**
+ * A tile to be loaded by the prefetch threads.
+ * 
+ */
+struct mrlPrefetchRequest
+{
+  exrTexture* txt;
+  int x, y, lx, ly;
+};
+
+namespace
+{
+  //! Maximum number of tiles waiting to be prefetched.  Requests made
+  //! while the queue is full are dropped.
+  const unsigned kPrefetchQueueSize   = 4096;
+  const unsigned kMaxPrefetchThreads  = 32;
+
+  //! Requests, a ring buffer protected by prefetchLock
+  mrlPrefetchRequest prefetchQueue[kPrefetchQueueSize];
+  unsigned prefetchHead = 0;
+  unsigned prefetchSize = 0;
+  unsigned peakPrefetchSize = 0;
+  miUlong  prefetchDropped  = 0;
+  bool     prefetchQuit = false;
+
+  //! Texture each prefetch thread is loading a tile of, if any
+  const exrTexture* prefetchActive[kMaxPrefetchThreads];
+  unsigned numPrefetchThreads = 0;
 
-      entry->size = tileXSize * tileYSize * sizeof( Imf::Rgba );
+#if defined(WIN32) || defined(WIN64)
+  CRITICAL_SECTION prefetchLock;
+  HANDLE           prefetchWake;  //<- semaphore posted for each request
+  HANDLE           prefetchThreads[kMaxPrefetchThreads];
+#else
+  pthread_mutex_t  prefetchLock;
+  pthread_cond_t   prefetchWake;
+  pthread_t        prefetchThreads[kMaxPrefetchThreads];
+#endif
+}
 
-      textureAllocateBlock( entry );
 
-      Imf::Rgba* pixels = static_cast< Imf::Rgba* >( entry->data );
-      if ( pixels != NULL ) 
-	{
-	  unsigned offset = dx + (x + y * tileYSize + dy) * tileXSize;
-	  in.setFrameBuffer( pixels - offset, 1, tileXSize );
-	  in.readTile( x, y, lx, ly );
-	}
-    } 
-  catch( const std::exception& e )
-    {
-      mi_error("mrl_exr_file: %s", e.what() );
-    }
+#if defined(WIN32) || defined(WIN64)
 
-   entry->access = accessId;
+static inline void prefetchLockQueue()   { EnterCriticalSection( &prefetchLock ); }
+static inline void prefetchUnlockQueue() { LeaveCriticalSection( &prefetchLock ); }
+static inline void prefetchSignal( unsigned n ) 
+{
+  ReleaseSemaphore( prefetchWake, n, NULL );
+}
+//! Wait for a request.  Queue must be locked, and is locked on return.
+static inline void prefetchWait()
+{
+  LeaveCriticalSection( &prefetchLock );
+  WaitForSingleObject( prefetchWake, INFINITE );
+  EnterCriticalSection( &prefetchLock );
 }
+static inline void prefetchYield() { SwitchToThread(); }
+
+#else
+
+static inline void prefetchLockQueue()   { pthread_mutex_lock( &prefetchLock ); }
+static inline void prefetchUnlockQueue() { pthread_mutex_unlock( &prefetchLock ); }
+static inline void prefetchSignal( unsigned n ) 
+{
+  if ( n == 1 ) pthread_cond_signal( &prefetchWake );
+  else          pthread_cond_broadcast( &prefetchWake );
+}
+//! Wait for a request.  Queue must be locked, and is locked on return.
+static inline void prefetchWait()
+{
+  pthread_cond_wait( &prefetchWake, &prefetchLock );
+}
+static inline void prefetchYield() { sched_yield(); }
+
+#endif
 
 
 /** 
- * Create a new texture block.
+ * Queue the tiles of a texture to be loaded by the prefetch threads.
  * 
- * @return new mrlTextureBlock*
+ * @param txt  texture
+ * @param reqs tiles to load
+ * @param num  number of tiles
  */
-static mrlTextureBlock*	textureNewBlock() 
+static void texturePrefetch( exrTexture* txt,
+			     mrlPrefetchRequest* reqs, const unsigned num )
 {
-   mrlTextureBlock* block;
-   if (freeBlocks != NULL)
-     {
-       block = freeBlocks;
-       freeBlocks = block->next;
-     }
-   else
-     {
-       block = new mrlTextureBlock;
-     }
+  if ( numPrefetchThreads == 0 || num == 0 ) return;
 
-   block->next = usedBlocks;
-   usedBlocks  = block;
-   ++numUsedBlocks;
+  unsigned queued = 0;
+  prefetchLockQueue();
+  for ( unsigned i = 0; i < num; ++i )
+    {
+      if ( prefetchSize == kPrefetchQueueSize )
+	{
+	  prefetchDropped += num - i;
+	  break;
+	}
+      unsigned idx = (prefetchHead + prefetchSize) % kPrefetchQueueSize;
+      prefetchQueue[idx] = reqs[i];
+      prefetchQueue[idx].txt = txt;
+      ++prefetchSize;
+      ++queued;
+    }
+  if ( prefetchSize > peakPrefetchSize ) peakPrefetchSize = prefetchSize;
+  prefetchUnlockQueue();
 
-   return block;
+  if ( queued ) prefetchSignal( queued );
 }
 
 
-class exrTexture;
+/** 
+ * Drop the queued tiles of a texture and wait for the prefetch threads
+ * to be done with it.
+ * 
+ * @param txt texture about to be deleted
+ */
+static void texturePrefetchCancel( const exrTexture* txt )
+{
+  if ( numPrefetchThreads == 0 ) return;
 
-typedef std::map< const exrTexture*, Imf::TiledRgbaInputFile* > FileDescriptors;
-static FileDescriptors fileDescriptors;
+  prefetchLockQueue();
 
+  unsigned kept = 0;
+  for ( unsigned i = 0; i < prefetchSize; ++i )
+    {
+      const mrlPrefetchRequest& r = 
+	prefetchQueue[ (prefetchHead + i) % kPrefetchQueueSize ];
+      if ( r.txt == txt ) continue;
+      prefetchQueue[ (prefetchHead + kept) % kPrefetchQueueSize ] = r;
+      ++kept;
+    }
+  prefetchSize = kept;
 
-static void textureDeleteFileDescriptor(const exrTexture* exr )
-{
-  FileDescriptors::iterator i = fileDescriptors.find( exr );
-  FileDescriptors::iterator e = fileDescriptors.end();
-  if ( i != e )
+  for (;;)
     {
-      delete i->second;
-      fileDescriptors.erase( i );
+      unsigned i = 0;
+      for ( ; i < numPrefetchThreads; ++i )
+	if ( prefetchActive[i] == txt ) break;
+      if ( i == numPrefetchThreads ) break;
+
+      prefetchUnlockQueue();
+      prefetchYield();
+      prefetchLockQueue();
     }
+
+  prefetchUnlockQueue();
 }
 
-static void textureDeleteFileDescriptors()
+
+
+/** 
+ * Add up the counters of all shards into the texture statistics.
+ * 
+ */
+static void textureGatherStats()
 {
-  FileDescriptors::iterator i = fileDescriptors.begin();
-  FileDescriptors::iterator e = fileDescriptors.end();
-  for ( ; i != e; ++i )
-    {
-      delete i->second;
-    }
-  fileDescriptors.clear();
+  mrlTextureCacheStats c;
+  memset( &c, 0, sizeof(c) );
+  textureCacheGather( c );
+
+  gStats->numTextureHits         += c.hits;
+  gStats->numTextureMisses       += c.misses;
+  gStats->textureEvictions       += c.evictions;
+  gStats->textureFlushes         += c.sweeps;
+  gStats->transferredTextureData += c.transferred;
+  gStats->texturePrefetches      += c.prefetches;
+  gStats->texturePrefetchHits    += c.prefetchHits;
+  if ( c.peakMemory > gStats->peakTextureMemory )
+    gStats->peakTextureMemory = c.peakMemory;
+
+  if ( numPrefetchThreads == 0 ) return;
+
+  prefetchLockQueue();
+  gStats->texturePrefetchDropped += prefetchDropped;
+  if ( peakPrefetchSize > gStats->peakPrefetchQueue )
+    gStats->peakPrefetchQueue = peakPrefetchSize;
+  prefetchDropped = 0;
+  prefetchUnlockQueue();
 }
 
-static Imf::TiledRgbaInputFile* 
-textureGetFileDescriptor( const exrTexture* txt );
 
 
 
-class exrTexture
+class exrTexture : public mrlTiledTexture
 {
 protected:
-  typedef std::map< unsigned long long, mrlTextureBlock* > DataBlocks;
-
   enum WrapMode
     {
       kBlack,
@@ -441,8 +505,39 @@ public:
     if (gStats->numTextures > gStats->numPeakTextures)
       gStats->numPeakTextures = gStats->numTextures;
 
-    Imf::TiledRgbaInputFile& in = *(textureGetFileDescriptor( this ));
+    Imf::TiledRgbaInputFile* file = textureCheckoutFileDescriptor( this, 
+								   filename );
+    try
+      {
+	readHeader( *file );
+      }
+    catch( ... )
+      {
+	// Do not leave an idle file behind for a texture that never existed.
+	textureCheckinFileDescriptor( this, file );
+	textureDeleteFileDescriptor( this );
+	free( _name );
+	throw;
+      }
+    textureCheckinFileDescriptor( this, file );
+
+    initTiles( sizeof( Imf::Rgba ) );
+  }
+
+  ~exrTexture() 
+  {
+    // Prefetch threads check their file back in when done with a tile,
+    // so the idle files can only be closed once they are stopped.
+    // mrlTiledTexture releases the blocks of the texture afterwards.
+    texturePrefetchCancel( this );
+    textureDeleteFileDescriptor( this );
+    free( _name );
+  }
 
+protected:
+  //! Read the size, tiling and wrap modes of the texture from its file.
+  void readHeader( Imf::TiledRgbaInputFile& in )
+  {
     const Imf::Header& h = in.header();
     Imf::Header::ConstIterator i = h.find("wrapmodes");
     if ( i != h.end() )
@@ -469,20 +564,16 @@ public:
     _tileYSize = in.tileYSize();
     _numXLevels = in.numXLevels();
     _numYLevels = in.numYLevels();
-  }
-
-  ~exrTexture() 
-  {
-    DataBlocks::iterator i = _datablocks.begin();
-    DataBlocks::iterator e = _datablocks.end();
-    for ( ; i != e; ++i )
-      {
-	textureDeleteBlock( i->second );
-      }
 
-    free( _name );
+    _numXTiles.resize( _numXLevels );
+    for ( unsigned i = 0; i < _numXLevels; ++i )
+      _numXTiles[i] = in.numXTiles( i );
+    _numYTiles.resize( _numYLevels );
+    for ( unsigned i = 0; i < _numYLevels; ++i )
+      _numYTiles[i] = in.numYTiles( i );
   }
 
+public:
   WrapMode wrapmode( const char* s )
   {
     if ( strncmp( s, "black", 5 ) == 0 )
@@ -501,28 +592,109 @@ public:
 	      const miScalar xf, const miScalar yf,
 	      const int lx, const int ly )
   {
-    // Calculate pixel coordinate for level
-    int dw = _width  / (1 << lx);
-    int dh = _height / (1 << ly);
-    miScalar ds = xf * dw - 0.5f;
-    miScalar dt = yf * dh - 0.5f;
+    LevelFetch fetch( this, lx, ly );
+    mrlBlur( c, fetch, xf, yf, _width / (1 << lx), _height / (1 << ly) );
+  }
 
-    int  x = mr::fastmath<miScalar>::floor(ds);
-    int  y = mr::fastmath<miScalar>::floor(dt);
+  //! Blend the nearest texel lookups of two levels the way mrl_exr_file
+  //! always has.  Colors get blended twice, which pulls them towards the
+  //! coarser level, but changing it would change the look of old scenes.
+  static void blendNearest( color& c, color& c2, miScalar frac )
+  {
+    c = mix( c, c2, frac );
+    c2   *= frac;
+    c2.a *= frac;
+    frac  = 1.0f - frac;
+    c    *= frac;
+    c.a  *= frac;
+    c    += c2;
+    c.a  += c2.a;
+  }
 
-    ds -= x;
-    dt -= y;
+  //! Mipmap (or ripmap if isotropic is false) lookup with the nearest
+  //! texel of each level.  Level 0 alone is looked up bilinearly.
+  void  mipmapNearest( color& c, const miScalar s, const miScalar t,
+		       const miScalar lodX, const miScalar lodY,
+		       const int lx, const int ly, const bool isotropic )
+  {
+    if ( lx == 0 && ly == 0 )
+      {
+	blur( c, s, t, 0, 0 );
+	return;
+      }
 
-    color tmp[4];
-    texel( tmp[0], x,   y, lx, ly );
-    texel( tmp[1], x,   y+1, lx, ly );
-    texel( tmp[2], x+1, y, lx, ly );
-    texel( tmp[3], x+1, y+1, lx, ly );
+    lookup( c, s, t, lx, ly );
 
-    c = mix( mix( tmp[0], tmp[1], dt ),
-	     mix( tmp[2], tmp[3], dt ), ds );
-    c.a = mix( mix( tmp[0].a, tmp[1].a, dt ),
-	       mix( tmp[2].a, tmp[3].a, dt ), ds );
+    color c2( kNoInit );
+    if ( isotropic )
+      {
+	miScalar frac = lodX - lx;
+	if ( frac > 0.005f && lx + 1 < (int)_numXLevels && 
+	     ly + 1 < (int)_numYLevels )
+	  {
+	    lookup( c2, s, t, lx + 1, ly + 1 );
+	    blendNearest( c, c2, frac );
+	  }
+	return;
+      }
+
+    miScalar frac = lodX - lx;
+    if ( frac > 0.005f && lx + 1 < (int)_numXLevels )
+      {
+	lookup( c2, s, t, lx + 1, ly );
+	blendNearest( c, c2, frac );
+      }
+    frac = lodY - ly;
+    if ( frac > 0.005f && ly + 1 < (int)_numYLevels )
+      {
+	lookup( c2, s, t, lx, ly + 1 );
+	blendNearest( c, c2, frac );
+      }
+  }
+
+  //! Mipmap (or ripmap if isotropic is false) lookup, bilinear on each
+  //! level and blended once across levels.  Lods between 0 and 1 blend
+  //! with level 1 too.  Ripmaps blend the next X and next Y levels by
+  //! their own fractions.
+  void  mipmapTrilinear( color& c, const miScalar s, const miScalar t,
+			 const miScalar lodX, const miScalar lodY,
+			 const int lx, const int ly, const bool isotropic )
+  {
+    blur( c, s, t, lx, ly );
+
+    color c2( kNoInit );
+    if ( isotropic )
+      {
+	miScalar frac = lodX - lx;
+	if ( frac > 0.005f && lx + 1 < (int)_numXLevels && 
+	     ly + 1 < (int)_numYLevels )
+	  {
+	    blur( c2, s, t, lx + 1, ly + 1 );
+	    mrlBlend( c, c2, frac );
+	  }
+	return;
+      }
+
+    miScalar fracX = lodX - lx;
+    miScalar fracY = lodY - ly;
+    if ( fracX > 0.005f && lx + 1 < (int)_numXLevels )
+      {
+	blur( c2, s, t, lx + 1, ly );
+	mrlBlend( c, c2, fracX );
+      }
+    if ( fracY > 0.005f && ly + 1 < (int)_numYLevels )
+      {
+	blur( c2, s, t, lx, ly + 1 );
+	mrlBlend( c, c2, fracY );
+      }
+  }
+
+  //! Heckbert's elliptical weighted average of the texels of a level
+  //! within ellipse e.  Texels outside the level repeat.
+  void  ewa( color& c, const mrlEllipse& e, const int lx, const int ly )
+  {
+    LevelFetch fetch( this, lx, ly );
+    mrlEwa( c, fetch, e, _width / (1 << lx), _height / (1 << ly), weightLut );
   }
 
   void  lookup( color& c, 
@@ -540,9 +712,6 @@ public:
     texel( c, x, y, lx, ly );
   }
 
-  unsigned numXLevels()  const { return _numXLevels; }
-  unsigned numYLevels()  const { return _numYLevels; }
-
   const char* filename() const { return _name; }
 
   int width()  const { return _width; }
@@ -556,220 +725,389 @@ public:
 
 
 protected:
-  void texel( color& c, int x, int y,
-	      const int lx, const int ly )
-  {   
-    ++accessId;
-    ++(gStats->numTextureAccesses);
+  //! Texels of a level, as the kernels of mrlTextureFilter.h fetch them
+  struct LevelFetch
+  {
+    exrTexture* txt;
+    int lx, ly;
 
-    // Handle wrapping modes
-    int dw = _width  / (1 << lx);
-    int dh = _height / (1 << ly);
+    LevelFetch( exrTexture* t, const int x, const int y ) :
+    txt( t ), lx( x ), ly( y )
+    {
+    }
+
+    void texel( color& c, const int x, const int y )
+    {
+      txt->texel( c, x, y, lx, ly );
+    }
+
+    void texel4( color c[4], const int x, const int y )
+    {
+      txt->texel4( c, x, y, lx, ly );
+    }
+  };
+  friend struct LevelFetch;
 
-    switch( _wrapX )
+  //! Apply a wrap mode to a coordinate of a level of size d.  Returns
+  //! false if the texel is black.
+  static bool wrap( int& x, const int d, const WrapMode mode )
+  {
+    switch( mode )
       {
       case kBlack:
-	if ( x < 0 || x >= dw ) 
-	  {
-	    c = 0; return;
-	  }
+	if ( x < 0 || x >= d ) return false;
 	break;
       case kClamp:
 	if ( x < 0 ) x = 0;
-	else if ( x >= dw ) x = dw - 1;
+	else if ( x >= d ) x = d - 1;
 	break;
       case kPeriodic:
-	x = mr::mod( x, dw );
+	x = mr::mod( x, d );
 	break;
       case kMirror:
 	if ( x < 0 )        x = abs(x);
-	else if ( x >= dw ) x = dw - (x - dw) - 1;
+	else if ( x >= d ) x = d - (x - d) - 1;
 	break;
       default:
-	mi_fatal("Unknown wrap mode for U");
+	mi_fatal("Unknown wrap mode");
       }
+    return true;
+  }
+
+  void texel( color& c, int x, int y,
+	      const int lx, const int ly )
+  {   
+    ++(gStats->numTextureAccesses);
+
+    // Handle wrapping modes
+    int dw = _width  / (1 << lx);
+    int dh = _height / (1 << ly);
 
-    switch( _wrapY )
+    if ( !wrap( x, dw, _wrapX ) || !wrap( y, dh, _wrapY ) )
       {
-      case kBlack:
-	if ( y < 0 || y >= dh ) 
-	  {
-	    c = 0; return;
-	  }
-	break;
-      case kClamp:
-	if ( y < 0 ) y = 0;
-	else if ( y >= dh ) y = dh - 1;
-	break;
-      case kPeriodic:
-	y = mr::mod( y, dh );
-	break;
-      case kMirror:
-	if ( y < 0 )        y = abs(y);
-	else if ( y >= dh ) y = dh - (y - dh) - 1;
-	break;
-      default:
-	mi_fatal("Unknown wrap mode for V");
+	c.r = c.g = c.b = c.a = 0.0f;
+	return;
       }
 
-
     // Calculate tileX and tileY value
     int tileX = x / _tileXSize;
     int tileY = y / _tileYSize;
 
-    unsigned long long key = hash_key( tileX, tileY, lx, ly );
-    DataBlocks::iterator e = _datablocks.end();
-    DataBlocks::iterator i = _datablocks.find( key );
+    x -= tileX * _tileXSize;
+    y -= tileY * _tileYSize;
 
-    mrlTextureBlock* block;
-    if ( i == e )
+    mrlTextureBlock* block = acquire( tileX, tileY, lx, ly );
+    if ( block == NULL ) 
       {
-	// block not created
-	block = textureNewBlock();
-	_datablocks.insert( std::make_pair( key, block ) );
+	c.r = c.g = c.b = c.a = 0.0f;
+	return;
       }
-    else
+
+    read( c, block, y * _tileXSize + x );
+    release( block );
+  }
+
+  //! Fetch the texels (x, y), (x, y+1), (x+1, y) and (x+1, y+1).  When
+  //! they all lie in one tile, as they mostly do, the tile is looked up
+  //! only once.
+  void texel4( color c[4], const int x, const int y,
+	       const int lx, const int ly )
+  {
+    int dw = _width  / (1 << lx);
+    int dh = _height / (1 << ly);
+
+    int x0 = x, x1 = x + 1, y0 = y, y1 = y + 1;
+    if ( wrap( x0, dw, _wrapX ) && wrap( x1, dw, _wrapX ) &&
+	 wrap( y0, dh, _wrapY ) && wrap( y1, dh, _wrapY ) )
       {
-	block = i->second;
+	int tileX = x0 / _tileXSize;
+	int tileY = y0 / _tileYSize;
+	if ( x1 / _tileXSize == (unsigned) tileX && 
+	     y1 / _tileYSize == (unsigned) tileY )
+	  {
+	    gStats->numTextureAccesses += 4;
+
+	    mrlTextureBlock* block = acquire( tileX, tileY, lx, ly );
+	    if ( block == NULL )
+	      {
+		for ( int i = 0; i < 4; ++i )
+		  c[i].r = c[i].g = c[i].b = c[i].a = 0.0f;
+		return;
+	      }
+
+	    x0 -= tileX * _tileXSize;  x1 -= tileX * _tileXSize;
+	    y0 -= tileY * _tileYSize;  y1 -= tileY * _tileYSize;
+	    read( c[0], block, y0 * _tileXSize + x0 );
+	    read( c[1], block, y1 * _tileXSize + x0 );
+	    read( c[2], block, y0 * _tileXSize + x1 );
+	    read( c[3], block, y1 * _tileXSize + x1 );
+	    release( block );
+	    return;
+	  }
       }
 
-    if ( block->data == NULL )
+    texel( c[0], x,   y,   lx, ly );
+    texel( c[1], x,   y+1, lx, ly );
+    texel( c[2], x+1, y,   lx, ly );
+    texel( c[3], x+1, y+1, lx, ly );
+  }
+
+  //! Read a tile with a file of the texture checked out of the pool.
+  virtual bool readTile( void* data, const int x, const int y,
+			 const int lx, const int ly )
+  {
+    Imf::TiledRgbaInputFile* file = NULL;
+    bool ok = false;
+
+    try 
+      {
+	file = textureCheckoutFileDescriptor( this, _name );
+	Imf::TiledRgbaInputFile& in = *file;
+
+	mrASSERT( lx < in.numXLevels() );
+	mrASSERT( ly < in.numYLevels() );
+      
+	Imath::Box2i dataWindow = in.dataWindowForLevel(lx, ly);
+      
+	int dx = dataWindow.min.x;
+	int dy = dataWindow.min.y;
+
+	Imf::Rgba* pixels = static_cast< Imf::Rgba* >( data );
+	unsigned offset = dx + (x + y * _tileYSize + dy) * _tileXSize;
+	in.setFrameBuffer( pixels - offset, 1, _tileXSize );
+	in.readTile( x, y, lx, ly );
+	ok = true;
+      } 
+    catch( const std::exception& e )
+      {
+	mi_error("mrl_exr_file: %s", e.what() );
+      }
+    catch( ... )
       {
-	// block not loaded
-	Imf::TiledRgbaInputFile* in = textureGetFileDescriptor( this );
-	if ( in == NULL ) return;
+	mi_error("mrl_exr_file: Unknown exception reading tile of \"%s\"",
+		 _name );
+      }
+
+    if ( file ) textureCheckinFileDescriptor( this, file );
+    return ok;
+  }
 
-	textureLoadBlock( block, *in, tileX, tileY, lx, ly );
+  //! Queue the tiles likely to be needed after a miss on a tile: its
+  //! neighbors and the tile covering it in the next coarser level.
+  virtual void missed( const int tileX, const int tileY,
+		       const int lx, const int ly )
+  {
+    mrlPrefetchRequest reqs[5];
+    unsigned num = 0;
+
+    static const int offsets[4][2] = { {-1,0}, {1,0}, {0,-1}, {0,1} };
+    for ( int i = 0; i < 4; ++i )
+      {
+	int x = tileX + offsets[i][0];
+	int y = tileY + offsets[i][1];
+	if ( x < 0 || y < 0 || 
+	     x >= (int)_numXTiles[lx] || y >= (int)_numYTiles[ly] ) continue;
+	reqs[num].x  = x;  reqs[num].y  = y;
+	reqs[num].lx = lx; reqs[num].ly = ly;
+	++num;
       }
 
-    const Imf::Rgba* pixels = (Imf::Rgba*) block->data;
-    if ( pixels == NULL ) 
+    int clx = lx + 1 < (int)_numXLevels ? lx + 1 : lx;
+    int cly = ly + 1 < (int)_numYLevels ? ly + 1 : ly;
+    if ( clx != lx || cly != ly )
       {
-	c.r = c.g = c.b = c.a = 0.0f;
-	return;
+	reqs[num].x  = tileX >> (clx - lx);
+	reqs[num].y  = tileY >> (cly - ly);
+	reqs[num].lx = clx; reqs[num].ly = cly;
+	++num;
       }
 
-    x -= tileX * _tileXSize;
-    y -= tileY * _tileYSize;
-    const Imf::Rgba& rgba = pixels[ y * _tileXSize + x ];
-    c.r = rgba.r;
-    c.g = rgba.g;
-    c.b = rgba.b;
-    c.a = rgba.a;
+    texturePrefetch( this, reqs, num );
   }
 
-  unsigned long long hash_key( const int x, const int y, 
-			       const int lx, const int ly )
+  static void read( color& c, const mrlTextureBlock* block,
+		    const unsigned offset )
   {
-    // Max. resolution accepted is 32768 x 32768 and 16 levels in X/Y.
-    mrASSERT( lx < 16 );
-    mrASSERT( ly < 16 );
-    mrASSERT( x < 32768 );
-    mrASSERT( y < 32768 );
-    unsigned long long key = (lx + (ly << 4) + (x << 8) + (y << 23));
-    return key;
+    mrlHalfToFloat( c, ((const Imf::Rgba*) block->data) + offset );
   }
 
-  DataBlocks _datablocks;
   char* _name;
   int _width, _height;
-  unsigned _tileXSize, _tileYSize;
-  unsigned _numXLevels, _numYLevels;
   WrapMode _wrapX, _wrapY;
 };
 
 
-static
-Imf::TiledRgbaInputFile* textureGetFileDescriptor( const exrTexture* txt )
+/** 
+ * Load a queued tile, unless it is in memory or being loaded already.
+ * 
+ * @param r tile to load
+ */
+static void texturePrefetchTile( const mrlPrefetchRequest& r )
 {
-  FileDescriptors::iterator i = fileDescriptors.find( txt );
-  if ( i == fileDescriptors.end() )
+  try
     {
-      if ( fileDescriptors.size() == maxFileDescriptors )
-	{
-	  i = fileDescriptors.begin();
-	  delete i->second;
-	  fileDescriptors.erase(i);
-	}
-
-      Imf::TiledRgbaInputFile* ret;
-      ret = new Imf::TiledRgbaInputFile( txt->filename() );
-      fileDescriptors.insert( std::make_pair( txt, ret ) );
-      return ret;
+      r.txt->preload( r.x, r.y, r.lx, r.ly );
     }
-  else
+  catch( ... )
     {
-      return i->second;
     }
 }
 
 
-static void textureShutdown()
+/** 
+ * Main loop of a prefetch thread.
+ * 
+ * @param data index of the thread
+ */
+static void texturePrefetchRun( void* data )
 {
-  accessId = 0;
-
-  while(usedBlocks != NULL)
-    textureDeleteBlock(usedBlocks);
+  unsigned id = (unsigned) (size_t) data;
 
-  mrlTextureBlock* c, *n;
-  for (c = freeBlocks; c != NULL; c = n) 
+  prefetchLockQueue();
+  for (;;)
     {
-      n = c->next;
-      delete c;
+      while ( prefetchSize == 0 && !prefetchQuit )
+	prefetchWait();
+      if ( prefetchQuit ) break;
+
+      mrlPrefetchRequest r = prefetchQueue[ prefetchHead ];
+      prefetchHead = (prefetchHead + 1) % kPrefetchQueueSize;
+      --prefetchSize;
+      prefetchActive[id] = r.txt;
+      prefetchUnlockQueue();
+
+      texturePrefetchTile( r );
+
+      prefetchLockQueue();
+      prefetchActive[id] = NULL;
     }
+  prefetchUnlockQueue();
+}
 
-  textureDeleteFileDescriptors();
 
-  freeBlocks = usedBlocks = NULL;
-  mi_delete_lock( &mMemFlushLock );
+#if defined(WIN32) || defined(WIN64)
+static unsigned __stdcall texturePrefetchThread( void* data )
+{
+  texturePrefetchRun( data );
+  return 0;
+}
+#else
+extern "C" void* texturePrefetchThread( void* data )
+{
+  texturePrefetchRun( data );
+  return NULL;
 }
+#endif
 
 
-static void textureInit( const unsigned maxMemory )
+/** 
+ * Start the prefetch threads.
+ * 
+ * @param num number of threads.  0 turns prefetching off.
+ */
+static void texturePrefetchStart( unsigned num )
 {
-  if ( memoryUsed == 0 )
+  if ( num > kMaxPrefetchThreads ) num = kMaxPrefetchThreads;
+
+  prefetchHead = prefetchSize = peakPrefetchSize = 0;
+  prefetchDropped = 0;
+  prefetchQuit = false;
+  numPrefetchThreads = 0;
+  if ( num == 0 ) return;
+
+#if defined(WIN32) || defined(WIN64)
+  InitializeCriticalSection( &prefetchLock );
+  prefetchWake = CreateSemaphore( NULL, 0, LONG_MAX, NULL );
+#else
+  pthread_mutex_init( &prefetchLock, NULL );
+  pthread_cond_init( &prefetchWake, NULL );
+#endif
+
+  for ( unsigned i = 0; i < num; ++i )
     {
-      accessId = 0;
-      if ( usedBlocks != NULL || freeBlocks != NULL )
-	{
-	  textureShutdown();
-	}
-      memoryUsed = 0;
-      memoryMax = maxMemory;
+      prefetchActive[i] = NULL;
+#if defined(WIN32) || defined(WIN64)
+      HANDLE h = (HANDLE) _beginthreadex( NULL, 0, texturePrefetchThread,
+					  (void*) (size_t) i, 0, NULL );
+      if ( h == 0 ) break;
+      prefetchThreads[i] = h;
+#else
+      if ( pthread_create( &prefetchThreads[i], NULL, texturePrefetchThread,
+			   (void*) (size_t) i ) != 0 )
+	break;
+#endif
+      ++numPrefetchThreads;
     }
 
-  mi_init_lock( &mMemFlushLock );
+  if ( numPrefetchThreads < num )
+    mi_warning("mrl_exr_file: could only start %u of %u prefetch threads",
+	       numPrefetchThreads, num);
 }
 
 
-#define WEIGHT_LUT_SIZE 1024
-static miScalar* weightLut = NULL;
-
-static miScalar getWeight( miScalar r2 )
+/** 
+ * Stop the prefetch threads, dropping any queued tiles.
+ * 
+ */
+static void texturePrefetchStop()
 {
-  int offset = (int) (r2 * (WEIGHT_LUT_SIZE - 1));
-  mrASSERT(offset >= 0 && offset < WEIGHT_LUT_SIZE);
-  return weightLut[offset];
+  if ( numPrefetchThreads == 0 ) return;
+
+  prefetchLockQueue();
+  prefetchQuit = true;
+  prefetchSize = 0;
+  prefetchUnlockQueue();
+  prefetchSignal( numPrefetchThreads );
+
+  for ( unsigned i = 0; i < numPrefetchThreads; ++i )
+    {
+#if defined(WIN32) || defined(WIN64)
+      WaitForSingleObject( prefetchThreads[i], INFINITE );
+      CloseHandle( prefetchThreads[i] );
+#else
+      pthread_join( prefetchThreads[i], NULL );
+#endif
+    }
+  numPrefetchThreads = 0;
+
+#if defined(WIN32) || defined(WIN64)
+  CloseHandle( prefetchWake );
+  DeleteCriticalSection( &prefetchLock );
+#else
+  pthread_cond_destroy( &prefetchWake );
+  pthread_mutex_destroy( &prefetchLock );
+#endif
 }
 
-static void weightLutInit()
+
+static void textureShutdown()
 {
-  if ( weightLut ) return;
+  if ( !cacheReady ) return;
 
-  weightLut = new miScalar[WEIGHT_LUT_SIZE];
+  texturePrefetchStop();
+  textureCacheShutdown();
 
-  for (int i = 0; i < WEIGHT_LUT_SIZE; ++i) {
-    miScalar alpha = 2;
-    miScalar r2 = miScalar(i) / miScalar(WEIGHT_LUT_SIZE - 1);
-    miScalar weight = exp(-alpha * r2);
-    weightLut[i] = weight;
-  }
+  textureDeleteFileDescriptors();
+  mi_delete_lock( &fdLock );
+
+  cacheReady = false;
 }
 
-void weightLutRelease()
+
+static void textureInit( const unsigned maxMemory, const unsigned maxFiles,
+			 const unsigned numThreads )
 {
-  delete [] weightLut;
-  weightLut = NULL;
+  textureShutdown();
+
+  textureCacheInit( maxMemory );
+
+  mi_init_lock( &fdLock );
+  maxFileDescriptors = maxFiles;
+  numFileDescriptors = 0;
+
+  cacheReady = true;
+
+  texturePrefetchStart( numThreads );
 }
 
 
@@ -785,6 +1123,14 @@ kQuartic,
 kGaussian
 };
 
+//! Filter mipmap and ripmap levels bilinearly instead of with their
+//! nearest texel (MRL_TEXTURE_FILTER=trilinear).
+static bool textureTrilinear = false;
+
+//! Filter kQuadratic, kQuartic and kGaussian lookups with Heckbert's
+//! elliptical weighted average instead of as ripmaps (MRL_TEXTURE_EWA=1).
+static bool textureElliptic = false;
+
 static float invLog2 = (float) (1. / log(2.));
 #define LOG2(x) (log(x)*invLog2)
 
@@ -820,7 +1166,50 @@ DLLEXPORT void mrl_exr_file_init( miState* const state,
 	  if ( maxNumPages < 1 ) maxNumPages = 16384;
 	}
       mi_info("mrl_exr_file: MRL_TEXTURE_MEMORY=%u", maxNumPages);
-      textureInit( maxNumPages * 1024 );
+
+      unsigned maxFiles = 512;
+      m = getenv( "MRL_TEXTURE_FILES" );
+      if ( m != NULL )
+	{
+	  maxFiles = (unsigned) atoi( m );
+	  if ( maxFiles < 1 ) maxFiles = 512;
+	}
+      mi_info("mrl_exr_file: MRL_TEXTURE_FILES=%u", maxFiles);
+
+      // Prefetch threads load tiles near the ones missed.  They mostly
+      // wait on disk, so they do not take many cpus away from rendering.
+      unsigned numThreads = 2;
+      m = getenv( "MRL_TEXTURE_THREADS" );
+      if ( m != NULL )
+	{
+	  numThreads = (unsigned) atoi( m );
+	}
+      mi_info("mrl_exr_file: MRL_TEXTURE_THREADS=%u", numThreads);
+
+      // Trilinear is smoother but slower, and would change the look of
+      // scenes rendered with the nearest lookups.
+      textureTrilinear = false;
+      m = getenv( "MRL_TEXTURE_FILTER" );
+      if ( m != NULL )
+	{
+	  if ( strcmp( m, "trilinear" ) == 0 )
+	    textureTrilinear = true;
+	  else if ( strcmp( m, "nearest" ) != 0 )
+	    mi_warning("mrl_exr_file: Unknown MRL_TEXTURE_FILTER \"%s\"", m);
+	}
+      mi_info("mrl_exr_file: MRL_TEXTURE_FILTER=%s",
+	      textureTrilinear ? "trilinear" : "nearest" );
+
+      // EWA is sharper for surfaces seen at an angle, but much slower.
+      textureElliptic = false;
+      m = getenv( "MRL_TEXTURE_EWA" );
+      if ( m != NULL )
+	{
+	  textureElliptic = ( atoi( m ) != 0 );
+	}
+      mi_info("mrl_exr_file: MRL_TEXTURE_EWA=%d", (int) textureElliptic );
+
+      textureInit( maxNumPages * 1024, maxFiles, numThreads );
       gStats->init();
       *req_inst = miTRUE;
       return;
@@ -852,8 +1241,11 @@ DLLEXPORT void mrl_exr_file_init( miState* const state,
      {
        exrTexture* cache = new exrTexture( name );
 
-       mi_info("mrl_exr_file: Opened file \"%s\", file descriptor %d.", name,
-		fileDescriptors.size() );
+       mi_lock( fdLock );
+       unsigned numOpen = numFileDescriptors;
+       mi_unlock( fdLock );
+       mi_info("mrl_exr_file: Opened file \"%s\", %u files open.", name,
+	       numOpen );
 
        miBoolean mirrorU = *mi_eval_boolean( &p->mirrorU );
        if ( mirrorU ) cache->mirrorU();
@@ -895,6 +1287,7 @@ mrl_exr_file_exit(
 {
   if ( !p )
   {
+    textureGatherStats();
     gStats->stats();
     textureShutdown();
     weightLutRelease();
@@ -905,11 +1298,7 @@ mrl_exr_file_exit(
   mi_query(miQ_FUNC_USERPTR, state, 0, &user);
   
   exrTexture* cache = static_cast<exrTexture*>( *user );
-  if (cache) 
-    {
-      textureDeleteFileDescriptor( cache );
-      delete cache;
-    }
+  delete cache;
 }
 
 
@@ -976,7 +1365,8 @@ DLLEXPORT miBoolean mrl_exr_file( mrl_exr_file_result_t* const m,
   //
   // Calculate dS/dx, dS/dy, dT/dx, dT/dy
   //
-  vector dS(kNoInit), dT( kNoInit );
+  // Shadow and light rays get no differentials, so these stay 0.
+  vector dS( 0.0f, 0.0f, 0.0f ), dT( 0.0f, 0.0f, 0.0f );
   rayDifferentials( dS, dT, state, t );
 
   //
@@ -994,74 +1384,47 @@ DLLEXPORT miBoolean mrl_exr_file( mrl_exr_file_result_t* const m,
       uvFilterSize = mi_eval_vector( &p->uvFilterSize );
     }
 
-  switch( filterType )
+  bool elliptic = ( textureElliptic && filterType > kBox );
+
+  if ( filterType == kNone )
     {
-    case kNone:
       lodX = lodY = 0;
-      break;
-    case kMipMap:
-    case kBox:
-#ifndef MR_ELLIPTIC_FILTER
-    default:
-#endif
+    }
+  else if ( elliptic )
+    {
+      lodX = lodY = mrlEwaLevel( dS.x, dS.y, dT.x, dT.y,
+				 cache->width(), cache->height(), 
+				 filterWidth );
+    }
+  else
+    {
       filterWidth *= 0.5f;
       lodX = filterWidth * LOG2( max( dS.lengthSquared(), 1e-6f ) );
       lodY = filterWidth * LOG2( max( dT.lengthSquared(), 1e-6f ) );
-      break;
-#ifdef MR_ELLIPTIC_FILTER
-    default:
-      if ( dT.lengthSquared() < dS.lengthSquared() )
-	{
-	  std::swap( dS, dT );
-	}
-      miScalar majorLength = dT.length();
-      miScalar minorLength = dS.length();
-
-      // if the eccentricity of the ellipse is looking to be too big, scale
-      // up the shorter of the two vectors so that it's a little more reasonable.
-      // This lets us avoid spending inordinate amounts of time filtering very
-      // long and skinny regions (which take a lot of time), at the expense of
-      // some blurring...
-      const miScalar maxEccentricity = 30;
-      miScalar e = majorLength / minorLength;
-
-      if (e > maxEccentricity) 
-	{
-	  // blur in the interests if filtering in a reasonable amount
-	  // of time
-	  minorLength *= e / maxEccentricity;
-	}
-
-      // Pick a lod such that we're looking at somewhere around 3-9 texels
-      // in the minor axis direction.
-      lodX = lodY = -filterWidth * LOG2(3.0f / minorLength);
-      lodX = clamp(lodX, 0.0f, cache->numXLevels() - 1 - 1e-7f);
-      lodY = clamp(lodY, 0.0f, cache->numYLevels() - 1 - 1e-7f);
-      break;
-#endif
     }
 
-  int lx = (int) lodX;
-  int ly = (int) lodY;
+  // The s,t mapping below mirrors the texture where s is negative and
+  // where t is positive, so the derivatives of the ellipse flip there.
+  miScalar flipS = st->x < 0.0f ? -1.0f : 1.0f;
+  miScalar flipT = st->y < 0.0f ? 1.0f : -1.0f;
 
   // Make sure s,t coordinates map onto [0,1] range
   st->x = fmod( fabs(st->x), 1.0f );
   st->y = 1.0f - fmod( fabs(st->y), 1.0f );
 
   color c( kNoInit );
-  if ( lx <= 0 && ly <= 0 )
+  if ( filterType == kNone )
     {
       gStats->level( 0 );
       gStats->level( 0 );
-      if ( filterType == kNone )
-	cache->lookup( c, st->x, st->y, 0, 0 );
-      else
-	cache->blur( c, st->x, st->y, 0, 0 );
+      cache->lookup( c, st->x, st->y, 0, 0 );
     }
   else
     {
-      if ( lx < 0 ) lx = 0;
-      if ( ly < 0 ) ly = 0;
+      if ( lodX < 0.0f ) lodX = 0.0f;
+      if ( lodY < 0.0f ) lodY = 0.0f;
+      int lx = (int) lodX;
+      int ly = (int) lodY;
 
       int numXLevels = cache->numXLevels();
       int numYLevels = cache->numYLevels();
@@ -1072,169 +1435,34 @@ DLLEXPORT miBoolean mrl_exr_file( mrl_exr_file_result_t* const m,
       gStats->level( ly );
 
 
-#ifdef MR_ELLIPTIC_FILTER
-      if ( filterType <= kBox )
-#endif
+      if ( !elliptic )
 	{
-	  cache->lookup( c, st->x, st->y, lx, ly );
-
-	  if ( filterType == kMipMap )
-	    {
-	      // Handle as MipMap
-	      miScalar frac = lodX - lx;
-	      if ( frac > 0.005f )
-		{
-		  lx += 1;
-		  ly += 1;
-		  if ( lx < numXLevels && ly < numYLevels )
-		    { 
-		      color c2( kNoInit );
-		      cache->lookup( c2, st->x, st->y, lx, ly );
-		      c = mix( c, c2, frac );
-		      c2   *= frac;
-		      c2.a *= frac;
-		      frac  = 1.0f - frac;
-		      c    *= frac;
-		      c.a  *= frac;
-		      c    += c2;
-		      c.a  += c2.a;
-		    }
-		}
-	    }
+	  // kMipMap is a MipMap, the others an anisotropic RipMap
+	  if ( textureTrilinear )
+	    cache->mipmapTrilinear( c, st->x, st->y, lodX, lodY, lx, ly,
+				    filterType == kMipMap );
 	  else
-	    {
-	      // Handle as anisotropic RipMap
-	      miScalar frac = lodX - lx;
-	      if ( frac > 0.005f )
-		{
-		  if ( (lx+1) < numXLevels )
-		    { 
-		      color c2( kNoInit );
-		      cache->lookup( c2, st->x, st->y, lx + 1, ly );
-		      c = mix( c, c2, frac );
-		      c2   *= frac;
-		      c2.a *= frac;
-		      frac  = 1.0f - frac;
-		      c    *= frac;
-		      c.a  *= frac;
-		      c    += c2;
-		      c.a  += c2.a;
-		    }
-		}
-
-	      frac = lodY - ly;
-	      if ( frac > 0.005f )
-		{
-		  if ( (ly+1) < numYLevels )
-		    { 
-		      color c2( kNoInit );
-		      cache->lookup( c2, st->x, st->y, lx, ly+1 );
-		      c = mix( c, c2, frac );
-		      c2   *= frac;
-		      c2.a *= frac;
-		      frac  = 1.0f - frac;
-		      c    *= frac;
-		      c.a  *= frac;
-		      c    += c2;
-		      c.a  += c2.a;
-		    }
-		}
-	    }
-
+	    cache->mipmapNearest( c, st->x, st->y, lodX, lodY, lx, ly,
+				  filterType == kMipMap );
+	}
+      else if ( lx == numXLevels - 1 || ly == numYLevels - 1 )
+	{
+	  // Avoid filtering enormous regions.  The last level is the
+	  // average of the texture.
+	  cache->lookup( c, st->x, st->y, numXLevels - 1, numYLevels - 1 );
 	}
-#ifdef MR_ELLIPTIC_FILTER
       else
 	{
-	  // Calculate pixel coordinate for level
-	  int scaleX = cache->width()  / (1 << lx);
-	  int scaleY = cache->height() / (1 << ly);
-	  mi_info("scale: %d, %d", scaleX, scaleY);
-
-	  st->x = st->x * scaleX - 0.5f;
-	  st->y = st->y * scaleY - 0.5f;
-	  mi_info("st: %g, %g", st->x, st->y);
-
-	  miScalar ux = dS.x * scaleX;
-	  miScalar vx = dS.y * scaleY;
-	  miScalar uy = dT.x * scaleX;
-	  miScalar vy = dT.y * scaleY;
-
-	  // compute ellipse coefficients to bound the region: 
-	  // A*x*x + B*x*y + C*y*y = F.
-	  miScalar A = vx*vx + vy*vy + 1;
-	  miScalar B = -2.0f * (ux*vx + uy*vy);
-	  miScalar C = ux*ux + uy*uy + 1;
-	  miScalar F = A * C - B * B * 0.25f;
-
-	  mi_info("* A:%g B:%g C:%g F:%g", A, B, C, F);
-	  float invF = 1.f / (A*C - B*B*0.25f);
-	  A *= invF;
-	  B *= invF;
-	  C *= invF;
-
-	  mi_info("# A:%g B:%g C:%g F:%g", A, B, C, F);
-
-	  // it better be an ellipse!
-	  mrASSERT(A*C-B*B/4. > 0.);
-
-	  // Compute the ellipse's (u,v) bounding box in texture space
-	  miScalar det = -B*B + 4.0f*A*C;
-	  miScalar invDet = 1.f / det;
-	  miScalar uSqrt = mr::math<miScalar>::sqrt(C * det);
-	  miScalar vSqrt = mr::math<miScalar>::sqrt(A * det);
-	  mi_info("uSqrt: %g", uSqrt);
-	  mi_info("vSqrt: %g", vSqrt);
-	  mi_info("invDet: %g", invDet);
-	  int u0 = mr::fastmath<miScalar>::floor(st->x - 2.0f * invDet * uSqrt );
-	  int u1 = mr::fastmath<miScalar>::ceil (st->x + 2.0f * invDet * uSqrt );
-	  int v0 = mr::fastmath<miScalar>::floor(st->y - 2.0f * invDet * vSqrt );
-	  int v1 = mr::fastmath<miScalar>::ceil (st->y + 2.0f * invDet * vSqrt );
-
-	  // Heckbert MS thesis, p. 59; scan over the bounding box of the ellipse
-	  // and incrementally update the value of Ax^2+Bxy*Cy^2; when this
-	  // value, q, is less than F, we're inside the ellipse so we filter
-	  // away..
-	  c = 0;
-	  miScalar den = 0.0f;
-	  miScalar ddq = 2 * A;
-	  miScalar U   = u0 - st->x;
-	  miScalar U2  = 2 * U;
-	  miScalar UU  = U * U;
-	  miScalar BU  = B * U;
-	  miScalar AU21 = A*(U2+1);
-
-	  mi_info("v0: %d  v1: %d  u0: %d  u1: %d", v0, v1, u0, u1);
-
-	  for (int v = v0; v <= v1; ++v) 
-	    {
-	      miScalar V  = v - st->y;
-	      miScalar VV = V * V;
-	      for (int u = u0; u <= u1; ++u) 
-		{
-		  miScalar U = u - st->x;
-		  miScalar r2 = A * U * U + B * U * V + C * VV;
-		  if (r2 < 1.0f)
-		    {
-		      miScalar weight = getWeight(r2);
-		      color tmp( kNoInit );
-		      miScalar x = (miScalar) mod(u, scaleX) / scaleX;
-		      miScalar y = (miScalar) mod(v, scaleY) / scaleY;
-		      cache->lookup(tmp, x, y, lx, ly);
- 		      tmp   *= weight;
- 		      tmp.a *= weight;
-		      c   += tmp;
-		      c.a += tmp.a;
-		      den += weight;
-		    }
-		}
-	    }
-
-
-	  mrASSERT(den > 0.);
-	  c   /= den;
-	  c.a /= den;
+	  // Heckbert MS thesis, p. 59; scan over the bounding box of the
+	  // ellipse and filter the texels inside it.
+	  mrlEllipse e;
+	  mrlEllipseSetup( e, st->x, st->y, 
+			   flipS * dS.x, flipT * dS.y, 
+			   flipS * dT.x, flipT * dT.y,
+			   cache->width()  / (1 << lx), 
+			   cache->height() / (1 << ly) );
+	  cache->ewa( c, e, lx, ly );
 	}
-#endif
     }
 
       
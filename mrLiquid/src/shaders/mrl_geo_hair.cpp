@@ -859,21 +859,14 @@ struct PfxHair
 
 	LOAD_INT( spit );
 	LOAD_INT( numMb );
-	unsigned i;
 
 	LOAD_INT( numOffsets );
 	offsets = new unsigned[ numOffsets ];
-	for ( i = 0; i < numOffsets; ++i )
-	{
-	   LOAD_INT( offsets[i] );
-	}
+	LOAD_ARRAY( offsets, numOffsets );
 
 	LOAD_INT( numScalars );
 	scalars = new float[ numScalars ];
-	for ( i = 0; i < numScalars; ++i )
-	{
-	   LOAD_FLOAT( scalars[i] );
-	}
+	LOAD_ARRAY( scalars, numScalars );
 	fclose(f);
 	return true;
      }
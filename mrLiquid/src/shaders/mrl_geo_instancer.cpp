@@ -0,0 +1,197 @@
+/****************************************************************************
+ * Created:	17.10.26
+ * Module:	mrl_geo_instancer
+ *
+ * Exports:
+ *      mrl_geo_instancer_init()
+ *      mrl_geo_instancer_exit()
+ *      mrl_geo_instancer()
+ *
+ * Requires:
+ *      mrClasses, an .mri file (saved by mrLiquid's particle instancer)
+ *
+ * History:
+ *      17.10.26: initial version
+ *
+ * Description:
+ *      Create one instance per particle of a particle instancer from
+ *      the matrices mrLiquid saved to a binary .mri file, instead of
+ *      parsing one mi instance block per particle.
+ *
+ ***************************************************************************/
+
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+
+#include "mrGenerics.h"
+using namespace mr;
+
+#include "mrByteSwap.h"
+#include "mrInstancerStream.h"
+#include "mrMappedFile.h"
+
+
+const int SHADER_VERSION = 1;
+
+
+//!
+//! Geometry Shader parameters
+//!
+struct mrl_geo_instancer_t
+{
+     miTag     filename;
+};
+
+
+
+//! Swap num 4-byte elements in place if needed.
+static void swap4( void* d, const unsigned num, const bool swap )
+{
+   if ( swap ) ByteSwapBlock( d, d, num, 4 );
+}
+
+
+static miBoolean addInstances(
+			      miTag* const result,
+			      miState* const state,
+			      const char* const file
+			      )
+{
+   mrMappedFile map( file );
+   const char* data = map.data();
+   if ( data == NULL || map.size() < sizeof(mrInstancerHeader) )
+   {
+      mi_error("mrl_geo_instancer: could not read \"%s\"", file);
+      return miFALSE;
+   }
+
+   mrInstancerHeader h;
+   memcpy( &h, data, sizeof(h) );
+   if ( strncmp( h.magic, MRL_INSTANCER_MAGIC, 4 ) != 0 )
+   {
+      mi_error("mrl_geo_instancer: \"%s\" is not an instancer file", file);
+      return miFALSE;
+   }
+
+   bool swap = ( h.endian != 1 );
+   swap4( &h.version, 6, swap );
+   if ( h.version > MRL_INSTANCER_VERSION )
+   {
+      mi_error("mrl_geo_instancer: \"%s\" is version %d, expected %d or "
+	       "older", file, h.version, MRL_INSTANCER_VERSION );
+      return miFALSE;
+   }
+
+   size_t stride = mrInstancerStride( h.flags );
+   size_t start  = sizeof(h) + h.namesSize;
+   if ( map.size() < start + stride * h.count )
+   {
+      mi_error("mrl_geo_instancer: \"%s\" is truncated", file);
+      return miFALSE;
+   }
+
+   // The instancer's name followed by the names of the objects
+   const char* names = data + sizeof(h);
+   const char* namesEnd = names + h.namesSize;
+   std::vector< const char* > objects;
+   const char* baseName = names;
+   const char* s = names;
+   for ( ; s < namesEnd && *s; ++s ) ;
+   for ( ++s; s < namesEnd && objects.size() < h.numObjects; ++s )
+   {
+      objects.push_back( s );
+      for ( ; s < namesEnd && *s; ++s ) ;
+   }
+   if ( objects.size() != h.numObjects || s > namesEnd )
+   {
+      mi_error("mrl_geo_instancer: \"%s\" has invalid object names", file);
+      return miFALSE;
+   }
+
+   bool motion = ( h.flags & kInstancerMotion ) != 0;
+   mi_debug("mrl_geo_instancer: %u instances of %u objects", h.count,
+	    h.numObjects);
+
+   std::vector< char > iname( strlen( baseName ) + 16 );
+   std::vector< unsigned > rec( stride / sizeof(unsigned) );
+   const char* r = data + start;
+   for ( unsigned i = 0; i < h.count; ++i, r += stride )
+   {
+      memcpy( &rec[0], r, stride );
+      swap4( &rec[0], (unsigned) rec.size(), swap );
+
+      unsigned object = rec[0];
+      if ( object >= h.numObjects )
+      {
+	 mi_error("mrl_geo_instancer: \"%s\" has invalid object index %u",
+		  file, object);
+	 return miFALSE;
+      }
+
+      sprintf( &iname[0], "%s|%07X", baseName, rec[1] );
+      miInstance* inst = mi_api_instance_begin( mi_mem_strdup(&iname[0]) );
+      const miScalar* m = (const miScalar*) &rec[2];
+      memcpy( inst->tf.global_to_local, m, 16 * sizeof(miScalar) );
+      mi_matrix_invert( inst->tf.local_to_global, inst->tf.global_to_local );
+      if ( motion )
+	 memcpy( inst->motion_transform, m + 16, 16 * sizeof(miScalar) );
+      mi_geoshader_add_result( result,
+			       mi_api_instance_end( 
+						   mi_mem_strdup(objects[object]),
+						   miNULLTAG, miNULLTAG ) );
+   }
+
+   return miTRUE;
+}
+
+
+
+//!
+//! MAIN ENTRY FUNCTIONS FOR SHADER.
+//! 
+EXTERN_C 
+DLLEXPORT int mrl_geo_instancer_version(void) {return(SHADER_VERSION);};
+
+
+
+EXTERN_C DLLEXPORT 
+void mrl_geo_instancer_exit(
+			    miState* const        state,
+			    struct mrl_geo_instancer_t* p
+			    )
+{
+}
+
+
+EXTERN_C DLLEXPORT 
+void mrl_geo_instancer_init(
+			    miState* const        state,
+			    struct mrl_geo_instancer_t* p,
+			    miBoolean* req_inst
+			    )
+{
+}
+
+
+EXTERN_C 
+DLLEXPORT miBoolean mrl_geo_instancer(
+				      miTag* const result,
+				      miState* const state,
+				      mrl_geo_instancer_t* const p
+				      )
+{
+   miTag nameTag = mr_eval( p->filename );
+   if ( nameTag == miNULLTAG )
+   {
+      mi_error("mrl_geo_instancer: no .mri filename provided");
+      return miFALSE;
+   }
+
+   const char* const file = (char*) mi_db_access( nameTag );
+   miBoolean ok = addInstances( result, state, file );
+   mi_db_unpin( nameTag );
+   return ok;
+}
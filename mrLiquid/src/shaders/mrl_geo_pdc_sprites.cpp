@@ -604,19 +604,17 @@ miBoolean addCards(
    if ( frameRate <= 0 ) frameRate = 24;
 
 
-   PDC_Header* header = readPDC( pdcTag, state );
-   if ( header == NULL ) 
+   PDC_Reader pdc( pdcTag, state );
+   if ( !pdc.valid() ) 
    {
       mi_error("No PDC found");
       return miFALSE;
    }
 
-   bool swap = ( header->endian != 1 );
+   bool swap = pdc.swap();
 
-   unsigned numParticles = header->count;
-   unsigned numAttrs = header->numAttrs;
-   SWAP_INT( numParticles );
-   SWAP_INT( numAttrs );
+   unsigned numParticles = pdc.count();
+   unsigned numAttrs = pdc.numAttrs();
    mi_debug("numParticles: %d", numParticles);
    mi_debug("numAttrs: %d", numAttrs );
 
@@ -626,53 +624,27 @@ miBoolean addCards(
 
    if ( cache == NULL ) cache = new PDC_Cache;
 
-   const char* loc = ((char*)header) + sizeof( PDC_Header );
+   std::vector< double > swapBuf;
    unsigned i;
    for ( i = 0; i < numAttrs; ++i )
    {
-      int len = *((int*) loc);  loc += sizeof(int);
-      SWAP_INT(len);
-
-      char attr[128];
-      for ( int j = 0; j < len; ++j, ++loc )
-	 attr[j] = *loc;
-      attr[len] = 0;  // null terminate the fucker
-
+      const char* attr = pdc.name(i);
       mi_vdebug("attr %s", attr);
       
-      Types type = (Types) *((int*) loc); loc += sizeof(int);
-      SWAP_INT( type );
+      Types type = pdc.type(i);
       mi_vdebug("type %d", type);
 
-      int size;
-      switch(type)
-      {
-	 case kInt:
-	    size = sizeof(int); break;
-	 case kIntArray:
-	    size = sizeof(int)*numParticles; break;
-	 case kDouble:
-	    size = sizeof(double); break;
-	 case kDoubleArray:
-	    size = sizeof(double)*numParticles; break;
-	 case kVector:
-	    size = sizeof(double)*3; break;
-	 case kVectorArray:
-	    size = sizeof(double)*3*numParticles; break;
-	 default:
-	    fprintf(stderr,"Unknown attribute type %d.", type);
-	    size = sizeof(double);
-      }
+      const char* loc = pdc.data(i);
 
       if ( strcmp(attr, "position") == 0 )
       {
 	 cache->pos.resize( numParticles );
 	 positionFound = true;
-	 miGeoVector* t = (miGeoVector*)loc;
+	 const miGeoVector* t = (const miGeoVector*)
+	    pdcDoubles( loc, numParticles * 3, swap, swapBuf );
 	 for ( unsigned j = 0; j < numParticles; ++j, ++t )
 	 {
 	    miGeoVector tmp = *t;
-	    SWAP_VECTOR( tmp );
 	    cache->pos[j].x = (float) tmp.x;
 	    cache->pos[j].y = (float) tmp.y;
 	    cache->pos[j].z = (float) tmp.z;
@@ -682,11 +654,11 @@ miBoolean addCards(
       {
 	 positionFound = true;
 	 cache->pos.resize( numParticles );
-	 miGeoVector* t = (miGeoVector*)loc;
+	 const miGeoVector* t = (const miGeoVector*)
+	    pdcDoubles( loc, numParticles * 3, swap, swapBuf );
 	 for ( unsigned j = 0; j < numParticles; ++j, ++t )
 	 {
 	    miGeoVector tmp = *t;
-	    SWAP_VECTOR( tmp );
 	    cache->pos[j].x = (float) tmp.x;
 	    cache->pos[j].y = (float) tmp.y;
 	    cache->pos[j].z = (float) tmp.z;
@@ -699,11 +671,11 @@ miBoolean addCards(
       {
 	 velocityFound = true;
 	 cache->vel.resize( numParticles );
-	 miGeoVector* t = (miGeoVector*)loc;
+	 const miGeoVector* t = (const miGeoVector*)
+	    pdcDoubles( loc, numParticles * 3, swap, swapBuf );
 	 for ( unsigned j = 0; j < numParticles; ++j, ++t )
 	 {
 	    miGeoVector tmp = *t;
-	    SWAP_VECTOR( tmp );
 	    tmp /= frameRate;
 	    cache->vel[j].x = (float) tmp.x;
 	    cache->vel[j].y = (float) tmp.y;
@@ -714,11 +686,11 @@ miBoolean addCards(
 		strcmp(attr, "worldVelocity") == 0 )
       {
 	 cache->vel.resize( numParticles );
-	 miGeoVector* t = (miGeoVector*)loc;
+	 const miGeoVector* t = (const miGeoVector*)
+	    pdcDoubles( loc, numParticles * 3, swap, swapBuf );
 	 for ( unsigned j = 0; j < numParticles; ++j, ++t )
 	 {
 	    miGeoVector tmp = *t;
-	    SWAP_VECTOR( tmp );
 	    tmp /= frameRate;
 	    cache->vel[j].x = (float) tmp.x;
 	    cache->vel[j].y = (float) tmp.y;
@@ -730,44 +702,40 @@ miBoolean addCards(
       else if ( strcmp(attr, "spriteNumPP") == 0 )
       {
 	 cache->sprite.resize( numParticles );
-	 double* t = (double*) loc;
+	 const double* t = pdcDoubles( loc, numParticles, swap, swapBuf );
 	 for ( unsigned j = 0; j < numParticles; ++j, ++t )
 	 {
 	    double tmp = *t;
-            SWAP_DOUBLE( tmp );
 	    cache->sprite[j] = (unsigned) tmp;
 	 }
       }
       else if ( strcmp( attr, "spriteScaleXPP" ) == 0 )
       {
 	 cache->scale.resize( numParticles );
-	 double* t = (double*) loc;
+	 const double* t = pdcDoubles( loc, numParticles, swap, swapBuf );
 	 for ( unsigned j = 0; j < numParticles; ++j, ++t )
 	 {
 	    double tmp = *t;
-	    SWAP_DOUBLE( tmp );
 	    cache->scale[j].x = (float) tmp;
 	 }
       }
       else if ( strcmp( attr, "spriteScaleYPP" ) == 0 )
       {
 	 cache->scale.resize( numParticles );
-	 double* t = (double*) loc;
+	 const double* t = pdcDoubles( loc, numParticles, swap, swapBuf );
 	 for ( unsigned j = 0; j < numParticles; ++j, ++t )
 	 {
 	    double tmp = *t;
-	    SWAP_DOUBLE( tmp );
 	    cache->scale[j].y = (float) tmp;
 	 }
       }
       else if ( strcmp( attr, "spriteTwistPP" ) == 0 )
       {
 	 cache->twist.resize( numParticles );
-	 double* t = (double*) loc;
+	 const double* t = pdcDoubles( loc, numParticles, swap, swapBuf );
 	 for ( unsigned j = 0; j < numParticles; ++j, ++t )
 	 {
 	    double tmp = *t;
-	    SWAP_DOUBLE( tmp );
 	    cache->twist[j] = (float) tmp;
 	 }
       }
@@ -795,7 +763,6 @@ miBoolean addCards(
 	 cache->spriteTwist = (miGeoScalar) *t;
 	 SWAP_DOUBLE( cache->spriteTwist );
       }
-      loc += size;
    }
 
    if ( cache->pos.empty() )
@@ -267,8 +267,8 @@ DLLEXPORT void mrl_volume_isect_init(
       state->instance = cache->instanceTag;
    }
 
-   PDC_Header* header = readPDC( cache->pdcTag, state );
-   if ( header == NULL ) 
+   PDC_Reader pdc( cache->pdcTag, state );
+   if ( !pdc.valid() ) 
    {
       mi_error("No PDC found");
       delete cache;
@@ -283,64 +283,37 @@ DLLEXPORT void mrl_volume_isect_init(
    bool    radiiFound = false;
    bool       idFound = false;
 
-   bool swap = ( header->endian != 1 );
+   bool swap = pdc.swap();
 
    miScalar frameRate = mr_eval( p->frameRate );
    if ( frameRate <= 0 ) frameRate = 1;
    
-   unsigned numParticles = header->count;
-   unsigned numAttrs = header->numAttrs;
-   SWAP_INT( numParticles );
-   SWAP_INT( numAttrs );
+   unsigned numParticles = pdc.count();
+   unsigned numAttrs = pdc.numAttrs();
    mi_debug("numParticles: %d", numParticles);
    mi_debug("numAttrs: %d", numAttrs );
 
    unsigned i;
-   const char* loc = ((char*)header) + sizeof( PDC_Header );
+   std::vector< double > swapBuf;
    for ( i = 0; i < numAttrs; ++i )
    {
-      int len = *((int*) loc);  loc += sizeof(int);
-      SWAP_INT(len);
-
-      char attr[128];
-      for ( int j = 0; j < len; ++j, ++loc )
-	 attr[j] = *loc;
-      attr[len] = 0;  // null terminate the fucker
+      const char* attr = pdc.name(i);
       mi_vdebug("attr %s", attr);
 
-      Types type = (Types) *((int*) loc); loc += sizeof(int);
-      SWAP_INT( type );
+      Types type = pdc.type(i);
       mi_vdebug("type %d", type);
 
-      int size;
-      switch(type)
-      {
-	 case kInt:
-	    size = sizeof(int); break;
-	 case kIntArray:
-	    size = sizeof(int)*numParticles; break;
-	 case kDouble:
-	    size = sizeof(double); break;
-	 case kDoubleArray:
-	    size = sizeof(double)*numParticles; break;
-	 case kVector:
-	    size = sizeof(double)*3; break;
-	 case kVectorArray:
-	    size = sizeof(double)*3*numParticles; break;
-	 default:
-	    fprintf(stderr,"Unknown attribute type %d.", type);
-	    size = sizeof(double);
-      }
+      const char* loc = pdc.data(i);
 
       if ( strcmp(attr, "position") == 0 )
       {
 	 positionFound = true;
 	 cache->pos.resize( numParticles );
-	 miGeoVector* t = (miGeoVector*)loc;
+	 const miGeoVector* t = (const miGeoVector*)
+	    pdcDoubles( loc, numParticles * 3, swap, swapBuf );
 	 for ( unsigned j = 0; j < numParticles; ++j, ++t )
 	 {
 	    miGeoVector tmp = *t;
-	    SWAP_VECTOR( tmp );
 	    cache->pos[j].x = (float) tmp.x;
 	    cache->pos[j].y = (float) tmp.y;
 	    cache->pos[j].z = (float) tmp.z;
@@ -349,11 +322,11 @@ DLLEXPORT void mrl_volume_isect_init(
       else if ( !positionFound && strcmp(attr, "worldPosition") == 0 )
       {
 	 cache->pos.resize( numParticles );
-	 miGeoVector* t = (miGeoVector*)loc;
+	 const miGeoVector* t = (const miGeoVector*)
+	    pdcDoubles( loc, numParticles * 3, swap, swapBuf );
 	 for ( unsigned j = 0; j < numParticles; ++j, ++t )
 	 {
 	    miGeoVector tmp = *t;
-	    SWAP_VECTOR( tmp );
 	    cache->pos[j].x = (float) tmp.x;
 	    cache->pos[j].y = (float) tmp.y;
 	    cache->pos[j].z = (float) tmp.z;
@@ -366,11 +339,11 @@ DLLEXPORT void mrl_volume_isect_init(
       {
 	 velocityFound = true;
 	 cache->vel.resize( numParticles );
-	 miGeoVector* t = (miGeoVector*)loc;
+	 const miGeoVector* t = (const miGeoVector*)
+	    pdcDoubles( loc, numParticles * 3, swap, swapBuf );
 	 for ( unsigned j = 0; j < numParticles; ++j, ++t )
 	 {
 	    miGeoVector tmp = *t;
-	    SWAP_VECTOR( tmp );
 	    tmp /= frameRate;
 	    cache->vel[j].x = (float) tmp.x;
 	    cache->vel[j].y = (float) tmp.y;
@@ -381,11 +354,11 @@ DLLEXPORT void mrl_volume_isect_init(
 		strcmp(attr, "worldVelocity") == 0 )
       {
 	 cache->vel.resize( numParticles );
-	 miGeoVector* t = (miGeoVector*)loc;
+	 const miGeoVector* t = (const miGeoVector*)
+	    pdcDoubles( loc, numParticles * 3, swap, swapBuf );
 	 for ( unsigned j = 0; j < numParticles; ++j, ++t )
 	 {
 	    miGeoVector tmp = *t;
-	    SWAP_VECTOR( tmp );
 	    tmp /= frameRate;
 	    cache->vel[j].x = (float) tmp.x;
 	    cache->vel[j].y = (float) tmp.y;
@@ -398,11 +371,10 @@ DLLEXPORT void mrl_volume_isect_init(
       {
 	 radiiFound = true;
 	 cache->radii.resize( numParticles );
-	 double* t = (double*)loc;
+	 const double* t = pdcDoubles( loc, numParticles, swap, swapBuf );
 	 for ( unsigned j = 0; j < numParticles; ++j, ++t )
 	 {
 	    double tmp = *t;
-            SWAP_DOUBLE( tmp );
 	    cache->radii[j] = (float) tmp;
 	 }
       }
@@ -421,11 +393,10 @@ DLLEXPORT void mrl_volume_isect_init(
       {
 	idFound = true;
 	cache->id.resize( numParticles );
-	double* t = (double*)loc;
+	const double* t = pdcDoubles( loc, numParticles, swap, swapBuf );
 	for ( unsigned j = 0; j < numParticles; ++j, ++t )
 	  {
 	    double tmp = *t;
-            SWAP_DOUBLE( tmp );
 	    cache->id[j] = (unsigned) tmp;
 	  }
       }
@@ -433,22 +404,17 @@ DLLEXPORT void mrl_volume_isect_init(
       {
 	 rotationFound = true;
 	 cache->rot.resize( numParticles );
-	 miGeoVector* t = (miGeoVector*)loc;
+	 const miGeoVector* t = (const miGeoVector*)
+	    pdcDoubles( loc, numParticles * 3, swap, swapBuf );
 	 for ( unsigned j = 0; j < numParticles; ++j, ++t )
 	 {
 	    miGeoVector tmp = *t;
-	    SWAP_VECTOR( tmp );
 	    cache->rot[j].x = (float) tmp.x;
 	    cache->rot[j].y = (float) tmp.y;
 	    cache->rot[j].z = (float) tmp.z;
 	 }
       }
-
-      
-      loc += size;
    }
-   
-   mi_db_unpin( cache->pdcTag );
 
    if ( numParticles == 0 ) return;
 
@@ -30,18 +30,29 @@
 //
 
 #include "pdcAux.h"
+#include "mrPDC2.h"
+#include "mrMappedFile.h"
 #include "mrGenerics.h"
 
 
 void  swapUserdata( miUserdata* data )
 {
    data->one = 1;
-   int len = data->parameter_size;
-   char* d = data->parameters;
-   char* e = d + len;
-   for ( ; d < e; d += 4 )
-      swap4Bytes( d );
-   
+   ByteSwapBlock( data->parameters, data->parameters,
+		  data->parameter_size / 4, 4 );
+}
+
+//! Fix the byte order of user data holding a PDC file or a reference to
+//! a .pdc2 file, and return whether it is one of those.
+static bool isPDCData( miUserdata* data )
+{
+   if ( strncmp( data->parameters, " CDP", 4 ) == 0 ||
+	strncmp( data->parameters, "RCDP", 4 ) == 0 )
+   {
+      swapUserdata( data );
+   }
+   return ( strncmp( data->parameters, "PDC ", 4 ) == 0 ||
+	    strncmp( data->parameters, PDC2_REF_MAGIC, 4 ) == 0 );
 }
 
 #define obj_error(err) mr_error( tag2name(objTag) << err );
@@ -90,12 +101,7 @@ PDC_Header* readPDC( miTag& dataTag, miState* const state )
       return NULL;
    }
 
-   if ( strncmp( data->parameters, " CDP", 4 ) == 0 )
-   {
-      swapUserdata( data );
-   }
-
-   while ( strncmp( data->parameters, "PDC ", 4 ) != 0 )
+   while ( !isPDCData( data ) )
    {
       mi_db_unpin( dataTag );
       dataTag = data->next_data;
@@ -110,13 +116,122 @@ PDC_Header* readPDC( miTag& dataTag, miState* const state )
 	 pdc_error(": (mrl_volume_isect) empty user data found");
 	 return NULL;
       }
-      
-      if ( strncmp( data->parameters, " CDP", 4 ) == 0 )
+   }
+
+   return (PDC_Header*) data->parameters;
+}
+
+
+PDC_Reader::PDC_Reader( miTag& dataTag, miState* const state ) :
+tag( miNULLTAG ),
+map( NULL ),
+num( 0 ),
+swap_( false ),
+ok( false )
+{
+   const char* data = (const char*) readPDC( dataTag, state );
+   if ( data == NULL ) return;
+
+   tag = dataTag;
+   if ( strncmp( data, PDC2_REF_MAGIC, 4 ) == 0 )
+      ok = openPDC2( data + 4 );
+   else
+      ok = parsePDC( (const PDC_Header*) data );
+}
+
+
+PDC_Reader::~PDC_Reader()
+{
+   delete map;
+   if ( tag != miNULLTAG ) mi_db_unpin( tag );
+}
+
+
+bool PDC_Reader::parsePDC( const PDC_Header* header )
+{
+   bool swap = ( header->endian != 1 );
+   swap_ = swap;
+
+   unsigned numParticles = header->count;
+   unsigned numAttrs = header->numAttrs;
+   SWAP_INT( numParticles );
+   SWAP_INT( numAttrs );
+   num = numParticles;
+
+   attrs.resize( numAttrs );
+   const char* loc = ((const char*)header) + sizeof( PDC_Header );
+   for ( unsigned i = 0; i < numAttrs; ++i )
+   {
+      int len = *((int*) loc);  loc += sizeof(int);
+      SWAP_INT(len);
+
+      Attr& a = attrs[i];
+      a.name.assign( loc, len );
+      loc += len;
+
+      a.type = (Types) *((int*) loc); loc += sizeof(int);
+      SWAP_INT( a.type );
+      a.data = loc;
+
+      unsigned long long size = pdc2Bytes( a.type, numParticles );
+      if ( size == 0 )
       {
-	 swapUserdata( data );
-	 break;
+	 mi_error("Unknown attribute type %d in pdc file.", a.type);
+	 size = sizeof(double);
       }
+      loc += size;
    }
+   return true;
+}
 
-   return (PDC_Header*) data->parameters;
+
+bool PDC_Reader::openPDC2( const char* file )
+{
+   map = new mrMappedFile( file );
+   const char* data = map->data();
+   if ( data == NULL || map->size() < sizeof(PDC2_Header) )
+   {
+      mi_error("Could not read particle cache \"%s\".", file);
+      return false;
+   }
+
+   PDC2_Header h = *((const PDC2_Header*) data);
+   bool swap = ( h.endian != 1 );
+   swap_ = swap;
+   SWAP_INT( h.version );
+   SWAP_INT( h.count );
+   SWAP_INT( h.numAttrs );
+   SWAP_DOUBLE( h.size );
+   if ( strncmp( h.magic, PDC2_MAGIC, 4 ) != 0 || 
+	h.version > PDC2_VERSION || h.size > map->size() ||
+	sizeof(h) + sizeof(PDC2_Attr) * (unsigned long long) h.numAttrs > 
+	h.size )
+   {
+      mi_error("Invalid particle cache \"%s\".", file);
+      return false;
+   }
+   num = h.count;
+
+   const PDC2_Attr* index = (const PDC2_Attr*) ( data + sizeof(h) );
+   attrs.resize( h.numAttrs );
+   for ( unsigned i = 0; i < h.numAttrs; ++i )
+   {
+      PDC2_Attr a = index[i];
+      SWAP_INT( a.type );
+      SWAP_DOUBLE( a.offset );
+      SWAP_DOUBLE( a.bytes );
+      a.name[ sizeof(a.name) - 1 ] = 0;
+      if ( a.bytes != pdc2Bytes( a.type, num ) || a.offset > h.size ||
+	   a.bytes > h.size - a.offset )
+      {
+	 mi_error("Invalid attribute \"%s\" in particle cache \"%s\".",
+		  a.name, file);
+	 return false;
+      }
+
+      attrs[i].name = a.name;
+      attrs[i].type = (Types) a.type;
+      attrs[i].data = data + a.offset;
+   }
+   return true;
 }
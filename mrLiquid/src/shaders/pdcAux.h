@@ -29,8 +29,15 @@
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //
 
+#include <vector>
+#include <string>
+
 #include <shader.h>
 
+#ifndef mrByteSwap_h
+#include "mrByteSwap.h"
+#endif
+
 enum Types
 {
 kInt = 0,
@@ -58,37 +65,25 @@ struct PDC_Header
 //! Swap 8 bytes
 inline void swap8Bytes( char* d )
 {
-  union
-  {
-    double f;
-    char b[8];
-  } dat1;
-
-  dat1.f = *((double*)d);
-  d[0] = dat1.b[7];
-  d[1] = dat1.b[6];
-  d[2] = dat1.b[5];
-  d[3] = dat1.b[4];
-  d[4] = dat1.b[3];
-  d[5] = dat1.b[2];
-  d[6] = dat1.b[1];
-  d[7] = dat1.b[0];
+  ByteSwapElement( d, d, 8 );
 }
 
 //! Swap 4 bytes
 inline void swap4Bytes( char* d )
 {
-  union
-  {
-    int f;
-    char b[4];
-  } dat1;
-
-  dat1.f = *((int*)d);
-  d[0] = dat1.b[3];
-  d[1] = dat1.b[2];
-  d[2] = dat1.b[1];
-  d[3] = dat1.b[0];
+  ByteSwapElement( d, d, 4 );
+}
+
+//! Return num doubles of PDC data at loc in host byte order.  If no
+//! swapping is needed, this is loc itself.  Otherwise, they are swapped
+//! all at once into buf.
+inline const double* pdcDoubles( const char* loc, const unsigned num,
+				 const bool swap, std::vector< double >& buf )
+{
+  if ( !swap ) return (const double*) loc;
+  buf.resize( num );
+  if ( num ) ByteSwapBlock( &buf[0], loc, num, sizeof(double) );
+  return num ? &buf[0] : (const double*) loc;
 }
 
 //! Given a state, it will search all object data for object attached to
@@ -107,6 +102,55 @@ miTag findPDCInObject( miState* const state );
 PDC_Header* readPDC( miTag& dataTag, miState* const state );
 
 
+class mrMappedFile;
+
+//! Attributes of a particle cache, either a Maya PDC file loaded as user
+//! data or a .pdc2 file (see mrPDC2.h) that the user data refers to,
+//! which is mapped into memory and used in place.  dataTag is found as
+//! in readPDC() and stays pinned (and the .pdc2 file mapped) for the
+//! life of the reader.
+class PDC_Reader
+{
+   public:
+     PDC_Reader( miTag& dataTag, miState* const state );
+     ~PDC_Reader();
+
+     //! Was a particle cache found?
+     inline bool valid() const { return ok; }
+
+     //! Does the data of attributes need to be byte-swapped?
+     inline bool swap() const { return swap_; }
+
+     inline unsigned count() const    { return num; }
+     inline unsigned numAttrs() const { return (unsigned) attrs.size(); }
+
+     inline const char* name( unsigned i ) const { return attrs[i].name.c_str(); }
+     inline Types       type( unsigned i ) const { return attrs[i].type; }
+     inline const char* data( unsigned i ) const { return attrs[i].data; }
+
+   private:
+     PDC_Reader( const PDC_Reader& );
+     PDC_Reader& operator=( const PDC_Reader& );
+
+     bool parsePDC( const PDC_Header* header );
+     bool openPDC2( const char* file );
+
+     struct Attr
+     {
+       std::string name;
+       Types       type;
+       const char* data;
+     };
+
+     std::vector< Attr > attrs;
+     miTag         tag;
+     mrMappedFile* map;
+     unsigned      num;
+     bool          swap_;
+     bool          ok;
+};
+
+
 #define    SWAP_INT(x) if ( swap ) swap4Bytes((char*) &x)
 #define SWAP_DOUBLE(x) if ( swap ) swap8Bytes((char*) &x)
 #define SWAP_VECTOR(v) if ( swap ) { \
@@ -0,0 +1,85 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef benchTimer_h
+#define benchTimer_h
+
+#if defined(WIN32) || defined(WIN64)
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+#include <cstdio>
+
+
+//! Wall clock time in seconds.
+inline double bench_time()
+{
+#if defined(WIN32) || defined(WIN64)
+   static LARGE_INTEGER freq = { 0 };
+   if ( freq.QuadPart == 0 ) QueryPerformanceFrequency( &freq );
+   LARGE_INTEGER t;
+   QueryPerformanceCounter( &t );
+   return (double) t.QuadPart / (double) freq.QuadPart;
+#else
+   struct timeval t;
+   gettimeofday( &t, NULL );
+   return (double) t.tv_sec + (double) t.tv_usec * 1e-6;
+#endif
+}
+
+//! Print one line of a benchmark report.
+inline void bench_report( const char* name, const char* what,
+			  size_t n, double secs )
+{
+   printf( "%-24s %-12s %10lu ops %9.2f ms %8.1f ns/op\n",
+	   name, what, (unsigned long) n, secs * 1000.0,
+	   n ? secs * 1e9 / (double) n : 0.0 );
+}
+
+//! Simple xorshift random number generator, so results do not depend
+//! on the platform's rand().
+struct benchRandom
+{
+   unsigned long long s;
+   benchRandom( unsigned long long seed = 0x2545F4914F6CDD1DULL ) : s(seed) {}
+   unsigned long long next()
+   {
+      s ^= s << 13; s ^= s >> 7; s ^= s << 17;
+      return s;
+   }
+   unsigned bits32() { return (unsigned) (next() >> 32); }
+   float    uniform() { return (float) (next() >> 40) / 16777216.0f; }
+};
+
+
+#endif // benchTimer_h
@@ -0,0 +1,273 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+//
+// Benchmark of corner welding in mrMesh::write_trilist().
+//
+// Welds the corners of a synthetic dense quad grid (smooth normals, one
+// uv set with a seam down the middle) into mesh vertices, both with
+// mrCornerHash and with the std::multimap of heap allocated VertexStores
+// that mrMesh used before.  A std::vector stands in for maya's
+// MIntArray.  Reports time and peak RSS, and checks that both produce
+// the same triangles.
+//
+// Usage:
+//
+// mrCornerHashBench [GRID] [new|old|both]
+//
+// GRID is the number of quads along each side (default 1000).  Peak RSS
+// is a high water mark for the whole process, so for exact numbers run
+// "new" and "old" as separate processes.  "both" runs new first.
+//
+
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <map>
+#include <vector>
+
+#include "mrCornerHash.h"
+#include "benchTimer.h"
+
+#if defined(WIN32) || defined(WIN64)
+#  include <psapi.h>
+#else
+#  include <sys/resource.h>
+#endif
+
+
+//! Peak resident set size of the process in MB.
+static double peak_rss()
+{
+#if defined(WIN32) || defined(WIN64)
+   PROCESS_MEMORY_COUNTERS pmc;
+   GetProcessMemoryInfo( GetCurrentProcess(), &pmc, sizeof(pmc) );
+   return (double) pmc.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+   struct rusage r;
+   getrusage( RUSAGE_SELF, &r );
+#  ifdef __APPLE__
+   return (double) r.ru_maxrss / (1024.0 * 1024.0);
+#  else
+   return (double) r.ru_maxrss / 1024.0;
+#  endif
+#endif
+}
+
+
+//! Triangulated corners of the grid, as write_trilist() sees them.
+struct Grid
+{
+     std::vector< unsigned > id;     // vertex id per corner
+     std::vector< unsigned > nid;    // normal id per corner
+     std::vector< int >      uvId;   // uv id per corner
+     std::vector< float >    u, v;   // uvs
+
+     Grid( unsigned n )
+     {
+	unsigned row = n + 1;
+	unsigned seam = n / 2;
+
+	// uvs: one per vertex, plus a second copy of the seam column
+	for ( unsigned y = 0; y <= n; ++y )
+	   for ( unsigned x = 0; x <= n; ++x )
+	   {
+	      u.push_back( (float) x / n );
+	      v.push_back( (float) y / n );
+	   }
+	unsigned seamBase = (unsigned) u.size();
+	for ( unsigned y = 0; y <= n; ++y )
+	{
+	   u.push_back( (float) seam / n + 0.5f );
+	   v.push_back( (float) y / n );
+	}
+
+	static const unsigned tri[6][2] = {
+	{ 0, 0 }, { 1, 0 }, { 1, 1 },
+	{ 0, 0 }, { 1, 1 }, { 0, 1 }
+	};
+
+	size_t corners = (size_t) n * n * 6;
+	id.reserve( corners );
+	nid.reserve( corners );
+	uvId.reserve( corners );
+	for ( unsigned y = 0; y < n; ++y )
+	   for ( unsigned x = 0; x < n; ++x )
+	      for ( unsigned c = 0; c < 6; ++c )
+	      {
+		 unsigned vx = x + tri[c][0];
+		 unsigned vy = y + tri[c][1];
+		 unsigned vid = vy * row + vx;
+		 id.push_back( vid );
+		 nid.push_back( vid );   // smooth normals
+		 if ( vx == seam && x == seam )
+		    uvId.push_back( (int) (seamBase + vy) );
+		 else
+		    uvId.push_back( (int) vid );
+	      }
+     }
+
+     size_t corners() const { return id.size(); }
+
+     bool same_uv( int a, int b ) const
+     {
+	if ( a == b ) return true;
+	if ( a < 0 || b < 0 ) return false;
+	return ( fabs( u[a] - u[b] ) <= 0.001f &&
+		 fabs( v[a] - v[b] ) <= 0.001f );
+     }
+};
+
+
+//! Welding with mrCornerHash, as mrMesh does now.
+static void weld_new( const Grid& g, std::vector< unsigned >& tris,
+		      unsigned& numVerts )
+{
+   mrCornerHash hash;
+   unsigned numMeshVerts = (unsigned) ( sqrt( (double) g.corners() / 6 ) + 1 );
+   hash.init( 1, numMeshVerts * numMeshVerts );
+
+   tris.reserve( g.corners() );
+   for ( size_t i = 0; i < g.corners(); ++i )
+   {
+      unsigned s = hash.find( g.id[i], g.nid[i] );
+      for ( ; s != mrCornerHash::kNone; s = hash.next( s ) )
+	 if ( g.same_uv( hash.uvIds( s )[0], g.uvId[i] ) ) break;
+
+      if ( s == mrCornerHash::kNone )
+      {
+	 s = hash.insert( g.id[i], g.nid[i] );
+	 hash.uvIds( s )[0] = g.uvId[i];
+      }
+      tris.push_back( s );
+   }
+   numVerts = hash.size();
+   hash.clear();
+}
+
+
+//! Welding with a multimap of VertexStores, as mrMesh did before.
+struct VertexStore
+{
+     unsigned           id;
+     unsigned           vid;
+     unsigned           nid;
+     std::vector< int > uvId;
+};
+
+static void weld_old( const Grid& g, std::vector< unsigned >& tris,
+		      unsigned& numVerts )
+{
+   typedef std::multimap< unsigned, VertexStore* > VertexHash_t;
+   VertexHash_t vertexHash;
+   std::vector< VertexStore* > triList;
+   triList.reserve( g.corners() );
+
+   tris.reserve( g.corners() );
+   for ( size_t i = 0; i < g.corners(); ++i )
+   {
+      VertexStore* s = NULL;
+      VertexHash_t::iterator it  = vertexHash.find( g.id[i] );
+      VertexHash_t::iterator end = vertexHash.end();
+      if ( it != end )
+      {
+	 end = vertexHash.upper_bound( g.id[i] );
+	 for ( ; it != end; ++it )
+	 {
+	    VertexStore* x = it->second;
+	    if ( x->nid != g.nid[i] || x->uvId.size() != 1 ) continue;
+	    if ( !g.same_uv( x->uvId[0], g.uvId[i] ) ) continue;
+	    s = x;
+	    break;
+	 }
+      }
+
+      if ( s == NULL )
+      {
+	 s = new VertexStore();
+	 s->id  = g.id[i];
+	 s->vid = (unsigned) vertexHash.size();
+	 s->nid = g.nid[i];
+	 s->uvId.resize( 1 );
+	 s->uvId[0] = g.uvId[i];
+	 vertexHash.insert( std::make_pair( s->id, s ) );
+	 triList.push_back( s );
+      }
+      tris.push_back( s->vid );
+   }
+   numVerts = (unsigned) triList.size();
+
+   VertexHash_t::iterator i = vertexHash.begin();
+   VertexHash_t::iterator e = vertexHash.end();
+   for ( ; i != e; ++i ) delete i->second;
+}
+
+
+int main( int argc, char** argv )
+{
+   unsigned n = argc > 1 ? (unsigned) atoi( argv[1] ) : 1000;
+   const char* mode = argc > 2 ? argv[2] : "both";
+   bool runNew = strcmp( mode, "old" ) != 0;
+   bool runOld = strcmp( mode, "new" ) != 0;
+
+   Grid g( n );
+   printf( "%ux%u grid, %lu corners, input %.0f MB\n", n, n,
+	   (unsigned long) g.corners(), peak_rss() );
+
+   std::vector< unsigned > a, b;
+   unsigned na = 0, nb = 0;
+
+   if ( runNew )
+   {
+      double t = bench_time();
+      weld_new( g, a, na );
+      t = bench_time() - t;
+      printf( "mrCornerHash  %9.0f ms  peak RSS %6.0f MB  %u vertices\n",
+	      t * 1000.0, peak_rss(), na );
+   }
+
+   if ( runOld )
+   {
+      double t = bench_time();
+      weld_old( g, b, nb );
+      t = bench_time() - t;
+      printf( "multimap      %9.0f ms  peak RSS %6.0f MB  %u vertices\n",
+	      t * 1000.0, peak_rss(), nb );
+   }
+
+   if ( runNew && runOld && ( a != b || na != nb ) )
+   {
+      printf( "ERROR: triangles differ\n" );
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,194 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+//
+// Benchmark of mrGroup's membership operations.
+//
+// mrGroup itself needs maya, so this times its member list, mrPtrList
+// from mrPtrIndex.h (insertion ordered vector, mrPtrIndex and NULL holes
+// compacted on iteration), and compares it against the plain vector +
+// std::find it replaced.
+//
+// Usage:
+//
+// mrGroupBench [N] [LINEAR_N]
+//
+// N defaults to 1000000.  The linear version is quadratic, so it runs
+// with LINEAR_N elements (default 20000).
+//
+
+#include <cstdlib>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+#include "mrPtrIndex.h"
+#include "benchTimer.h"
+
+
+struct Node { int id; };
+
+
+//! mrGroup< D, C > keeps its members in an mrPtrList< D, C >.
+typedef mrPtrList< Node > IndexedMembers;
+
+
+//! The vector + std::find members mrGroup used before.
+class LinearMembers
+{
+     std::vector< Node* > members;
+
+   public:
+     bool push_back( Node* elem )
+     {
+	members.push_back( elem );
+	return true;
+     }
+
+     bool contains( const Node* elem ) const
+     {
+	return std::find( members.begin(), members.end(), elem ) !=
+	       members.end();
+     }
+
+     bool erase( Node* elem )
+     {
+	std::vector< Node* >::iterator i = std::find( members.begin(),
+						      members.end(), elem );
+	if ( i == members.end() ) return false;
+	members.erase( i );
+	return true;
+     }
+
+     std::vector< Node* >::iterator begin() { return members.begin(); }
+     std::vector< Node* >::iterator end()   { return members.end(); }
+};
+
+
+struct Workload
+{
+     std::vector< Node >  nodes;
+     std::vector< Node* > order;    // insertion order
+     std::vector< Node* > queries;  // half members, half strangers
+     std::vector< Node* > erased;   // every other member, shuffled
+
+     Workload( size_t n ) : nodes( n * 2 )
+     {
+	benchRandom rnd;
+	for ( size_t i = 0; i < nodes.size(); ++i ) nodes[i].id = (int) i;
+
+	for ( size_t i = 0; i < n; ++i ) order.push_back( &nodes[i * 2] );
+	shuffle( order, rnd );
+
+	for ( size_t i = 0; i < n; ++i )
+	   queries.push_back( &nodes[ (rnd.next() % n) * 2 + (i & 1) ] );
+
+	for ( size_t i = 0; i < n; i += 2 ) erased.push_back( order[i] );
+	shuffle( erased, rnd );
+     }
+
+     static void shuffle( std::vector< Node* >& v, benchRandom& rnd )
+     {
+	for ( size_t i = v.size(); i > 1; --i )
+	   std::swap( v[i-1], v[ rnd.next() % i ] );
+     }
+};
+
+
+template< class M >
+static size_t run( const char* name, const Workload& w,
+		   std::vector< Node* >& result )
+{
+   M m;
+   size_t hits = 0;
+
+   double t = bench_time();
+   for ( size_t i = 0; i < w.order.size(); ++i )
+      m.push_back( w.order[i] );
+   bench_report( name, "insert", w.order.size(), bench_time() - t );
+
+   t = bench_time();
+   for ( size_t i = 0; i < w.queries.size(); ++i )
+      hits += m.contains( w.queries[i] );
+   bench_report( name, "contains", w.queries.size(), bench_time() - t );
+
+   t = bench_time();
+   for ( size_t i = 0; i < w.erased.size(); ++i )
+      m.erase( w.erased[i] );
+   result.assign( m.begin(), m.end() );
+   bench_report( name, "erase", w.erased.size(), bench_time() - t );
+
+   return hits;
+}
+
+
+static bool check( size_t n )
+{
+   Workload w( n );
+   std::vector< Node* > a, b;
+   size_t ha = run< IndexedMembers >( "indexed", w, a );
+   size_t hb = run< LinearMembers >(  "linear",  w, b );
+   return ha == hb && a == b;
+}
+
+
+int main( int argc, char** argv )
+{
+   size_t n    = argc > 1 ? (size_t) atol( argv[1] ) : 1000000;
+   size_t nlin = argc > 2 ? (size_t) atol( argv[2] ) : 20000;
+
+   printf( "mrGroup membership, %lu members\n", (unsigned long) n );
+   Workload w( n );
+   std::vector< Node* > result;
+   run< IndexedMembers >( "indexed", w, result );
+
+   printf( "\nindexed vs linear, %lu members\n", (unsigned long) nlin );
+   if ( !check( nlin ) )
+   {
+      printf( "ERROR: indexed and linear members differ\n" );
+      return 1;
+   }
+
+   // Inserting a member twice must not add a second entry.
+   IndexedMembers m;
+   Node x;
+   m.push_back( &x );
+   if ( m.push_back( &x ) || m.size() != 1 ||
+	m.end() - m.begin() != 1 )
+   {
+      printf( "ERROR: duplicate insert added a member\n" );
+      return 1;
+   }
+
+   printf( "\nOK\n" );
+   return 0;
+}
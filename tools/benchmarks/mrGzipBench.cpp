@@ -0,0 +1,234 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+
+//
+// Throughput against compression ratio of the gzip .mi writer.
+//
+// Writes the same ascii .mi stream (polygon mesh objects laid out as
+// mrMesh writes them, plus an instance of each) through mrlFile, first
+// plain (level 0) and then with mrlFile::open_gz() at levels 1 to 9.
+// Each compressed file is read back with zlib and compared with the
+// plain one.  MB/s is megabytes of .mi text written per second, before
+// compression, including closing the file.  Files are removed
+// afterwards.
+//
+// Usage:
+//
+// mrGzipBench [N] [dir]
+//
+// N   number of mesh objects, 16384 vertices each (default 16)
+// dir directory for the files (default .)
+//
+
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <zlib.h>
+
+#include "mrlBufferedIO.h"
+#include "benchTimer.h"
+
+
+static const int kGrid = 128;   // vertices per side of each mesh
+
+// As set by mrOptions for the default exportFloatPrecision of 6.
+static const char* kMatrixSpec =
+"%.6g %.6g %.6g %.6g\n%.6g %.6g %.6g %.6g\n"
+"%.6g %.6g %.6g %.6g\n%.6g %.6g %.6g %.6g\n";
+
+
+//! Write a wavy grid as a polygon object, like mrMesh::write_group().
+static void write_object( mrlFile* f, const int n )
+{
+  f->printf( "object \"pPlaneShape%d\"\n", n );
+  f->puts( "\tvisible on\n\tshadow on\n\ttrace on\n" );
+  f->puts( "\tgroup\n" );
+
+  float ox = (float) ( n % 8 ) * 10.0f;
+  float oz = (float) ( n / 8 ) * 10.0f;
+  float ph = (float) n * 0.37f;
+
+  // positions
+  for ( int j = 0; j < kGrid; ++j )
+    for ( int i = 0; i < kGrid; ++i )
+      {
+	float x = ox + i * 10.0f / ( kGrid - 1 );
+	float z = oz + j * 10.0f / ( kGrid - 1 );
+	float y = 0.5f * sinf( x * 0.9f + ph ) * cosf( z * 1.3f );
+	f->printf( "\t\t%g %g %g\n", x, y, z );
+      }
+
+  // normals
+  for ( int j = 0; j < kGrid; ++j )
+    for ( int i = 0; i < kGrid; ++i )
+      {
+	float x = ox + i * 10.0f / ( kGrid - 1 );
+	float z = oz + j * 10.0f / ( kGrid - 1 );
+	float dx = -0.45f * cosf( x * 0.9f + ph ) * cosf( z * 1.3f );
+	float dz =  0.65f * sinf( x * 0.9f + ph ) * sinf( z * 1.3f );
+	float len = sqrtf( dx * dx + 1.0f + dz * dz );
+	f->printf( "\t\t%g %g %g\n", dx / len, 1.0f / len, dz / len );
+      }
+
+  // uvs
+  for ( int j = 0; j < kGrid; ++j )
+    for ( int i = 0; i < kGrid; ++i )
+      f->printf( "\t\t%g %g 0\n", (float) i / ( kGrid - 1 ),
+		 (float) j / ( kGrid - 1 ) );
+
+  const int numVerts = kGrid * kGrid;
+  for ( int v = 0; v < numVerts; ++v )
+    f->printf( "\t\tv %d n %d t %d\n", v, numVerts + v, 2 * numVerts + v );
+
+  for ( int j = 0; j < kGrid - 1; ++j )
+    for ( int i = 0; i < kGrid - 1; ++i )
+      {
+	int v = j * kGrid + i;
+	f->printf( "\t\tp %d %d %d %d\n", v, v + 1, v + kGrid + 1, v + kGrid );
+      }
+
+  f->puts( "\tend group\nend object\n\n" );
+
+  f->printf( "instance \"pPlane%d\" \"pPlaneShape%d\"\n", n, n );
+  f->puts( "\ttransform\n" );
+  float s = sinf( ph ), c = cosf( ph );
+  f->printf( kMatrixSpec,
+	     c, 0.0, -s, 0.0,   0.0, 1.0, 0.0, 0.0,
+	     s, 0.0, c, 0.0,    -ox * c, 0.0, -oz, 1.0 );
+  f->puts( "\tmaterial [ \"lambert2SG\" ]\nend instance\n\n" );
+}
+
+static double write_file( const std::string& name, const int level,
+			  const int numObjects, unsigned long long& bytes )
+{
+  double t = bench_time();
+  mrlFile* f = ( level > 0 ? mrlFile::open_gz( name.c_str(), level ) :
+		 mrlFile::open( name.c_str(), "wb" ) );
+  if ( !f )
+    {
+      fprintf( stderr, "Could not create \"%s\"\n", name.c_str() );
+      exit(1);
+    }
+
+  f->puts( "verbose on\nlink \"base.so\"\n$include \"base.mi\"\n\n" );
+  for ( int n = 0; n < numObjects; ++n )
+    write_object( f, n );
+
+  bytes = f->tell();
+  if ( mrlFile::close( f ) != 0 )
+    {
+      fprintf( stderr, "Could not write \"%s\"\n", name.c_str() );
+      exit(1);
+    }
+  return bench_time() - t;
+}
+
+static long file_size( const std::string& name )
+{
+  FILE* fp = fopen( name.c_str(), "rb" );
+  if ( !fp ) return 0;
+  fseek( fp, 0, SEEK_END );
+  long size = ftell( fp );
+  fclose( fp );
+  return size;
+}
+
+//! Check that the gzip file decompresses to the plain one.
+static bool same_contents( const std::string& plain, const std::string& gz )
+{
+  FILE* fp = fopen( plain.c_str(), "rb" );
+  gzFile z = gzopen( gz.c_str(), "rb" );
+  bool ok = ( fp != NULL && z != NULL );
+
+  static char a[65536], b[65536];
+  while ( ok )
+    {
+      size_t na = fread( a, 1, sizeof(a), fp );
+      int    nb = gzread( z, b, sizeof(b) );
+      if ( nb < 0 || (size_t) nb != na || memcmp( a, b, na ) != 0 )
+	ok = false;
+      if ( na == 0 ) break;
+    }
+
+  if ( fp ) fclose( fp );
+  if ( z )  gzclose( z );
+  return ok;
+}
+
+
+int main( int argc, char** argv )
+{
+  int numObjects = argc > 1 ? atoi( argv[1] ) : 16;
+  std::string dir = argc > 2 ? argv[2] : ".";
+  if ( numObjects < 1 ) numObjects = 1;
+
+  std::string plain = dir + "/mrGzipBench.mi";
+  std::string gz    = dir + "/mrGzipBench.mi.gz";
+
+  printf( "%d mesh objects, %d vertices\n\n", numObjects,
+	  numObjects * kGrid * kGrid );
+  printf( "%-6s %10s %10s %10s %8s\n", "level", "seconds", "MB/s",
+	  "size MB", "ratio" );
+
+  bool ok = true;
+  long plainSize = 0;
+  for ( int level = 0; level <= 9; ++level )
+    {
+      const std::string& name = level ? gz : plain;
+      unsigned long long bytes;
+      double secs = write_file( name, level, numObjects, bytes );
+      long size = file_size( name );
+      if ( level == 0 ) plainSize = size;
+
+      printf( "%-6d %10.2f %10.1f %10.1f %8.2f\n", level, secs,
+	      bytes / secs / 1e6, size / 1e6,
+	      size ? (double) plainSize / size : 0.0 );
+
+      if ( level > 0 )
+	{
+	  if ( !same_contents( plain, gz ) )
+	    {
+	      printf( "ERROR: level %d does not decompress to the plain file\n",
+		      level );
+	      ok = false;
+	    }
+	  remove( gz.c_str() );
+	}
+    }
+  remove( plain.c_str() );
+
+  if ( !ok ) return 1;
+  printf( "\nOK\n" );
+  return 0;
+}
@@ -0,0 +1,318 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+//
+// Benchmark of the backends mrHash (the node lists) can be built with:
+//
+//   flat      stdext::flat_hash_multimap (gg_flat_hash_map.h, the default)
+//   multimap  stdext::hash_multimap      (gg_hash_map.h, MR_MULTIMAP_HASH)
+//   google    google::dense_hash_map     (MR_GOOGLE)
+//
+// mrHash itself needs maya's MString, so lookups are done here the same
+// way mrHash::find() does them, on nodes named like maya dag paths.
+// The google backend is only built if this is compiled with -DMR_GOOGLE.
+//
+// Usage:
+//
+// mrHashBench [N]
+//
+// N is the number of nodes and defaults to 1000000.
+//
+
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "benchTimer.h"
+
+
+// Same hash and key comparison as mrHash.h
+struct HashFunctor
+{
+  inline size_t operator()( const char* str ) const
+  {
+    size_t hval = 0; 
+    int c;
+    while ( (c = *str++) ) 
+      hval = c + hval * 65599;
+    return hval;
+  }
+};
+
+struct EqualFunctor
+{
+  inline bool operator()( const char* a, const char* b ) const
+  {
+    return (a == b) || (a && b && strcmp(a, b) == 0); 
+  }
+};
+
+#include "gg_hash_map.h"
+#include "gg_flat_hash_map.h"
+#ifdef MR_GOOGLE
+#  include <google/dense_hash_map>
+#endif
+
+
+struct Node
+{
+     std::string name;
+};
+
+
+struct NameEqual
+{
+     const char* name;
+     NameEqual( const char* n ) : name(n) {}
+     inline bool operator()( const Node* node ) const
+     {
+	return strcmp( node->name.c_str(), name ) == 0;
+     }
+};
+
+
+//
+// Each backend wrapped with the find/insert/remove of mrHash
+//
+struct FlatBackend
+{
+     typedef stdext::flat_hash_multimap< const char*, Node* > Map;
+     Map m;
+
+     void insert( Node* n )
+     {
+	m.insert( Map::value_type( n->name.c_str(), n ) );
+     }
+
+     Node* find( const char* name )
+     {
+	Map::iterator i = m.find( HashFunctor()( name ), NameEqual(name) );
+	return i == m.end() ? NULL : i->second;
+     }
+
+     bool remove( const char* name )
+     {
+	Map::iterator i = m.find( HashFunctor()( name ), NameEqual(name) );
+	if ( i == m.end() ) return false;
+	m.erase( i );
+	return true;
+     }
+
+     size_t walk()
+     {
+	size_t n = 0;
+	for ( Map::iterator i = m.begin(); i != m.end(); ++i )
+	   n += i->second->name.size();
+	return n;
+     }
+};
+
+struct MultimapBackend
+{
+     typedef stdext::hash_multimap< const char*, Node* > Map;
+     Map m;
+
+     void insert( Node* n )
+     {
+	m.insert( Map::value_type( n->name.c_str(), n ) );
+     }
+
+     Map::iterator lookup( const char* name )
+     {
+	size_t key = HashFunctor()( name );
+	Map::iterator e = m.end();
+	Map::iterator i = m.find( key );
+	if ( i == e ) return e;
+	Map::iterator u = m.upper_bound( key );
+	for ( ; i != u; ++i )
+	   if ( i->second->name == name ) return i;
+	return e;
+     }
+
+     Node* find( const char* name )
+     {
+	Map::iterator i = lookup( name );
+	return i == m.end() ? NULL : i->second;
+     }
+
+     bool remove( const char* name )
+     {
+	Map::iterator i = lookup( name );
+	if ( i == m.end() ) return false;
+	m.erase( i );
+	return true;
+     }
+
+     size_t walk()
+     {
+	size_t n = 0;
+	for ( Map::iterator i = m.begin(); i != m.end(); ++i )
+	   n += i->second->name.size();
+	return n;
+     }
+};
+
+#ifdef MR_GOOGLE
+struct GoogleBackend
+{
+     typedef google::dense_hash_map< const char*, Node*,
+				     HashFunctor, EqualFunctor > Map;
+     Map m;
+
+     GoogleBackend()
+     {
+	m.set_empty_key( NULL );
+	m.set_deleted_key( "*" );
+     }
+
+     void insert( Node* n )
+     {
+	m.insert( Map::value_type( n->name.c_str(), n ) );
+     }
+
+     Node* find( const char* name )
+     {
+	Map::iterator i = m.find( name );
+	return i == m.end() ? NULL : i->second;
+     }
+
+     bool remove( const char* name )
+     {
+	Map::iterator i = m.find( name );
+	if ( i == m.end() ) return false;
+	m.erase( i );
+	m.resize( 0 );   // as mrHash::remove() does
+	return true;
+     }
+
+     size_t walk()
+     {
+	size_t n = 0;
+	for ( Map::iterator i = m.begin(); i != m.end(); ++i )
+	   n += i->second->name.size();
+	return n;
+     }
+};
+#endif
+
+
+struct Workload
+{
+     std::vector< Node >        nodes;
+     std::vector< std::string > misses;
+     std::vector< size_t >      order;   // random lookup order
+
+     Workload( size_t n ) : nodes( n )
+     {
+	benchRandom rnd;
+	char buf[128];
+	for ( size_t i = 0; i < n; ++i )
+	{
+	   sprintf( buf, "|group%lu|pCube%lu|pCubeShape%lu",
+		    (unsigned long) (i / 100), (unsigned long) i,
+		    (unsigned long) i );
+	   nodes[i].name = buf;
+	   sprintf( buf, "|group%lu|pSphere%lu|pSphereShape%lu",
+		    (unsigned long) (i / 100), (unsigned long) i,
+		    (unsigned long) i );
+	   misses.push_back( buf );
+	   order.push_back( i );
+	}
+	for ( size_t i = n; i > 1; --i )
+	   std::swap( order[i-1], order[ rnd.next() % i ] );
+     }
+};
+
+
+template< class B >
+static bool run( const char* name, Workload& w )
+{
+   B b;
+   size_t n = w.nodes.size();
+   bool ok = true;
+
+   double t = bench_time();
+   for ( size_t i = 0; i < n; ++i )
+      b.insert( &w.nodes[i] );
+   bench_report( name, "insert", n, bench_time() - t );
+
+   t = bench_time();
+   for ( size_t i = 0; i < n; ++i )
+   {
+      Node* x = &w.nodes[ w.order[i] ];
+      if ( b.find( x->name.c_str() ) != x ) ok = false;
+   }
+   bench_report( name, "find hit", n, bench_time() - t );
+
+   t = bench_time();
+   for ( size_t i = 0; i < n; ++i )
+      if ( b.find( w.misses[ w.order[i] ].c_str() ) ) ok = false;
+   bench_report( name, "find miss", n, bench_time() - t );
+
+   t = bench_time();
+   size_t len = b.walk();
+   bench_report( name, "iterate", n, bench_time() - t );
+
+   t = bench_time();
+   for ( size_t i = 0; i < n; i += 2 )
+      if ( !b.remove( w.nodes[ w.order[i] ].name.c_str() ) ) ok = false;
+   bench_report( name, "erase", n / 2, bench_time() - t );
+
+   size_t left = 0;
+   for ( size_t i = 1; i < n; i += 2 )
+      if ( b.find( w.nodes[ w.order[i] ].name.c_str() ) ) ++left;
+   if ( left != n / 2 || len == 0 ) ok = false;
+
+   if ( !ok ) printf( "ERROR: %s returned wrong nodes\n", name );
+   return ok;
+}
+
+
+int main( int argc, char** argv )
+{
+   size_t n = argc > 1 ? (size_t) atol( argv[1] ) : 1000000;
+
+   printf( "mrHash backends, %lu nodes\n", (unsigned long) n );
+   Workload w( n );
+
+   bool ok = run< FlatBackend >( "flat", w );
+   ok &= run< MultimapBackend >( "multimap", w );
+#ifdef MR_GOOGLE
+   ok &= run< GoogleBackend >( "google", w );
+#endif
+
+   if ( !ok ) return 1;
+   printf( "\nOK\n" );
+   return 0;
+}
@@ -0,0 +1,161 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+//
+// Bit exactness test and benchmark of mr_hex_encode(), used by
+// mrObject::write_hex_floats().
+//
+// The output is compared against the old write_hex_floats() loop
+// (swap each float to big endian and print it with %08x) and against
+// the scalar table encoder, for random and special floats (zeros,
+// denormals, infinities, nans, limits), at all alignments and for all
+// lengths up to 256 floats.
+//
+// Usage:
+//
+// mrHexEncodeBench [N]
+//
+// N is the number of floats timed (default 4000000).
+//
+
+#include <cstdlib>
+#include <cstring>
+#include <cfloat>
+#include <vector>
+
+#include "mrHexEncode.h"
+#include "benchTimer.h"
+
+
+//! What the old loop printed for one float: its bytes in memory
+//! order, as a big endian %08x.
+static char* old_encode( char* out, const float* data, size_t num )
+{
+   for ( size_t i = 0; i < num; ++i )
+   {
+      const unsigned char* b = 
+      reinterpret_cast< const unsigned char* >( data + i );
+      unsigned x = ( (unsigned) b[0] << 24 | (unsigned) b[1] << 16 |
+		     (unsigned) b[2] << 8  | (unsigned) b[3] );
+      sprintf( out, "%08x", x );
+      out += 8;
+   }
+   return out;
+}
+
+
+static float from_bits( unsigned u )
+{
+   float f;
+   memcpy( &f, &u, sizeof(f) );
+   return f;
+}
+
+
+int main( int argc, char** argv )
+{
+   size_t n = argc > 1 ? (size_t) atol( argv[1] ) : 4000000;
+   if ( n < 1024 ) n = 1024;
+
+   benchRandom rnd;
+   std::vector< float > data( n + 4 );
+   for ( size_t i = 0; i < data.size(); ++i )
+   {
+      switch( rnd.next() % 4 )
+      {
+	 case 0:  data[i] = from_bits( rnd.bits32() ); break;  // any bits
+	 default: data[i] = ( rnd.uniform() - 0.5f ) * 1000.0f; break;
+      }
+   }
+
+   static const unsigned kSpecial[] = {
+   0x00000000, 0x80000000, 0x00000001, 0x807fffff, 0x00800000,
+   0x7f7fffff, 0xff7fffff, 0x7f800000, 0xff800000, 0x7fc00000,
+   0xffc00000, 0x7f800001, 0x3f800000, 0xbf800000, 0x0f0f0f0f,
+   0xf0f0f0f0, 0x99999999, 0xaaaaaaaa, 0xffffffff, 0x12345678
+   };
+   unsigned numSpecial = sizeof(kSpecial) / sizeof(kSpecial[0]);
+   for ( unsigned i = 0; i < numSpecial; ++i )
+      data[i * 3] = from_bits( kSpecial[i] );
+
+   // Bit exactness, every length up to 256 floats at every alignment
+   std::vector< char > a( data.size() * 8 + 64 ), b( a.size() ), c( a.size() );
+   std::vector< unsigned char > raw( 256 * 4 + 16 );
+   for ( unsigned len = 0; len <= 256; ++len )
+   {
+      for ( unsigned off = 0; off < 16; ++off )
+      {
+	 // Copy the floats to an odd address to test unaligned loads
+	 memcpy( &raw[off], &data[len], len * 4 );
+	 std::vector< float > aligned( len + 1 );
+	 memcpy( &aligned[0], &raw[off], len * 4 );
+
+	 char* ea = old_encode( &a[0], &aligned[0], len );
+	 char* eb = mr_hex_encode( &b[0], &raw[off], len * 4 );
+	 char* ec = mr_hex_encode_scalar( &c[0], &raw[off], len * 4 );
+	 size_t sa = ea - &a[0];
+	 if ( (size_t) (eb - &b[0]) != sa || (size_t) (ec - &c[0]) != sa ||
+	      memcmp( &a[0], &b[0], sa ) != 0 ||
+	      memcmp( &a[0], &c[0], sa ) != 0 )
+	 {
+	    printf( "ERROR: mismatch for %u floats at offset %u\n", len, off );
+	    return 1;
+	 }
+      }
+   }
+
+   // And all of the data at once
+   char* ea = old_encode( &a[0], &data[0], n );
+   double t = bench_time();
+   char* eb = mr_hex_encode( &b[0], &data[0], n * 4 );
+   double tSSE = bench_time() - t;
+   t = bench_time();
+   char* ec = mr_hex_encode_scalar( &c[0], &data[0], n * 4 );
+   double tScalar = bench_time() - t;
+   size_t sa = ea - &a[0];
+   if ( (size_t) (eb - &b[0]) != sa || (size_t) (ec - &c[0]) != sa ||
+	memcmp( &a[0], &b[0], sa ) != 0 || memcmp( &a[0], &c[0], sa ) != 0 )
+   {
+      printf( "ERROR: mismatch encoding %lu floats\n", (unsigned long) n );
+      return 1;
+   }
+
+   t = bench_time();
+   old_encode( &a[0], &data[0], n );
+   double tOld = bench_time() - t;
+
+   bench_report( "%08x per float", "encode", n, tOld );
+   bench_report( "mr_hex_encode_scalar", "encode", n, tScalar );
+   bench_report( "mr_hex_encode", "encode", n, tSSE );
+   printf( "\nOK\n" );
+   return 0;
+}
@@ -0,0 +1,260 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+
+//
+// Export time and file size of a particle instancer written as one mi
+// instance per particle (mrInstance::write_instance) and as the binary
+// .mri stream read by mrl_geo_instancer (options->exportInstancerStream).
+//
+// Only the writing is timed.  The instance matrices are made up front,
+// as both paths compute them the same way in
+// mrParticlesInstancer::write().  Files go through mrlFile, as in the
+// exporter, and are removed afterwards.
+//
+// Usage:
+//
+// mrInstancerStreamBench [N] [dir] [mb]
+//
+// N   number of particles (default 1000000)
+// dir directory for the files (default .)
+// mb  1 to write motion transforms too (default 1)
+//
+
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "mrlBufferedIO.h"
+#include "mrInstancerStream.h"
+#include "benchTimer.h"
+
+
+static const char* kInstancer = "instancerShape1";
+static const char* kShapes[]  = { "pCubeShape1", "pSphereShape1",
+				  "pConeShape1" };
+static const unsigned kNumShapes = 3;
+static const char* kMaterial = "lambert2SG";
+
+// As set by mrOptions for the default exportFloatPrecision of 6.
+static const char* kMatrixSpec =
+"%.6g %.6g %.6g %.6g\n%.6g %.6g %.6g %.6g\n"
+"%.6g %.6g %.6g %.6g\n%.6g %.6g %.6g %.6g\n";
+
+
+struct benchParticle
+{
+  unsigned shape;
+  double   m[4][4];
+  double   mt[4][4];
+};
+
+
+//! A random rotation, scale and translation, and the same moved by a
+//! velocity, like the particle matrices.
+static void make_particle( benchRandom& rnd, benchParticle& p )
+{
+   p.shape = rnd.bits32() % kNumShapes;
+
+   double a = rnd.uniform() * 6.2831853, b = rnd.uniform() * 6.2831853;
+   double s = 0.5 + rnd.uniform();
+   double ca = cos(a), sa = sin(a), cb = cos(b), sb = sin(b);
+   double r[3][3] = {
+   {  ca * s,       sa * s,      0 },
+   { -sa * cb * s,  ca * cb * s, sb * s },
+   {  sa * sb * s, -ca * sb * s, cb * s }
+   };
+   memset( p.m, 0, sizeof(p.m) );
+   for ( int i = 0; i < 3; ++i )
+      for ( int j = 0; j < 3; ++j )
+	 p.m[i][j] = r[i][j];
+   p.m[3][0] = ( rnd.uniform() - 0.5 ) * 200.0;
+   p.m[3][1] = ( rnd.uniform() - 0.5 ) * 200.0;
+   p.m[3][2] = ( rnd.uniform() - 0.5 ) * 200.0;
+   p.m[3][3] = 1.0;
+
+   memcpy( p.mt, p.m, sizeof(p.m) );
+   p.mt[3][0] -= rnd.uniform() * 0.5;
+   p.mt[3][1] -= rnd.uniform() * 0.5;
+   p.mt[3][2] -= rnd.uniform() * 0.5;
+}
+
+
+static void write_matrix( mrlFile* f, const double m[4][4] )
+{
+   mrl_fprintf( f, kMatrixSpec,
+		m[0][0], m[0][1], m[0][2], m[0][3],
+		m[1][0], m[1][1], m[1][2], m[1][3],
+		m[2][0], m[2][1], m[2][2], m[2][3],
+		m[3][0], m[3][1], m[3][2], m[3][3] );
+}
+
+
+//! What mrParticlesInstancer::write() spits without the stream: one
+//! instance per particle and the instgroup of all of them.
+static void write_mi( mrlFile* f, const std::vector< benchParticle >& parts,
+		      bool mb )
+{
+   char pId[32];
+   unsigned num = (unsigned) parts.size();
+   for ( unsigned i = 0; i < num; ++i )
+   {
+      const benchParticle& p = parts[i];
+      sprintf( pId, "|%07X", i );
+      mrl_fprintf( f, "instance \"%s%s\" \"%s\"\n", kInstancer, pId,
+		   kShapes[p.shape] );
+      f->puts( "\ttransform\n" );
+      write_matrix( f, p.m );
+      if ( mb )
+      {
+	 f->puts( "\tmotion transform\n" );
+	 write_matrix( f, p.mt );
+      }
+      mrl_fprintf( f, "\tmaterial [\"%s\"]\n", kMaterial );
+      f->puts( "end instance\n" );
+      f->putc( '\n' );
+   }
+
+   mrl_fprintf( f, "instgroup \"%sGrp\"\n", kInstancer );
+   for ( unsigned i = 0; i < num; ++i )
+   {
+      sprintf( pId, "|%07X", i );
+      mrl_fprintf( f, "\"%s%s\"\n", kInstancer, pId );
+   }
+   f->puts( "end instgroup\n" );
+   f->putc( '\n' );
+}
+
+
+//! What mrParticlesInstancer::open_stream() and write() save with
+//! exportInstancerStream on.
+static void write_stream( mrlFile* f,
+			  const std::vector< benchParticle >& parts, bool mb )
+{
+   mrInstancerHeader h;
+   memcpy( h.magic, MRL_INSTANCER_MAGIC, 4 );
+   h.version    = MRL_INSTANCER_VERSION;
+   h.endian     = 1;
+   h.flags      = mb ? kInstancerMotion : 0;
+   h.numObjects = kNumShapes;
+   h.count      = (unsigned) parts.size();
+
+   std::string names( kInstancer, strlen( kInstancer ) + 1 );
+   for ( unsigned i = 0; i < kNumShapes; ++i )
+      names.append( kShapes[i], strlen( kShapes[i] ) + 1 );
+   names.resize( ( names.size() + 3 ) & ~3, '\0' );
+   h.namesSize = (unsigned) names.size();
+
+   f->write( &h, sizeof(h), 1 );
+   f->write( names.data(), 1, names.size() );
+
+   unsigned num = h.count;
+   for ( unsigned i = 0; i < num; ++i )
+   {
+      const benchParticle& p = parts[i];
+      unsigned ids[2] = { p.shape, i };
+      float matrices[32];
+      unsigned n = 16;
+      for ( unsigned r = 0; r < 4; ++r )
+	 for ( unsigned c = 0; c < 4; ++c )
+	    matrices[r*4+c] = (float) p.m[r][c];
+      if ( mb )
+      {
+	 for ( unsigned r = 0; r < 4; ++r )
+	    for ( unsigned c = 0; c < 4; ++c )
+	       matrices[16+r*4+c] = (float) p.mt[r][c];
+	 n = 32;
+      }
+      f->write( ids, sizeof(unsigned), 2 );
+      f->write( matrices, sizeof(float), n );
+   }
+}
+
+
+static double file_size( const std::string& name )
+{
+   FILE* f = fopen( name.c_str(), "rb" );
+   if ( !f ) return -1;
+   fseek( f, 0, SEEK_END );
+   double size = (double) ftell( f );
+   fclose( f );
+   return size;
+}
+
+
+int main( int argc, char** argv )
+{
+   size_t n = argc > 1 ? (size_t) atol( argv[1] ) : 1000000;
+   std::string dir = argc > 2 ? argv[2] : ".";
+   bool mb = argc > 3 ? atoi( argv[3] ) != 0 : true;
+   if ( n < 1 ) n = 1;
+
+   benchRandom rnd;
+   std::vector< benchParticle > parts( n );
+   for ( size_t i = 0; i < n; ++i )
+      make_particle( rnd, parts[i] );
+
+   std::string miName  = dir + "/mrInstancerStreamBench.mi";
+   std::string mriName = dir + "/mrInstancerStreamBench.mri";
+
+   double t = bench_time();
+   mrlFile* f = mrlFile::open( miName.c_str(), "wb" );
+   if ( !f ) { printf( "ERROR: could not open %s\n", miName.c_str() ); return 1; }
+   write_mi( f, parts, mb );
+   mrlFile::close( f );
+   double tMi = bench_time() - t;
+   double sMi = file_size( miName );
+
+   t = bench_time();
+   f = mrlFile::open( mriName.c_str(), "wb" );
+   if ( !f ) { printf( "ERROR: could not open %s\n", mriName.c_str() ); return 1; }
+   write_stream( f, parts, mb );
+   mrlFile::close( f );
+   double tStream = bench_time() - t;
+   double sStream = file_size( mriName );
+
+   remove( miName.c_str() );
+   remove( mriName.c_str() );
+
+   unsigned stride = mrInstancerStride( mb ? kInstancerMotion : 0 );
+   printf( "%lu particles, motion blur %s, %u byte records\n",
+	   (unsigned long) n, mb ? "on" : "off", stride );
+   bench_report( "mi instances", "write", n, tMi );
+   bench_report( "instancer stream", "write", n, tStream );
+   printf( "%-24s %10.1f Mb %8.1f bytes/particle\n", "mi instances",
+	   sMi / (1024.0 * 1024.0), sMi / (double) n );
+   printf( "%-24s %10.1f Mb %8.1f bytes/particle\n", "instancer stream",
+	   sStream / (1024.0 * 1024.0), sStream / (double) n );
+   return 0;
+}
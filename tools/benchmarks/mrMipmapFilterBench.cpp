@@ -0,0 +1,550 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+
+
+//
+// Scalar and SSE2 versions of the filter kernels of mrl_exr_file
+// (shaders/mrlTextureFilter.h), run side by side over an in-memory half
+// float mipmap of a zone plate, a checker and noise:
+//
+//   halfToFloat - mrlHalfToFloat*() of texels
+//   blur        - mrlBlur*(), bilinear lookups at random levels
+//   ewa         - mrlEwa*(), elliptical lookups of footprints 1-96
+//                 texels wide and up to 6 times as long, at the level
+//                 mrlEwaLevel() picks for them
+//
+// Each is checked against a double precision version of what it
+// computes: exact half conversion, bilinear interpolation of the exact
+// texels, and EWA of the exact texels with exact gaussian weights (so the
+// error of ewa includes that of its weight table).  "max diff" is the
+// largest difference between the scalar and SSE2 results of the same
+// lookups.
+//
+// Usage:
+//
+// mrMipmapFilterBench [N] [size]
+//
+// N     number of texels converted and blur lookups timed, ewa does N/50
+//       (default 2000000)
+// size  width and height of the image, a power of 2 (default 1024)
+//
+
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "benchTimer.h"
+#include "shaders/mrlTextureFilter.h"
+
+
+struct benchColor
+{
+  float r, g, b, a;
+};
+
+struct benchColorD
+{
+  double r, g, b, a;
+};
+
+
+//! Exact value of a half, given as its bits
+static double bench_half_value( const unsigned short h )
+{
+  int e = ( h >> 10 ) & 0x1f;
+  int m = h & 0x3ff;
+  double v;
+  if ( e == 31 )     v = m ? std::numeric_limits<double>::quiet_NaN() :
+			       std::numeric_limits<double>::infinity();
+  else if ( e == 0 ) v = ldexp( (double) m, -24 );
+  else               v = ldexp( (double) ( m | 0x400 ), e - 25 );
+  return ( h & 0x8000 ) ? -v : v;
+}
+
+//! Nearest half of a float in [0, 65504], as bits
+static unsigned short bench_to_half( const float f )
+{
+  if ( f < ldexp( 1.0, -24 ) ) return 0;
+  int e;
+  double m = frexp( (double) f, &e );   // f = m * 2^e, m in [0.5, 1)
+  if ( e < -13 )
+    {
+      // denormal
+      return (unsigned short) floor( ldexp( (double) f, 24 ) + 0.5 );
+    }
+  unsigned bits = (unsigned) floor( ldexp( m, 11 ) + 0.5 );  // 1024..2048
+  if ( bits == 2048 ) { bits = 1024; ++e; }
+  return (unsigned short) ( ( ( e + 14 ) << 10 ) | ( bits & 0x3ff ) );
+}
+
+
+//! Mipmap of square levels of half rgba texels, each level half the size
+//! of the previous one, made with 2x2 box downsampling like a mipmapped
+//! EXR.
+class benchPyramid
+{
+public:
+  benchPyramid( const int size )
+  {
+    int w = size;
+    std::vector< float > p( w * w * 4 );
+
+    benchRandom rnd;
+    for ( int y = 0; y < w; ++y )
+      for ( int x = 0; x < w; ++x )
+	{
+	  float u = (float) x / w - 0.5f, v = (float) y / w - 0.5f;
+	  float* c = &p[ ( y * w + x ) * 4 ];
+	  c[0] = 0.5f + 0.5f * (float) cos( ( u * u + v * v ) * w * 3.0f );
+	  c[1] = ( ( x / 4 + y / 4 ) & 1 ) ? 1.0f : 0.0f;
+	  c[2] = rnd.uniform();
+	  c[3] = 1.0f;
+	}
+
+    for (;;)
+      {
+	std::vector< unsigned short > h( p.size() );
+	for ( size_t i = 0; i < p.size(); ++i )
+	  h[i] = bench_to_half( p[i] );
+	_levels.push_back( h );
+	_sizes.push_back( w );
+	if ( w == 1 ) break;
+
+	int n = w / 2;
+	std::vector< float > d( n * n * 4 );
+	for ( int y = 0; y < n; ++y )
+	  for ( int x = 0; x < n; ++x )
+	    for ( int k = 0; k < 4; ++k )
+	      d[ ( y * n + x ) * 4 + k ] = 
+		( p[ ( (2*y)   * w + 2*x   ) * 4 + k ] +
+		  p[ ( (2*y)   * w + 2*x+1 ) * 4 + k ] +
+		  p[ ( (2*y+1) * w + 2*x   ) * 4 + k ] +
+		  p[ ( (2*y+1) * w + 2*x+1 ) * 4 + k ] ) * 0.25f;
+	p.swap( d );
+	w = n;
+      }
+  }
+
+  int numLevels() const { return (int) _levels.size(); }
+  int size( const int l ) const { return _sizes[l]; }
+
+  //! Texel of a level as half bits, clamped to its edges
+  const unsigned short* texel( int x, int y, const int l ) const
+  {
+    int d = _sizes[l];
+    if ( x < 0 ) x = 0; else if ( x >= d ) x = d - 1;
+    if ( y < 0 ) y = 0; else if ( y >= d ) y = d - 1;
+    return &_levels[l][ ( y * d + x ) * 4 ];
+  }
+
+  //! Exact texel of a level
+  void texel( benchColorD& c, const int x, const int y, const int l ) const
+  {
+    const unsigned short* h = texel( x, y, l );
+    c.r = bench_half_value( h[0] );
+    c.g = bench_half_value( h[1] );
+    c.b = bench_half_value( h[2] );
+    c.a = bench_half_value( h[3] );
+  }
+
+  //! Bilinear lookup of exact texels, as mrlBlur() does it
+  void blur( benchColorD& c, const float s, const float t,
+	     const int l ) const
+  {
+    int d = _sizes[l];
+    double ds = (double) s * d - 0.5;
+    double dt = (double) t * d - 0.5;
+    int x = (int) floor( ds );
+    int y = (int) floor( dt );
+    ds -= x;
+    dt -= y;
+
+    benchColorD t0, t1, t2, t3;
+    texel( t0, x,   y,   l );
+    texel( t1, x,   y+1, l );
+    texel( t2, x+1, y,   l );
+    texel( t3, x+1, y+1, l );
+    c.r = ( t0.r * (1-dt) + t1.r * dt ) * (1-ds) + ( t2.r * (1-dt) + t3.r * dt ) * ds;
+    c.g = ( t0.g * (1-dt) + t1.g * dt ) * (1-ds) + ( t2.g * (1-dt) + t3.g * dt ) * ds;
+    c.b = ( t0.b * (1-dt) + t1.b * dt ) * (1-ds) + ( t2.b * (1-dt) + t3.b * dt ) * ds;
+    c.a = ( t0.a * (1-dt) + t1.a * dt ) * (1-ds) + ( t2.a * (1-dt) + t3.a * dt ) * ds;
+  }
+
+  //! EWA of exact texels with exact weights, over the same ellipse
+  void ewa( benchColorD& c, const mrlEllipse& e, const int l ) const
+  {
+    int d = _sizes[l];
+    double den = 0;
+    c.r = c.g = c.b = c.a = 0;
+    for ( int v = e.v0; v <= e.v1; ++v )
+      for ( int u = e.u0; u <= e.u1; ++u )
+	{
+	  double U = u - (double) e.s, V = v - (double) e.t;
+	  double r2 = e.A * U * U + e.B * U * V + e.C * V * V;
+	  if ( r2 >= 1.0 ) continue;
+	  double w = exp( -2.0 * r2 );
+	  benchColorD x;
+	  texel( x, mrlMod( u, d ), mrlMod( v, d ), l );
+	  c.r += x.r * w; c.g += x.g * w; c.b += x.b * w; c.a += x.a * w;
+	  den += w;
+	}
+    if ( den > 0 )
+      {
+	c.r /= den; c.g /= den; c.b /= den; c.a /= den;
+      }
+  }
+
+private:
+  std::vector< std::vector< unsigned short > > _levels;
+  std::vector< int > _sizes;
+};
+
+
+//
+// The two versions of the kernels
+//
+
+struct benchScalar
+{
+  static const char* name() { return "scalar"; }
+
+  template< class C >
+  static void halfToFloat( C& c, const void* rgba )
+  {
+    mrlHalfToFloatScalar( c, rgba );
+  }
+
+  template< class C, class F >
+  static void blur( C& c, F& f, const float s, const float t,
+		    const int dw, const int dh )
+  {
+    mrlBlurScalar( c, f, s, t, dw, dh );
+  }
+
+  template< class C, class F >
+  static void ewa( C& c, F& f, const mrlEllipse& e,
+		   const int dw, const int dh, const float* lut )
+  {
+    mrlEwaScalar( c, f, e, dw, dh, lut );
+  }
+};
+
+#ifdef MRL_SSE2
+struct benchSSE2
+{
+  static const char* name() { return "sse2"; }
+
+  template< class C >
+  static void halfToFloat( C& c, const void* rgba )
+  {
+    mrlHalfToFloatSSE2( c, rgba );
+  }
+
+  template< class C, class F >
+  static void blur( C& c, F& f, const float s, const float t,
+		    const int dw, const int dh )
+  {
+    mrlBlurSSE2( c, f, s, t, dw, dh );
+  }
+
+  template< class C, class F >
+  static void ewa( C& c, F& f, const mrlEllipse& e,
+		   const int dw, const int dh, const float* lut )
+  {
+    mrlEwaSSE2( c, f, e, dw, dh, lut );
+  }
+};
+#endif
+
+
+//! Texel fetch of a level, converting halfs with the kernels K like the
+//! shader's exrTexture::read().
+template< class K >
+struct benchFetch
+{
+  const benchPyramid& pyr;
+  int l;
+
+  benchFetch( const benchPyramid& p, const int level ) : pyr( p ), l( level )
+  {
+  }
+
+  void texel( benchColor& c, const int x, const int y )
+  {
+    K::halfToFloat( c, pyr.texel( x, y, l ) );
+  }
+
+  void texel4( benchColor c[4], const int x, const int y )
+  {
+    K::halfToFloat( c[0], pyr.texel( x,   y,   l ) );
+    K::halfToFloat( c[1], pyr.texel( x,   y+1, l ) );
+    K::halfToFloat( c[2], pyr.texel( x+1, y,   l ) );
+    K::halfToFloat( c[3], pyr.texel( x+1, y+1, l ) );
+  }
+};
+
+
+struct benchLookup
+{
+  float s, t;
+  int   level;
+  mrlEllipse e;
+};
+
+//! Results of a version of the kernels
+struct benchResults
+{
+  std::vector< benchColor > half, blur, ewa;
+  double tHalf, tBlur, tEwa;
+};
+
+
+template< class K >
+static void bench_run( benchResults& res, const benchPyramid& pyr,
+		       const std::vector< benchLookup >& lookups,
+		       const size_t numEwa, const float* lut )
+{
+  const size_t n = lookups.size();
+  const int size = pyr.size( 0 );
+
+  // All 65536 halfs, then texels of level 0 for timing
+  res.half.resize( 16384 );
+  for ( unsigned i = 0; i < 16384; ++i )
+    {
+      unsigned short h[4];
+      for ( unsigned k = 0; k < 4; ++k ) h[k] = (unsigned short) ( i * 4 + k );
+      K::halfToFloat( res.half[i], h );
+    }
+
+  const unsigned short* texels = pyr.texel( 0, 0, 0 );
+  const size_t numTexels = (size_t) size * size;
+  float sum = 0.0f;
+  double t = bench_time();
+  for ( size_t i = 0, j = 0; i < n; ++i )
+    {
+      benchColor c;
+      K::halfToFloat( c, texels + j * 4 );
+      sum += c.r;
+      if ( ++j == numTexels ) j = 0;
+    }
+  res.tHalf = bench_time() - t;
+
+  res.blur.resize( n );
+  t = bench_time();
+  for ( size_t i = 0; i < n; ++i )
+    {
+      const benchLookup& x = lookups[i];
+      benchFetch< K > fetch( pyr, x.level );
+      int d = pyr.size( x.level );
+      K::blur( res.blur[i], fetch, x.s, x.t, d, d );
+    }
+  res.tBlur = bench_time() - t;
+
+  res.ewa.resize( numEwa );
+  t = bench_time();
+  for ( size_t i = 0; i < numEwa; ++i )
+    {
+      const benchLookup& x = lookups[i];
+      benchFetch< K > fetch( pyr, x.level );
+      int d = pyr.size( x.level );
+      K::ewa( res.ewa[i], fetch, x.e, d, d, lut );
+    }
+  res.tEwa = bench_time() - t;
+
+  if ( sum == 12345.0f ) printf( "(checksum)\n" );
+}
+
+
+//! Largest and rms differences over r, g, b and a
+struct benchError
+{
+  double max, sum;
+  size_t n;
+
+  benchError() : max( 0 ), sum( 0 ), n( 0 ) {}
+
+  void add( const double a, const double b )
+  {
+    double d = fabs( a - b );
+    if ( a != a && b != b ) d = 0;       // both nan
+    else if ( a == b )      d = 0;       // both the same infinity
+    else if ( d != d )      d = HUGE_VAL;
+    if ( d > max ) max = d;
+    sum += d * d;
+    ++n;
+  }
+  void add( const benchColor& a, const benchColorD& b )
+  {
+    add( a.r, b.r ); add( a.g, b.g ); add( a.b, b.b ); add( a.a, b.a );
+  }
+  void add( const benchColor& a, const benchColor& b )
+  {
+    add( a.r, b.r ); add( a.g, b.g ); add( a.b, b.b ); add( a.a, b.a );
+  }
+  double rms() const { return n ? sqrt( sum / n ) : 0.0; }
+};
+
+
+static void bench_print( const char* kernel, const char* version,
+			 const benchError& err, const benchError* diff )
+{
+  printf( "%-12s %-8s %12.3g %12.3g", kernel, version, err.max, err.rms() );
+  if ( diff ) printf( " %12.3g", diff->max );
+  printf( "\n" );
+}
+
+
+static void bench_check( const char* name, const benchResults& res,
+			 const benchResults* other, const benchPyramid& pyr,
+			 const std::vector< benchLookup >& lookups )
+{
+  benchError err, diff;
+  for ( unsigned i = 0; i < 16384; ++i )
+    {
+      benchColorD x;
+      x.r = bench_half_value( (unsigned short) ( i * 4 ) );
+      x.g = bench_half_value( (unsigned short) ( i * 4 + 1 ) );
+      x.b = bench_half_value( (unsigned short) ( i * 4 + 2 ) );
+      x.a = bench_half_value( (unsigned short) ( i * 4 + 3 ) );
+      err.add( res.half[i], x );
+      if ( other ) diff.add( res.half[i], other->half[i] );
+    }
+  bench_print( "halfToFloat", name, err, other ? &diff : NULL );
+
+  err = diff = benchError();
+  for ( size_t i = 0; i < res.blur.size(); ++i )
+    {
+      benchColorD x;
+      pyr.blur( x, lookups[i].s, lookups[i].t, lookups[i].level );
+      err.add( res.blur[i], x );
+      if ( other ) diff.add( res.blur[i], other->blur[i] );
+    }
+  bench_print( "blur", name, err, other ? &diff : NULL );
+
+  err = diff = benchError();
+  for ( size_t i = 0; i < res.ewa.size(); ++i )
+    {
+      benchColorD x;
+      pyr.ewa( x, lookups[i].e, lookups[i].level );
+      err.add( res.ewa[i], x );
+      if ( other ) diff.add( res.ewa[i], other->ewa[i] );
+    }
+  bench_print( "ewa", name, err, other ? &diff : NULL );
+}
+
+
+int main( int argc, char** argv )
+{
+  size_t n    = argc > 1 ? (size_t) atol( argv[1] ) : 2000000;
+  int    size = argc > 2 ? atoi( argv[2] ) : 1024;
+  if ( n < 1000 ) n = 1000;
+  if ( size < 16 ) size = 16;
+
+  benchPyramid pyr( size );
+
+  float lut[ WEIGHT_LUT_SIZE ];
+  mrlWeightLutInit( lut );
+
+  // Lookups anywhere, with footprints whose minor axis is 1-96 texels of
+  // level 0 and up to 6 times as long, at any angle.  Blur and ewa both
+  // look them up at the level mrlEwaLevel() picks, where the minor axis
+  // should be 3-6 texels long.
+  benchRandom rnd;
+  std::vector< benchLookup > lookups( n );
+  size_t badLevels = 0;
+  for ( size_t i = 0; i < n; ++i )
+    {
+      benchLookup& x = lookups[i];
+      x.s = rnd.uniform();
+      x.t = rnd.uniform();
+
+      float minor = powf( 96.0f, rnd.uniform() );
+      float major = minor * ( 1.0f + 5.0f * rnd.uniform() );
+      float angle = rnd.uniform() * 3.14159265f;
+      float ca = cosf( angle ), sa = sinf( angle );
+      float dsdx =  major * ca / size, dtdx = major * sa / size;
+      float dsdy = -minor * sa / size, dtdy = minor * ca / size;
+
+      float lod = mrlEwaLevel( dsdx, dtdx, dsdy, dtdy, size, size, 1.0f );
+      x.level = lod < 0.0f ? 0 : (int) lod;
+      if ( x.level > pyr.numLevels() - 1 ) x.level = pyr.numLevels() - 1;
+
+      float texels = minor / (float) ( 1 << x.level );
+      if ( x.level > 0 && ( texels < 2.999f || texels > 6.001f ) )
+	++badLevels;
+
+      int d = pyr.size( x.level );
+      mrlEllipseSetup( x.e, x.s, x.t, dsdx, dtdx, dsdy, dtdy, d, d );
+    }
+  size_t numEwa = n / 50;
+
+  printf( "%dx%d image, %d levels, %lu texels and blur lookups, "
+	  "%lu ewa lookups\n\n", size, size, pyr.numLevels(),
+	  (unsigned long) n, (unsigned long) numEwa );
+
+  benchResults scalar;
+  bench_run< benchScalar >( scalar, pyr, lookups, numEwa, lut );
+#ifdef MRL_SSE2
+  benchResults sse2;
+  bench_run< benchSSE2 >( sse2, pyr, lookups, numEwa, lut );
+#endif
+
+  printf( "%-12s %-8s %12s %12s %12s\n", "kernel", "version", 
+	  "max error", "rms error", "max diff" );
+  bench_check( benchScalar::name(), scalar, NULL, pyr, lookups );
+#ifdef MRL_SSE2
+  bench_check( benchSSE2::name(), sse2, &scalar, pyr, lookups );
+#else
+  printf( "(no SSE2 version: built without MR_SSE or SSE2)\n" );
+#endif
+  printf( "\n" );
+
+  bench_report( "halfToFloat, scalar", "texel", n, scalar.tHalf );
+#ifdef MRL_SSE2
+  bench_report( "halfToFloat, sse2", "texel", n, sse2.tHalf );
+#endif
+  bench_report( "blur, scalar", "lookup", n, scalar.tBlur );
+#ifdef MRL_SSE2
+  bench_report( "blur, sse2", "lookup", n, sse2.tBlur );
+#endif
+  bench_report( "ewa, scalar", "lookup", numEwa, scalar.tEwa );
+#ifdef MRL_SSE2
+  bench_report( "ewa, sse2", "lookup", numEwa, sse2.tEwa );
+#endif
+
+  printf( "\n%lu lookups at a level where the minor axis is not 3-6 "
+	  "texels long\n", (unsigned long) badLevels );
+  return badLevels ? 1 : 0;
+}
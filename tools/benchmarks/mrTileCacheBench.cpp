@@ -0,0 +1,441 @@
+//
+//  Copyright (c) 2004, Gonzalo Garramuno
+//
+//  All rights reserved.
+//
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  *       Redistributions of source code must retain the above copyright
+//  notice, this list of conditions and the following disclaimer.
+//  *       Redistributions in binary form must reproduce the above
+//  copyright notice, this list of conditions and the following disclaimer
+//  in the documentation and/or other materials provided with the
+//  distribution.
+//  *       Neither the name of Gonzalo Garramuno nor the names of
+//  its other contributors may be used to endorse or promote products derived
+//  from this software without specific prior written permission. 
+//
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+
+
+
+//
+// Benchmark of mrl_exr_file's texture cache (mrlTextureCache.h): tile
+// lookups with mrlTiledTexture::tileSlot() and acquire()/release(), over
+// a tiled, mipmapped EXR file generated for the test.
+//
+// The cache is built from the shader's own sources.  Only the reading of
+// a tile is done here, as the shader's version of it needs mental ray.
+// Each pass is run with 1, 2, 4... up to the given number of threads:
+//
+//   tileSlot  - finding the tile table entry alone
+//   hot       - acquire() with every tile in memory, so all lookups hit
+//   cold      - acquire() on an empty cache.  Threads missing on the
+//               same tile wait for the one reading it, so each tile
+//               must be read once at most.
+//   evicting  - acquire() with room for a quarter of the tiles, so the
+//               clock hand keeps releasing blocks while threads read
+//               them.  N / 16 lookups per thread, as most miss.
+//
+// Every texel read by the hot, cold and evicting passes is checked
+// against the image written, so a block released while in use shows up
+// as an error.
+//
+// Usage:
+//
+// mrTileCacheBench [N] [threads] [size] [tile]
+//
+// N       lookups per thread (default 2000000)
+// threads maximum number of threads (default 8)
+// size    width and height of the image (default 4096)
+// tile    tile width and height (default 64)
+//
+
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+
+#if defined(WIN32) || defined(WIN64)
+#  include <process.h>
+#endif
+
+#include "shaders/mrlTextureCache.h"
+
+#include "ImfRgba.h"
+#include "ImfTiledRgbaFile.h"
+
+#include "benchTimer.h"
+
+
+//! A texture of the cache read from a tiled EXR file.  Files are kept in
+//! a pool, so each thread reading a tile has one of its own.
+class benchTexture : public mrlTiledTexture
+{
+public:
+  benchTexture( const char* filename ) :
+    _filename( filename ),
+    _reads( 0 )
+  {
+    mrl_mutex_init( _filesLock );
+
+    Imf::TiledRgbaInputFile* in = new Imf::TiledRgbaInputFile( filename );
+    _tileXSize  = in->tileXSize();
+    _tileYSize  = in->tileYSize();
+    _numXLevels = in->numXLevels();
+    _numYLevels = in->numYLevels();
+    _numXTiles.resize( _numXLevels );
+    for ( unsigned i = 0; i < _numXLevels; ++i )
+      _numXTiles[i] = in->numXTiles( i );
+    _numYTiles.resize( _numYLevels );
+    for ( unsigned i = 0; i < _numYLevels; ++i )
+      _numYTiles[i] = in->numYTiles( i );
+    _files.push_back( in );
+
+    initTiles( sizeof( Imf::Rgba ) );
+  }
+
+  ~benchTexture()
+  {
+    for ( size_t i = 0; i < _files.size(); ++i )
+      delete _files[i];
+    mrl_mutex_destroy( _filesLock );
+  }
+
+  //! Number of tiles read from the file
+  mrAtomic reads() const { return _reads; }
+
+protected:
+  virtual bool readTile( void* data, const int x, const int y,
+			 const int lx, const int ly )
+  {
+    MR_ATOMIC_INC( _reads );
+
+    mrl_lock( _filesLock );
+    Imf::TiledRgbaInputFile* in = NULL;
+    if ( !_files.empty() )
+      {
+	in = _files.back();
+	_files.pop_back();
+      }
+    mrl_unlock( _filesLock );
+
+    try
+      {
+	if ( in == NULL ) in = new Imf::TiledRgbaInputFile( _filename );
+
+	// Same frame buffer placement as exrTexture::readTile()
+	Imath::Box2i dw = in->dataWindowForLevel( lx, ly );
+	Imf::Rgba* pixels = static_cast< Imf::Rgba* >( data );
+	unsigned offset = dw.min.x + (x + y * _tileYSize + dw.min.y) * _tileXSize;
+	in->setFrameBuffer( pixels - offset, 1, _tileXSize );
+	in->readTile( x, y, lx, ly );
+      }
+    catch( const std::exception& e )
+      {
+	fprintf( stderr, "%s\n", e.what() );
+	return false;
+      }
+
+    mrl_lock( _filesLock );
+    _files.push_back( in );
+    mrl_unlock( _filesLock );
+    return true;
+  }
+
+  const char* _filename;
+  volatile mrAtomic _reads;
+  mrlMutex _filesLock;
+  std::vector< Imf::TiledRgbaInputFile* > _files;
+};
+
+
+//! A lookup: a random texel of a random level, picked up front so the
+//! random number generator is not timed.
+struct benchLookup
+{
+  int tileX, tileY, level;
+  int x, y;     //<- texel within the tile
+};
+
+enum benchMode
+{
+kTileSlot,
+kAcquire
+};
+
+struct benchThread
+{
+  benchTexture* txt;
+  const benchLookup* lookups;
+  size_t        num;
+  benchMode     mode;
+  const std::vector< int >* widths;  //<- width and height of each level
+  size_t        errors;
+  double        checksum;
+};
+
+
+static void bench_run( benchThread* t )
+{
+  benchTexture& txt = *t->txt;
+  const std::vector< int >& widths = *t->widths;
+  unsigned tileX = txt.tileXSize();
+  unsigned tileY = txt.tileYSize();
+  double sum = 0;
+  size_t errors = 0;
+  for ( size_t i = 0; i < t->num; ++i )
+    {
+      const benchLookup& l = t->lookups[i];
+      if ( t->mode == kTileSlot )
+	{
+	  sum += (double) (size_t) txt.tileSlot( l.tileX, l.tileY,
+						 l.level, l.level );
+	  continue;
+	}
+
+      mrlTextureBlock* b = txt.acquire( l.tileX, l.tileY, l.level, l.level );
+      if ( b == NULL ) { ++errors; continue; }
+
+      const Imf::Rgba& p = ((const Imf::Rgba*) b->data)[ l.y * tileX + l.x ];
+      float r = p.r, blue = p.b;
+      mrlTiledTexture::release( b );
+
+      // Texels past the edge of the level are not in the file
+      int w = widths[ l.level ];
+      int x = l.tileX * tileX + l.x;
+      int y = l.tileY * tileY + l.y;
+      if ( x >= w || y >= w ) continue;
+      if ( blue != (float) l.level || fabs( r - (float) x / w ) > 1e-3f )
+	++errors;
+      sum += r;
+    }
+  t->errors   = errors;
+  t->checksum = sum;
+}
+
+#if defined(WIN32) || defined(WIN64)
+static unsigned __stdcall bench_thread( void* data )
+{
+  bench_run( (benchThread*) data );
+  return 0;
+}
+#else
+extern "C" void* bench_thread( void* data )
+{
+  bench_run( (benchThread*) data );
+  return NULL;
+}
+#endif
+
+
+//! Time num lookups on each of numThreads threads.  Returns the time
+//! taken, and adds the texels that were wrong to errors.
+static double bench_threads( benchTexture& txt,
+			     const std::vector< benchLookup >& lookups,
+			     const std::vector< int >& widths,
+			     const unsigned numThreads, const size_t num,
+			     const benchMode mode, size_t& errors )
+{
+  std::vector< benchThread > t( numThreads );
+  for ( unsigned i = 0; i < numThreads; ++i )
+    {
+      t[i].txt  = &txt;
+      t[i].lookups = &lookups[ (i * 7919) % ( lookups.size() - num + 1 ) ];
+      t[i].num  = num;
+      t[i].mode = mode;
+      t[i].widths = &widths;
+      t[i].errors = 0;
+      t[i].checksum = 0;
+    }
+
+  double start = bench_time();
+#if defined(WIN32) || defined(WIN64)
+  std::vector< HANDLE > h( numThreads );
+  for ( unsigned i = 0; i < numThreads; ++i )
+    h[i] = (HANDLE) _beginthreadex( NULL, 0, bench_thread, &t[i], 0, NULL );
+  for ( unsigned i = 0; i < numThreads; ++i )
+    {
+      WaitForSingleObject( h[i], INFINITE );
+      CloseHandle( h[i] );
+    }
+#else
+  std::vector< pthread_t > h( numThreads );
+  for ( unsigned i = 0; i < numThreads; ++i )
+    pthread_create( &h[i], NULL, bench_thread, &t[i] );
+  for ( unsigned i = 0; i < numThreads; ++i )
+    pthread_join( h[i], NULL );
+#endif
+  double secs = bench_time() - start;
+
+  for ( unsigned i = 0; i < numThreads; ++i )
+    errors += t[i].errors;
+  return secs;
+}
+
+
+//! Write a tiled, mipmapped image.  Red is x / width of the level and
+//! blue the level, so lookups can check what they read.
+static void bench_write_exr( const char* filename, const int size,
+			     const int tile )
+{
+  Imf::TiledRgbaOutputFile out( filename, size, size, tile, tile,
+				Imf::MIPMAP_LEVELS, Imf::ROUND_DOWN );
+  std::vector< Imf::Rgba > pixels( size * size );
+  for ( int l = 0; l < out.numLevels(); ++l )
+    {
+      int w = out.levelWidth( l ), h = out.levelHeight( l );
+      for ( int y = 0; y < h; ++y )
+	for ( int x = 0; x < w; ++x )
+	  {
+	    Imf::Rgba& p = pixels[ y * w + x ];
+	    p.r = (float) x / w;
+	    p.g = (float) y / h;
+	    p.b = (float) l;
+	    p.a = 1.0f;
+	  }
+      out.setFrameBuffer( &pixels[0], 1, w );
+      out.writeTiles( 0, out.numXTiles( l ) - 1, 0, out.numYTiles( l ) - 1,
+		      l );
+    }
+}
+
+
+static void bench_print_stats( const benchTexture& txt, const size_t errors )
+{
+  mrlTextureCacheStats s;
+  memset( &s, 0, sizeof(s) );
+  textureCacheGather( s );
+  printf( "%26s %lu hits, %lu misses, %lu evictions, %lu tiles read, "
+	  "%lu errors\n", "", s.hits, s.misses, s.evictions,
+	  (unsigned long) txt.reads(), (unsigned long) errors );
+}
+
+
+int main( int argc, char** argv )
+{
+  size_t   n          = argc > 1 ? (size_t) atol( argv[1] ) : 2000000;
+  unsigned maxThreads = argc > 2 ? (unsigned) atoi( argv[2] ) : 8;
+  int      size       = argc > 3 ? atoi( argv[3] ) : 4096;
+  int      tile       = argc > 4 ? atoi( argv[4] ) : 64;
+  if ( n < 1000 ) n = 1000;
+  if ( maxThreads < 1 ) maxThreads = 1;
+
+  const char* filename = "mrTileCacheBench.exr";
+  bench_write_exr( filename, size, tile );
+
+  Imf::TiledRgbaInputFile in( filename );
+  int numLevels = in.numLevels();
+  std::vector< int > widths( numLevels );
+  size_t numTiles = 0;
+  for ( int l = 0; l < numLevels; ++l )
+    {
+      widths[l] = in.levelWidth( l );
+      numTiles += in.numXTiles( l ) * in.numYTiles( l );
+    }
+  unsigned tileBytes = tile * tile * sizeof( Imf::Rgba );
+
+  // Lookups mostly on the finer levels, as when rendering
+  benchRandom rnd;
+  std::vector< benchLookup > lookups( n + 8192 );
+  for ( size_t i = 0; i < lookups.size(); ++i )
+    {
+      benchLookup& l = lookups[i];
+      unsigned r = rnd.bits32();
+      l.level = 0;
+      while ( l.level < numLevels - 1 && ( r & 1 ) ) { ++l.level; r >>= 1; }
+      l.tileX = rnd.bits32() % in.numXTiles( l.level );
+      l.tileY = rnd.bits32() % in.numYTiles( l.level );
+      l.x = rnd.bits32() % tile;
+      l.y = rnd.bits32() % tile;
+    }
+
+  printf( "%dx%d image, %dx%d tiles, %d levels, %lu tiles\n",
+	  size, size, tile, tile, numLevels, (unsigned long) numTiles );
+
+  size_t errors = 0;
+  bool   readTwice = false;
+  for ( unsigned numThreads = 1; ; numThreads *= 2 )
+    {
+      if ( numThreads > maxThreads ) numThreads = maxThreads;
+      size_t total = n * numThreads;
+      printf( "\n%u threads\n", numThreads );
+
+      // Room for all tiles.  Tiles do not spread evenly over the shards,
+      // so leave each shard plenty of room.
+      textureCacheInit( (unsigned) ( 4 * numTiles + kNumShards ) * tileBytes );
+      {
+	benchTexture txt( filename );
+	for ( int l = 0; l < numLevels; ++l )
+	  for ( unsigned y = 0; y < txt.numYTiles( l ); ++y )
+	    for ( unsigned x = 0; x < txt.numXTiles( l ); ++x )
+	      txt.preload( x, y, l, l );
+	mrlTextureCacheStats s;
+	textureCacheGather( s );   // drop the preloads
+
+	size_t e = 0;
+	double t = bench_threads( txt, lookups, widths, numThreads, n,
+				  kTileSlot, e );
+	bench_report( "tileSlot", "lookup", total, t );
+	t = bench_threads( txt, lookups, widths, numThreads, n, kAcquire, e );
+	bench_report( "acquire, hot", "lookup", total, t );
+	bench_print_stats( txt, e );
+	errors += e;
+      }
+
+      {
+	benchTexture txt( filename );
+	size_t e = 0;
+	double t = bench_threads( txt, lookups, widths, numThreads, n,
+				  kAcquire, e );
+	bench_report( "acquire, cold", "lookup", total, t );
+	bench_print_stats( txt, e );
+	errors += e;
+	if ( (size_t) txt.reads() > numTiles ) readTwice = true;
+      }
+
+      // Room for a quarter of the tiles.  Most lookups miss, so do
+      // fewer of them.
+      textureCacheInit( (unsigned) ( numTiles / 4 ) * tileBytes );
+      {
+	benchTexture txt( filename );
+	size_t e = 0;
+	double t = bench_threads( txt, lookups, widths, numThreads, n / 16,
+				  kAcquire, e );
+	bench_report( "acquire, evicting", "lookup", total / 16, t );
+	bench_print_stats( txt, e );
+	errors += e;
+      }
+
+      if ( numThreads == maxThreads ) break;
+    }
+  textureCacheShutdown();
+
+  remove( filename );
+
+  if ( readTwice )
+    {
+      printf( "ERROR: tiles read more than once on an empty cache\n" );
+      return 1;
+    }
+  if ( errors )
+    {
+      printf( "ERROR: %lu lookups read the wrong texels\n",
+	      (unsigned long) errors );
+      return 1;
+    }
+  return 0;
+}